@@ -15,12 +15,18 @@
 static struct device *dev;
 static double accel_offset[3];
 
+/* Samples are accumulated in micro m/s^2, and converted once. */
+static s64_t sensor_value_to_micro(const struct sensor_value *val)
+{
+	return (s64_t)val->val1 * 1000000 + val->val2;
+}
+
 int orientation_detector_poll(
 	struct orientation_detector_sensor_data *sensor_data)
 {
 	int err;
 	u8_t i;
-	double aggregated_data[3] = {0};
+	s64_t aggregated_data[3] = {0};
 	struct sensor_value accel_data[3];
 	enum orientation_state current_orientation;
 
@@ -48,10 +54,11 @@ int orientation_detector_poll(
 			return err;
 		}
 
-		aggregated_data[2] += sensor_value_to_double(&accel_data[2]);
+		aggregated_data[2] += sensor_value_to_micro(&accel_data[2]);
 	}
 
-	sensor_data->z = (aggregated_data[2] / (double)MEASUREMENT_ITERATIONS) -
+	sensor_data->z = (aggregated_data[2] /
+			  (1000000.0 * MEASUREMENT_ITERATIONS)) -
 				accel_offset[2];
 
 	if (sensor_data->z >= FLIP_ACCELERATION_THRESHOLD) {
@@ -80,7 +87,7 @@ int orientation_detector_calibrate(void)
 	u8_t i;
 	int err;
 	struct sensor_value accel_data[3];
-	double aggregated_data[3] = {0};
+	s64_t aggregated_data[3] = {0};
 
 	for (i = 0; i < CALIBRATION_ITERATIONS; i++) {
 		err = sensor_sample_fetch(dev);
@@ -101,16 +108,16 @@ int orientation_detector_calibrate(void)
 			return err;
 		}
 
-		aggregated_data[0] += sensor_value_to_double(&accel_data[0]);
-		aggregated_data[1] += sensor_value_to_double(&accel_data[1]);
-		aggregated_data[2] +=
-			(sensor_value_to_double(&accel_data[2])
-			+ ((double)SENSOR_G) / 1000000.0);
+		aggregated_data[0] += sensor_value_to_micro(&accel_data[0]);
+		aggregated_data[1] += sensor_value_to_micro(&accel_data[1]);
+		aggregated_data[2] += sensor_value_to_micro(&accel_data[2]) +
+				      SENSOR_G;
 	}
 
-	accel_offset[0] = aggregated_data[0] / (double)CALIBRATION_ITERATIONS;
-	accel_offset[1] = aggregated_data[1] / (double)CALIBRATION_ITERATIONS;
-	accel_offset[2] = aggregated_data[2] / (double)CALIBRATION_ITERATIONS;
+	for (i = 0; i < ARRAY_SIZE(accel_offset); i++) {
+		accel_offset[i] = aggregated_data[i] /
+				  (1000000.0 * CALIBRATION_ITERATIONS);
+	}
 
 	return 0;
 }
@@ -0,0 +1,303 @@
+#
+# Copyright (c) 2019 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+
+"""Tune and evaluate the activity classifier of the cat tracker.
+
+Traces are CSV files with one accelerometer sample per line, in mg:
+
+    x,y,z,label
+
+where label is rest, walk, run or climb. The traces are run through
+activity_host, which is built from the same motion feature and classifier
+sources as the application, so that the results match the device.
+
+The thresholds are chosen by a grid search on the labelled windows. The
+result is evaluated against the threshold wake-up used without the
+classifier, where every acceleration above the threshold starts a GPS
+search and a cloud update. In both, the threshold is compared with the
+deviation of the magnitude from its mean, so that gravity is removed.
+"""
+
+from itertools import product
+import argparse
+import math
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+
+ACTIVITIES = ('rest', 'walk', 'run', 'climb')
+SRC_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                       '..', '..', 'src', 'motion')
+HOST_DIR = os.path.dirname(os.path.abspath(__file__))
+
+GRID = {
+    'rest_var_max': (400, 900, 1600, 2500, 3600, 6400),
+    'run_var_min': (40000, 60000, 90000, 120000, 160000),
+    'run_peaks_min': (3, 4, 5, 6, 8),
+    'climb_horizontal_min': (500, 600, 700, 800, 900),
+}
+
+
+def build(block_size, out_dir):
+    """Build activity_host for the given block size."""
+    binary = os.path.join(out_dir, 'activity_host')
+    cmd = ['cc', '-O2', '-std=gnu99', '-Wall',
+           '-DCONFIG_MOTION_BLOCK_SIZE={}'.format(block_size),
+           '-I', os.path.join(HOST_DIR, '..', 'include'), '-I', SRC_DIR,
+           os.path.join(HOST_DIR, 'activity_host.c'),
+           os.path.join(SRC_DIR, 'motion_features.c'),
+           os.path.join(SRC_DIR, 'activity.c'),
+           '-o', binary]
+    subprocess.check_call(cmd)
+    return binary
+
+
+def move_min(args):
+    """Cloud acceleration threshold in mg, as set in motion_handler()."""
+    return int(args.accel_threshold / 9.80665 * 1000)
+
+
+def run(binary, trace, model, args):
+    """Run a trace through activity_host and return one dict per block."""
+    peak_gap = args.peak_gap_ms * args.rate // 1000
+    cmd = [binary] + [str(model[k]) for k in GRID]
+    cmd += [str(move_min(args)), str(args.confirm_blocks),
+            str(args.peak_threshold), str(peak_gap)]
+
+    with open(trace) as f:
+        out = subprocess.check_output(cmd, stdin=f, universal_newlines=True)
+
+    keys = ('label', 'mag_mean', 'mag_var', 'peak_count',
+            'mean_x', 'mean_y', 'mean_z', 'mag_dev_max', 'window', 'activity')
+    blocks = []
+    for line in out.splitlines():
+        block = dict(zip(keys, line.split(',')))
+        for k in keys[1:8]:
+            block[k] = int(block[k])
+        blocks.append(block)
+    return blocks
+
+
+def classify(model, block, threshold):
+    """Same decision as activity_classify(), used for the grid search."""
+    if block['mag_var'] <= model['rest_var_max'] and \
+       block['peak_count'] == 0:
+        return 'rest'
+    if block['mag_dev_max'] < threshold:
+        return 'rest'
+    if block['mean_x'] ** 2 + block['mean_y'] ** 2 >= \
+       model['climb_horizontal_min'] ** 2:
+        return 'climb'
+    if block['mag_var'] >= model['run_var_min'] or \
+       block['peak_count'] >= model['run_peaks_min']:
+        return 'run'
+    return 'walk'
+
+
+def balanced_accuracy(model, blocks, threshold):
+    """Mean recall over the labelled activities."""
+    recalls = []
+    for activity in ACTIVITIES:
+        labelled = [b for b in blocks if b['label'] == activity]
+        if labelled:
+            hits = sum(classify(model, b, threshold) == activity
+                       for b in labelled)
+            recalls.append(hits / len(labelled))
+    return sum(recalls) / len(recalls) if recalls else 0.0
+
+
+def train(blocks, threshold):
+    """Grid search for the thresholds with the best balanced accuracy."""
+    best, best_score = None, -1.0
+    for values in product(*GRID.values()):
+        model = dict(zip(GRID, values))
+        if model['rest_var_max'] >= model['run_var_min']:
+            continue
+        score = balanced_accuracy(model, blocks, threshold)
+        if score > best_score:
+            best, best_score = model, score
+    return best, best_score
+
+
+def count_cycles(blocks, trigger, moving, block_time, cycle_time):
+    """Run the main loop of the application in passive mode.
+
+    trigger(block) tells if a block gives accel_trig_sem, and moving(block)
+    if it sets the moved since fix flag. As in motion_handler(), a moving
+    block gives the semaphore at most once per cycle time. The loop takes
+    the semaphore, searches for a fix if the tracker moved since the last
+    one, waits for the cycle time and then connects to the cloud. The fix
+    is assumed to be found at once.
+
+    Returns the number of cycles, the number of fixes and the number of
+    cycles started by a block labelled as rest.
+    """
+    cycles, fixes, false_cycles = 0, 0, 0
+    given, moved = None, True
+    next_trig, busy_until = 0.0, 0.0
+    for i, block in enumerate(blocks):
+        now = i * block_time
+        if moving(block):
+            moved = True
+        if trigger(block) and now >= next_trig:
+            given = block['label']
+            next_trig = now + cycle_time
+        if given is not None and now >= busy_until:
+            cycles += 1
+            false_cycles += given == 'rest'
+            given = None
+            if moved:
+                fixes += 1
+                moved = False
+            busy_until = now + cycle_time
+    return cycles, fixes, false_cycles
+
+
+def report(blocks, args):
+    """Print the confusion matrix and the wake-ups against the baseline."""
+    labelled = [b for b in blocks if b['label'] in ACTIVITIES]
+
+    print('Confusion matrix (rows: label, columns: classifier output)')
+    print('{:>8}'.format('') + ''.join('{:>8}'.format(a) for a in ACTIVITIES))
+    for label in ACTIVITIES:
+        row = [sum(1 for b in labelled
+                   if b['label'] == label and b['activity'] == a)
+               for a in ACTIVITIES]
+        print('{:>8}'.format(label) + ''.join('{:>8}'.format(n) for n in row))
+
+    hits = sum(b['label'] == b['activity'] for b in labelled)
+    if labelled:
+        print('Accuracy: {:.1%}'.format(hits / len(labelled)))
+
+    block_time = args.block_size / args.rate
+    hours = len(blocks) * block_time / 3600
+    threshold = move_min(args)
+
+    # Without the classifier, every block above the threshold gives the
+    # semaphore, and a fix is searched for in every cycle.
+    def baseline(block):
+        return block['mag_dev_max'] > threshold
+
+    def always(block):
+        return True
+
+    def classifier(block):
+        return block['activity'] != 'rest'
+
+    print('\n{:.2f} h of samples, {:.0f} J per fix, {:.0f} J per cloud '
+          'update'.format(hours, args.gps_energy, args.cloud_energy))
+    results = {}
+    for name, trigger, moving in (('threshold', baseline, always),
+                                  ('classifier', classifier, classifier)):
+        cycles, fixes, false_cycles = count_cycles(
+            blocks, trigger, moving, block_time, args.cycle_time)
+        energy = fixes * args.gps_energy + cycles * args.cloud_energy
+        results[name] = energy
+        print('{:>10}: {} cycles, {} fixes, {} started at rest ({:.1%}), '
+              '{:.0f} J/h'.format(name, cycles, fixes, false_cycles,
+                                  false_cycles / cycles if cycles else 0,
+                                  energy / hours if hours else 0))
+
+    if results['threshold']:
+        change = results['classifier'] / results['threshold'] - 1
+        print('Energy of the classifier: {:+.1%}'.format(change))
+        if change >= 0:
+            print('The classifier does not save energy on these traces.')
+
+
+def synthetic(path, rate, seed):
+    """Write a labelled trace of the four activities for a smoke test."""
+    rnd = random.Random(seed)
+
+    def rest(t):
+        # Short twitches, such as scratching, do not move the cat.
+        if rnd.random() < 0.003:
+            return (1500, 0, 1000)
+        return (0, 0, 1000)
+
+    def walk(t):
+        return (0, 0, 1000 + 300 * math.sin(2 * math.pi * 1.8 * t))
+
+    def run(t):
+        return (0, 0, 1000 + 800 * math.sin(2 * math.pi * 2.8 * t))
+
+    def climb(t):
+        return (850, 0, 400 + 150 * math.sin(2 * math.pi * 1.0 * t))
+
+    shapes = {'rest': rest, 'walk': walk, 'run': run, 'climb': climb}
+    with open(path, 'w') as f:
+        f.write('x,y,z,label\n')
+        t = 0.0
+        for _ in range(40):
+            label = rnd.choice(ACTIVITIES)
+            for _ in range(int(rnd.uniform(30, 120) * rate)):
+                x, y, z = shapes[label](t)
+                f.write('{},{},{},{}\n'.format(
+                    *(int(v + rnd.gauss(0, 15)) for v in (x, y, z)), label))
+                t += 1 / rate
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Tune and evaluate the cat tracker activity classifier.')
+    parser.add_argument('traces', nargs='*', help='Labelled CSV traces')
+    parser.add_argument('--synthetic', metavar='FILE',
+                        help='Write a synthetic trace to FILE and use it')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--rate', type=int, default=12,
+                        help='Sample rate [Hz] (CONFIG_MOTION_SAMPLE_RATE)')
+    parser.add_argument('--block-size', type=int, default=32,
+                        help='CONFIG_MOTION_BLOCK_SIZE')
+    parser.add_argument('--peak-threshold', type=int, default=200,
+                        help='CONFIG_MOTION_PEAK_THRESHOLD [mg]')
+    parser.add_argument('--peak-gap-ms', type=int, default=250,
+                        help='CONFIG_MOTION_PEAK_GAP_MS')
+    parser.add_argument('--confirm-blocks', type=int, default=2,
+                        help='CONFIG_ACTIVITY_CONFIRM_BLOCKS')
+    parser.add_argument('--accel-threshold', type=float, default=0.5,
+                        help='Cloud acceleration threshold, with gravity '
+                        'removed [m/s^2]')
+    parser.add_argument('--cycle-time', type=float, default=60.0,
+                        help='Wait of a cycle, passive_wait in the '
+                        'cloud configuration [s]')
+    parser.add_argument('--gps-energy', type=float, default=3.0,
+                        help='Energy of one GPS fix [J]')
+    parser.add_argument('--cloud-energy', type=float, default=2.0,
+                        help='Energy of one cloud update [J]')
+    args = parser.parse_args()
+
+    traces = list(args.traces)
+    if args.synthetic:
+        synthetic(args.synthetic, args.rate, args.seed)
+        traces.append(args.synthetic)
+    if not traces:
+        parser.error('no traces given')
+
+    with tempfile.TemporaryDirectory() as tmp:
+        binary = build(args.block_size, tmp)
+        model = {k: v[len(v) // 2] for k, v in GRID.items()}
+        blocks = [b for t in traces for b in run(binary, t, model, args)]
+
+        model, score = train([b for b in blocks if b['label'] in ACTIVITIES],
+                             move_min(args))
+        if model is None:
+            sys.exit('no labelled windows in the traces')
+        print('Balanced accuracy per window: {:.1%}\n'.format(score))
+
+        blocks = []
+        for trace in traces:
+            blocks += run(binary, trace, model, args)
+        report(blocks, args)
+
+    print('\nSuggested configuration:')
+    for key, value in model.items():
+        print('CONFIG_ACTIVITY_{}={}'.format(key.upper(), value))
+
+
+if __name__ == '__main__':
+    main()
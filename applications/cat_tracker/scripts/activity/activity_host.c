@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Runs the motion feature extraction and activity classification of the
+ * cat tracker on a recorded trace, block by block as on the device.
+ *
+ * The trace is read from standard input, one sample per line:
+ *   x,y,z[,label]
+ * with the acceleration in mg. Lines that do not start with a number are
+ * skipped. One line is written per block:
+ *   label,mag_mean,mag_var,peak_count,mean_x,mean_y,mean_z,mag_dev_max,
+ *   window,activity
+ * where label is the most common label in the block, window the class of
+ * the block alone, and activity the output of the classifier.
+ *
+ * Usage: activity_host rest_var_max run_var_min run_peaks_min
+ *                      climb_horizontal_min move_min confirm_blocks
+ *                      peak_threshold peak_gap
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "motion_features.h"
+#include "activity.h"
+
+#define LABEL_MAX_LEN	16
+#define ARG_COUNT	8
+
+static char labels[MOTION_BLOCK_SIZE][LABEL_MAX_LEN];
+
+static const char *block_label(size_t count)
+{
+	size_t best = 0;
+	size_t best_count = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		size_t same = 0;
+
+		for (size_t j = 0; j < count; j++) {
+			same += (strcmp(labels[i], labels[j]) == 0);
+		}
+
+		if (same > best_count) {
+			best = i;
+			best_count = same;
+		}
+	}
+
+	return labels[best][0] ? labels[best] : "-";
+}
+
+int main(int argc, char **argv)
+{
+	struct activity_model model;
+	struct activity_classifier classifier;
+	struct motion_block block = { .count = 0 };
+	struct motion_features features;
+	u16_t peak_threshold;
+	size_t peak_gap;
+	char line[128];
+
+	if (argc != ARG_COUNT + 1) {
+		fprintf(stderr, "Usage: %s rest_var_max run_var_min "
+			"run_peaks_min climb_horizontal_min move_min "
+			"confirm_blocks peak_threshold peak_gap\n", argv[0]);
+		return 1;
+	}
+
+	model.rest_var_max = strtoul(argv[1], NULL, 10);
+	model.run_var_min = strtoul(argv[2], NULL, 10);
+	model.run_peaks_min = strtoul(argv[3], NULL, 10);
+	model.climb_horizontal_min = strtoul(argv[4], NULL, 10);
+	model.move_min = strtoul(argv[5], NULL, 10);
+	activity_init(&classifier, &model, strtoul(argv[6], NULL, 10));
+	peak_threshold = strtoul(argv[7], NULL, 10);
+	peak_gap = strtoul(argv[8], NULL, 10);
+
+	while (fgets(line, sizeof(line), stdin) != NULL) {
+		int x, y, z;
+		char label[LABEL_MAX_LEN] = "";
+
+		if (sscanf(line, "%d,%d,%d,%15[^,\r\n]", &x, &y, &z,
+			   label) < 3) {
+			continue;
+		}
+
+		block.x[block.count] = x;
+		block.y[block.count] = y;
+		block.z[block.count] = z;
+		strcpy(labels[block.count], label);
+
+		if (++block.count < MOTION_BLOCK_SIZE) {
+			continue;
+		}
+
+		motion_features_get(&block, peak_threshold, peak_gap,
+				    &features);
+		activity_update(&classifier, &features);
+
+		printf("%s,%u,%u,%u,%d,%d,%d,%u,%s,%s\n",
+		       block_label(block.count),
+		       features.mag_mean, features.mag_var,
+		       features.peak_count,
+		       features.mean[0], features.mean[1], features.mean[2],
+		       features.mag_dev_max,
+		       activity_name(activity_classify(&model, &features)),
+		       activity_name(classifier.activity));
+
+		block.count = 0;
+	}
+
+	return 0;
+}
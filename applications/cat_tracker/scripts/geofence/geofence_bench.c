@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Benchmarks the geofence grid index of the cat tracker against testing
+ * every geofence on every fix.
+ *
+ * Random circles and polygons are placed in a square area, and random
+ * tracks walk through it. Both methods must find the same crossings.
+ *
+ * Build from this directory with:
+ *   cc -O2 -I../include -I../../src/geofence \
+ *      -DCONFIG_GEOFENCE_MAX_COUNT=1024 -DCONFIG_GEOFENCE_VERTICES_MAX=8192 \
+ *      -DCONFIG_GEOFENCE_GRID_SIZE=32 -DCONFIG_GEOFENCE_GRID_ENTRIES=16384 \
+ *      geofence_bench.c ../../src/geofence/geofence.c -lm -o geofence_bench
+ *
+ * Usage: geofence_bench [fences [fixes [seed]]]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <misc/util.h>
+
+#include "geofence.h"
+
+/* Area around Trondheim, about 20 km across. */
+#define AREA_LAT		63430000
+#define AREA_LON		10390000
+#define AREA_SIZE		180000
+#define UDEG_PER_M		9
+#define RADIUS_MIN		20
+#define RADIUS_MAX		300
+#define VERTICES_MAX		12
+#define TRACK_LEN		1000
+#define STEP_MAX		30
+
+static struct geofence_set set;
+static struct geofence_point *track;
+static bool inside[GEOFENCE_MAX_COUNT];
+
+static s32_t rand_range(s32_t min, s32_t max)
+{
+	return min + (s32_t)(rand() % (max - min + 1));
+}
+
+/* Degrees of longitude are shorter than degrees of latitude here. */
+static s32_t lon_scaled(s32_t udeg)
+{
+	return udeg / cos(AREA_LAT * (M_PI / 180 / GEOFENCE_UDEG_PER_DEG));
+}
+
+static void fences_add(size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		struct geofence_point center = {
+			.lat = AREA_LAT + rand_range(0, AREA_SIZE),
+			.lon = AREA_LON + lon_scaled(rand_range(0, AREA_SIZE)),
+		};
+		u32_t radius = rand_range(RADIUS_MIN, RADIUS_MAX);
+		struct geofence_point vertices[VERTICES_MAX];
+		size_t vertex_count = rand_range(3, VERTICES_MAX);
+		int err;
+
+		if (i % 2 == 0) {
+			err = geofence_add_circle(&set, i, &center, radius);
+		} else {
+			/* Star shaped, with vertices at random distances. */
+			for (size_t v = 0; v < vertex_count; v++) {
+				double angle = 2 * M_PI * v / vertex_count;
+				s32_t r = rand_range(radius / 3, radius) *
+					  UDEG_PER_M;
+
+				vertices[v].lat = center.lat + r * sin(angle);
+				vertices[v].lon = center.lon +
+						  lon_scaled(r * cos(angle));
+			}
+
+			err = geofence_add_polygon(&set, i, vertices,
+						   vertex_count);
+		}
+
+		if (err) {
+			fprintf(stderr, "Geofence %zu not added: %d\n", i, err);
+			exit(1);
+		}
+	}
+}
+
+/* Random walk, turning a little at each fix. */
+static void track_fill(size_t count)
+{
+	double lat = 0;
+	double lon = 0;
+	double heading = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		double step = rand_range(0, STEP_MAX) * UDEG_PER_M;
+
+		if (i % TRACK_LEN == 0) {
+			lat = AREA_LAT + rand_range(0, AREA_SIZE);
+			lon = AREA_LON + lon_scaled(rand_range(0, AREA_SIZE));
+			heading = rand_range(0, 359) * M_PI / 180;
+		}
+
+		heading += rand_range(-30, 30) * M_PI / 180;
+		lat += step * sin(heading);
+		lon += lon_scaled(step * cos(heading));
+
+		track[i].lat = lat;
+		track[i].lon = lon;
+	}
+}
+
+static double elapsed_ns(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - start->tv_sec) * 1e9 +
+	       (now.tv_nsec - start->tv_nsec);
+}
+
+static size_t run_indexed(size_t count)
+{
+	struct geofence_event events[GEOFENCE_MAX_COUNT];
+	size_t crossings = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		if (i % TRACK_LEN == 0) {
+			/* Each track starts from an unknown position. */
+			geofence_index(&set);
+		}
+
+		crossings += geofence_update(&set, &track[i], events,
+					     ARRAY_SIZE(events));
+	}
+
+	return crossings;
+}
+
+static size_t run_linear(size_t count)
+{
+	size_t crossings = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		for (size_t f = 0; f < set.count; f++) {
+			bool now = geofence_test(&set, f, &track[i]);
+
+			crossings += (i % TRACK_LEN != 0) && (now != inside[f]);
+			inside[f] = now;
+		}
+	}
+
+	return crossings;
+}
+
+int main(int argc, char **argv)
+{
+	size_t fence_count = (argc > 1) ? atoi(argv[1]) : 500;
+	size_t fix_count = (argc > 2) ? atoi(argv[2]) : 100000;
+	unsigned int seed = (argc > 3) ? atoi(argv[3]) : 1;
+	struct timespec start;
+	size_t indexed_crossings;
+	size_t linear_crossings;
+	double indexed_ns;
+	double linear_ns;
+	int err;
+
+	if (fence_count > GEOFENCE_MAX_COUNT) {
+		fprintf(stderr, "At most %d geofences\n", GEOFENCE_MAX_COUNT);
+		return 1;
+	}
+
+	track = malloc(fix_count * sizeof(*track));
+	if (track == NULL) {
+		return 1;
+	}
+
+	srand(seed);
+	geofence_init(&set);
+	fences_add(fence_count);
+	track_fill(fix_count);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	err = geofence_index(&set);
+	if (err) {
+		fprintf(stderr, "Index error: %d\n", err);
+		return 1;
+	}
+
+	printf("%zu geofences, %zu vertices, %dx%d grid, %.1f entries per "
+	       "cell, indexed in %.0f us\n", set.count, set.vertex_count,
+	       GEOFENCE_GRID_SIZE, GEOFENCE_GRID_SIZE,
+	       (double)set.cell_start[GEOFENCE_GRID_CELLS] /
+	       GEOFENCE_GRID_CELLS, elapsed_ns(&start) / 1000);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	indexed_crossings = run_indexed(fix_count);
+	indexed_ns = elapsed_ns(&start) / fix_count;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	linear_crossings = run_linear(fix_count);
+	linear_ns = elapsed_ns(&start) / fix_count;
+
+	printf("%zu fixes, %zu crossings\n", fix_count, indexed_crossings);
+	printf("  grid:   %8.0f ns per fix\n", indexed_ns);
+	printf("  linear: %8.0f ns per fix\n", linear_ns);
+	printf("  speedup: %.1fx\n", linear_ns / indexed_ns);
+
+	if (indexed_crossings != linear_crossings) {
+		printf("Crossings differ, linear scan found %zu\n",
+		       linear_crossings);
+		return 1;
+	}
+
+	free(track);
+
+	return 0;
+}
@@ -10,6 +10,9 @@
 #include "cJSON_os.h"
 #include "../version.h"
 #include <net/cloud.h>
+#if defined(CONFIG_GEOFENCE)
+#include <geofence.h>
+#endif
 
 static bool change_gpst = true;
 static bool change_active = true;
@@ -17,6 +20,10 @@ static bool change_active_wait = true;
 static bool change_passive_wait = true;
 static bool change_movement_timeout = true;
 static bool change_accel_threshold = true;
+#if defined(CONFIG_GEOFENCE)
+/* Geofences set from the last "geo", to be reported back. */
+static cJSON *geofences_set;
+#endif
 
 struct twins_gps_buf {
 	cJSON *gps_buf_objects;
@@ -90,6 +97,141 @@ static int json_add_str(cJSON *parent, const char *str, const char *item)
 	return json_add_obj(parent, str, json_str);
 }
 
+#if defined(CONFIG_GEOFENCE)
+static int geofence_point_decode(cJSON *lat, cJSON *lng,
+				 struct geofence_point *point)
+{
+	if (lat == NULL || lng == NULL || lat->type != cJSON_Number ||
+	    lng->type != cJSON_Number) {
+		return -EINVAL;
+	}
+
+	point->lat = lat->valueint;
+	point->lon = lng->valueint;
+
+	return 0;
+}
+
+static int geofence_polygon_decode(struct geofence_set *set, u16_t id,
+				   cJSON *pts)
+{
+	struct geofence_point vertices[CONFIG_GEOFENCE_POLYGON_VERTICES_MAX];
+	int count = cJSON_GetArraySize(pts);
+	int err;
+
+	if ((size_t)count > ARRAY_SIZE(vertices)) {
+		return -ENOMEM;
+	}
+
+	for (int i = 0; i < count; i++) {
+		cJSON *pt = cJSON_GetArrayItem(pts, i);
+
+		err = geofence_point_decode(cJSON_GetArrayItem(pt, 0),
+					    cJSON_GetArrayItem(pt, 1),
+					    &vertices[i]);
+		if (err != 0) {
+			return err;
+		}
+	}
+
+	return geofence_add_polygon(set, id, vertices, count);
+}
+
+/* Without support for decimals, parsed numbers only have valueint, but
+ * numbers are printed from valuedouble.
+ */
+static void json_numbers_set(cJSON *item)
+{
+	for (; item != NULL; item = item->next) {
+		if (item->type == cJSON_Number) {
+			cJSON_SetIntValue(item, item->valueint);
+		}
+
+		json_numbers_set(item->child);
+	}
+}
+
+/* Geofences replace the previous ones. Each is either a circle,
+ * {"id": 1, "lat": 63421000, "lng": 10437000, "r": 50}, with the radius
+ * in meters, or a polygon, {"id": 2, "pts": [[63421000, 10437000], ...]}.
+ * Positions are in micro degrees, as cJSON is built without support for
+ * decimals. Ids are unique, and geofences kept with the same id keep
+ * whether the last fix was inside them.
+ */
+static int geofence_decode(cJSON *geo, struct geofence_set *set)
+{
+	int count = cJSON_GetArraySize(geo);
+	u16_t inside[GEOFENCE_MAX_COUNT];
+	int inside_count;
+	cJSON *accepted;
+	int err;
+
+	accepted = cJSON_CreateArray();
+	if (accepted == NULL) {
+		return -ENOMEM;
+	}
+
+	inside_count = geofence_inside_get(set, inside);
+	geofence_init(set);
+
+	cJSON_Delete(geofences_set);
+	geofences_set = NULL;
+
+	for (int i = 0; i < count; i++) {
+		cJSON *fence = cJSON_GetArrayItem(geo, i);
+		cJSON *copy;
+		cJSON *id = cJSON_GetObjectItem(fence, "id");
+		cJSON *pts = cJSON_GetObjectItem(fence, "pts");
+		cJSON *radius = cJSON_GetObjectItem(fence, "r");
+		struct geofence_point center;
+
+		if (id == NULL || id->type != cJSON_Number ||
+		    id->valueint < 0 || id->valueint > UINT16_MAX) {
+			err = -EINVAL;
+		} else if (pts != NULL) {
+			err = geofence_polygon_decode(set, id->valueint, pts);
+		} else if (radius != NULL) {
+			err = geofence_point_decode(
+				cJSON_GetObjectItem(fence, "lat"),
+				cJSON_GetObjectItem(fence, "lng"), &center);
+			if (err == 0) {
+				err = geofence_add_circle(set, id->valueint,
+							  &center,
+							  radius->valueint);
+			}
+		} else {
+			err = -EINVAL;
+		}
+
+		if (err != 0) {
+			printk("Geofence %d not set, error: %d\n", i, err);
+			continue;
+		}
+
+		copy = cJSON_Duplicate(fence, true);
+		if (copy != NULL) {
+			json_numbers_set(copy->child);
+			json_add_obj_array(accepted, copy);
+		}
+	}
+
+	printk("SETTING %d GEOFENCES\n", (int)set->count);
+
+	err = geofence_index(set);
+	if (err != 0) {
+		/* None of the geofences are used. */
+		cJSON_Delete(accepted);
+		accepted = cJSON_CreateArray();
+	} else if (inside_count >= 0) {
+		geofence_inside_set(set, inside, inside_count);
+	}
+
+	geofences_set = accepted;
+
+	return err;
+}
+#endif
+
 int cloud_decode_response(char *input, struct cloud_data *cloud_data)
 {
 	char *string = NULL;
@@ -102,6 +244,7 @@ int cloud_decode_response(char *input, struct cloud_data *cloud_data)
 	cJSON *passive_wait = NULL;
 	cJSON *movement_timeout = NULL;
 	cJSON *accel_threshold = NULL;
+	cJSON *geofences = NULL;
 
 	if (input == NULL) {
 		return -EINVAL;
@@ -127,6 +270,7 @@ int cloud_decode_response(char *input, struct cloud_data *cloud_data)
 		passive_wait = cJSON_GetObjectItem(group_obj, "mvres");
 		movement_timeout = cJSON_GetObjectItem(group_obj, "mvt");
 		accel_threshold = cJSON_GetObjectItem(group_obj, "acct");
+		geofences = cJSON_GetObjectItem(group_obj, "geo");
 		goto get_data;
 	}
 
@@ -144,6 +288,7 @@ int cloud_decode_response(char *input, struct cloud_data *cloud_data)
 				cJSON_GetObjectItem(subgroup_obj, "mvt");
 			accel_threshold =
 				cJSON_GetObjectItem(subgroup_obj, "acct");
+			geofences = cJSON_GetObjectItem(subgroup_obj, "geo");
 		}
 	} else {
 		goto end;
@@ -188,6 +333,16 @@ get_data:
 		       accel_threshold->valueint);
 		change_accel_threshold = true;
 	}
+
+#if defined(CONFIG_GEOFENCE)
+	if (geofences != NULL && cloud_data->geofences != NULL) {
+		int err = geofence_decode(geofences, cloud_data->geofences);
+
+		if (err != 0) {
+			printk("Geofence index error: %d\n", err);
+		}
+	}
+#endif
 end:
 	cJSON_Delete(root_obj);
 	return 0;
@@ -296,6 +451,71 @@ int cloud_encode_gps_buffer(struct cloud_msg *output,
 	return 0;
 }
 
+int cloud_encode_geofence_data(struct cloud_msg *output,
+			       struct cloud_data_geofence *events,
+			       size_t count,
+			       struct cloud_data_time *cloud_data_time)
+{
+	int err = 0;
+	char *buffer;
+
+	cloud_data_time->delta_time = cloud_data_time->epoch * (time_t)1000 -
+				     cloud_data_time->update_time;
+
+	cJSON *root_obj = cJSON_CreateObject();
+	cJSON *state_obj = cJSON_CreateObject();
+	cJSON *reported_obj = cJSON_CreateObject();
+	cJSON *geo_obj = cJSON_CreateArray();
+
+	if (root_obj == NULL || state_obj == NULL || reported_obj == NULL ||
+	    geo_obj == NULL) {
+		cJSON_Delete(root_obj);
+		cJSON_Delete(state_obj);
+		cJSON_Delete(reported_obj);
+		cJSON_Delete(geo_obj);
+		return -ENOMEM;
+	}
+
+	err += json_add_obj(reported_obj, "geo", geo_obj);
+	err += json_add_obj(state_obj, "reported", reported_obj);
+	err += json_add_obj(root_obj, "state", state_obj);
+
+	for (size_t i = 0; i < count; i++) {
+		s64_t geo_ts = cloud_data_time->delta_time +
+			       events[i].timestamp;
+		cJSON *event_obj = cJSON_CreateObject();
+		cJSON *event_val_obj = cJSON_CreateObject();
+
+		if (event_obj == NULL || event_val_obj == NULL) {
+			cJSON_Delete(event_obj);
+			cJSON_Delete(event_val_obj);
+			err = -ENOMEM;
+			break;
+		}
+
+		err += json_add_number(event_val_obj, "id", events[i].id);
+		err += json_add_bool(event_val_obj, "in", events[i].inside);
+		err += json_add_obj(event_obj, "v", event_val_obj);
+		err += json_add_number(event_obj, "ts", geo_ts);
+		err += json_add_obj_array(geo_obj, event_obj);
+	}
+
+	if (err != 0) {
+		cJSON_Delete(root_obj);
+		return -EAGAIN;
+	}
+
+	buffer = cJSON_Print(root_obj);
+	cJSON_Delete(root_obj);
+
+	printk("Encoded message: %s\n", buffer);
+
+	output->buf = buffer;
+	output->len = strlen(buffer);
+
+	return 0;
+}
+
 int cloud_encode_modem_data(struct cloud_msg *output,
 			    struct modem_param_info *modem_info,
 			    bool dynamic_modem_data, int rsrp,
@@ -475,15 +695,27 @@ int cloud_encode_cfg_data(struct cloud_msg *output,
 		cnt++;
 	}
 
+#if defined(CONFIG_GEOFENCE)
+	if (geofences_set != NULL) {
+		cJSON *geo_obj = cJSON_Duplicate(geofences_set, true);
+
+		if (geo_obj == NULL) {
+			err -= ENOMEM;
+		} else {
+			err += json_add_obj(cfg_obj, "geo", geo_obj);
+		}
+
+		cnt++;
+	}
+#endif
+
 	err += json_add_obj(reported_obj, "cfg", cfg_obj);
 	err += json_add_obj(state_obj, "reported", reported_obj);
 	err += json_add_obj(root_obj, "state", state_obj);
 
 	if (err != 0 || cnt == 0) {
+		/* The other objects are part of the root by now. */
 		cJSON_Delete(root_obj);
-		cJSON_Delete(state_obj);
-		cJSON_Delete(reported_obj);
-		cJSON_Delete(cfg_obj);
 		return -EAGAIN;
 	}
 
@@ -501,6 +733,10 @@ int cloud_encode_cfg_data(struct cloud_msg *output,
 	change_passive_wait		= false;
 	change_movement_timeout 	= false;
 	change_accel_threshold		= false;
+#if defined(CONFIG_GEOFENCE)
+	cJSON_Delete(geofences_set);
+	geofences_set = NULL;
+#endif
 
 	return 0;
 }
@@ -518,6 +754,8 @@ int cloud_encode_sensor_data(struct cloud_msg *output,
 
 	s64_t bat_ts = cloud_data_time->delta_time + cloud_data->bat_timestamp;
 	s64_t acc_ts = cloud_data_time->delta_time + cloud_data->acc_timestamp;
+	s64_t act_ts = cloud_data_time->delta_time +
+		       cloud_data->activity_timestamp;
 	s64_t gps_ts = cloud_data_time->delta_time + cir_buf_gps->gps_timestamp;
 
 	cJSON *root_obj = cJSON_CreateObject();
@@ -525,17 +763,19 @@ int cloud_encode_sensor_data(struct cloud_msg *output,
 	cJSON *reported_obj = cJSON_CreateObject();
 	cJSON *bat_obj = cJSON_CreateObject();
 	cJSON *acc_obj = cJSON_CreateObject();
+	cJSON *act_obj = cJSON_CreateObject();
 	cJSON *gps_obj = cJSON_CreateObject();
 	cJSON *gps_val_obj = cJSON_CreateObject();
 
 	if (root_obj == NULL || state_obj == NULL || reported_obj == NULL ||
-	    bat_obj == NULL || acc_obj == NULL || gps_obj == NULL ||
-	    gps_val_obj == NULL) {
+	    bat_obj == NULL || acc_obj == NULL || act_obj == NULL ||
+	    gps_obj == NULL || gps_val_obj == NULL) {
 		cJSON_Delete(root_obj);
 		cJSON_Delete(state_obj);
 		cJSON_Delete(reported_obj);
 		cJSON_Delete(bat_obj);
 		cJSON_Delete(acc_obj);
+		cJSON_Delete(act_obj);
 		cJSON_Delete(gps_obj);
 		cJSON_Delete(gps_val_obj);
 		return -ENOMEM;
@@ -551,6 +791,16 @@ int cloud_encode_sensor_data(struct cloud_msg *output,
 	err += json_add_DoubleArray(acc_obj, "v", cloud_data->acc);
 	err += json_add_number(acc_obj, "ts", acc_ts);
 
+	/*ACT*/
+	if (cloud_data->activity != NULL) {
+		err += json_add_str(act_obj, "v", cloud_data->activity);
+		err += json_add_number(act_obj, "ts", act_ts);
+		err += json_add_obj(reported_obj, "act", act_obj);
+	} else {
+		cJSON_Delete(act_obj);
+		act_obj = NULL;
+	}
+
 	/*GPS*/
 	err += json_add_number(gps_val_obj, "lng", cir_buf_gps->longitude);
 	err += json_add_number(gps_val_obj, "lat", cir_buf_gps->latitude);
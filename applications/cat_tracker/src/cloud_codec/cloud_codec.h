@@ -22,6 +22,14 @@ struct cloud_data_gps {
 	bool queued;
 };
 
+struct cloud_data_geofence {
+	u16_t id;
+	bool inside;
+	s64_t timestamp;
+};
+
+struct geofence_set;
+
 struct cloud_data {
 	int bat_voltage;
 	s64_t bat_timestamp;
@@ -29,6 +37,10 @@ struct cloud_data {
 	double acc[3];
 	s64_t acc_timestamp;
 
+	/* Name of the current activity, NULL if not classified. */
+	const char *activity;
+	s64_t activity_timestamp;
+
 	int gps_timeout;
 	bool active;
 	int active_wait;
@@ -36,6 +48,9 @@ struct cloud_data {
 	int movement_timeout;
 	int accel_threshold;
 
+	/* Geofences set from the cfg section, NULL if not used. */
+	struct geofence_set *geofences;
+
 	bool gps_found;
 };
 
@@ -56,6 +71,11 @@ int cloud_encode_gps_buffer(struct cloud_msg *output,
 			    struct cloud_data_gps *cir_buf_gps,
 			    struct cloud_data_time *cloud_data_time);
 
+int cloud_encode_geofence_data(struct cloud_msg *output,
+			       struct cloud_data_geofence *events,
+			       size_t count,
+			       struct cloud_data_time *cloud_data_time);
+
 int cloud_encode_modem_data(struct cloud_msg *output,
 			    struct modem_param_info *modem_info,
 			    bool syncronization, int rsrp,
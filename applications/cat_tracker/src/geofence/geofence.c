@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <misc/util.h>
+#include "geofence.h"
+
+/* Mean length of one degree of latitude [m]. */
+#define METERS_PER_DEG		111195
+#define RADIUS_MAX		1000000
+#define LON_SCALE_SHIFT		16
+#define LON_SPAN_MAX		(360 * GEOFENCE_UDEG_PER_DEG)
+
+static bool map_get(const u32_t *map, size_t i)
+{
+	return map[i / 32] & BIT(i % 32);
+}
+
+static void map_set(u32_t *map, size_t i, bool value)
+{
+	if (value) {
+		map[i / 32] |= BIT(i % 32);
+	} else {
+		map[i / 32] &= ~BIT(i % 32);
+	}
+}
+
+static bool box_contains(const struct geofence_box *box,
+			 const struct geofence_point *pos)
+{
+	return (pos->lat >= box->min.lat) && (pos->lat <= box->max.lat) &&
+	       (pos->lon >= box->min.lon) && (pos->lon <= box->max.lon);
+}
+
+static size_t cell_of(s32_t value, s32_t min, s32_t size)
+{
+	s32_t cell = (value - min) / size;
+
+	return MIN(MAX(cell, 0), GEOFENCE_GRID_SIZE - 1);
+}
+
+static bool id_used(const struct geofence_set *set, u16_t id)
+{
+	for (size_t i = 0; i < set->count; i++) {
+		if (set->fences[i].id == id) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool circle_contains(const struct geofence *fence,
+			    const struct geofence_point *pos)
+{
+	s64_t dlat = pos->lat - fence->circle.center.lat;
+	s64_t dlon = ((s64_t)pos->lon - fence->circle.center.lon) *
+		     fence->circle.lon_scale >> LON_SCALE_SHIFT;
+	s64_t radius = fence->circle.radius;
+
+	return dlat * dlat + dlon * dlon <= radius * radius;
+}
+
+/* Crossing number test, in integers. Longitude is x, latitude is y. */
+static bool polygon_contains(const struct geofence_point *vertices,
+			     size_t count, const struct geofence_point *pos)
+{
+	bool inside = false;
+
+	for (size_t i = 0, j = count - 1; i < count; j = i++) {
+		const struct geofence_point *a = &vertices[i];
+		const struct geofence_point *b = &vertices[j];
+		s64_t lhs;
+		s64_t rhs;
+
+		if ((a->lat > pos->lat) == (b->lat > pos->lat)) {
+			continue;
+		}
+
+		/* Is pos left of the edge at its latitude? */
+		lhs = ((s64_t)pos->lon - a->lon) * ((s64_t)b->lat - a->lat);
+		rhs = ((s64_t)b->lon - a->lon) * ((s64_t)pos->lat - a->lat);
+
+		if ((b->lat > a->lat) ? (lhs < rhs) : (lhs > rhs)) {
+			inside = !inside;
+		}
+	}
+
+	return inside;
+}
+
+/* Count or fill the grid entries of a geofence, one per cell its bounding
+ * box overlaps.
+ */
+static size_t index_fence(struct geofence_set *set, size_t index, bool fill)
+{
+	const struct geofence_box *box = &set->fences[index].box;
+	const struct geofence_box *bounds = &set->bounds;
+	size_t lat_min = cell_of(box->min.lat, bounds->min.lat,
+				 set->cell_size.lat);
+	size_t lat_max = cell_of(box->max.lat, bounds->min.lat,
+				 set->cell_size.lat);
+	size_t lon_min = cell_of(box->min.lon, bounds->min.lon,
+				 set->cell_size.lon);
+	size_t lon_max = cell_of(box->max.lon, bounds->min.lon,
+				 set->cell_size.lon);
+
+	for (size_t row = lat_min; row <= lat_max; row++) {
+		for (size_t col = lon_min; col <= lon_max; col++) {
+			size_t cell = row * GEOFENCE_GRID_SIZE + col;
+
+			if (fill) {
+				set->cell_fences[--set->cell_start[cell]] =
+					index;
+			} else {
+				set->cell_start[cell]++;
+			}
+		}
+	}
+
+	return (lat_max - lat_min + 1) * (lon_max - lon_min + 1);
+}
+
+s32_t geofence_udeg(double deg)
+{
+	double udeg = deg * GEOFENCE_UDEG_PER_DEG;
+
+	return (s32_t)(udeg < 0 ? udeg - 0.5 : udeg + 0.5);
+}
+
+void geofence_init(struct geofence_set *set)
+{
+	memset(set, 0, sizeof(*set));
+}
+
+int geofence_add_circle(struct geofence_set *set, u16_t id,
+			const struct geofence_point *center, u32_t radius)
+{
+	struct geofence *fence;
+	s64_t lon_span;
+
+	if ((radius == 0) || (radius > RADIUS_MAX)) {
+		return -EINVAL;
+	}
+
+	if (set->count == GEOFENCE_MAX_COUNT) {
+		return -ENOMEM;
+	}
+
+	if (id_used(set, id)) {
+		return -EEXIST;
+	}
+
+	fence = &set->fences[set->count];
+	fence->id = id;
+	fence->type = GEOFENCE_CIRCLE;
+	fence->circle.center = *center;
+	fence->circle.radius = (u64_t)radius * GEOFENCE_UDEG_PER_DEG /
+			       METERS_PER_DEG;
+	fence->circle.lon_scale =
+		cos(center->lat * (M_PI / 180 / GEOFENCE_UDEG_PER_DEG)) *
+		BIT(LON_SCALE_SHIFT);
+
+	if (fence->circle.lon_scale == 0) {
+		return -EINVAL;
+	}
+
+	lon_span = MIN(((s64_t)fence->circle.radius << LON_SCALE_SHIFT) /
+		       fence->circle.lon_scale, LON_SPAN_MAX);
+
+	fence->box.min.lat = center->lat - fence->circle.radius;
+	fence->box.max.lat = center->lat + fence->circle.radius;
+	fence->box.min.lon = center->lon - lon_span;
+	fence->box.max.lon = center->lon + lon_span;
+
+	set->count++;
+	set->indexed = false;
+
+	return 0;
+}
+
+int geofence_add_polygon(struct geofence_set *set, u16_t id,
+			 const struct geofence_point *vertices, size_t count)
+{
+	struct geofence *fence;
+
+	if (count < 3) {
+		return -EINVAL;
+	}
+
+	if ((set->count == GEOFENCE_MAX_COUNT) ||
+	    (count > ARRAY_SIZE(set->vertices) - set->vertex_count)) {
+		return -ENOMEM;
+	}
+
+	if (id_used(set, id)) {
+		return -EEXIST;
+	}
+
+	fence = &set->fences[set->count];
+	fence->id = id;
+	fence->type = GEOFENCE_POLYGON;
+	fence->polygon.first = set->vertex_count;
+	fence->polygon.count = count;
+	fence->box.min = vertices[0];
+	fence->box.max = vertices[0];
+
+	for (size_t i = 0; i < count; i++) {
+		set->vertices[set->vertex_count++] = vertices[i];
+
+		fence->box.min.lat = MIN(fence->box.min.lat, vertices[i].lat);
+		fence->box.min.lon = MIN(fence->box.min.lon, vertices[i].lon);
+		fence->box.max.lat = MAX(fence->box.max.lat, vertices[i].lat);
+		fence->box.max.lon = MAX(fence->box.max.lon, vertices[i].lon);
+	}
+
+	set->count++;
+	set->indexed = false;
+
+	return 0;
+}
+
+int geofence_index(struct geofence_set *set)
+{
+	struct geofence_box *bounds = &set->bounds;
+	size_t total = 0;
+
+	set->indexed = false;
+	set->located = false;
+	set->inside_count = 0;
+	memset(set->inside_map, 0, sizeof(set->inside_map));
+	memset(set->cell_start, 0, sizeof(set->cell_start));
+
+	if (set->count == 0) {
+		set->indexed = true;
+		return 0;
+	}
+
+	*bounds = set->fences[0].box;
+
+	for (size_t i = 1; i < set->count; i++) {
+		const struct geofence_box *box = &set->fences[i].box;
+
+		bounds->min.lat = MIN(bounds->min.lat, box->min.lat);
+		bounds->min.lon = MIN(bounds->min.lon, box->min.lon);
+		bounds->max.lat = MAX(bounds->max.lat, box->max.lat);
+		bounds->max.lon = MAX(bounds->max.lon, box->max.lon);
+	}
+
+	set->cell_size.lat = (bounds->max.lat - bounds->min.lat) /
+			     GEOFENCE_GRID_SIZE + 1;
+	set->cell_size.lon = (bounds->max.lon - bounds->min.lon) /
+			     GEOFENCE_GRID_SIZE + 1;
+
+	/* Count the entries of each cell, and turn the counts into the end
+	 * of each cell. The entries are then filled in backwards, which
+	 * leaves the start of each cell in cell_start.
+	 */
+	for (size_t i = 0; i < set->count; i++) {
+		total += index_fence(set, i, false);
+	}
+
+	if (total > ARRAY_SIZE(set->cell_fences)) {
+		return -ENOMEM;
+	}
+
+	for (size_t cell = 1; cell < GEOFENCE_GRID_CELLS; cell++) {
+		set->cell_start[cell] += set->cell_start[cell - 1];
+	}
+
+	for (size_t i = 0; i < set->count; i++) {
+		index_fence(set, i, true);
+	}
+
+	set->cell_start[GEOFENCE_GRID_CELLS] = total;
+	set->indexed = true;
+
+	return 0;
+}
+
+int geofence_inside_get(const struct geofence_set *set, u16_t *ids)
+{
+	if (!set->located) {
+		return -ENODATA;
+	}
+
+	for (size_t i = 0; i < set->inside_count; i++) {
+		ids[i] = set->fences[set->inside[i]].id;
+	}
+
+	return set->inside_count;
+}
+
+void geofence_inside_set(struct geofence_set *set, const u16_t *ids,
+			 size_t count)
+{
+	for (size_t i = 0; i < set->count; i++) {
+		for (size_t j = 0; j < count; j++) {
+			if (set->fences[i].id != ids[j]) {
+				continue;
+			}
+
+			set->inside[set->inside_count++] = i;
+			map_set(set->inside_map, i, true);
+			break;
+		}
+	}
+
+	set->located = true;
+}
+
+bool geofence_test(const struct geofence_set *set, size_t index,
+		   const struct geofence_point *pos)
+{
+	const struct geofence *fence = &set->fences[index];
+
+	if (!box_contains(&fence->box, pos)) {
+		return false;
+	}
+
+	if (fence->type == GEOFENCE_CIRCLE) {
+		return circle_contains(fence, pos);
+	}
+
+	return polygon_contains(&set->vertices[fence->polygon.first],
+				fence->polygon.count, pos);
+}
+
+size_t geofence_update(struct geofence_set *set,
+		       const struct geofence_point *pos,
+		       struct geofence_event *events, size_t max_events)
+{
+	u16_t inside[GEOFENCE_MAX_COUNT];
+	size_t found = 0;
+	size_t inside_count = 0;
+	size_t event_count = 0;
+
+	if (!set->indexed) {
+		return 0;
+	}
+
+	if ((set->count > 0) && box_contains(&set->bounds, pos)) {
+		size_t cell = cell_of(pos->lat, set->bounds.min.lat,
+				      set->cell_size.lat) *
+			      GEOFENCE_GRID_SIZE +
+			      cell_of(pos->lon, set->bounds.min.lon,
+				      set->cell_size.lon);
+
+		for (size_t i = set->cell_start[cell];
+		     i < set->cell_start[cell + 1]; i++) {
+			if (geofence_test(set, set->cell_fences[i], pos)) {
+				inside[found++] = set->cell_fences[i];
+			}
+		}
+	}
+
+	/* Geofences still inside are cleared from the map, so that the
+	 * ones left in the map are the ones that were left. A crossing that
+	 * does not fit in the events is not taken, so that it is found
+	 * again by the next fix.
+	 */
+	for (size_t i = 0; i < found; i++) {
+		if (map_get(set->inside_map, inside[i])) {
+			map_set(set->inside_map, inside[i], false);
+		} else if (set->located) {
+			if (event_count == max_events) {
+				continue;
+			}
+
+			events[event_count].id = set->fences[inside[i]].id;
+			events[event_count].inside = true;
+			event_count++;
+		}
+
+		inside[inside_count++] = inside[i];
+	}
+
+	for (size_t i = 0; i < set->inside_count; i++) {
+		if (!map_get(set->inside_map, set->inside[i])) {
+			continue;
+		}
+
+		map_set(set->inside_map, set->inside[i], false);
+
+		if (event_count < max_events) {
+			events[event_count].id = set->fences[set->inside[i]].id;
+			events[event_count].inside = false;
+			event_count++;
+		} else {
+			inside[inside_count++] = set->inside[i];
+		}
+	}
+
+	for (size_t i = 0; i < inside_count; i++) {
+		map_set(set->inside_map, inside[i], true);
+		set->inside[i] = inside[i];
+	}
+
+	set->inside_count = inside_count;
+	set->located = true;
+
+	return event_count;
+}
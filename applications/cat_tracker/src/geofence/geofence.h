@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *
+ * @brief   Geofences with a grid index, tested on every GPS fix.
+ */
+
+#ifndef GEOFENCE_H__
+#define GEOFENCE_H__
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GEOFENCE_MAX_COUNT CONFIG_GEOFENCE_MAX_COUNT
+#define GEOFENCE_GRID_SIZE CONFIG_GEOFENCE_GRID_SIZE
+#define GEOFENCE_GRID_CELLS (GEOFENCE_GRID_SIZE * GEOFENCE_GRID_SIZE)
+
+/** Number of micro degrees in one degree. */
+#define GEOFENCE_UDEG_PER_DEG 1000000
+
+/**@brief Position in micro degrees.
+ *
+ * Geofences are tested in a plane of latitude and longitude, so they must
+ * not cross the antimeridian or a pole.
+ */
+struct geofence_point {
+	s32_t lat;
+	s32_t lon;
+};
+
+struct geofence_box {
+	struct geofence_point min;
+	struct geofence_point max;
+};
+
+enum geofence_type {
+	GEOFENCE_CIRCLE,
+	GEOFENCE_POLYGON,
+};
+
+struct geofence {
+	u16_t id;
+	enum geofence_type type;
+	struct geofence_box box;
+	union {
+		struct {
+			struct geofence_point center;
+			/** Radius in micro degrees of latitude. */
+			u32_t radius;
+			/** Cosine of the latitude, to scale longitudes
+			 *  [1/65536].
+			 */
+			u32_t lon_scale;
+		} circle;
+		struct {
+			/** Index of the first vertex in the set. */
+			u16_t first;
+			u16_t count;
+		} polygon;
+	};
+};
+
+/**@brief Crossing of a geofence. */
+struct geofence_event {
+	u16_t id;
+	/** true when entering the geofence, false when leaving it. */
+	bool inside;
+};
+
+/**@brief Set of geofences, with the grid index and the geofences the
+ *        last fix was inside.
+ */
+struct geofence_set {
+	struct geofence fences[GEOFENCE_MAX_COUNT];
+	size_t count;
+	struct geofence_point vertices[CONFIG_GEOFENCE_VERTICES_MAX];
+	size_t vertex_count;
+
+	/* Grid index over the bounding box of all geofences. The geofences
+	 * of cell i are cell_fences[cell_start[i]] up to
+	 * cell_fences[cell_start[i + 1]].
+	 */
+	struct geofence_box bounds;
+	struct geofence_point cell_size;
+	u16_t cell_start[GEOFENCE_GRID_CELLS + 1];
+	u16_t cell_fences[CONFIG_GEOFENCE_GRID_ENTRIES];
+	bool indexed;
+
+	u16_t inside[GEOFENCE_MAX_COUNT];
+	size_t inside_count;
+	u32_t inside_map[(GEOFENCE_MAX_COUNT + 31) / 32];
+	bool located;
+};
+
+/**@brief Convert degrees to micro degrees. */
+s32_t geofence_udeg(double deg);
+
+/**@brief Remove all geofences from a set. */
+void geofence_init(struct geofence_set *set);
+
+/**@brief Add a circle to a set.
+ *
+ * @param set Set of geofences.
+ * @param id Identifier reported in events, unique in the set.
+ * @param center Center of the circle.
+ * @param radius Radius in meters.
+ *
+ * @return 0 on success, -ENOMEM if the set is full, -EEXIST if the id is
+ *         used, or -EINVAL if the circle is invalid.
+ */
+int geofence_add_circle(struct geofence_set *set, u16_t id,
+			const struct geofence_point *center, u32_t radius);
+
+/**@brief Add a polygon to a set. The vertices are copied.
+ *
+ * @param set Set of geofences.
+ * @param id Identifier reported in events, unique in the set.
+ * @param vertices Vertices, in order along the edge.
+ * @param count Number of vertices, at least 3.
+ *
+ * @return 0 on success, -ENOMEM if the set is full, -EEXIST if the id is
+ *         used, or -EINVAL if the polygon is invalid.
+ */
+int geofence_add_polygon(struct geofence_set *set, u16_t id,
+			 const struct geofence_point *vertices, size_t count);
+
+/**@brief Build the grid index of a set.
+ *
+ * Must be called after the geofences are added and before the set is
+ * updated. The next update only finds the geofences the fix is inside,
+ * without reporting crossings.
+ *
+ * @return 0 on success, or -ENOMEM if the index is full.
+ */
+int geofence_index(struct geofence_set *set);
+
+/**@brief Get the geofences the last fix was inside.
+ *
+ * @param set Set of geofences.
+ * @param ids Ids of the geofences, room for GEOFENCE_MAX_COUNT.
+ *
+ * @return Number of ids, or -ENODATA if the set has not had a fix.
+ */
+int geofence_inside_get(const struct geofence_set *set, u16_t *ids);
+
+/**@brief Set the geofences the last fix was inside, by id.
+ *
+ * Used when a set is replaced, so that the next update only reports
+ * crossings of the geofences kept in the set as real crossings. Ids that
+ * are not in the set are ignored. Must be called after geofence_index().
+ *
+ * @param set Indexed set of geofences.
+ * @param ids Ids from geofence_inside_get().
+ * @param count Number of ids.
+ */
+void geofence_inside_set(struct geofence_set *set, const u16_t *ids,
+			 size_t count);
+
+/**@brief Test if a position is inside a geofence of a set.
+ *
+ * @param set Set of geofences.
+ * @param index Index of the geofence in the set.
+ * @param pos Position.
+ */
+bool geofence_test(const struct geofence_set *set, size_t index,
+		   const struct geofence_point *pos);
+
+/**@brief Update a set with a fix, and get the geofences crossed since the
+ *        last fix.
+ *
+ * Only the geofences in the cell of the fix, and the ones the last fix was
+ * inside, are tested.
+ *
+ * @param set Indexed set of geofences.
+ * @param pos Position of the fix.
+ * @param events Crossings since the last fix.
+ * @param max_events Size of @p events. Geofences of further crossings
+ *                   are left as they were, so that the crossings are
+ *                   reported by a later update.
+ *
+ * @return Number of crossings stored in @p events.
+ */
+size_t geofence_update(struct geofence_set *set,
+		       const struct geofence_point *pos,
+		       struct geofence_event *events, size_t max_events);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GEOFENCE_H__ */
@@ -12,8 +12,16 @@
 #include <ui.h>
 #include <net/cloud.h>
 #include <cloud_codec.h>
+#if defined(CONFIG_MOTION)
+#include <motion.h>
+#include <activity.h>
+#endif
+#if defined(CONFIG_GEOFENCE)
+#include <geofence.h>
+#endif
 #include <lte_lc.h>
 #include <stdlib.h>
+#include <math.h>
 #include <modem_info.h>
 #include <time.h>
 #include <nrf_socket.h>
@@ -39,7 +47,7 @@ struct cloud_data cloud_data = { .gps_timeout = 1000,
 				 .active_wait = 30,
 				 .passive_wait = 300,
 				 .movement_timeout = 3600,
-				 .accel_threshold = 100,
+				 .accel_threshold = 5,
 				 .gps_found = false };
 
 struct k_timer governing_timer;
@@ -59,11 +67,42 @@ static int rsrp;
 static int head_cir_buf;
 static int num_queued_entries;
 
+/* Messages submitted with cloud_send_async() and not yet sent. */
+static atomic_t pending_msgs;
+static bool send_async_supported = true;
+
 static struct k_work cloud_ack_config_change_work;
 
+#if defined(CONFIG_MOTION)
+static struct activity_classifier classifier;
+/* Set at boot and while moving, cleared when a fix is taken. */
+static atomic_t moved = ATOMIC_INIT(1);
+#endif
+
+#if defined(CONFIG_LTE_LINK_STATE)
+/* Set while an asynchronous reconnect is in progress. */
+static atomic_t lte_reconnecting;
+#endif
+
 K_SEM_DEFINE(accel_trig_sem, 0, 1);
 K_SEM_DEFINE(gps_timeout_sem, 0, 1);
 
+#if defined(CONFIG_GEOFENCE)
+#define GEOFENCE_EVENTS_MAX 8
+
+static struct geofence_set geofences;
+
+/* Crossings not yet published. */
+static struct cloud_data_geofence geofence_events[GEOFENCE_EVENTS_MAX];
+static size_t geofence_event_count;
+
+/* Protects the geofences, which are set from the cloud and tested on GPS
+ * fixes, and the crossings.
+ */
+K_MUTEX_DEFINE(geofence_mutex);
+K_SEM_DEFINE(geofence_sem, 0, 1);
+#endif
+
 void error_handler(enum error_type err_type, int err_code)
 {
 #if !defined(CONFIG_DEBUG) && defined(CONFIG_REBOOT)
@@ -119,6 +158,18 @@ void cloud_error_handler(int err)
 	error_handler(ERROR_CLOUD, err);
 }
 
+/* The position only changes if the tracker moved since the last fix.
+ * Without activity classification, it is assumed to be moving.
+ */
+static bool moved_since_fix(void)
+{
+#if defined(CONFIG_MOTION)
+	return atomic_get(&moved) != 0;
+#else
+	return true;
+#endif
+}
+
 static int check_active_wait(void)
 {
 	if (!cloud_data.active) {
@@ -202,6 +253,69 @@ static int cloud_process_and_sleep(int timeout)
 	return 0;
 }
 
+static int cloud_send_msg(struct cloud_msg *msg)
+{
+	int err;
+
+	if (send_async_supported) {
+		/* Counted first, as the message may be sent before the call
+		 * returns when another thread processes cloud input.
+		 */
+		atomic_inc(&pending_msgs);
+
+		err = cloud_send_async(cloud_backend, msg);
+		if (err == 0) {
+			return 0;
+		}
+
+		atomic_dec(&pending_msgs);
+
+		if (err != -ENOTSUP) {
+			return err;
+		}
+
+		send_async_supported = false;
+	}
+
+	return cloud_send(cloud_backend, msg);
+}
+
+/* Process cloud data until all submitted messages have been sent, or until
+ * the timeout expires. Without asynchronous sending, the whole timeout is
+ * spent processing.
+ */
+static int cloud_flush(int timeout)
+{
+	s64_t remaining = timeout;
+	s64_t start_time = k_uptime_get();
+	int err;
+
+	if (!send_async_supported) {
+		return cloud_process_and_sleep(timeout);
+	}
+
+	while (remaining > 0 && cloud_connected &&
+	       atomic_get(&pending_msgs) > 0) {
+		cloud_wait(remaining);
+
+		err = cloud_ping(cloud_backend);
+		if (err != 0) {
+			printk("cloud_ping error: %d\n", err);
+			return err;
+		}
+
+		err = cloud_input(cloud_backend);
+		if (err != 0) {
+			printk("cloud_input error: %d\n", err);
+			return err;
+		}
+
+		remaining = timeout + start_time - k_uptime_get();
+	}
+
+	return 0;
+}
+
 static int cloud_connect_process(void)
 {
 	int err;
@@ -259,17 +373,12 @@ static void set_current_time(struct gps_data gps_data)
 	cloud_data_time.update_time = k_uptime_get();
 }
 
+/* The threshold is configured in tenths of m/s^2, and is compared with the
+ * acceleration with gravity removed.
+ */
 static double get_accel_thres(void)
 {
-	double accel_threshold_double;
-
-	if (cloud_data.accel_threshold == 0) {
-		accel_threshold_double = 0;
-	} else {
-		accel_threshold_double = cloud_data.accel_threshold / 10;
-	}
-
-	return accel_threshold_double;
+	return cloud_data.accel_threshold / 10.0;
 }
 
 static void populate_gps_buffer(struct gps_data gps_data)
@@ -322,16 +431,10 @@ static void cloud_pair(void)
 		.buf = "",
 		.len = 0 };
 
-	err = cloud_send(cloud_backend, &msg);
+	err = cloud_send_msg(&msg);
 	if (err != 0) {
 		printk("Cloud send failed, err: %d\n", err);
 	}
-
-	cloud_process_and_sleep(CONFIG_CLOUD_POLL_WAIT);
-	if (err != 0) {
-		printk("cloud_process_and_sleep error: %d\n", err);
-		cloud_disconnect_process();
-	}
 }
 
 static void cloud_ack_config_change(void)
@@ -343,21 +446,28 @@ static void cloud_ack_config_change(void)
 		.endpoint.type = CLOUD_EP_TOPIC_MSG,
 	};
 
+#if defined(CONFIG_GEOFENCE)
+	/* The geofences set are reported back. */
+	k_mutex_lock(&geofence_mutex, K_FOREVER);
+#endif
 	err = cloud_encode_cfg_data(&msg, &cloud_data);
+#if defined(CONFIG_GEOFENCE)
+	k_mutex_unlock(&geofence_mutex);
+#endif
 	if (err != 0) {
 		printk("Error enconding configurations %d\n", err);
 		return;
 	}
 
-	err = cloud_send(cloud_backend, &msg);
+	err = cloud_send_msg(&msg);
 	if (err != 0) {
 		printk("Cloud send failed, err: %d\n", err);
 		return;
 	}
 
-	err = cloud_process_and_sleep(CONFIG_CLOUD_POLL_WAIT);
+	err = cloud_flush(CONFIG_CLOUD_POLL_WAIT);
 	if (err != 0) {
-		printk("cloud_process_and_sleep error: %d\n", err);
+		printk("cloud_flush error: %d\n", err);
 		cloud_disconnect_process();
 	}
 }
@@ -385,20 +495,61 @@ static void cloud_send_sensor_data(void)
 		return;
 	}
 
-	err = cloud_send(cloud_backend, &msg);
+	err = cloud_send_msg(&msg);
 	if (err != 0) {
 		printk("Cloud send failed, err: %d\n", err);
 		return;
 	}
 
-	cloud_process_and_sleep(CONFIG_CLOUD_POLL_WAIT);
+	cloud_data.gps_found = false;
+}
+
+#if defined(CONFIG_GEOFENCE)
+static void cloud_send_geofence_data(void)
+{
+	int err;
+	size_t count;
+
+	struct cloud_msg msg = {
+		/* Crossings are alerts, so they are acknowledged. */
+		.qos = CLOUD_QOS_AT_LEAST_ONCE,
+		.endpoint.type = CLOUD_EP_TOPIC_MSG,
+	};
+
+	k_mutex_lock(&geofence_mutex, K_FOREVER);
+
+	count = geofence_event_count;
+	if (count == 0) {
+		k_mutex_unlock(&geofence_mutex);
+		return;
+	}
+
+	err = cloud_encode_geofence_data(&msg, geofence_events, count,
+					 &cloud_data_time);
+
+	k_mutex_unlock(&geofence_mutex);
+
 	if (err != 0) {
-		printk("cloud_process_and_sleep error: %d\n", err);
-		cloud_disconnect_process();
+		printk("Error encoding geofence crossings %d\n", err);
+		return;
 	}
 
-	cloud_data.gps_found = false;
+	err = cloud_send_msg(&msg);
+	if (err != 0) {
+		printk("Cloud send failed, err: %d\n", err);
+		return;
+	}
+
+	/* Crossings found while sending are kept for the next message. */
+	k_mutex_lock(&geofence_mutex, K_FOREVER);
+
+	geofence_event_count -= count;
+	memmove(geofence_events, &geofence_events[count],
+		geofence_event_count * sizeof(geofence_events[0]));
+
+	k_mutex_unlock(&geofence_mutex);
 }
+#endif
 
 #if defined(CONFIG_MODEM_INFO)
 static void cloud_send_modem_data(int inc_dyn_data)
@@ -423,17 +574,11 @@ static void cloud_send_modem_data(int inc_dyn_data)
 		return;
 	}
 
-	err = cloud_send(cloud_backend, &msg);
+	err = cloud_send_msg(&msg);
 	if (err != 0) {
 		printk("Cloud send failed, err: %d\n", err);
 		return;
 	}
-
-	cloud_process_and_sleep(CONFIG_CLOUD_POLL_WAIT);
-	if (err != 0) {
-		printk("cloud_process_and_sleep error: %d\n", err);
-		cloud_disconnect_process();
-	}	
 }
 #endif
 
@@ -461,7 +606,7 @@ static void cloud_send_buffered_data(void)
 			goto end;
 		}
 
-		err = cloud_send(cloud_backend, &msg);
+		err = cloud_send_msg(&msg);
 		if (err != 0) {
 			printk("Cloud send failed, err: %d\n", err);
 			goto end;
@@ -470,11 +615,6 @@ static void cloud_send_buffered_data(void)
 		num_queued_entries -= CONFIG_CIRCULAR_SENSOR_BUFFER_MAX;
 	}
 
-	cloud_process_and_sleep(CONFIG_CLOUD_POLL_WAIT);
-	if (err != 0) {
-		printk("cloud_process_and_sleep error: %d\n", err);
-		cloud_disconnect_process();
-	}
 end:
 	num_queued_entries = 0;
 	queued_entries = false;
@@ -482,6 +622,8 @@ end:
 
 static void cloud_pairing(void)
 {
+	int err;
+
 	ui_led_set_pattern(UI_CLOUD_CONNECTED);
 
 	cloud_connect_process();
@@ -491,14 +633,29 @@ static void cloud_pairing(void)
 #if defined(CONFIG_MODEM_INFO)
 	cloud_send_modem_data(false);
 #endif
+
+	/* Wait the full period, the pairing response is expected after the
+	 * messages have been sent.
+	 */
+	err = cloud_process_and_sleep(CONFIG_CLOUD_POLL_WAIT);
+	if (err != 0) {
+		printk("cloud_process_and_sleep error: %d\n", err);
+		cloud_disconnect_process();
+	}
 }
 
 static void cloud_process_cycle(void)
 {
+	int err;
+
 	ui_led_set_pattern(UI_CLOUD_CONNECTED);
 
 	cloud_connect_process();
 
+#if defined(CONFIG_GEOFENCE)
+	cloud_send_geofence_data();
+#endif
+
 #if defined(CONFIG_SENSOR_DATA_SEND)
 	cloud_send_sensor_data();
 #endif
@@ -510,6 +667,12 @@ static void cloud_process_cycle(void)
 #if defined(CONFIG_BUFFERED_DATA_SEND)
 	cloud_send_buffered_data();
 #endif
+
+	err = cloud_flush(CONFIG_CLOUD_POLL_WAIT);
+	if (err != 0) {
+		printk("cloud_flush error: %d\n", err);
+		cloud_disconnect_process();
+	}
 }
 
 static void cloud_ack_config_change_work_fn(struct k_work *work)
@@ -522,6 +685,51 @@ static void work_init(void)
 	k_work_init(&cloud_ack_config_change_work, cloud_ack_config_change_work_fn);
 }
 
+#if defined(CONFIG_MOTION)
+static void motion_handler(const struct motion_block *block,
+			   const struct motion_features *features)
+{
+	static s64_t next_trig_time;
+	s64_t now = k_uptime_get();
+	double move_min;
+
+	ARG_UNUSED(block);
+
+	/* The threshold may be changed from the cloud at any time.
+	 * SENSOR_G is given in micro m/s^2.
+	 */
+	move_min = get_accel_thres() * 1000000000.0 / SENSOR_G;
+	classifier.model.move_min = MIN(MAX(move_min, 0), UINT16_MAX);
+
+	if (activity_update(&classifier, features)) {
+		printk("Activity: %s\n", activity_name(classifier.activity));
+
+		cloud_data.activity = activity_name(classifier.activity);
+		cloud_data.activity_timestamp = now;
+
+		for (size_t i = 0; i < ARRAY_SIZE(cloud_data.acc); i++) {
+			cloud_data.acc[i] =
+				features->mean[i] * (SENSOR_G / 1000000000.0);
+		}
+
+		cloud_data.acc_timestamp = now;
+	}
+
+	if (classifier.activity == ACTIVITY_REST) {
+		return;
+	}
+
+	atomic_set(&moved, 1);
+
+	/* Moving starts a GPS and cloud cycle in passive mode, at most once
+	 * per cycle, for as long as it lasts.
+	 */
+	if (now >= next_trig_time) {
+		next_trig_time = now + K_SECONDS(check_active_wait());
+		k_sem_give(&accel_trig_sem);
+	}
+}
+#else
 static void adxl362_trigger_handler(struct device *dev,
 				    struct sensor_trigger *trig)
 {
@@ -542,10 +750,10 @@ static void adxl362_trigger_handler(struct device *dev,
 		double x = sensor_value_to_double(&accel[0]);
 		double y = sensor_value_to_double(&accel[1]);
 		double z = sensor_value_to_double(&accel[2]);
+		double mag = sqrt(x * x + y * y + z * z);
 
-		if ((abs(x) > get_accel_thres()) ||
-		    (abs(y) > get_accel_thres()) ||
-		    (abs(z) > get_accel_thres())) {
+		/* At rest, the magnitude is gravity on any axis. */
+		if (fabs(mag - SENSOR_G / 1000000.0) > get_accel_thres()) {
 			cloud_data.acc[0] = x;
 			cloud_data.acc[1] = y;
 			cloud_data.acc[2] = z;
@@ -558,6 +766,43 @@ static void adxl362_trigger_handler(struct device *dev,
 		printk("Unknown trigger\n");
 	}
 }
+#endif
+
+#if defined(CONFIG_GEOFENCE)
+static void geofence_check(const struct gps_data *gps_data)
+{
+	struct geofence_event events[GEOFENCE_EVENTS_MAX];
+	struct geofence_point pos = {
+		.lat = geofence_udeg(gps_data->pvt.latitude),
+		.lon = geofence_udeg(gps_data->pvt.longitude),
+	};
+	size_t count;
+
+	k_mutex_lock(&geofence_mutex, K_FOREVER);
+
+	/* Crossings that do not fit are found again by a later fix. */
+	count = geofence_update(&geofences, &pos, events,
+				GEOFENCE_EVENTS_MAX - geofence_event_count);
+
+	for (size_t i = 0; i < count; i++) {
+		struct cloud_data_geofence *event =
+			&geofence_events[geofence_event_count++];
+
+		printk("Geofence %d %s\n", events[i].id,
+		       events[i].inside ? "entered" : "left");
+
+		event->id = events[i].id;
+		event->inside = events[i].inside;
+		event->timestamp = k_uptime_get();
+	}
+
+	k_mutex_unlock(&geofence_mutex);
+
+	if (count > 0) {
+		k_sem_give(&geofence_sem);
+	}
+}
+#endif
 
 static void gps_trigger_handler(struct device *dev, struct gps_trigger *trigger)
 {
@@ -578,6 +823,16 @@ static void gps_trigger_handler(struct device *dev, struct gps_trigger *trigger)
 	set_current_time(gps_data);
 	populate_gps_buffer(gps_data);
 	gps_control_stop(1);
+
+#if defined(CONFIG_MOTION)
+	atomic_clear(&moved);
+#endif
+
+#if defined(CONFIG_GEOFENCE)
+	geofence_check(&gps_data);
+#endif
+
+	k_sem_give(&gps_timeout_sem);
 }
 
 static void adxl362_init(void)
@@ -589,6 +844,21 @@ static void adxl362_init(void)
 		return;
 	}
 
+#if defined(CONFIG_MOTION)
+	const struct activity_model model = {
+		.rest_var_max = CONFIG_ACTIVITY_REST_VAR_MAX,
+		.run_var_min = CONFIG_ACTIVITY_RUN_VAR_MIN,
+		.run_peaks_min = CONFIG_ACTIVITY_RUN_PEAKS_MIN,
+		.climb_horizontal_min = CONFIG_ACTIVITY_CLIMB_HORIZONTAL_MIN,
+	};
+
+	activity_init(&classifier, &model, CONFIG_ACTIVITY_CONFIRM_BLOCKS);
+
+	/* Samples are read from the FIFO in blocks instead. */
+	if (motion_init(motion_handler)) {
+		printk("Motion init error\n");
+	}
+#else
 	if (IS_ENABLED(CONFIG_ADXL362_TRIGGER)) {
 		struct sensor_trigger trig = { .chan = SENSOR_CHAN_ACCEL_XYZ };
 
@@ -598,6 +868,7 @@ static void adxl362_init(void)
 			return;
 		}
 	}
+#endif
 }
 
 void cloud_event_handler(const struct cloud_backend *const backend,
@@ -624,12 +895,21 @@ void cloud_event_handler(const struct cloud_backend *const backend,
 		printk("CLOUD_EVT_ERROR\n");
 		break;
 	case CLOUD_EVT_DATA_SENT:
-		printk("CLOUD_EVT_DATA_SENT\n");
+		printk("CLOUD_EVT_DATA_SENT, id: %d\n", evt->data.msg.id);
+		if (send_async_supported && atomic_get(&pending_msgs) > 0) {
+			atomic_dec(&pending_msgs);
+		}
 		break;
 	case CLOUD_EVT_DATA_RECEIVED:
 		printk("CLOUD_EVT_DATA_RECEIVED\n");
 		if (evt->data.msg.len > 2) {
+#if defined(CONFIG_GEOFENCE)
+			k_mutex_lock(&geofence_mutex, K_FOREVER);
+#endif
 			err = cloud_decode_response(evt->data.msg.buf, &cloud_data);
+#if defined(CONFIG_GEOFENCE)
+			k_mutex_unlock(&geofence_mutex);
+#endif
 			if (err != 0) {
 				printk("Could not decode response %d\n", err);
 			}
@@ -648,15 +928,47 @@ void cloud_event_handler(const struct cloud_backend *const backend,
 	}
 }
 
-static void lte_connect(enum lte_conn_actions action)
+#if defined(CONFIG_LTE_LINK_STATE)
+static bool lte_registered(enum lte_lc_nw_reg_status nw_reg_status)
+{
+	return (nw_reg_status == LTE_LC_NW_REG_REGISTERED_HOME) ||
+	       (nw_reg_status == LTE_LC_NW_REG_REGISTERED_ROAMING);
+}
+
+static void lte_evt_handler(const struct lte_lc_evt *evt)
+{
+	if (evt->type != LTE_LC_EVT_NW_REG_STATUS) {
+		return;
+	}
+
+	if (lte_registered(evt->nw_reg_status)) {
+		if (atomic_get(&lte_reconnecting)) {
+			printk("LTE registered\n");
+			ui_led_set_pattern(UI_LTE_CONNECTED);
+		}
+	} else {
+		printk("LTE registration status: %d\n", evt->nw_reg_status);
+	}
+}
+#endif
+
+/* Returns true if the LTE link is up. */
+static bool lte_connect(enum lte_conn_actions action)
 {
 	int err;
+	bool reconnected = false;
 
 	enum lte_lc_nw_reg_status nw_reg_status;
 
 	ui_led_set_pattern(UI_LTE_CONNECTING);
 
 	if (action == LTE_INIT) {
+#if defined(CONFIG_LTE_LINK_STATE)
+		err = lte_lc_register_handler(lte_evt_handler);
+		if (err != 0) {
+			printk("lte_lc_register_handler error: %d\n", err);
+		}
+#endif
 		if (IS_ENABLED(CONFIG_LTE_AUTO_INIT_AND_CONNECT)) {
 			/* Do nothing, modem is already turned on
 			 * and connected.
@@ -671,6 +983,9 @@ static void lte_connect(enum lte_conn_actions action)
 			}
 		}
 	} else if (action == LTE_CYCLE) {
+		/* The status is cached with CONFIG_LTE_LINK_STATE, no AT
+		 * commands are sent.
+		 */
 		err = lte_lc_nw_reg_status_get(&nw_reg_status);
 		if (err != 0) {
 			printk("lte_lc_nw_reg_status error: %d\n", err);
@@ -680,12 +995,29 @@ static void lte_connect(enum lte_conn_actions action)
 		switch(nw_reg_status) {
 			case LTE_LC_NW_REG_REGISTERED_HOME:
 				printk("REGISTERED TO HOME NETWORK\n");
-				return;
+				break;
 			case LTE_LC_NW_REG_REGISTERED_ROAMING:
 				printk("REGISTERED TO ROAMING NETWORK\n");
-				return;
+				break;
 			default:
 				printk("LTE not connected.\n");
+#if defined(CONFIG_LTE_LINK_STATE)
+				/* Registration is reported to lte_evt_handler,
+				 * and picked up in a later cycle.
+				 */
+				if (atomic_set(&lte_reconnecting, 1)) {
+					return false;
+				}
+				printk("Connecting to LTE network.\n");
+				err = lte_lc_connect_async();
+				if (err != 0) {
+					printk("lte_lc_connect_async error: %d\n",
+					       err);
+					atomic_clear(&lte_reconnecting);
+					goto gps_mode;
+				}
+				return false;
+#else
 				printk("Connecting to LTE network. ");
 				printk("This may take several minutes.\n");
 				err = lte_lc_init_and_connect();
@@ -693,7 +1025,17 @@ static void lte_connect(enum lte_conn_actions action)
 					printk("LTE link could not be established.\n");
 					goto gps_mode;
 				}
+				reconnected = true;
 				break;
+#endif
+		}
+
+#if defined(CONFIG_LTE_LINK_STATE)
+		/* Pair again once an asynchronous reconnect has completed. */
+		reconnected = atomic_clear(&lte_reconnecting);
+#endif
+		if (!reconnected) {
+			return true;
 		}
 	}
 
@@ -711,11 +1053,11 @@ static void lte_connect(enum lte_conn_actions action)
 #endif
 	ui_led_set_pattern(UI_LTE_CONNECTED);
 	cloud_pairing();
-	return;
+	return true;
 
 gps_mode:
 	lte_lc_gps_nw_mode();
-	return;
+	return false;
 }
 
 #if defined(CONFIG_MODEM_INFO)
@@ -753,6 +1095,10 @@ void main(void)
 	printk("The cat tracker has started\n");
 	printk("Version: %s\n", DEVICE_APP_VERSION);
 
+#if defined(CONFIG_GEOFENCE)
+	cloud_data.geofences = &geofences;
+#endif
+
 	cloud_backend = cloud_get_binding("BIFRAVST_CLOUD");
 	__ASSERT(cloud_backend != NULL, "Bifravst Cloud backend not found");
 
@@ -784,15 +1130,25 @@ check_mode:
 		}
 	}
 
-	gps_control_start(1);
-	if (k_sem_take(&gps_timeout_sem, K_SECONDS(cloud_data.gps_timeout))) {
-		gps_control_stop(1);
+	/* The last fix is still valid if the tracker has not moved. */
+	if (moved_since_fix()) {
+		gps_control_start(1);
+		if (k_sem_take(&gps_timeout_sem,
+			       K_SECONDS(cloud_data.gps_timeout))) {
+			gps_control_stop(1);
+		}
 	}
 
+#if defined(CONFIG_GEOFENCE)
+	/* A geofence crossing ends the wait, to be published at once. */
+	k_sem_take(&geofence_sem, K_SECONDS(check_active_wait()));
+#else
 	k_sleep(K_SECONDS(check_active_wait()));
+#endif
 
-	lte_connect(LTE_CYCLE);
-	cloud_process_cycle();
+	if (lte_connect(LTE_CYCLE)) {
+		cloud_process_cycle();
+	}
 
 goto check_mode;
 
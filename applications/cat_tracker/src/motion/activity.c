@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include "activity.h"
+
+void activity_init(struct activity_classifier *classifier,
+		   const struct activity_model *model, u8_t confirm_windows)
+{
+	classifier->model = *model;
+	classifier->confirm_windows = confirm_windows;
+	classifier->activity = ACTIVITY_REST;
+	classifier->candidate = ACTIVITY_REST;
+	classifier->candidate_windows = 0;
+}
+
+enum activity activity_classify(const struct activity_model *model,
+				const struct motion_features *features)
+{
+	s32_t x = features->mean[0];
+	s32_t y = features->mean[1];
+	u32_t climb_min = model->climb_horizontal_min;
+
+	if ((features->mag_var <= model->rest_var_max) &&
+	    (features->peak_count == 0)) {
+		return ACTIVITY_REST;
+	}
+
+	if (features->mag_dev_max < model->move_min) {
+		return ACTIVITY_REST;
+	}
+
+	/* Compared squared, to avoid the square root. */
+	if ((u32_t)(x * x + y * y) >= climb_min * climb_min) {
+		return ACTIVITY_CLIMB;
+	}
+
+	if ((features->mag_var >= model->run_var_min) ||
+	    (features->peak_count >= model->run_peaks_min)) {
+		return ACTIVITY_RUN;
+	}
+
+	return ACTIVITY_WALK;
+}
+
+bool activity_update(struct activity_classifier *classifier,
+		     const struct motion_features *features)
+{
+	enum activity activity = activity_classify(&classifier->model,
+						   features);
+
+	if (activity == classifier->activity) {
+		classifier->candidate_windows = 0;
+		return false;
+	}
+
+	if (activity != classifier->candidate) {
+		classifier->candidate = activity;
+		classifier->candidate_windows = 0;
+	}
+
+	if (++classifier->candidate_windows < classifier->confirm_windows) {
+		return false;
+	}
+
+	classifier->activity = activity;
+	classifier->candidate_windows = 0;
+
+	return true;
+}
+
+const char *activity_name(enum activity activity)
+{
+	switch (activity) {
+	case ACTIVITY_REST:
+		return "rest";
+	case ACTIVITY_WALK:
+		return "walk";
+	case ACTIVITY_RUN:
+		return "run";
+	case ACTIVITY_CLIMB:
+		return "climb";
+	default:
+		return "unknown";
+	}
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *
+ * @brief   Activity classification from motion features.
+ */
+
+#ifndef ACTIVITY_H__
+#define ACTIVITY_H__
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include "motion_features.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum activity {
+	ACTIVITY_REST,
+	ACTIVITY_WALK,
+	ACTIVITY_RUN,
+	ACTIVITY_CLIMB,
+};
+
+/**@brief Thresholds of the classifier. Each block of samples is a window.
+ *
+ * A window is rest if the magnitude is steady and has no peaks, or if it
+ * never deviates from its mean by @p move_min or more. Otherwise,
+ * it is climb if gravity is mostly along the horizontal axes, run if the
+ * magnitude varies much or has many peaks, and walk if not.
+ */
+struct activity_model {
+	/** Largest variance of the magnitude at rest [mg^2]. */
+	u32_t rest_var_max;
+	/** Smallest variance of the magnitude when running [mg^2]. */
+	u32_t run_var_min;
+	/** Smallest number of peaks per window when running. */
+	u16_t run_peaks_min;
+	/** Smallest horizontal part of the mean acceleration when
+	 *  climbing [mg].
+	 */
+	u16_t climb_horizontal_min;
+	/** Smallest deviation of the magnitude from its mean for a window to
+	 *  be moving [mg]. 0 to tell rest by the variance and peaks only.
+	 */
+	u16_t move_min;
+};
+
+struct activity_classifier {
+	struct activity_model model;
+	/** Number of windows a new activity must last before it is taken. */
+	u8_t confirm_windows;
+	enum activity activity;
+	enum activity candidate;
+	u8_t candidate_windows;
+};
+
+/**@brief Initialize a classifier, starting at rest. */
+void activity_init(struct activity_classifier *classifier,
+		   const struct activity_model *model, u8_t confirm_windows);
+
+/**@brief Classify one window, without history. */
+enum activity activity_classify(const struct activity_model *model,
+				const struct motion_features *features);
+
+/**@brief Update the classifier with a window.
+ *
+ * @return true if the activity changed.
+ */
+bool activity_update(struct activity_classifier *classifier,
+		     const struct motion_features *features);
+
+/**@brief Get the name of an activity, as reported to the cloud. */
+const char *activity_name(enum activity activity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ACTIVITY_H__ */
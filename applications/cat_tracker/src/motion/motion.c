@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <spi.h>
+#include <misc/util.h>
+
+#include "motion.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(motion, CONFIG_MOTION_LOG_LEVEL);
+
+/* The FIFO is accessed directly, as the ADXL362 driver reads one sample at
+ * a time. The driver only writes the FIFO registers during initialization.
+ */
+#define ADXL362_WRITE_REG		0x0A
+#define ADXL362_READ_REG		0x0B
+#define ADXL362_READ_FIFO		0x0D
+#define ADXL362_REG_FIFO_ENTRIES_L	0x0C
+#define ADXL362_REG_FIFO_CTL		0x28
+#define ADXL362_REG_FIFO_SAMPLES	0x29
+#define ADXL362_FIFO_CTL_STREAM		0x02
+#define ADXL362_FIFO_CTL_AH		BIT(3)
+#define ADXL362_FIFO_ENTRIES_MASK	0x3FF
+
+#define FIFO_ENTRY_SIZE		2
+#define BLOCK_ENTRIES		(MOTION_BLOCK_SIZE * 3)
+#define BLOCK_PERIOD_MS		(MOTION_BLOCK_SIZE * MSEC_PER_SEC / \
+				 CONFIG_MOTION_SAMPLE_RATE)
+#define PEAK_GAP		(CONFIG_MOTION_PEAK_GAP_MS * \
+				 CONFIG_MOTION_SAMPLE_RATE / MSEC_PER_SEC)
+
+static struct device *spi_dev;
+
+#if defined(DT_INST_0_ADI_ADXL362_CS_GPIOS_CONTROLLER)
+static struct spi_cs_control cs_ctrl;
+#endif
+
+static struct spi_config spi_cfg = {
+	.frequency = DT_INST_0_ADI_ADXL362_SPI_MAX_FREQUENCY,
+	.operation = SPI_WORD_SET(8) | SPI_TRANSFER_MSB,
+	.slave = DT_INST_0_ADI_ADXL362_BASE_ADDRESS,
+};
+
+static motion_handler_t motion_handler;
+static struct k_delayed_work read_work;
+static struct motion_block block;
+static u8_t fifo_buf[BLOCK_ENTRIES * FIFO_ENTRY_SIZE];
+
+static int reg_write(u8_t reg, u8_t val)
+{
+	u8_t cmd[] = { ADXL362_WRITE_REG, reg, val };
+	const struct spi_buf buf = { .buf = cmd, .len = sizeof(cmd) };
+	const struct spi_buf_set tx = { .buffers = &buf, .count = 1 };
+
+	return spi_write(spi_dev, &spi_cfg, &tx);
+}
+
+static int read(u8_t *cmd, size_t cmd_len, u8_t *data, size_t len)
+{
+	const struct spi_buf tx_buf = { .buf = cmd, .len = cmd_len };
+	const struct spi_buf_set tx = { .buffers = &tx_buf, .count = 1 };
+	/* The command bytes are clocked in while the command is sent. */
+	const struct spi_buf rx_bufs[] = {
+		{ .buf = cmd, .len = cmd_len },
+		{ .buf = data, .len = len },
+	};
+	const struct spi_buf_set rx = {
+		.buffers = rx_bufs,
+		.count = ARRAY_SIZE(rx_bufs)
+	};
+
+	return spi_transceive(spi_dev, &spi_cfg, &tx, &rx);
+}
+
+static int fifo_entries_get(size_t *entries)
+{
+	u8_t cmd[] = { ADXL362_READ_REG, ADXL362_REG_FIFO_ENTRIES_L };
+	u8_t data[2];
+	int err;
+
+	err = read(cmd, sizeof(cmd), data, sizeof(data));
+	if (err) {
+		return err;
+	}
+
+	*entries = (data[0] | (data[1] << 8)) & ADXL362_FIFO_ENTRIES_MASK;
+
+	return 0;
+}
+
+static void read_work_fn(struct k_work *work)
+{
+	u8_t cmd = ADXL362_READ_FIFO;
+	struct motion_features features;
+	size_t entries;
+	s32_t next = BLOCK_PERIOD_MS;
+	int err;
+
+	err = fifo_entries_get(&entries);
+	if (err) {
+		LOG_ERR("Could not get FIFO entries, error: %d", err);
+		goto exit;
+	}
+
+	if (entries > BLOCK_ENTRIES) {
+		/* Behind, read the rest right away. */
+		entries = BLOCK_ENTRIES;
+		next = K_NO_WAIT;
+	}
+
+	/* Whole samples only, the rest is read with the next block. */
+	entries -= entries % 3;
+	if (entries == 0) {
+		goto exit;
+	}
+
+	/* All samples are read in one transaction. */
+	err = read(&cmd, sizeof(cmd), fifo_buf, entries * FIFO_ENTRY_SIZE);
+	if (err) {
+		LOG_ERR("Could not read FIFO, error: %d", err);
+		goto exit;
+	}
+
+	block.count = 0;
+	motion_block_decode(&block, fifo_buf, entries * FIFO_ENTRY_SIZE,
+			    CONFIG_MOTION_MG_PER_LSB);
+	motion_features_get(&block, CONFIG_MOTION_PEAK_THRESHOLD, PEAK_GAP,
+			    &features);
+
+	LOG_DBG("%d samples, magnitude mean %d var %u, %d peaks",
+		block.count, features.mag_mean, features.mag_var,
+		features.peak_count);
+
+	motion_handler(&block, &features);
+
+exit:
+	k_delayed_work_submit(&read_work, next);
+}
+
+int motion_init(motion_handler_t handler)
+{
+	int err;
+
+	if (handler == NULL) {
+		return -EINVAL;
+	}
+
+	spi_dev = device_get_binding(DT_INST_0_ADI_ADXL362_BUS_NAME);
+	if (spi_dev == NULL) {
+		LOG_ERR("Could not get SPI device");
+		return -ENODEV;
+	}
+
+#if defined(DT_INST_0_ADI_ADXL362_CS_GPIOS_CONTROLLER)
+	cs_ctrl.gpio_dev =
+		device_get_binding(DT_INST_0_ADI_ADXL362_CS_GPIOS_CONTROLLER);
+	if (cs_ctrl.gpio_dev == NULL) {
+		LOG_ERR("Could not get GPIO device for SPI CS");
+		return -ENODEV;
+	}
+
+	cs_ctrl.gpio_pin = DT_INST_0_ADI_ADXL362_CS_GPIOS_PIN;
+	spi_cfg.cs = &cs_ctrl;
+#endif
+
+	/* The watermark is set in entries, three per sample. The ninth bit
+	 * is in the FIFO control register.
+	 */
+	err = reg_write(ADXL362_REG_FIFO_SAMPLES, BLOCK_ENTRIES & 0xFF);
+	if (!err) {
+		err = reg_write(ADXL362_REG_FIFO_CTL,
+				ADXL362_FIFO_CTL_STREAM |
+				((BLOCK_ENTRIES > 0xFF) ?
+				 ADXL362_FIFO_CTL_AH : 0));
+	}
+
+	if (err) {
+		LOG_ERR("Could not set up FIFO, error: %d", err);
+		return err;
+	}
+
+	motion_handler = handler;
+
+	k_delayed_work_init(&read_work, read_work_fn);
+	k_delayed_work_submit(&read_work, BLOCK_PERIOD_MS);
+
+	return 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *
+ * @brief   Motion module for cat tracker
+ *
+ * Reads the ADXL362 FIFO in blocks of samples and computes motion features
+ * over each block.
+ */
+
+#ifndef MOTION_H__
+#define MOTION_H__
+
+#include <zephyr.h>
+#include "motion_features.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**@brief Motion handler, called from the system work queue for each block.
+ *
+ * @param block Block of samples, valid until the handler returns.
+ * @param features Features of the block.
+ */
+typedef void (*motion_handler_t)(const struct motion_block *block,
+				 const struct motion_features *features);
+
+/**@brief Initialize the motion module.
+ *
+ * Sets the FIFO of the ADXL362 in stream mode and starts reading it once per
+ * block. The ADXL362 driver must be initialized.
+ *
+ * @param handler Handler for the blocks of samples.
+ *
+ * @return 0 if the operation is successful, negative error code otherwise.
+ */
+int motion_init(motion_handler_t handler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MOTION_H__ */
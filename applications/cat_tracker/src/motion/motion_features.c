@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <misc/util.h>
+#include "motion_features.h"
+
+#define FIFO_ENTRY_SIZE		2
+#define FIFO_TAG_SHIFT		14
+#define FIFO_TAG_X		0
+#define FIFO_TAG_Z		2
+#define FIFO_TAG_TEMP		3
+
+static u16_t isqrt(u32_t val)
+{
+	u32_t root = 0;
+	u32_t bit = 1UL << 30;
+
+	while (bit > val) {
+		bit >>= 2;
+	}
+
+	while (bit != 0) {
+		if (val >= root + bit) {
+			val -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+
+		bit >>= 2;
+	}
+
+	return root;
+}
+
+size_t motion_block_decode(struct motion_block *block, const u8_t *fifo,
+			   size_t len, u8_t mg_per_lsb)
+{
+	size_t added = 0;
+	s16_t sample[3];
+	u8_t next_tag = FIFO_TAG_X;
+
+	for (size_t i = 0; i + FIFO_ENTRY_SIZE <= len; i += FIFO_ENTRY_SIZE) {
+		u16_t entry = fifo[i] | (fifo[i + 1] << 8);
+		u8_t tag = entry >> FIFO_TAG_SHIFT;
+		/* Sign extend the 14-bit value. */
+		s16_t value = (s16_t)(entry << 2) >> 2;
+
+		if (block->count == MOTION_BLOCK_SIZE) {
+			break;
+		}
+
+		if (tag == FIFO_TAG_TEMP) {
+			continue;
+		}
+
+		if ((tag != next_tag) && (tag != FIFO_TAG_X)) {
+			/* Out of sync, wait for the start of a sample. */
+			next_tag = FIFO_TAG_X;
+			continue;
+		}
+
+		sample[tag] = value * mg_per_lsb;
+
+		if (tag < FIFO_TAG_Z) {
+			next_tag = tag + 1;
+			continue;
+		}
+
+		block->x[block->count] = sample[0];
+		block->y[block->count] = sample[1];
+		block->z[block->count] = sample[2];
+		block->count++;
+		added++;
+		next_tag = FIFO_TAG_X;
+	}
+
+	return added;
+}
+
+void motion_features_get(struct motion_block *block, u16_t peak_threshold,
+			 size_t peak_gap, struct motion_features *features)
+{
+	const size_t count = block->count;
+	s32_t sum[3] = {0};
+	u32_t mag_sum = 0;
+	u64_t mag_sum_sq = 0;
+	size_t last_peak = 0;
+	bool peak_found = false;
+	u32_t peak_level;
+
+	memset(features, 0, sizeof(*features));
+
+	if (count == 0) {
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		s32_t x = block->x[i];
+		s32_t y = block->y[i];
+		s32_t z = block->z[i];
+		u16_t mag = isqrt(x * x + y * y + z * z);
+
+		block->mag[i] = mag;
+
+		sum[0] += x;
+		sum[1] += y;
+		sum[2] += z;
+
+		mag_sum += mag;
+		mag_sum_sq += (u32_t)mag * mag;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(sum); i++) {
+		features->mean[i] = sum[i] / (s32_t)count;
+	}
+
+	features->mag_mean = mag_sum / count;
+	features->mag_var = (mag_sum_sq - ((u64_t)mag_sum * mag_sum) / count) /
+			    count;
+
+	for (size_t i = 0; i < count; i++) {
+		u16_t dev = (block->mag[i] > features->mag_mean) ?
+			    block->mag[i] - features->mag_mean :
+			    features->mag_mean - block->mag[i];
+
+		features->mag_dev_max = MAX(features->mag_dev_max, dev);
+	}
+
+	/* A peak is a local maximum of the magnitude that is high enough
+	 * above the mean, and far enough from the previous peak.
+	 */
+	peak_level = features->mag_mean + peak_threshold;
+
+	for (size_t i = 1; i + 1 < count; i++) {
+		if ((block->mag[i] < peak_level) ||
+		    (block->mag[i] < block->mag[i - 1]) ||
+		    (block->mag[i] <= block->mag[i + 1])) {
+			continue;
+		}
+
+		if (peak_found && (i - last_peak < peak_gap)) {
+			continue;
+		}
+
+		features->peak_count++;
+		last_peak = i;
+		peak_found = true;
+	}
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *
+ * @brief   Fixed-point motion features computed over blocks of
+ *          accelerometer samples.
+ */
+
+#ifndef MOTION_FEATURES_H__
+#define MOTION_FEATURES_H__
+
+#include <zephyr/types.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MOTION_BLOCK_SIZE CONFIG_MOTION_BLOCK_SIZE
+
+/**@brief Block of accelerometer samples in mg.
+ *
+ * Each axis is stored in its own array, so that the features are computed
+ * in loops over contiguous data.
+ */
+struct motion_block {
+	s16_t x[MOTION_BLOCK_SIZE];
+	s16_t y[MOTION_BLOCK_SIZE];
+	s16_t z[MOTION_BLOCK_SIZE];
+	/** Acceleration magnitude, set by motion_features_get(). */
+	u16_t mag[MOTION_BLOCK_SIZE];
+	size_t count;
+};
+
+/**@brief Motion features of a block. Values are in mg. */
+struct motion_features {
+	/** Mean acceleration per axis. */
+	s16_t mean[3];
+	/** Mean acceleration magnitude. */
+	u16_t mag_mean;
+	/** Largest deviation of the magnitude from its mean. Gravity is
+	 *  removed, so this is the acceleration caused by movement.
+	 */
+	u16_t mag_dev_max;
+	/** Variance of the acceleration magnitude [mg^2]. */
+	u32_t mag_var;
+	/** Number of step-like peaks in the acceleration magnitude. */
+	u16_t peak_count;
+};
+
+/**@brief Decode ADXL362 FIFO data into a block.
+ *
+ * Entries are sorted into axes by their tags. Leading entries of an
+ * incomplete sample are skipped, and temperature entries are ignored.
+ *
+ * @param block Block to append the samples to.
+ * @param fifo Raw FIFO data, two bytes per entry, least significant first.
+ * @param len Length of @p fifo in bytes.
+ * @param mg_per_lsb Scale of the samples.
+ *
+ * @return Number of samples appended.
+ */
+size_t motion_block_decode(struct motion_block *block, const u8_t *fifo,
+			   size_t len, u8_t mg_per_lsb);
+
+/**@brief Compute the motion features of a block.
+ *
+ * @param block Block of samples. The magnitudes are set.
+ * @param peak_threshold Minimum height of a peak above the mean magnitude.
+ * @param peak_gap Minimum number of samples between two peaks.
+ * @param features Features of the block.
+ */
+void motion_features_get(struct motion_block *block, u16_t peak_threshold,
+			 size_t peak_gap, struct motion_features *features);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MOTION_FEATURES_H__ */
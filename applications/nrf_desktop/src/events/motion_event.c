@@ -13,7 +13,8 @@ static int log_motion_event(const struct event_header *eh, char *buf,
 {
 	const struct motion_event *event = cast_motion_event(eh);
 
-	return snprintf(buf, buf_len, "dx=%d, dy=%d", event->dx, event->dy);
+	return snprintf(buf, buf_len, "dx=%d, dy=%d, ts=%u", event->dx,
+			event->dy, event->timestamp);
 }
 
 static void profile_motion_event(struct log_event_buf *buf,
@@ -24,12 +25,13 @@ static void profile_motion_event(struct log_event_buf *buf,
 	ARG_UNUSED(event);
 	profiler_log_encode_u32(buf, event->dx);
 	profiler_log_encode_u32(buf, event->dy);
+	profiler_log_encode_u32(buf, event->timestamp);
 }
 
 
 EVENT_INFO_DEFINE(motion_event,
-		  ENCODE(PROFILER_ARG_S32, PROFILER_ARG_S32),
-		  ENCODE("dx", "dy"),
+		  ENCODE(PROFILER_ARG_S32, PROFILER_ARG_S32, PROFILER_ARG_U32),
+		  ENCODE("dx", "dy", "timestamp"),
 		  profile_motion_event);
 
 EVENT_TYPE_DEFINE(motion_event,
@@ -24,6 +24,7 @@ struct motion_event {
 
 	s16_t dx;
 	s16_t dy;
+	u32_t timestamp; /* Time of the newest motion in hardware cycles. */
 };
 
 EVENT_TYPE_DECLARE(motion_event);
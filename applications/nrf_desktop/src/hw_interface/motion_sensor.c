@@ -11,8 +11,10 @@
 
 #include <device.h>
 #include <sensor.h>
+#include <profiler.h>
 
 #include "motion_sensor.h"
+#include "motion_sync.h"
 
 #include "event_manager.h"
 #include "motion_event.h"
@@ -32,6 +34,21 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_MOTION_LOG_LEVEL);
 
 #define NODATA_LIMIT		10
 
+#define MS_TO_CYCLES(ms) \
+	((u32_t)(((u64_t)(ms) * CONFIG_SYS_CLOCK_HW_CYCLES_PER_SEC) / \
+		 MSEC_PER_SEC))
+
+#if CONFIG_DESKTOP_MOTION_SENSOR_REPORT_SYNC
+#define REPORT_PERIOD_MAX \
+	MS_TO_CYCLES(CONFIG_DESKTOP_MOTION_SENSOR_REPORT_PERIOD_MAX_MS)
+#define READ_MARGIN \
+	MS_TO_CYCLES(CONFIG_DESKTOP_MOTION_SENSOR_REPORT_SYNC_MARGIN_MS)
+#else
+/* Report period is never estimated. */
+#define REPORT_PERIOD_MAX	0
+#define READ_MARGIN		0
+#endif
+
 
 enum state {
 	STATE_DISABLED,
@@ -51,6 +68,7 @@ struct sensor_state {
 	u8_t peer_count;
 	u32_t option[MOTION_SENSOR_OPTION_COUNT];
 	u32_t option_mask;
+	struct motion_sync sync;
 };
 
 
@@ -60,7 +78,13 @@ static struct k_thread thread;
 
 static struct device *sensor_dev;
 
-static struct sensor_state state;
+static struct sensor_state state = {
+	.sync = MOTION_SYNC_INITIALIZER(REPORT_PERIOD_MAX),
+};
+
+#if CONFIG_DESKTOP_MOTION_SENSOR_LATENCY_STATS
+static u16_t latency_event_id;
+#endif
 
 
 static void data_ready_handler(struct device *dev, struct sensor_trigger *trig);
@@ -128,10 +152,73 @@ static void data_ready_handler(struct device *dev, struct sensor_trigger *trig)
 	k_spin_unlock(&state.lock, key);
 }
 
-static int motion_read(bool send_event)
+static u32_t cycles_to_us(u32_t cycles)
+{
+	return SYS_CLOCK_HW_CYCLES_TO_NS64(cycles) / NSEC_PER_USEC;
+}
+
+static void latency_stats_init(void)
+{
+#if CONFIG_DESKTOP_MOTION_SENSOR_LATENCY_STATS
+	static const char *labels[] = {"min_us", "avg_us", "max_us", "cnt"};
+	static const enum profiler_arg types[] = {
+		PROFILER_ARG_U32,
+		PROFILER_ARG_U32,
+		PROFILER_ARG_U32,
+		PROFILER_ARG_U32,
+	};
+
+	BUILD_ASSERT_MSG(ARRAY_SIZE(labels) == ARRAY_SIZE(types), "");
+
+	latency_event_id = profiler_register_event_type("motion_latency",
+							labels, types,
+							ARRAY_SIZE(types));
+#endif
+}
+
+static void latency_stats_send(void)
+{
+#if CONFIG_DESKTOP_MOTION_SENSOR_LATENCY_STATS
+	struct motion_sync_stats stats;
+
+	k_spinlock_key_t key = k_spin_lock(&state.lock);
+	if (state.sync.lat_cnt <
+	    CONFIG_DESKTOP_MOTION_SENSOR_LATENCY_STATS_WINDOW) {
+		k_spin_unlock(&state.lock, key);
+		return;
+	}
+	motion_sync_stats_get(&state.sync, &stats);
+	k_spin_unlock(&state.lock, key);
+
+	if (is_profiling_enabled(latency_event_id)) {
+		struct log_event_buf buf;
+
+		profiler_log_start(&buf);
+		profiler_log_encode_u32(&buf, cycles_to_us(stats.min));
+		profiler_log_encode_u32(&buf, cycles_to_us(stats.avg));
+		profiler_log_encode_u32(&buf, cycles_to_us(stats.max));
+		profiler_log_encode_u32(&buf, stats.cnt);
+		profiler_log_send(&buf, latency_event_id);
+	}
+#endif
+}
+
+static s32_t read_delay_get(void)
+{
+	u32_t delay = motion_sync_read_delay(&state.sync, k_cycle_get_32(),
+					     READ_MARGIN);
+
+	/* Read is done up to one tick earlier than requested. */
+	return cycles_to_us(delay) / USEC_PER_MSEC;
+}
+
+static int motion_read(bool accumulate, bool publish)
 {
 	struct sensor_value value_x;
 	struct sensor_value value_y;
+	s16_t dx = 0;
+	s16_t dy = 0;
+	u32_t timestamp;
 
 	int err = sensor_sample_fetch(sensor_dev);
 
@@ -144,12 +231,32 @@ static int motion_read(bool send_event)
 					 &value_y);
 	}
 
-	if (err || !send_event) {
+	if (err || !accumulate) {
+		return err;
+	}
+
+	timestamp = k_cycle_get_32();
+
+	k_spinlock_key_t key = k_spin_lock(&state.lock);
+
+	motion_sync_add(&state.sync, value_x.val1, value_y.val1, timestamp);
+
+	bool has_motion = publish &&
+		motion_sync_publish(&state.sync, &dx, &dy, &timestamp);
+	bool synced = (state.sync.period != 0);
+
+	if (publish && !has_motion) {
+		motion_sync_slot_skip(&state.sync, timestamp);
+	}
+
+	k_spin_unlock(&state.lock, key);
+
+	if (!publish) {
 		return err;
 	}
 
 	static unsigned int nodata;
-	if (!value_x.val1 && !value_y.val1) {
+	if (!has_motion) {
 		if (nodata < NODATA_LIMIT) {
 			nodata++;
 		} else {
@@ -157,14 +264,22 @@ static int motion_read(bool send_event)
 
 			return -ENODATA;
 		}
+
+		if (synced) {
+			/* Thread wakes up on the next report slot. There is
+			 * no need to keep report flow going with empty events.
+			 */
+			return -EAGAIN;
+		}
 	} else {
 		nodata = 0;
 	}
 
 	struct motion_event *event = new_motion_event();
 
-	event->dx = value_x.val1;
-	event->dy = value_y.val1;
+	event->dx = dx;
+	event->dy = dy;
+	event->timestamp = timestamp;
 	EVENT_SUBMIT(event);
 
 	return err;
@@ -364,26 +479,58 @@ static void motion_thread_fn(void)
 	int err = init();
 
 	if (!err) {
+		latency_stats_init();
 		module_set_state(MODULE_STATE_READY);
 	}
 
+	bool sample = false;
+	s32_t timeout = K_FOREVER;
+
 	while (!err) {
-		bool send_event;
+		bool fetching;
+		s32_t delay = 0;
 		u32_t option_bm;
 
-		k_sem_take(&sem, K_FOREVER);
+		k_sem_take(&sem, timeout);
 
 		k_spinlock_key_t key = k_spin_lock(&state.lock);
-		send_event = (state.state == STATE_FETCHING) && state.sample;
+		fetching = (state.state == STATE_FETCHING);
+		sample = fetching && (sample || state.sample);
 		state.sample = false;
 		option_bm = state.option_mask;
+		if (sample) {
+			delay = read_delay_get();
+		}
 		k_spin_unlock(&state.lock, key);
 
-		err = motion_read(send_event);
+		bool no_motion = false;
+
+		if (delay > 0) {
+			/* Motion is accumulated by the sensor. Read it just
+			 * before the report slot to reduce latency.
+			 */
+			timeout = delay;
+		} else {
+			err = motion_read(fetching, sample);
+
+			if (sample && (err == -EAGAIN)) {
+				/* Wait for the next report slot. */
+				err = 0;
+			} else {
+				sample = false;
+			}
 
-		bool no_motion = (err == -ENODATA);
-		if (unlikely(no_motion)) {
-			err = 0;
+			no_motion = (err == -ENODATA);
+			if (unlikely(no_motion)) {
+				err = 0;
+			}
+
+			timeout = K_FOREVER;
+			if (sample) {
+				key = k_spin_lock(&state.lock);
+				timeout = MAX(read_delay_get(), 1);
+				k_spin_unlock(&state.lock, key);
+			}
 		}
 
 		if (IS_ENABLED(CONFIG_DESKTOP_CONFIG_CHANNEL_ENABLE) &&
@@ -397,6 +544,8 @@ static void motion_thread_fn(void)
 		}
 		if (state.state != STATE_FETCHING) {
 			enable_trigger();
+			sample = false;
+			timeout = K_FOREVER;
 		}
 		k_spin_unlock(&state.lock, key);
 	}
@@ -413,11 +562,14 @@ static bool event_handler(const struct event_header *eh)
 
 		if (event->report_type == IN_REPORT_MOUSE) {
 			k_spinlock_key_t key = k_spin_lock(&state.lock);
+			motion_sync_report_sent(&state.sync, k_cycle_get_32());
 			if (state.state == STATE_FETCHING) {
 				state.sample = true;
 				k_sem_give(&sem);
 			}
 			k_spin_unlock(&state.lock, key);
+
+			latency_stats_send();
 		}
 
 		return false;
@@ -439,6 +591,8 @@ static bool event_handler(const struct event_header *eh)
 			bool is_connected = (state.peer_count != 0);
 
 			k_spinlock_key_t key = k_spin_lock(&state.lock);
+			/* Report period may change with the subscriber. */
+			motion_sync_reset(&state.sync);
 			switch (state.state) {
 			case STATE_DISCONNECTED:
 				if (is_connected) {
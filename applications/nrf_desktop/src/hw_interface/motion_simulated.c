@@ -60,6 +60,7 @@ static void motion_event_send(s16_t dx, s16_t dy)
 
 	event->dx = dx;
 	event->dy = dy;
+	event->timestamp = k_cycle_get_32();
 	EVENT_SUBMIT(event);
 }
 
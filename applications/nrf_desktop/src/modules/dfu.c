@@ -33,19 +33,64 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_DESKTOP_CONFIG_CHANNEL_DFU_LOG_LEVEL);
 
 #define FLASH_PAGE_SIZE_LOG2	12
 #define FLASH_PAGE_SIZE		BIT(FLASH_PAGE_SIZE_LOG2)
-#define FLASH_PAGE_ID(off)	((off) >> FLASH_PAGE_SIZE_LOG2)
+#define FLASH_WRITE_ALIGN	sizeof(u32_t)
+
+#define WRITE_BUF_SIZE	CONFIG_DESKTOP_CONFIG_CHANNEL_DFU_WRITE_BUF_SIZE
+#define WRITE_BUF_COUNT	CONFIG_DESKTOP_CONFIG_CHANNEL_DFU_WRITE_BUF_COUNT
+#define PREERASE_SIZE	(CONFIG_DESKTOP_CONFIG_CHANNEL_DFU_PREERASE_PAGES * \
+			 FLASH_PAGE_SIZE)
+
+#define THREAD_STACK_SIZE CONFIG_DESKTOP_CONFIG_CHANNEL_DFU_THREAD_STACK_SIZE
+#define THREAD_PRIORITY		K_LOWEST_APPLICATION_THREAD_PRIO
 
 #define DFU_TIMEOUT K_SECONDS(2)
+#define WRITE_BUF_TIMEOUT K_SECONDS(1)
 #define REBOOT_REQUEST_TIMEOUT K_MSEC(250)
 
+BUILD_ASSERT_MSG((FLASH_PAGE_SIZE % WRITE_BUF_SIZE) == 0,
+		 "Write buffer size must divide flash page size");
+BUILD_ASSERT_MSG((WRITE_BUF_SIZE % FLASH_WRITE_ALIGN) == 0,
+		 "Write buffer size must be aligned to flash write size");
+
+/* Received data is coalesced into buffers aligned to WRITE_BUF_SIZE in flash.
+ * Full buffers are written by the writer thread, so the event handler does
+ * not wait for the flash operations.
+ */
+struct write_buf {
+	u32_t offset;
+	size_t len;
+	u8_t data[WRITE_BUF_SIZE];
+};
+
+enum {
+	WRITER_ABORT,
+	WRITER_ERROR,
+};
+
 static struct bt_conn *active_conn;
 static struct k_delayed_work dfu_timeout;
 static struct k_delayed_work reboot_request;
+static struct k_work write_done;
 
 static const struct flash_area *flash_area;
 static u32_t cur_offset;
 static u32_t img_csum;
 static u32_t img_length;
+static bool dfu_stopping;
+static bool img_received;
+
+static struct write_buf write_buf[WRITE_BUF_COUNT];
+static size_t fill_idx;
+static size_t write_idx;
+static u32_t erased_end;
+static atomic_t write_pending;
+static atomic_t written_offset;
+static atomic_t writer_flags;
+
+static K_SEM_DEFINE(write_sem, 0, WRITE_BUF_COUNT);
+static K_SEM_DEFINE(free_sem, 0, WRITE_BUF_COUNT);
+static K_THREAD_STACK_DEFINE(writer_stack, THREAD_STACK_SIZE);
+static struct k_thread writer_thread;
 
 
 static void set_ble_latency(bool low_latency)
@@ -82,15 +127,158 @@ static void set_ble_latency(bool low_latency)
 	LOG_INF("BLE latency %screased", low_latency ? "de" : "in");
 }
 
-static void dfu_timeout_handler(struct k_work *work)
+static int erase_until(u32_t end)
 {
-	LOG_WRN("DFU timed out");
+	while (erased_end < end) {
+		int err = flash_area_erase(flash_area, erased_end,
+					   FLASH_PAGE_SIZE);
+		if (err) {
+			LOG_ERR("Cannot erase page (%d)", err);
+			return err;
+		}
+
+		erased_end += FLASH_PAGE_SIZE;
+	}
+
+	return 0;
+}
+
+static int write_buf_store(const struct write_buf *buf)
+{
+	u32_t end = buf->offset + buf->len;
+	int err = erase_until(end);
+
+	if (!err) {
+		err = flash_area_write(flash_area, buf->offset, buf->data,
+				       buf->len);
+		if (err) {
+			LOG_ERR("Cannot write data (%d)", err);
+		}
+	}
+
+	if (!err) {
+		/* Erase upcoming pages while next data is received. */
+		err = erase_until(MIN(end + PREERASE_SIZE,
+				      ROUND_UP(img_length, FLASH_PAGE_SIZE)));
+	}
+
+	return err;
+}
+
+static void writer_thread_fn(void)
+{
+	while (true) {
+		k_sem_take(&write_sem, K_FOREVER);
+
+		const struct write_buf *buf = &write_buf[write_idx];
+
+		if (!atomic_test_bit(&writer_flags, WRITER_ABORT)) {
+			if (write_buf_store(buf)) {
+				atomic_set_bit(&writer_flags, WRITER_ERROR);
+				atomic_set_bit(&writer_flags, WRITER_ABORT);
+			} else {
+				atomic_set(&written_offset,
+					   MIN(buf->offset + buf->len,
+					       img_length));
+			}
+		}
+
+		write_idx = (write_idx + 1) % WRITE_BUF_COUNT;
+		atomic_dec(&write_pending);
+		k_sem_give(&free_sem);
+
+		k_work_submit(&write_done);
+	}
+}
+
+static void write_buf_submit(void)
+{
+	struct write_buf *buf = &write_buf[fill_idx];
+
+	/* Last write of the image is padded with erased flash value. */
+	while ((buf->len % FLASH_WRITE_ALIGN) != 0) {
+		buf->data[buf->len] = 0xFF;
+		buf->len++;
+	}
+
+	fill_idx = (fill_idx + 1) % WRITE_BUF_COUNT;
+	atomic_inc(&write_pending);
+	k_sem_give(&write_sem);
+}
+
+static int write_buf_claim(u32_t offset)
+{
+	/* Wait only if the writer falls behind the transport. */
+	if (k_sem_take(&free_sem, WRITE_BUF_TIMEOUT)) {
+		return -ETIMEDOUT;
+	}
+
+	write_buf[fill_idx].offset = offset;
+	write_buf[fill_idx].len = 0;
+
+	return 0;
+}
+
+static void dfu_finish(void)
+{
+	if (!dfu_stopping || (atomic_get(&write_pending) > 0)) {
+		/* Writer is still busy. */
+		return;
+	}
+
+	bool write_error = atomic_test_bit(&writer_flags, WRITER_ERROR);
+
+	/* Data that was received but not written is dropped. Host resumes
+	 * DFU from the last written offset.
+	 */
+	cur_offset = atomic_get(&written_offset);
+
+	if (img_received && !write_error && (cur_offset == img_length)) {
+		LOG_INF("DFU image written");
+		boot_request_upgrade(false);
+	}
+
+	flash_area_close(flash_area);
+	flash_area = NULL;
+	dfu_stopping = false;
+	atomic_clear(&writer_flags);
 
 	set_ble_latency(false);
+}
 
-	if (flash_area) {
-		flash_area_close(flash_area);
-		flash_area = NULL;
+static void dfu_stop(bool received)
+{
+	k_delayed_work_cancel(&dfu_timeout);
+
+	dfu_stopping = true;
+	img_received = received;
+
+	if (!received) {
+		atomic_set_bit(&writer_flags, WRITER_ABORT);
+	}
+
+	dfu_finish();
+}
+
+static void write_done_handler(struct k_work *work)
+{
+	if (atomic_test_bit(&writer_flags, WRITER_ERROR) &&
+	    flash_area && !dfu_stopping) {
+		LOG_ERR("DFU write failed");
+		dfu_stop(false);
+	} else {
+		dfu_finish();
+	}
+}
+
+static void dfu_timeout_handler(struct k_work *work)
+{
+	LOG_WRN("DFU timed out");
+
+	if (flash_area && !dfu_stopping) {
+		dfu_stop(false);
+	} else {
+		set_ble_latency(false);
 	}
 }
 
@@ -107,65 +295,57 @@ static void reboot_request_handler(struct k_work *work)
 	sys_reboot(SYS_REBOOT_WARM);
 }
 
-static bool is_new_page_started(u32_t off, size_t data_size)
-{
-	return FLASH_PAGE_ID(off - 1) != FLASH_PAGE_ID(off + data_size - 1);
-}
-
 static void handle_dfu_data(const struct config_event *event)
 {
 	const u8_t *data = event->dyndata.data;
 	size_t size = event->dyndata.size;
-	int err;
 
-	if (!flash_area) {
+	if (!flash_area || dfu_stopping) {
 		LOG_WRN("DFU was not started");
 		return;
 	}
 
 	LOG_INF("DFU data received cur_offset:%" PRIu32, cur_offset);
 
-	if (size == 0) {
+	if ((size == 0) || (size > img_length - cur_offset)) {
 		LOG_WRN("Invalid DFU data header");
-		goto dfu_finish;
+		dfu_stop(false);
+		return;
 	}
 
-	if (is_new_page_started(cur_offset, size)) {
-		err = flash_area_erase(flash_area,
-		       FLASH_PAGE_ID(cur_offset + size - 1) << FLASH_PAGE_SIZE_LOG2,
-		       FLASH_PAGE_SIZE);
-		if (err) {
-			LOG_ERR("Cannot erase page (%d)", err);
-			goto dfu_finish;
+	while (size > 0) {
+		struct write_buf *buf = &write_buf[fill_idx];
+		size_t buf_size = WRITE_BUF_SIZE -
+				  (buf->offset % WRITE_BUF_SIZE);
+		size_t len = MIN(size, buf_size - buf->len);
+
+		memcpy(&buf->data[buf->len], data, len);
+		buf->len += len;
+		cur_offset += len;
+		data += len;
+		size -= len;
+
+		if (cur_offset == img_length) {
+			write_buf_submit();
+		} else if (buf->len == buf_size) {
+			write_buf_submit();
+
+			if (write_buf_claim(cur_offset)) {
+				LOG_ERR("No DFU write buffer");
+				dfu_stop(false);
+				return;
+			}
 		}
 	}
 
-	err = flash_area_write(flash_area, cur_offset, data, size);
-	if (err) {
-		LOG_ERR("Cannot write data (%d)", err);
-		goto dfu_finish;
-	}
-
-	cur_offset += size;
+	LOG_INF("DFU chunk received");
 
-	LOG_INF("DFU chunk written");
-
-	if (img_length == cur_offset) {
-		LOG_INF("DFU image written");
-		boot_request_upgrade(false);
-
-		goto dfu_finish;
+	if (cur_offset == img_length) {
+		LOG_INF("DFU image received");
+		dfu_stop(true);
 	} else {
 		k_delayed_work_submit(&dfu_timeout, DFU_TIMEOUT);
 	}
-
-	return;
-
-dfu_finish:
-	flash_area_close(flash_area);
-	flash_area = NULL;
-	set_ble_latency(false);
-	k_delayed_work_cancel(&dfu_timeout);
 }
 
 static void handle_dfu_start(const struct config_event *event)
@@ -244,6 +424,19 @@ static void handle_dfu_start(const struct config_event *event)
 	} else {
 		LOG_INF("DFU started");
 
+		/* Writer is idle, all buffers are free. Page of the restart
+		 * offset was already erased by the previous write.
+		 */
+		erased_end = ROUND_UP(cur_offset, FLASH_PAGE_SIZE);
+		atomic_set(&written_offset, cur_offset);
+
+		k_sem_reset(&free_sem);
+		for (size_t i = 0; i < WRITE_BUF_COUNT - 1; i++) {
+			k_sem_give(&free_sem);
+		}
+		write_buf[fill_idx].offset = cur_offset;
+		write_buf[fill_idx].len = 0;
+
 		set_ble_latency(true);
 	}
 
@@ -460,6 +653,14 @@ static bool event_handler(const struct event_header *eh)
 
 			k_delayed_work_init(&dfu_timeout, dfu_timeout_handler);
 			k_delayed_work_init(&reboot_request, reboot_request_handler);
+			k_work_init(&write_done, write_done_handler);
+
+			k_thread_create(&writer_thread, writer_stack,
+					THREAD_STACK_SIZE,
+					(k_thread_entry_t)writer_thread_fn,
+					NULL, NULL, NULL,
+					THREAD_PRIORITY, 0, K_NO_WAIT);
+			k_thread_name_set(&writer_thread, "dfu_writer");
 		}
 		return false;
 	}
@@ -14,7 +14,6 @@
 #include <sys/types.h>
 
 #include <zephyr/types.h>
-#include <misc/slist.h>
 #include <misc/util.h>
 
 #include "button_event.h"
@@ -27,6 +26,7 @@
 #include "hid_keymap.h"
 #include "hid_keymap_def.h"
 #include "hid_report_desc.h"
+#include "hid_eventq.h"
 
 #define MODULE hid_state
 #include "module_state_event.h"
@@ -61,23 +61,10 @@ struct items {
 	bool update_needed;
 };
 
-/**@brief Enqueued HID state item. */
-struct item_event {
-	sys_snode_t node;	/**< Event queue linked list node. */
-	struct item item;	/**< HID state item which has been enqueued. */
-	u32_t timestamp;	/**< HID event timestamp. */
-};
-
-/**@brief Event queue. */
-struct eventq {
-	sys_slist_t root;
-	size_t len;
-};
-
 /**@brief Report state. */
 struct report_data {
 	struct items items;
-	struct eventq eventq;
+	struct hid_eventq eventq;
 };
 
 struct report_state {
@@ -102,6 +89,9 @@ struct hid_state {
 };
 
 
+static struct hid_eventq_event
+	eventq_buf[IN_REPORT_COUNT][CONFIG_DESKTOP_HID_EVENT_QUEUE_SIZE];
+
 static struct hid_state state = {
 	.report_data[IN_REPORT_MOUSE].items.item_count_max =
 		MOUSE_REPORT_BUTTON_COUNT_MAX,
@@ -109,6 +99,12 @@ static struct hid_state state = {
 		KEYBOARD_REPORT_KEY_COUNT_MAX,
 	.report_data[IN_REPORT_CONSUMER_CTRL].items.item_count_max =
 		CONSUMER_CTRL_REPORT_KEY_COUNT_MAX,
+	.report_data[IN_REPORT_MOUSE].eventq =
+		HID_EVENTQ_INITIALIZER(eventq_buf[IN_REPORT_MOUSE]),
+	.report_data[IN_REPORT_KEYBOARD_KEYS].eventq =
+		HID_EVENTQ_INITIALIZER(eventq_buf[IN_REPORT_KEYBOARD_KEYS]),
+	.report_data[IN_REPORT_CONSUMER_CTRL].eventq =
+		HID_EVENTQ_INITIALIZER(eventq_buf[IN_REPORT_CONSUMER_CTRL]),
 };
 
 
@@ -183,180 +179,13 @@ static int usage_id_compare(const void *a, const void *b)
 	return (p_a->usage_id - p_b->usage_id);
 }
 
-static void eventq_reset(struct eventq *eventq)
-{
-	struct item_event *event;
-	struct item_event *tmp;
-
-	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&eventq->root, event, tmp, node) {
-		sys_slist_remove(&eventq->root, NULL, &event->node);
-
-		k_free(event);
-	}
-
-	sys_slist_init(&eventq->root);
-	eventq->len = 0;
-}
-
-static bool eventq_is_full(const struct eventq *eventq)
-{
-	return (eventq->len >= CONFIG_DESKTOP_HID_EVENT_QUEUE_SIZE);
-}
-
-
-static bool eventq_is_empty(struct eventq *eventq)
-{
-	bool empty = sys_slist_is_empty(&eventq->root);
-
-	__ASSERT_NO_MSG(!empty == (eventq->len != 0));
-
-	return empty;
-}
-
-static struct item_event *eventq_get(struct eventq *eventq)
-{
-	sys_snode_t *node = sys_slist_get(&eventq->root);
-
-	if (!node) {
-		return NULL;
-	}
-
-	eventq->len--;
-
-	return CONTAINER_OF(node, struct item_event, node);
-}
-
-static void eventq_append(struct eventq *eventq, u16_t usage_id, s16_t value)
-{
-	struct item_event *hid_event = k_malloc(sizeof(*hid_event));
-
-	if (!hid_event) {
-		LOG_WRN("Failed to allocate HID event");
-		return;
-	}
-
-	hid_event->item.usage_id = usage_id;
-	hid_event->item.value = value;
-	hid_event->timestamp = K_MSEC(k_uptime_get());
-
-	/* Add a new event to the queue. */
-	sys_slist_append(&eventq->root, &hid_event->node);
-
-	eventq->len++;
-}
-
-static void eventq_region_purge(struct eventq *eventq,
-				sys_snode_t *last_to_purge)
-{
-	sys_snode_t *tmp;
-	sys_snode_t *tmp_safe;
-	size_t cnt = 0;
-
-	SYS_SLIST_FOR_EACH_NODE_SAFE(&eventq->root, tmp, tmp_safe) {
-		sys_slist_remove(&eventq->root, NULL, tmp);
-
-		k_free(CONTAINER_OF(tmp, struct item_event, node));
-		cnt++;
-
-		if (tmp == last_to_purge) {
-			break;
-		}
-	}
-
-	eventq->len -= cnt;
-
-	LOG_WRN("%u stale events removed from the queue!", cnt);
-}
-
-
-static void eventq_cleanup(struct eventq *eventq, u32_t timestamp)
+static void eventq_cleanup(struct hid_eventq *eventq, u32_t timestamp)
 {
-	/* Find timed out events. */
-
-	sys_snode_t *first_valid;
+	size_t cnt = hid_eventq_cleanup(eventq, timestamp,
+					CONFIG_DESKTOP_HID_REPORT_EXPIRATION);
 
-	SYS_SLIST_FOR_EACH_NODE(&eventq->root, first_valid) {
-		u32_t diff = timestamp - CONTAINER_OF(
-			first_valid, struct item_event, node)->timestamp;
-
-		if (diff < CONFIG_DESKTOP_HID_REPORT_EXPIRATION) {
-			break;
-		}
-	}
-
-	/* Remove events but only if key up was generated for each removed
-	 * key down.
-	 */
-
-	sys_snode_t *maxfound = sys_slist_peek_head(&eventq->root);
-	size_t maxfound_pos = 0;
-
-	sys_snode_t *cur;
-	size_t cur_pos = 0;
-
-	sys_snode_t *tmp_safe;
-
-	SYS_SLIST_FOR_EACH_NODE_SAFE(&eventq->root, cur, tmp_safe) {
-		const struct item cur_item =
-			CONTAINER_OF(cur, struct item_event, node)->item;
-
-		if (cur_item.value > 0) {
-			/* Every key down must be paired with key up.
-			 * Set hit count to value as we just detected
-			 * first key down for this usage.
-			 */
-
-			unsigned int hit_count = cur_item.value;
-			sys_snode_t *j = cur;
-			size_t j_pos = cur_pos;
-
-			SYS_SLIST_ITERATE_FROM_NODE(&eventq->root, j) {
-				j_pos++;
-				if (j == first_valid) {
-					break;
-				}
-
-				const struct item item =
-					CONTAINER_OF(j,
-						     struct item_event,
-						     node)->item;
-
-				if (cur_item.usage_id == item.usage_id) {
-					hit_count += item.value;
-
-					if (hit_count == 0) {
-						/* All events with this usage
-						 * are paired.
-						 */
-						break;
-					}
-				}
-			}
-
-			if (j == first_valid) {
-				/* Pair not found. */
-				break;
-			}
-
-			if (j_pos > maxfound_pos) {
-				maxfound = j;
-				maxfound_pos = j_pos;
-			}
-		}
-
-
-		if (cur == first_valid) {
-			break;
-		}
-
-		if (cur == maxfound) {
-			/* All events up to this point have pairs and can
-			 * be deleted.
-			 */
-			eventq_region_purge(eventq, maxfound);
-		}
-
-		cur_pos++;
+	if (cnt > 0) {
+		LOG_WRN("%u stale events removed from the queue!", cnt);
 	}
 }
 
@@ -456,7 +285,7 @@ static void disconnect_subscriber(const void *subscriber_id)
 
 			LOG_INF("Clear mouse report data");
 			clear_items(&rd->items);
-			eventq_reset(&rd->eventq);
+			hid_eventq_reset(&rd->eventq);
 		}
 	}
 
@@ -662,17 +491,13 @@ static bool update_report(enum in_report tr)
 	struct report_data *rd = &state.report_data[tr];
 	bool update_needed = false;
 
-	while (!update_needed && !eventq_is_empty(&rd->eventq)) {
-		/* There are enqueued events to handle. */
-		struct item_event *event = eventq_get(&rd->eventq);
-
-		__ASSERT_NO_MSG(event);
+	struct hid_eventq_event event;
 
+	while (!update_needed && hid_eventq_get(&rd->eventq, &event)) {
+		/* There are enqueued events to handle. */
 		update_needed = key_value_set(&rd->items,
-					      event->item.usage_id,
-					      event->item.value);
-
-		k_free(event);
+					      event.usage_id,
+					      event.value);
 
 		/* If no item was changed, try next event. */
 	}
@@ -781,7 +606,7 @@ static void report_issued(const void *subscriber_id, enum in_report tr,
 		 */
 		LOG_ERR("Error while sending report");
 		clear_items(&rd->items);
-		eventq_reset(&rd->eventq);
+		hid_eventq_reset(&rd->eventq);
 		if (tr == IN_REPORT_MOUSE) {
 			state.last_dx = 0;
 			state.last_dy = 0;
@@ -827,7 +652,7 @@ static void connect(const void *subscriber_id, enum in_report tr)
 
 		struct report_data *rd = &state.report_data[tr];
 
-		if (!eventq_is_empty(&rd->eventq)) {
+		if (!hid_eventq_is_empty(&rd->eventq)) {
 			/* Remove all stale events from the queue. */
 			eventq_cleanup(&rd->eventq, K_MSEC(k_uptime_get()));
 		}
@@ -851,7 +676,7 @@ static void disconnect(const void *subscriber_id, enum in_report tr)
 
 	LOG_INF("Clear report data (%d)", tr);
 	clear_items(&rd->items);
-	eventq_reset(&rd->eventq);
+	hid_eventq_reset(&rd->eventq);
 }
 
 /**@brief Enqueue event that updates a given usage. */
@@ -860,27 +685,24 @@ static void enqueue(struct report_data *rd, u16_t usage_id, s16_t value,
 {
 	eventq_cleanup(&rd->eventq, K_MSEC(k_uptime_get()));
 
-	if (eventq_is_full(&rd->eventq)) {
+	if (hid_eventq_is_full(&rd->eventq)) {
 		if (!connected) {
 			/* In disconnected state no items are recorded yet.
 			 * Try to remove queued items starting from the
 			 * oldest one.
 			 */
-			sys_snode_t *i;
-
-			SYS_SLIST_FOR_EACH_NODE(&rd->eventq.root, i) {
+			for (size_t i = 0; i < rd->eventq.len; i++) {
 				/* Initial cleanup was done above. Queue will
 				 * not contain events with expired timestamp.
 				 */
 				u32_t timestamp =
-					CONTAINER_OF(i,
-						     struct item_event,
-						     node)->timestamp +
+					hid_eventq_peek(&rd->eventq,
+							i)->timestamp +
 					CONFIG_DESKTOP_HID_REPORT_EXPIRATION;
 
 				eventq_cleanup(&rd->eventq, timestamp);
 
-				if (!eventq_is_full(&rd->eventq)) {
+				if (!hid_eventq_is_full(&rd->eventq)) {
 					/* At least one element was removed
 					 * from the queue. Do not continue
 					 * list traverse, content was modified!
@@ -890,17 +712,18 @@ static void enqueue(struct report_data *rd, u16_t usage_id, s16_t value,
 			}
 		}
 
-		if (eventq_is_full(&rd->eventq)) {
+		if (hid_eventq_is_full(&rd->eventq)) {
 			/* To maintain the sanity of HID state, clear
 			 * all recorded events and items.
 			 */
 			LOG_WRN("Queue is full, all events are dropped!");
 			clear_items(&rd->items);
-			eventq_reset(&rd->eventq);
+			hid_eventq_reset(&rd->eventq);
 		}
 	}
 
-	eventq_append(&rd->eventq, usage_id, value);
+	hid_eventq_append(&rd->eventq, usage_id, value,
+			  K_MSEC(k_uptime_get()));
 }
 
 /**@brief Function for updating the value linked to the HID usage. */
@@ -911,7 +734,7 @@ static void update_key(const struct hid_keymap *map, s16_t value)
 	bool connected = state.selected &&
 		(state.selected->state[tr].state != STATE_DISCONNECTED);
 
-	if (!connected || !eventq_is_empty(&rd->eventq)) {
+	if (!connected || !hid_eventq_is_empty(&rd->eventq)) {
 		/* Report cannot be sent yet - enqueue this HID event. */
 		enqueue(rd, map->usage_id, value, connected);
 	} else {
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+
+#include "hid_eventq.h"
+
+
+static void eventq_purge(struct hid_eventq *eventq, size_t cnt)
+{
+	__ASSERT_NO_MSG(cnt <= eventq->len);
+
+	size_t head = eventq->head + cnt;
+
+	if (head >= eventq->size) {
+		head -= eventq->size;
+	}
+
+	eventq->head = head;
+	eventq->len -= cnt;
+}
+
+bool hid_eventq_get(struct hid_eventq *eventq, struct hid_eventq_event *event)
+{
+	if (hid_eventq_is_empty(eventq)) {
+		return false;
+	}
+
+	*event = *hid_eventq_peek(eventq, 0);
+	eventq_purge(eventq, 1);
+
+	return true;
+}
+
+void hid_eventq_append(struct hid_eventq *eventq, u16_t usage_id, s16_t value,
+		       u32_t timestamp)
+{
+	__ASSERT_NO_MSG(!hid_eventq_is_full(eventq));
+
+	struct hid_eventq_event *event = hid_eventq_peek(eventq, eventq->len);
+
+	event->usage_id = usage_id;
+	event->value = value;
+	event->timestamp = timestamp;
+
+	eventq->len++;
+}
+
+/* Find the key up that pairs all key downs of the usage of the event at
+ * the given position. Returns end if the pair was not found before end.
+ */
+static size_t pair_find(const struct hid_eventq *eventq, size_t pos,
+			size_t end)
+{
+	const struct hid_eventq_event *key_down = hid_eventq_peek(eventq, pos);
+	unsigned int hit_count = key_down->value;
+
+	for (size_t i = pos + 1; i < end; i++) {
+		const struct hid_eventq_event *event =
+			hid_eventq_peek(eventq, i);
+
+		if (event->usage_id == key_down->usage_id) {
+			hit_count += event->value;
+
+			if (hit_count == 0) {
+				/* All events with this usage are paired. */
+				return i;
+			}
+		}
+	}
+
+	return end;
+}
+
+size_t hid_eventq_cleanup(struct hid_eventq *eventq, u32_t timestamp,
+			  u32_t expiration)
+{
+	/* Find timed out events. Events are ordered by timestamp, so search
+	 * stops on the first valid one.
+	 */
+	size_t first_valid;
+
+	for (first_valid = 0; first_valid < eventq->len; first_valid++) {
+		u32_t diff = timestamp -
+			hid_eventq_peek(eventq, first_valid)->timestamp;
+
+		if (diff < expiration) {
+			break;
+		}
+	}
+
+	/* Remove events but only if key up was generated for each removed
+	 * key down.
+	 */
+	size_t maxfound = 0;
+	size_t purge_cnt = 0;
+
+	for (size_t cur = 0; cur < first_valid; cur++) {
+		if (hid_eventq_peek(eventq, cur)->value > 0) {
+			/* Every key down must be paired with key up. */
+			size_t pair = pair_find(eventq, cur, first_valid);
+
+			if (pair == first_valid) {
+				/* Pair not found. */
+				break;
+			}
+
+			maxfound = MAX(maxfound, pair);
+		}
+
+		if (cur == maxfound) {
+			/* All events up to this point have pairs and can
+			 * be deleted.
+			 */
+			purge_cnt = cur + 1;
+		}
+	}
+
+	eventq_purge(eventq, purge_cnt);
+
+	return purge_cnt;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef _HID_EVENTQ_H_
+#define _HID_EVENTQ_H_
+
+/**
+ * @file
+ * @defgroup hid_eventq HID event queue
+ * @{
+ * @brief Fixed capacity queue of HID events for the nRF52 Desktop.
+ *
+ * The queue keeps the HID events that cannot be reported yet. Events are
+ * stored in a ring buffer provided by the user, so no memory is allocated
+ * when an event is enqueued.
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <misc/util.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Enqueued HID event. */
+struct hid_eventq_event {
+	u16_t usage_id;		/**< HID usage ID. */
+	s16_t value;		/**< HID value. */
+	u32_t timestamp;	/**< HID event timestamp. */
+};
+
+/** @brief HID event queue. */
+struct hid_eventq {
+	struct hid_eventq_event *events;	/**< Ring buffer. */
+	u8_t size;				/**< Ring buffer size. */
+	u8_t head;				/**< Index of the oldest event. */
+	u8_t len;				/**< Number of enqueued events. */
+};
+
+/** @brief Initializer of the HID event queue.
+ *
+ * @param _events Array of events used as the ring buffer. The array size
+ *                is the maximum number of enqueued events.
+ */
+#define HID_EVENTQ_INITIALIZER(_events)			\
+	{						\
+		.events = _events,			\
+		.size = ARRAY_SIZE(_events),		\
+	}
+
+/** @brief Remove all events from the queue. */
+static inline void hid_eventq_reset(struct hid_eventq *eventq)
+{
+	eventq->head = 0;
+	eventq->len = 0;
+}
+
+/** @brief Check if the queue is full. */
+static inline bool hid_eventq_is_full(const struct hid_eventq *eventq)
+{
+	return (eventq->len >= eventq->size);
+}
+
+/** @brief Check if the queue is empty. */
+static inline bool hid_eventq_is_empty(const struct hid_eventq *eventq)
+{
+	return (eventq->len == 0);
+}
+
+/** @brief Get the event at the given position, counting from the oldest.
+ *
+ * @param eventq Queue.
+ * @param pos Position of the event, must be lower than the queue length.
+ *
+ * @return Pointer to the event.
+ */
+static inline struct hid_eventq_event *hid_eventq_peek(
+		const struct hid_eventq *eventq, size_t pos)
+{
+	size_t idx = eventq->head + pos;
+
+	if (idx >= eventq->size) {
+		idx -= eventq->size;
+	}
+
+	return &eventq->events[idx];
+}
+
+/** @brief Remove the oldest event from the queue.
+ *
+ * @param eventq Queue.
+ * @param event Pointer to the structure the event is copied to.
+ *
+ * @return true if an event was removed, false if the queue is empty.
+ */
+bool hid_eventq_get(struct hid_eventq *eventq, struct hid_eventq_event *event);
+
+/** @brief Append an event to the queue.
+ *
+ * @param eventq Queue, must not be full.
+ * @param usage_id HID usage ID.
+ * @param value HID value.
+ * @param timestamp Event timestamp.
+ */
+void hid_eventq_append(struct hid_eventq *eventq, u16_t usage_id, s16_t value,
+		       u32_t timestamp);
+
+/** @brief Remove expired events from the queue.
+ *
+ * Expired events are removed only if every removed key down is paired with
+ * a key up that is removed as well.
+ *
+ * @param eventq Queue.
+ * @param timestamp Current time.
+ * @param expiration Time after which an event expires.
+ *
+ * @return Number of removed events.
+ */
+size_t hid_eventq_cleanup(struct hid_eventq *eventq, u32_t timestamp,
+			  u32_t expiration);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _HID_EVENTQ_H_ */
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <limits.h>
+
+#include "motion_sync.h"
+
+/* Weight of the new sample in the report period estimation is
+ * 1 / (2 ^ PERIOD_FILTER_SHIFT).
+ */
+#define PERIOD_FILTER_SHIFT	2
+
+/* Number of consecutive samples longer than the estimated period after
+ * which the report period is assumed to have changed.
+ */
+#define PERIOD_RESEED_COUNT	4
+
+
+static s16_t motion_take(s32_t *acc)
+{
+	s32_t value = MAX(MIN(*acc, SHRT_MAX), SHRT_MIN);
+
+	*acc -= value;
+
+	return value;
+}
+
+void motion_sync_reset(struct motion_sync *ms)
+{
+	ms->dx = 0;
+	ms->dy = 0;
+	ms->acc_valid = false;
+	ms->published = false;
+	ms->sent_valid = false;
+	ms->period = 0;
+	ms->long_cnt = 0;
+}
+
+void motion_sync_add(struct motion_sync *ms, s32_t dx, s32_t dy, u32_t time)
+{
+	if (!dx && !dy) {
+		return;
+	}
+
+	if (!ms->acc_valid) {
+		ms->first_read = time;
+		ms->acc_valid = true;
+	}
+
+	ms->dx += dx;
+	ms->dy += dy;
+	ms->last_read = time;
+}
+
+bool motion_sync_publish(struct motion_sync *ms, s16_t *dx, s16_t *dy,
+			 u32_t *timestamp)
+{
+	if (!ms->acc_valid) {
+		return false;
+	}
+
+	*dx = motion_take(&ms->dx);
+	*dy = motion_take(&ms->dy);
+	*timestamp = ms->last_read;
+
+	ms->sample_time = ms->first_read;
+	ms->published = true;
+
+	/* Remaining motion is still the oldest one. */
+	ms->acc_valid = (ms->dx != 0) || (ms->dy != 0);
+
+	return true;
+}
+
+void motion_sync_slot_skip(struct motion_sync *ms, u32_t now)
+{
+	/* Period cannot be measured across the skipped slot. */
+	ms->sent_valid = false;
+
+	if (!ms->period) {
+		return;
+	}
+
+	ms->next_slot += ms->period;
+	if ((s32_t)(ms->next_slot - now) <= 0) {
+		ms->next_slot = now + ms->period;
+	}
+}
+
+static void period_update(struct motion_sync *ms, u32_t sample)
+{
+	if (sample > ms->period_max) {
+		ms->long_cnt = 0;
+		return;
+	}
+
+	if (ms->period && (sample > ms->period + ms->period / 2)) {
+		/* Reports were not sent in consecutive slots, unless this
+		 * keeps happening. Then the connection interval got longer.
+		 */
+		ms->long_cnt++;
+		if (ms->long_cnt < PERIOD_RESEED_COUNT) {
+			return;
+		}
+		ms->period = 0;
+	}
+
+	ms->long_cnt = 0;
+
+	if (!ms->period) {
+		ms->period = sample;
+	} else {
+		ms->period = ms->period -
+			     (ms->period >> PERIOD_FILTER_SHIFT) +
+			     (sample >> PERIOD_FILTER_SHIFT);
+	}
+}
+
+static void latency_update(struct motion_sync *ms, u32_t latency)
+{
+	ms->lat_min = MIN(ms->lat_min, latency);
+	ms->lat_max = MAX(ms->lat_max, latency);
+	ms->lat_sum += latency;
+	ms->lat_cnt++;
+}
+
+void motion_sync_report_sent(struct motion_sync *ms, u32_t time)
+{
+	if (ms->published) {
+		latency_update(ms, time - ms->sample_time);
+
+		if (ms->sent_valid) {
+			period_update(ms, time - ms->last_sent);
+		}
+		ms->published = false;
+		ms->sent_valid = true;
+	} else {
+		/* Report without motion, e.g. button press. */
+		ms->sent_valid = false;
+	}
+
+	ms->last_sent = time;
+	ms->next_slot = time + ms->period;
+}
+
+u32_t motion_sync_read_delay(const struct motion_sync *ms, u32_t now,
+			     u32_t margin)
+{
+	if (!ms->period || ms->published) {
+		return 0;
+	}
+
+	s32_t delay = ms->next_slot - margin - now;
+
+	if (delay <= 0) {
+		return 0;
+	}
+
+	return MIN((u32_t)delay, ms->period);
+}
+
+void motion_sync_stats_get(struct motion_sync *ms,
+			   struct motion_sync_stats *stats)
+{
+	if (ms->lat_cnt) {
+		stats->min = ms->lat_min;
+		stats->max = ms->lat_max;
+		stats->avg = ms->lat_sum / ms->lat_cnt;
+	} else {
+		stats->min = 0;
+		stats->max = 0;
+		stats->avg = 0;
+	}
+	stats->cnt = ms->lat_cnt;
+
+	ms->lat_min = UINT32_MAX;
+	ms->lat_max = 0;
+	ms->lat_sum = 0;
+	ms->lat_cnt = 0;
+}
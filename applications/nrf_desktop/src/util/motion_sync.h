@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef _MOTION_SYNC_H_
+#define _MOTION_SYNC_H_
+
+/**
+ * @file
+ * @defgroup motion_sync Motion report synchronization
+ * @{
+ * @brief Accumulation of motion synchronized with HID report slots.
+ *
+ * Motion read from the sensor is accumulated until the report slot is
+ * available. The period of report slots is estimated from the time between
+ * sent reports. All times are given in the same unit, chosen by the user
+ * (for example hardware clock cycles), and may wrap around.
+ */
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Sensor to report latency statistics. */
+struct motion_sync_stats {
+	u32_t min;	/**< Minimum latency. */
+	u32_t avg;	/**< Average latency. */
+	u32_t max;	/**< Maximum latency. */
+	u32_t cnt;	/**< Number of sent reports with motion. */
+};
+
+/** @brief Motion synchronization state. */
+struct motion_sync {
+	s32_t dx;		/**< Accumulated motion in X axis. */
+	s32_t dy;		/**< Accumulated motion in Y axis. */
+	u32_t first_read;	/**< Time of the oldest accumulated motion. */
+	u32_t last_read;	/**< Time of the newest accumulated motion. */
+	u32_t sample_time;	/**< Time of the oldest published motion. */
+	u32_t last_sent;	/**< Time of the last sent report. */
+	u32_t next_slot;	/**< Expected time of the next report. */
+	u32_t period;		/**< Estimated report period, 0 if unknown. */
+	u32_t period_max;	/**< Maximum report period. */
+	u8_t long_cnt;		/**< Consecutive periods longer than estimated. */
+	bool acc_valid;		/**< Motion is accumulated. */
+	bool published;		/**< Published motion waits for report. */
+	bool sent_valid;	/**< Last sent report contained motion. */
+
+	u32_t lat_min;
+	u32_t lat_max;
+	u32_t lat_cnt;
+	u64_t lat_sum;
+};
+
+/** @brief Initializer of the motion synchronization state.
+ *
+ * @param _period_max Maximum period between reports. Longer time between
+ *                    two sent reports is not used for the period estimation.
+ */
+#define MOTION_SYNC_INITIALIZER(_period_max)		\
+	{						\
+		.period_max = _period_max,		\
+		.lat_min = UINT32_MAX,			\
+	}
+
+/** @brief Drop accumulated motion and estimated report period.
+ *
+ * Latency statistics are not affected.
+ */
+void motion_sync_reset(struct motion_sync *ms);
+
+/** @brief Accumulate motion read from the sensor.
+ *
+ * @param ms Motion synchronization state.
+ * @param dx Motion in X axis.
+ * @param dy Motion in Y axis.
+ * @param time Time of the sensor read.
+ */
+void motion_sync_add(struct motion_sync *ms, s32_t dx, s32_t dy, u32_t time);
+
+/** @brief Take accumulated motion to be sent in the report.
+ *
+ * Motion that does not fit into the event is left for the next report.
+ *
+ * @param ms Motion synchronization state.
+ * @param dx Motion in X axis.
+ * @param dy Motion in Y axis.
+ * @param timestamp Time of the newest motion included.
+ *
+ * @return true if motion was published, false if no motion is accumulated.
+ */
+bool motion_sync_publish(struct motion_sync *ms, s16_t *dx, s16_t *dy,
+			 u32_t *timestamp);
+
+/** @brief Skip the report slot for which no motion was published.
+ *
+ * @param ms Motion synchronization state.
+ * @param now Current time.
+ */
+void motion_sync_slot_skip(struct motion_sync *ms, u32_t now);
+
+/** @brief Notify about the sent report.
+ *
+ * @param ms Motion synchronization state.
+ * @param time Time of sending the report.
+ */
+void motion_sync_report_sent(struct motion_sync *ms, u32_t time);
+
+/** @brief Get the time after which the sensor should be read.
+ *
+ * @param ms Motion synchronization state.
+ * @param now Current time.
+ * @param margin Time needed between the read and the report slot.
+ *
+ * @return Time to wait, 0 if sensor should be read immediately.
+ */
+u32_t motion_sync_read_delay(const struct motion_sync *ms, u32_t now,
+			     u32_t margin);
+
+/** @brief Get latency statistics and start new measurement.
+ *
+ * @param ms Motion synchronization state.
+ * @param stats Pointer to the structure the statistics are written to.
+ */
+void motion_sync_stats_get(struct motion_sync *ms,
+			   struct motion_sync_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* _MOTION_SYNC_H_ */
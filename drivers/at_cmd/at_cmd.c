@@ -9,43 +9,77 @@
 #include <stdio.h>
 #include <net/socket.h>
 #include <init.h>
-#include <bsd_limits.h>
+#include <profiler.h>
 
 #include <at_cmd.h>
 
 LOG_MODULE_REGISTER(at_cmd, CONFIG_AT_CMD_LOG_LEVEL);
 
 #define THREAD_PRIORITY   K_PRIO_PREEMPT(CONFIG_AT_CMD_THREAD_PRIO)
+#define NOTIF_PRIORITY    K_PRIO_PREEMPT(CONFIG_AT_CMD_NOTIF_THREAD_PRIO)
 
 #define AT_CMD_OK_STR    "OK"
 #define AT_CMD_ERROR_STR "ERROR"
-#define AT_CMD_CMS_STR   "+CMS:"
-#define AT_CMD_CME_STR   "+CME:"
+#define AT_CMD_CMS_STR   "+CMS ERROR:"
+#define AT_CMD_CME_STR   "+CME ERROR:"
 
 static K_THREAD_STACK_DEFINE(socket_thread_stack, \
 				CONFIG_AT_CMD_THREAD_STACK_SIZE);
-
-static K_SEM_DEFINE(cmd_pending, 1, 1);
+static K_THREAD_STACK_DEFINE(notif_thread_stack, \
+				CONFIG_AT_CMD_NOTIF_THREAD_STACK_SIZE);
 
 static int              common_socket_fd;
-static char             *response_buf;
-static u32_t            response_buf_len;
 
 static struct k_thread  socket_thread;
+static struct k_work_q  notif_work_q;
 static at_cmd_handler_t notification_handler;
-static at_cmd_handler_t current_cmd_handler;
 
 struct return_state_object {
 	int               code;
 	enum at_cmd_state state;
 };
 
-K_MSGQ_DEFINE(return_code_msq, sizeof(struct return_state_object), 1, 4);
+/* A command, on the stack of the calling thread until it completes. */
+struct at_cmd_req {
+	sys_snode_t                node;
+	const char                 *cmd;
+	enum at_cmd_prio           prio;
+	at_cmd_handler_t           handler;
+	char                       *buf;
+	size_t                     buf_len;
+	const char                 **response;
+	struct k_sem               done;
+	struct return_state_object ret;
+};
+
+/* Commands waiting to be sent, in order of priority. */
+static sys_slist_t       cmd_queue;
+/* The command that has been sent and waits for its result code. */
+static struct at_cmd_req *cmd_current;
+/* Takes the place of a sent command whose caller has timed out, so that
+ * its result is dropped.
+ */
+static struct at_cmd_req cmd_abandoned;
+
+K_MUTEX_DEFINE(cmd_lock);
+
+struct notif_handler {
+	const char       *prefix;
+	at_cmd_handler_t handler;
+};
+
+static struct notif_handler notif_handlers[CONFIG_AT_CMD_NOTIF_HANDLER_COUNT];
+
+K_MUTEX_DEFINE(notif_lock);
 
+/* Responses are received once into these buffers, and passed on to the
+ * handlers or to the caller of at_cmd_write_ref() without copying.
+ */
 struct callback_work_item {
 	struct k_work    work;
-	char             data[CONFIG_AT_CMD_RESPONSE_MAX_LEN];
+	atomic_t         ref;
 	at_cmd_handler_t callback;
+	char             data[CONFIG_AT_CMD_RESPONSE_MAX_LEN];
 };
 
 K_MEM_SLAB_DEFINE(rsp_work_items, sizeof(struct callback_work_item),
@@ -62,65 +96,215 @@ static int open_socket(void)
 	return 0;
 }
 
-static int get_return_code(char *buf, struct return_state_object *ret)
+static bool line_is(const char *line, size_t len, const char *str,
+		    size_t str_len)
+{
+	return (len >= str_len) && (memcmp(line, str, str_len) == 0);
+}
+
+/* Classifies the response by its last line, which holds the result code for
+ * command responses, and terminates the payload in front of it. Only the last
+ * line is scanned, so result codes within the payload cannot match.
+ *
+ * Returns the length of the payload including the terminating null
+ * character.
+ */
+static int get_return_code(char *buf, size_t len,
+			   struct return_state_object *ret)
 {
-	char *tmpstr = NULL;
-	int new_len  = 0;
+	char *end = buf + len;
+	char *line;
+	size_t line_len;
 
 	ret->state = AT_CMD_NOTIFICATION;
 
-	do {
-		tmpstr = strstr(buf, AT_CMD_OK_STR);
-		if (tmpstr) {
-			ret->state = AT_CMD_OK;
-			ret->code  = 0;
-			break;
+	while ((end > buf) && ((end[-1] == '\0') || (end[-1] == '\r') ||
+			       (end[-1] == '\n'))) {
+		end--;
+	}
+
+	line = end;
+
+	while ((line > buf) && (line[-1] != '\n')) {
+		line--;
+	}
+
+	line_len = end - line;
+
+	if (line_is(line, line_len, AT_CMD_OK_STR,
+		    sizeof(AT_CMD_OK_STR) - 1)) {
+		ret->state = AT_CMD_OK;
+		ret->code  = 0;
+	} else if (line_is(line, line_len, AT_CMD_ERROR_STR,
+			   sizeof(AT_CMD_ERROR_STR) - 1)) {
+		ret->state = AT_CMD_ERROR;
+		ret->code  = -ENOEXEC;
+	} else if (line_is(line, line_len, AT_CMD_CMS_STR,
+			   sizeof(AT_CMD_CMS_STR) - 1)) {
+		ret->state = AT_CMD_ERROR_CMS;
+		ret->code  = atoi(line + sizeof(AT_CMD_CMS_STR) - 1);
+	} else if (line_is(line, line_len, AT_CMD_CME_STR,
+			   sizeof(AT_CMD_CME_STR) - 1)) {
+		ret->state = AT_CMD_ERROR_CME;
+		ret->code  = atoi(line + sizeof(AT_CMD_CME_STR) - 1);
+	} else {
+		return strlen(buf) + 1;
+	}
+
+	*line = '\0';
+
+	return line - buf + 1;
+}
+
+static void item_unref(struct callback_work_item *item)
+{
+	/* atomic_dec() returns the previous value. */
+	if (atomic_dec(&item->ref) == 1) {
+		k_mem_slab_free(&rsp_work_items, (void **)&item);
+	}
+}
+
+static void callback_worker(struct k_work *work)
+{
+	struct callback_work_item *item =
+		CONTAINER_OF(work, struct callback_work_item, work);
+
+	item->callback(item->data);
+
+	item_unref(item);
+}
+
+static bool prefix_matches(const char *prefix, const char *notif)
+{
+	return (prefix == NULL) ||
+	       (strncmp(notif, prefix, strlen(prefix)) == 0);
+}
+
+static bool prefix_equal(const char *a, const char *b)
+{
+	if ((a == NULL) || (b == NULL)) {
+		return a == b;
+	}
+
+	return strcmp(a, b) == 0;
+}
+
+/* Passes a notification to the handlers registered for its prefix. */
+static void notif_dispatch(char *notif)
+{
+	struct notif_handler handlers[ARRAY_SIZE(notif_handlers)];
+	at_cmd_handler_t global_handler;
+
+	k_mutex_lock(&notif_lock, K_FOREVER);
+	memcpy(handlers, notif_handlers, sizeof(handlers));
+	global_handler = notification_handler;
+	k_mutex_unlock(&notif_lock);
+
+	for (size_t i = 0; i < ARRAY_SIZE(handlers); i++) {
+		if ((handlers[i].handler != NULL) &&
+		    prefix_matches(handlers[i].prefix, notif)) {
+			handlers[i].handler(notif);
 		}
+	}
 
-		tmpstr = strstr(buf, AT_CMD_ERROR_STR);
-		if (tmpstr) {
-			ret->state = AT_CMD_ERROR;
-			ret->code  = -ENOEXEC;
-			break;
+	if (global_handler != NULL) {
+		global_handler(notif);
+	}
+}
+
+/* Sends queued commands until one is sent successfully.
+ * Must be called with cmd_lock held.
+ */
+static void cmd_send_next(void)
+{
+	int bytes_sent;
+	int bytes_to_send;
+	sys_snode_t *node;
+	struct at_cmd_req *req;
+
+	while (cmd_current == NULL) {
+		node = sys_slist_get(&cmd_queue);
+		if (node == NULL) {
+			return;
 		}
 
-		tmpstr = strstr(buf, AT_CMD_CMS_STR);
-		if (tmpstr) {
-			ret->state = AT_CMD_ERROR_CMS;
-			ret->code = atoi(&buf[ARRAY_SIZE(AT_CMD_CMS_STR) - 1]);
-			break;
+		req = CONTAINER_OF(node, struct at_cmd_req, node);
+		bytes_to_send = strlen(req->cmd);
+
+		LOG_DBG("Sending command %s", log_strdup(req->cmd));
+
+		bytes_sent = send(common_socket_fd, req->cmd, bytes_to_send, 0);
+		if (bytes_sent == -1) {
+			LOG_ERR("Failed to send AT command (err:%d)", errno);
+			req->ret.code  = -errno;
+			req->ret.state = AT_CMD_ERROR;
+			k_sem_give(&req->done);
+			continue;
 		}
 
-		tmpstr = strstr(buf, AT_CMD_CME_STR);
-		if (tmpstr) {
-			ret->state = AT_CMD_ERROR_CME;
-			ret->code = atoi(&buf[ARRAY_SIZE(AT_CMD_CMS_STR) - 1]);
-			break;
+		LOG_DBG("Bytes sent: %d", bytes_sent);
+
+		if (bytes_sent != bytes_to_send) {
+			LOG_ERR("Bytes sent (%d) was not the "
+				"same as expected (%d)",
+				bytes_sent, bytes_to_send);
 		}
-	} while (0);
 
-	if (tmpstr) {
-		new_len = tmpstr - buf;
-		buf[new_len++] = '\0';
-	} else {
-		new_len = strlen(buf) + 1;
+		cmd_current = req;
 	}
-
-	return new_len;
 }
 
-static void callback_worker(struct k_work *item)
+/* Passes the payload of a command response to the caller, and completes
+ * the command. The next command is sent right away, before the caller of
+ * the completed one has run. *item is set to NULL if the caller takes over
+ * the buffer.
+ */
+static void cmd_complete(struct callback_work_item **item,
+			 struct return_state_object *ret, int payload_len)
 {
-	struct callback_work_item *data =
-		CONTAINER_OF(item, struct callback_work_item, work);
+	struct at_cmd_req *req;
+
+	k_mutex_lock(&cmd_lock, K_FOREVER);
+
+	req = cmd_current;
+	cmd_current = NULL;
 
-	if (data != NULL) {
-		data->callback(data->data);
+	if (req == &cmd_abandoned) {
+		LOG_DBG("Dropped result of timed out command");
+		req = NULL;
+	} else if (req == NULL) {
+		LOG_WRN("Result code without command");
 	}
 
-	k_mem_slab_free(&rsp_work_items, (void **)&data);
-}
+	if ((req != NULL) && (payload_len > 0)) {
+		if (req->response != NULL) {
+			/* The caller takes over the reference. */
+			if (ret->code == 0) {
+				*req->response = (*item)->data;
+				*item = NULL;
+			}
+		} else if ((req->buf_len > 0) && (req->buf != NULL)) {
+			if (req->buf_len > payload_len) {
+				memcpy(req->buf, (*item)->data, payload_len);
+			} else {
+				LOG_ERR("Response buffer not large enough");
+
+				ret->code = -EMSGSIZE;
+			}
+		} else {
+			(*item)->callback = req->handler;
+		}
+	}
+
+	if (req != NULL) {
+		req->ret = *ret;
+		k_sem_give(&req->done);
+	}
 
+	cmd_send_next();
+
+	k_mutex_unlock(&cmd_lock);
+}
 
 static void socket_thread_fn(void *arg1, void *arg2, void *arg3)
 {
@@ -141,6 +325,7 @@ static void socket_thread_fn(void *arg1, void *arg2, void *arg3)
 		ret.code  = 0;
 		ret.state = AT_CMD_OK;
 		item->callback = NULL;
+		atomic_set(&item->ref, 1);
 
 		bytes_read = recv(common_socket_fd, item->data,
 				  sizeof(item->data), 0);
@@ -154,6 +339,7 @@ static void socket_thread_fn(void *arg1, void *arg2, void *arg3)
 
 				ret.state = AT_CMD_ERROR;
 				ret.code  = -errno;
+				cmd_complete(&item, &ret, 0);
 				goto next;
 			}
 
@@ -168,106 +354,96 @@ static void socket_thread_fn(void *arg1, void *arg2, void *arg3)
 				"missing termination character");
 
 			ret.code  = -ENOBUFS;
+			cmd_complete(&item, &ret, 0);
 			goto next;
 		}
 
-		payload_len = get_return_code(item->data, &ret);
-
-		if (ret.state != AT_CMD_NOTIFICATION) {
-			if ((response_buf_len > 0) &&
-			    (response_buf != NULL)) {
-				if (response_buf_len > payload_len) {
-					memcpy(response_buf, item->data,
-					       payload_len);
-				} else {
-					LOG_ERR("Response buffer not large "
-						"enough");
-
-					ret.code  = -EMSGSIZE;
-				}
-
-				response_buf_len = 0;
-				response_buf     = NULL;
-
-				goto next;
-			}
-		}
-
-		if (payload_len == 0) {
-			goto next;
-		}
+		payload_len = get_return_code(item->data, bytes_read, &ret);
 
 		if (ret.state == AT_CMD_NOTIFICATION) {
-			item->callback = notification_handler;
+			item->callback = notif_dispatch;
 		} else {
-			item->callback = current_cmd_handler;
+			cmd_complete(&item, &ret, payload_len);
 		}
 next:
-		/* If no callback was set, free the item.
-		 * Otherwise, work queue callback will free it.
+		/* If no callback was set, release the item. Otherwise, the
+		 * work queue callback will release it.
 		 */
-		if (item->callback == NULL) {
-			k_mem_slab_free(&rsp_work_items, (void **)&item);
+		if (item == NULL) {
+			/* Handed over to at_cmd_write_ref(). */
+		} else if (item->callback == NULL) {
+			item_unref(item);
 		} else {
 			k_work_init(&item->work, callback_worker);
-			k_work_submit(&item->work);
-		}
-
-		/* Notify back only if command was sent. */
-		if ((k_sem_count_get(&cmd_pending) == 0) &&
-		    (ret.state != AT_CMD_NOTIFICATION)) {
-			current_cmd_handler = NULL;
-
-			k_msgq_put(&return_code_msq, &ret, K_FOREVER);
+			k_work_submit_to_queue(&notif_work_q, &item->work);
 		}
 	}
 }
 
-static inline int at_write(const char *const cmd, enum at_cmd_state *state)
+static int cmd_write(struct at_cmd_req *req, enum at_cmd_state *state,
+		     s32_t timeout)
 {
-	int bytes_sent;
-	int bytes_to_send = strlen(cmd);
-	struct return_state_object ret;
+	sys_snode_t *node;
+	sys_snode_t *prev = NULL;
 
-	LOG_DBG("Sending command %s", log_strdup(cmd));
+	k_sem_init(&req->done, 0, 1);
 
-	bytes_sent = send(common_socket_fd, cmd, bytes_to_send, 0);
+	k_mutex_lock(&cmd_lock, K_FOREVER);
 
-	if (bytes_sent == -1) {
-		LOG_ERR("Failed to send AT command (err:%d)", errno);
-		ret.code  = -errno;
-		ret.state = AT_CMD_ERROR;
-	} else {
-		k_msgq_get(&return_code_msq, &ret, K_FOREVER);
-		LOG_DBG("Bytes sent: %d", bytes_sent);
+	/* Queue behind the commands of the same or higher priority. */
+	SYS_SLIST_FOR_EACH_NODE(&cmd_queue, node) {
+		if (CONTAINER_OF(node, struct at_cmd_req, node)->prio >
+		    req->prio) {
+			break;
+		}
 
-		if (bytes_sent != bytes_to_send) {
-			LOG_ERR("Bytes sent (%d) was not the "
-				"same as expected (%d)",
-				bytes_sent, bytes_to_send);
+		prev = node;
+	}
+
+	sys_slist_insert(&cmd_queue, prev, &req->node);
+	cmd_send_next();
+
+	k_mutex_unlock(&cmd_lock);
+
+	if (k_sem_take(&req->done, timeout) != 0) {
+		k_mutex_lock(&cmd_lock, K_FOREVER);
+
+		if (sys_slist_find_and_remove(&cmd_queue, &req->node)) {
+			LOG_WRN("Timed out before sending %s",
+				log_strdup(req->cmd));
+			req->ret.code  = -ETIMEDOUT;
+			req->ret.state = AT_CMD_ERROR;
+		} else if (cmd_current == req) {
+			LOG_WRN("Timed out waiting for result of %s",
+				log_strdup(req->cmd));
+			cmd_current    = &cmd_abandoned;
+			req->ret.code  = -ETIMEDOUT;
+			req->ret.state = AT_CMD_ERROR;
 		}
+
+		/* Otherwise, the command completed in the meantime. */
+
+		k_mutex_unlock(&cmd_lock);
 	}
 
 	if (state) {
-		*state = ret.state;
+		*state = req->ret.state;
 	}
 
-	return ret.code;
+	return req->ret.code;
 }
 
 int at_cmd_write_with_callback(const char *const cmd,
 			       at_cmd_handler_t  handler,
 			       enum at_cmd_state *state)
 {
-	k_sem_take(&cmd_pending, K_FOREVER);
-
-	current_cmd_handler = handler;
-
-	int return_code = at_write(cmd, state);
-
-	k_sem_give(&cmd_pending);
+	struct at_cmd_req req = {
+		.cmd     = cmd,
+		.prio    = AT_CMD_PRIO_NORMAL,
+		.handler = handler,
+	};
 
-	return return_code;
+	return cmd_write(&req, state, K_FOREVER);
 }
 
 int at_cmd_write(const char *const cmd,
@@ -275,26 +451,130 @@ int at_cmd_write(const char *const cmd,
 		 size_t buf_len,
 		 enum at_cmd_state *state)
 {
-	k_sem_take(&cmd_pending, K_FOREVER);
+	return at_cmd_write_prio(cmd, buf, buf_len, state,
+				 AT_CMD_PRIO_NORMAL, K_FOREVER);
+}
 
-	response_buf     = buf;
-	response_buf_len = buf_len;
+int at_cmd_write_prio(const char *const cmd,
+		      char *buf,
+		      size_t buf_len,
+		      enum at_cmd_state *state,
+		      enum at_cmd_prio prio,
+		      s32_t timeout)
+{
+	struct at_cmd_req req = {
+		.cmd     = cmd,
+		.prio    = prio,
+		.buf     = buf,
+		.buf_len = buf_len,
+	};
+
+	if (prio > AT_CMD_PRIO_LOW) {
+		return -EINVAL;
+	}
 
-	int return_code = at_write(cmd, state);
+	return cmd_write(&req, state, timeout);
+}
 
-	k_sem_give(&cmd_pending);
+int at_cmd_write_ref(const char *const cmd,
+		     const char **response,
+		     enum at_cmd_state *state)
+{
+	struct at_cmd_req req = {
+		.cmd      = cmd,
+		.prio     = AT_CMD_PRIO_NORMAL,
+		.response = response,
+	};
+
+	if (response == NULL) {
+		return -EINVAL;
+	}
+
+	*response = NULL;
 
-	return return_code;
+	return cmd_write(&req, state, K_FOREVER);
 }
 
-void at_cmd_set_notification_handler(at_cmd_handler_t handler)
+void at_cmd_response_ref(const char *response)
+{
+	struct callback_work_item *item =
+		CONTAINER_OF(response, struct callback_work_item, data);
+
+	atomic_inc(&item->ref);
+}
+
+void at_cmd_response_unref(const char *response)
+{
+	if (response == NULL) {
+		return;
+	}
+
+	item_unref(CONTAINER_OF(response, struct callback_work_item, data));
+}
+
+int at_cmd_notif_register(const char *prefix, at_cmd_handler_t handler)
 {
+	int err = -ENOMEM;
+	struct notif_handler *entry = NULL;
+
+	if (handler == NULL) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&notif_lock, K_FOREVER);
 
-	k_sem_take(&cmd_pending, K_FOREVER);
+	for (size_t i = 0; i < ARRAY_SIZE(notif_handlers); i++) {
+		if ((notif_handlers[i].handler == handler) &&
+		    prefix_equal(notif_handlers[i].prefix, prefix)) {
+			err = -EALREADY;
+			goto exit;
+		}
+
+		if ((entry == NULL) && (notif_handlers[i].handler == NULL)) {
+			entry = &notif_handlers[i];
+		}
+	}
+
+	if (entry != NULL) {
+		entry->prefix  = prefix;
+		entry->handler = handler;
+		err = 0;
+	}
+
+exit:
+	k_mutex_unlock(&notif_lock);
+
+	return err;
+}
+
+int at_cmd_notif_deregister(const char *prefix, at_cmd_handler_t handler)
+{
+	int err = -ENXIO;
+
+	k_mutex_lock(&notif_lock, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(notif_handlers); i++) {
+		if ((notif_handlers[i].handler == handler) &&
+		    prefix_equal(notif_handlers[i].prefix, prefix)) {
+			notif_handlers[i].handler = NULL;
+			notif_handlers[i].prefix  = NULL;
+			err = 0;
+			break;
+		}
+	}
+
+	k_mutex_unlock(&notif_lock);
+
+	return err;
+}
+
+void at_cmd_set_notification_handler(at_cmd_handler_t handler)
+{
+	k_mutex_lock(&notif_lock, K_FOREVER);
 
 	notification_handler = handler;
 
-	k_sem_give(&cmd_pending);
+	k_mutex_unlock(&notif_lock);
 }
 
 static int at_cmd_driver_init(struct device *dev)
@@ -311,12 +591,18 @@ static int at_cmd_driver_init(struct device *dev)
 
 	LOG_DBG("Common AT socket created");
 
+	k_work_q_start(&notif_work_q, notif_thread_stack,
+		       K_THREAD_STACK_SIZEOF(notif_thread_stack),
+		       NOTIF_PRIORITY);
+
 	k_thread_create(&socket_thread, socket_thread_stack,
 			K_THREAD_STACK_SIZEOF(socket_thread_stack),
 			socket_thread_fn,
 			NULL, NULL, NULL,
 			THREAD_PRIORITY, 0, K_NO_WAIT);
 
+	profiler_stack_monitor_register(&socket_thread);
+
 	LOG_DBG("Common AT socket processing thread created");
 
 	return 0;
@@ -31,7 +31,13 @@ LOG_MODULE_REGISTER(lte_lc, CONFIG_LTE_LINK_CONTROL_LOG_LEVEL);
 #define AT_CEREG_READ				"AT+CEREG?"
 #define AT_CEREG_RESPONSE_PREFIX		"+CEREG"
 #define AT_CEREG_PARAMS_COUNT			10
+/* Notifications are "+CEREG: <stat>,...", read responses
+ * "+CEREG: <n>,<stat>,...".
+ */
 #define AT_CEREG_REG_STATUS_INDEX		1
+#define AT_CEREG_NOTIF_ACTIVE_TIME_INDEX	7
+#define AT_CEREG_NOTIF_TAU_INDEX		8
+#define AT_CEREG_READ_REG_STATUS_INDEX		2
 #define AT_CEREG_ACTIVE_TIME_INDEX		8
 #define AT_CEREG_TAU_INDEX			9
 #define AT_CEREG_RESPONSE_MAX_LEN		80
@@ -44,9 +50,21 @@ LOG_MODULE_REGISTER(lte_lc, CONFIG_LTE_LINK_CONTROL_LOG_LEVEL);
 #define AT_XSYSTEMMODE_GPS_INDEX		2
 #define AT_XSYSTEMMODE_PARAMS_COUNT		5
 #define AT_XSYSTEMMODE_RESPONSE_MAX_LEN		30
+#define AT_XRAI_PROTO				"AT%%XRAI=%d"
+#define AT_XRAI_MAX_LEN				12
+#define AT_CSCON_1				"AT+CSCON=1"
+#define AT_CSCON_READ				"AT+CSCON?"
+#define AT_CSCON_RESPONSE_PREFIX		"+CSCON"
+#define AT_CSCON_PARAMS_COUNT			3
+/* Notifications are "+CSCON: <mode>", read responses "+CSCON: <n>,<mode>" */
+#define AT_CSCON_MODE_INDEX			1
+#define AT_CSCON_READ_MODE_INDEX		2
+#define AT_CSCON_RESPONSE_MAX_LEN		20
+#define AT_XT3412_SUB_PROTO			"AT%%XT3412=1,%d,%d"
+#define AT_XT3412_RESPONSE_PREFIX		"%XT3412"
 
 /* Forward declarations */
-static int parse_nw_reg_status(const char *at_response,
+static int parse_nw_reg_status(const char *at_response, size_t status_index,
 			       enum lte_lc_nw_reg_status *status);
 static bool response_is_valid(const char *response, size_t response_len,
 			      const char *check);
@@ -121,7 +139,55 @@ static const char nw_mode_preferred[] = "AT%XSYSTEMMODE=1,0,1,0";
 static const char nw_mode_fallback[] = "AT%XSYSTEMMODE=0,1,1,0";
 #endif
 
-static struct k_sem link;
+static K_SEM_DEFINE(link, 0, 1);
+
+#if defined(CONFIG_LTE_LINK_STATE)
+static struct lte_lc_link_state link_state = {
+	.nw_reg_status = LTE_LC_NW_REG_NOT_REGISTERED,
+	.tau = -1,
+	.active_time = -1,
+};
+static bool link_state_ready;
+static lte_lc_evt_handler_t evt_handlers[CONFIG_LTE_LINK_STATE_HANDLER_COUNT];
+
+K_MUTEX_DEFINE(link_state_lock);
+
+static int link_state_init(void);
+static void cereg_notification_handle(const char *notif,
+				      enum lte_lc_nw_reg_status status);
+static void rrc_notification_handle(const char *notif);
+static void tau_pre_warning_handle(const char *notif);
+#endif
+
+#if defined(CONFIG_LTE_PSM_SCHED)
+struct tx_entry {
+	struct k_work *work;
+	/* Uptime (ms) when the work is submitted at the latest. */
+	s64_t deadline;
+};
+
+static struct tx_entry tx_queue[CONFIG_LTE_PSM_SCHED_QUEUE_SIZE];
+static struct k_delayed_work tx_timer;
+static bool sched_ready;
+static bool rrc_connected;
+static s64_t rrc_connected_since;
+static enum lte_lc_rai rai_current;
+
+static struct lte_lc_cycle_stats cycle_stats;
+static s64_t cycle_start_time;
+static bool cycle_active;
+static bool cycle_ending;
+static lte_lc_cycle_handler_t cycle_handler;
+
+/* Completed cycle, reported from the system work queue. */
+static struct k_work cycle_work;
+static struct lte_lc_cycle_stats cycle_done_stats;
+static lte_lc_cycle_handler_t cycle_done_handler;
+
+K_MUTEX_DEFINE(sched_lock);
+
+static void sched_rrc_update(bool connected);
+#endif
 
 #if defined(CONFIG_LTE_PDP_CMD) && defined(CONFIG_LTE_PDP_CONTEXT)
 static const char cgdcont[] = "AT+CGDCONT="CONFIG_LTE_PDP_CONTEXT;
@@ -145,18 +211,44 @@ void at_handler(char *response)
 
 	LOG_DBG("recv: %s", log_strdup(response));
 
-	err = parse_nw_reg_status(response, &status);
+#if defined(CONFIG_LTE_LINK_STATE)
+	if (strncmp(response, AT_CSCON_RESPONSE_PREFIX,
+		    sizeof(AT_CSCON_RESPONSE_PREFIX) - 1) == 0) {
+		rrc_notification_handle(response);
+		return;
+	}
+
+	if (strncmp(response, AT_XT3412_RESPONSE_PREFIX,
+		    sizeof(AT_XT3412_RESPONSE_PREFIX) - 1) == 0) {
+		tau_pre_warning_handle(response);
+		return;
+	}
+#endif
+
+	err = parse_nw_reg_status(response, AT_CEREG_REG_STATUS_INDEX, &status);
 	if (err) {
 		LOG_ERR("Could not get network registration status");
 		return;
 	}
 
+#if defined(CONFIG_LTE_LINK_STATE)
+	cereg_notification_handle(response, status);
+#endif
+
 	if ((status == LTE_LC_NW_REG_REGISTERED_HOME) ||
 	    (status == LTE_LC_NW_REG_REGISTERED_ROAMING)) {
 		k_sem_give(&link);
 	}
 }
 
+/* Registers at_handler for notifications starting with @p prefix. */
+static int notif_register(const char *prefix)
+{
+	int err = at_cmd_notif_register(prefix, at_handler);
+
+	return (err == -EALREADY) ? 0 : err;
+}
+
 static int w_lte_lc_init(void)
 {
 #if defined(CONFIG_LTE_EDRX_REQ)
@@ -208,6 +300,11 @@ static int w_lte_lc_init(void)
 	}
 	LOG_INF("PDN Auth: %s", log_strdup(cgauth));
 #endif
+#if defined(CONFIG_LTE_LINK_STATE)
+	if (link_state_init() != 0) {
+		return -EIO;
+	}
+#endif
 
 	return 0;
 }
@@ -219,7 +316,11 @@ static int w_lte_lc_connect(void)
 	bool retry;
 
 	k_sem_init(&link, 0, 1);
-	at_cmd_set_notification_handler(at_handler);
+
+	err = notif_register(AT_CEREG_RESPONSE_PREFIX);
+	if (err) {
+		return err;
+	}
 
 	do {
 		retry = false;
@@ -258,7 +359,13 @@ static int w_lte_lc_connect(void)
 	} while (retry);
 
 exit:
-	at_cmd_set_notification_handler(NULL);
+#if defined(CONFIG_LTE_LINK_STATE)
+	/* The link state is kept up to date from the notifications. */
+	if (link_state_ready) {
+		return err;
+	}
+#endif
+	at_cmd_notif_deregister(AT_CEREG_RESPONSE_PREFIX, at_handler);
 
 	return err;
 }
@@ -334,18 +441,54 @@ int lte_lc_psm_req(bool enable)
 	return 0;
 }
 
-int lte_lc_psm_get(int *tau, int *active_time)
+/**@brief Parses a GPRS timer parameter, such as the periodic TAU or the
+ *	  active time, from a +CEREG parameter list.
+ *
+ * @param list Parameter list with the parsed +CEREG response.
+ * @param index Index of the timer parameter.
+ * @param lookup Timer unit lookup table, in seconds.
+ * @param lookup_len Number of entries in the lookup table.
+ * @param seconds Pointer to where the timer value is stored, -1 if the timer
+ *		  is deactivated.
+ *
+ * @return Zero on success or (negative) error code otherwise.
+ */
+static int parse_psm_timer(struct at_param_list *list, size_t index,
+			   const u32_t *lookup, size_t lookup_len, int *seconds)
 {
 	int err;
-	struct at_param_list at_resp_list = {0};
-	char buf[AT_CEREG_RESPONSE_MAX_LEN] = {0};
 	char timer_str[9] = {0};
 	char unit_str[4] = {0};
 	size_t timer_str_len = sizeof(timer_str) - 1;
 	size_t unit_str_len = sizeof(unit_str) - 1;
-	size_t index;
+	size_t lut_idx;
 	u32_t timer_unit, timer_value;
 
+	err = at_params_string_get(list, index, timer_str, &timer_str_len);
+	if (err) {
+		return err;
+	}
+
+	memcpy(unit_str, timer_str, unit_str_len);
+
+	lut_idx = strtoul(unit_str, NULL, 2);
+	if (lut_idx > (lookup_len - 1)) {
+		return -EINVAL;
+	}
+
+	timer_unit = lookup[lut_idx];
+	timer_value = strtoul(timer_str + unit_str_len, NULL, 2);
+	*seconds = timer_unit ? timer_unit * timer_value : -1;
+
+	return 0;
+}
+
+int lte_lc_psm_get(int *tau, int *active_time)
+{
+	int err;
+	struct at_param_list at_resp_list = {0};
+	char buf[AT_CEREG_RESPONSE_MAX_LEN] = {0};
+
 	if ((tau == NULL) || (active_time == NULL)) {
 		return -EINVAL;
 	}
@@ -380,51 +523,22 @@ int lte_lc_psm_get(int *tau, int *active_time)
 	}
 
 	/* Parse periodic TAU string */
-	err = at_params_string_get(&at_resp_list,
-				   AT_CEREG_TAU_INDEX,
-				   timer_str,
-				   &timer_str_len);
+	err = parse_psm_timer(&at_resp_list, AT_CEREG_TAU_INDEX,
+			      t3412_lookup, ARRAY_SIZE(t3412_lookup), tau);
 	if (err) {
 		LOG_ERR("Could not get TAU, error: %d", err);
 		goto parse_psm_clean_exit;
 	}
 
-	memcpy(unit_str, timer_str, unit_str_len);
-
-	index = strtoul(unit_str, NULL, 2);
-	if (index > (ARRAY_SIZE(t3412_lookup) - 1)) {
-		LOG_ERR("Unable to parse periodic TAU string");
-		err = -EINVAL;
-		goto parse_psm_clean_exit;
-	}
-
-	timer_unit = t3412_lookup[index];
-	timer_value = strtoul(timer_str + unit_str_len, NULL, 2);
-	*tau = timer_unit ? timer_unit * timer_value : -1;
-
 	/* Parse active time string */
-	err = at_params_string_get(&at_resp_list,
-				   AT_CEREG_ACTIVE_TIME_INDEX,
-				   timer_str,
-				   &timer_str_len);
+	err = parse_psm_timer(&at_resp_list, AT_CEREG_ACTIVE_TIME_INDEX,
+			      t3324_lookup, ARRAY_SIZE(t3324_lookup),
+			      active_time);
 	if (err) {
-		LOG_ERR("Could not get TAU, error: %d", err);
-		goto parse_psm_clean_exit;
-	}
-
-	memcpy(unit_str, timer_str, unit_str_len);
-
-	index = strtoul(unit_str, NULL, 2);
-	if (index > (ARRAY_SIZE(t3324_lookup) - 1)) {
-		LOG_ERR("Unable to parse active time string");
-		err = -EINVAL;
+		LOG_ERR("Could not get active time, error: %d", err);
 		goto parse_psm_clean_exit;
 	}
 
-	timer_unit = t3324_lookup[index];
-	timer_value = strtoul(timer_str + unit_str_len, NULL, 2);
-	*active_time = timer_unit ? timer_unit * timer_value : -1;
-
 	LOG_DBG("TAU: %d sec, active time: %d sec\n", *tau, *active_time);
 
 parse_psm_clean_exit:
@@ -443,6 +557,691 @@ int lte_lc_edrx_req(bool enable)
 	return 0;
 }
 
+int lte_lc_rai_req(enum lte_lc_rai rai)
+{
+	char cmd[AT_XRAI_MAX_LEN];
+
+	switch (rai) {
+	case LTE_LC_RAI_DISABLED:
+	case LTE_LC_RAI_ONE_RESPONSE:
+	case LTE_LC_RAI_NO_RESPONSE:
+		break;
+	default:
+		LOG_ERR("Invalid release assistance indication: %d", rai);
+		return -EINVAL;
+	}
+
+	snprintf(cmd, sizeof(cmd), AT_XRAI_PROTO, rai);
+
+	if (at_cmd_write(cmd, NULL, 0, NULL) != 0) {
+		return -EIO;
+	}
+
+	return 0;
+}
+
+#if defined(CONFIG_LTE_LINK_STATE)
+/* Calls the registered event handlers. Must be called without
+ * link_state_lock held, handlers may use the getters.
+ */
+static void evt_notify(const struct lte_lc_evt *evt)
+{
+	lte_lc_evt_handler_t handlers[ARRAY_SIZE(evt_handlers)];
+
+	k_mutex_lock(&link_state_lock, K_FOREVER);
+	memcpy(handlers, evt_handlers, sizeof(handlers));
+	k_mutex_unlock(&link_state_lock);
+
+	for (size_t i = 0; i < ARRAY_SIZE(handlers); i++) {
+		if (handlers[i] != NULL) {
+			handlers[i](evt);
+		}
+	}
+}
+
+static int parse_rrc_mode(const char *at_response, size_t mode_index,
+			  bool *connected)
+{
+	int err, mode;
+	struct at_param_list resp_list = {0};
+	char response_prefix[sizeof(AT_CSCON_RESPONSE_PREFIX)] = {0};
+	size_t response_prefix_len = sizeof(response_prefix);
+
+	err = at_params_list_init(&resp_list, AT_CSCON_PARAMS_COUNT);
+	if (err) {
+		LOG_ERR("Could not init AT params list, error: %d", err);
+		return err;
+	}
+
+	err = at_parser_max_params_from_str(at_response, NULL, &resp_list,
+					    AT_CSCON_PARAMS_COUNT);
+	if (err) {
+		LOG_ERR("Could not parse +CSCON, error: %d", err);
+		goto clean_exit;
+	}
+
+	err = at_params_string_get(&resp_list,
+				   AT_RESPONSE_PREFIX_INDEX,
+				   response_prefix,
+				   &response_prefix_len);
+	if (err) {
+		LOG_ERR("Could not get response prefix, error: %d", err);
+		goto clean_exit;
+	}
+
+	if (!response_is_valid(response_prefix, response_prefix_len,
+			       AT_CSCON_RESPONSE_PREFIX)) {
+		LOG_ERR("Invalid CSCON response");
+		err = -EIO;
+		goto clean_exit;
+	}
+
+	err = at_params_int_get(&resp_list, mode_index, &mode);
+	if (err) {
+		LOG_ERR("Could not get RRC mode, error: %d", err);
+		goto clean_exit;
+	}
+
+	*connected = (mode == 1);
+
+clean_exit:
+	at_params_list_free(&resp_list);
+
+	return err;
+}
+
+/* Parses the PSM timers of a +CEREG notification or read response. The
+ * timers are only present when the network has granted PSM.
+ */
+static int parse_cereg_psm(const char *at_response, size_t tau_index,
+			   size_t active_time_index, int *tau, int *active_time)
+{
+	int err;
+	struct at_param_list resp_list = {0};
+
+	err = at_params_list_init(&resp_list, AT_CEREG_PARAMS_COUNT);
+	if (err) {
+		return err;
+	}
+
+	err = at_parser_max_params_from_str(at_response, NULL, &resp_list,
+					    AT_CEREG_PARAMS_COUNT);
+	if (err) {
+		goto clean_exit;
+	}
+
+	err = parse_psm_timer(&resp_list, tau_index, t3412_lookup,
+			      ARRAY_SIZE(t3412_lookup), tau);
+	if (err) {
+		goto clean_exit;
+	}
+
+	err = parse_psm_timer(&resp_list, active_time_index, t3324_lookup,
+			      ARRAY_SIZE(t3324_lookup), active_time);
+
+clean_exit:
+	at_params_list_free(&resp_list);
+
+	return err;
+}
+
+static void cereg_notification_handle(const char *notif,
+				      enum lte_lc_nw_reg_status status)
+{
+	int tau, active_time;
+	bool psm_valid;
+	bool status_changed;
+	bool psm_changed = false;
+	struct lte_lc_evt evt;
+
+	psm_valid = (parse_cereg_psm(notif, AT_CEREG_NOTIF_TAU_INDEX,
+				     AT_CEREG_NOTIF_ACTIVE_TIME_INDEX,
+				     &tau, &active_time) == 0);
+
+	k_mutex_lock(&link_state_lock, K_FOREVER);
+
+	status_changed = (link_state.nw_reg_status != status);
+	link_state.nw_reg_status = status;
+
+	if (psm_valid && ((link_state.tau != tau) ||
+			  (link_state.active_time != active_time))) {
+		link_state.tau = tau;
+		link_state.active_time = active_time;
+		psm_changed = true;
+	}
+
+	k_mutex_unlock(&link_state_lock);
+
+	if (status_changed) {
+		evt.type = LTE_LC_EVT_NW_REG_STATUS;
+		evt.nw_reg_status = status;
+		evt_notify(&evt);
+	}
+
+	if (psm_changed) {
+		LOG_DBG("TAU: %d sec, active time: %d sec", tau, active_time);
+
+		evt.type = LTE_LC_EVT_PSM_UPDATE;
+		evt.psm_cfg.tau = tau;
+		evt.psm_cfg.active_time = active_time;
+		evt_notify(&evt);
+	}
+}
+
+static void rrc_notification_handle(const char *notif)
+{
+	bool connected;
+	bool changed;
+	struct lte_lc_evt evt;
+
+	if (parse_rrc_mode(notif, AT_CSCON_MODE_INDEX, &connected)) {
+		LOG_ERR("Could not get RRC mode");
+		return;
+	}
+
+	k_mutex_lock(&link_state_lock, K_FOREVER);
+	changed = (link_state.rrc_connected != connected);
+	link_state.rrc_connected = connected;
+	k_mutex_unlock(&link_state_lock);
+
+	if (!changed) {
+		return;
+	}
+
+	LOG_DBG("RRC %s", connected ? "connected" : "idle");
+
+#if defined(CONFIG_LTE_PSM_SCHED)
+	sched_rrc_update(connected);
+#endif
+
+	evt.type = LTE_LC_EVT_RRC_UPDATE;
+	evt.rrc_connected = connected;
+	evt_notify(&evt);
+}
+
+static void tau_pre_warning_handle(const char *notif)
+{
+	u32_t time;
+	char *end;
+	/* Skip "%XT3412:", the AT command parser does not accept digits in
+	 * notification IDs.
+	 */
+	const char *time_str = notif + sizeof(AT_XT3412_RESPONSE_PREFIX);
+	struct lte_lc_evt evt;
+
+	if (notif[sizeof(AT_XT3412_RESPONSE_PREFIX) - 1] != ':') {
+		LOG_ERR("Invalid %%XT3412 notification");
+		return;
+	}
+
+	time = strtoul(time_str, &end, 10);
+	if (end == time_str) {
+		LOG_ERR("Could not parse %%XT3412");
+		return;
+	}
+
+	LOG_DBG("TAU in %u ms", time);
+
+	k_mutex_lock(&link_state_lock, K_FOREVER);
+	link_state.next_tau = k_uptime_get() + time;
+	k_mutex_unlock(&link_state_lock);
+
+	evt.type = LTE_LC_EVT_TAU_PRE_WARNING;
+	evt.time = time;
+	evt_notify(&evt);
+}
+
+/* Subscribes to the notifications feeding the link state, installs the
+ * notification handler and reads the initial state. Subsequent calls return
+ * immediately.
+ */
+static int link_state_init(void)
+{
+	int err = 0;
+	int tau, active_time;
+	bool connected;
+	enum lte_lc_nw_reg_status status;
+	char buf[AT_CEREG_RESPONSE_MAX_LEN] = {0};
+
+	k_mutex_lock(&link_state_lock, K_FOREVER);
+
+	if (link_state_ready) {
+		goto exit;
+	}
+
+	if ((at_cmd_write(cereg_5_subscribe, NULL, 0, NULL) != 0) ||
+	    (at_cmd_write(AT_CSCON_1, NULL, 0, NULL) != 0)) {
+		err = -EIO;
+		goto exit;
+	}
+
+	snprintf(buf, sizeof(buf), AT_XT3412_SUB_PROTO,
+		 CONFIG_LTE_TAU_PRE_WARNING_TIME,
+		 CONFIG_LTE_TAU_PRE_WARNING_THRESHOLD);
+
+	/* Older modem firmware has no TAU pre-warnings, the rest of the link
+	 * state works without them.
+	 */
+	if (at_cmd_write(buf, NULL, 0, NULL) != 0) {
+		LOG_WRN("TAU pre-warnings not supported");
+	}
+
+	/* Register the handler before reading the state, so that no change
+	 * can fall in between.
+	 */
+	if ((notif_register(AT_CEREG_RESPONSE_PREFIX) != 0) ||
+	    (notif_register(AT_CSCON_RESPONSE_PREFIX) != 0) ||
+	    (notif_register(AT_XT3412_RESPONSE_PREFIX) != 0)) {
+		err = -ENOMEM;
+		goto exit;
+	}
+
+	memset(buf, 0, sizeof(buf));
+
+	if ((at_cmd_write(AT_CEREG_READ, buf, sizeof(buf), NULL) == 0) &&
+	    (parse_nw_reg_status(buf, AT_CEREG_READ_REG_STATUS_INDEX,
+				 &status) == 0)) {
+		link_state.nw_reg_status = status;
+
+		if (parse_cereg_psm(buf, AT_CEREG_TAU_INDEX,
+				    AT_CEREG_ACTIVE_TIME_INDEX,
+				    &tau, &active_time) == 0) {
+			link_state.tau = tau;
+			link_state.active_time = active_time;
+		}
+	} else {
+		LOG_WRN("Could not read registration status");
+	}
+
+	memset(buf, 0, sizeof(buf));
+
+	if ((at_cmd_write(AT_CSCON_READ, buf, sizeof(buf), NULL) == 0) &&
+	    (parse_rrc_mode(buf, AT_CSCON_READ_MODE_INDEX, &connected) == 0)) {
+		link_state.rrc_connected = connected;
+	} else {
+		LOG_WRN("Could not read RRC mode");
+	}
+
+	link_state_ready = true;
+
+exit:
+	k_mutex_unlock(&link_state_lock);
+
+	return err;
+}
+
+int lte_lc_link_state_get(struct lte_lc_link_state *state)
+{
+	if (state == NULL) {
+		return -EINVAL;
+	}
+
+	if (!link_state_ready) {
+		return -ENODATA;
+	}
+
+	k_mutex_lock(&link_state_lock, K_FOREVER);
+	*state = link_state;
+	k_mutex_unlock(&link_state_lock);
+
+	return 0;
+}
+
+int lte_lc_register_handler(lte_lc_evt_handler_t handler)
+{
+	int err = -ENOMEM;
+
+	if (handler == NULL) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&link_state_lock, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(evt_handlers); i++) {
+		if (evt_handlers[i] == handler) {
+			err = -EALREADY;
+			goto exit;
+		}
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(evt_handlers); i++) {
+		if (evt_handlers[i] == NULL) {
+			evt_handlers[i] = handler;
+			err = 0;
+			break;
+		}
+	}
+
+exit:
+	k_mutex_unlock(&link_state_lock);
+
+	return err;
+}
+
+int lte_lc_deregister_handler(lte_lc_evt_handler_t handler)
+{
+	int err = -ENXIO;
+
+	if (handler == NULL) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&link_state_lock, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(evt_handlers); i++) {
+		if (evt_handlers[i] == handler) {
+			evt_handlers[i] = NULL;
+			err = 0;
+			break;
+		}
+	}
+
+	k_mutex_unlock(&link_state_lock);
+
+	return err;
+}
+
+int lte_lc_connect_async(void)
+{
+	int err;
+
+	err = link_state_init();
+	if (err) {
+		return err;
+	}
+
+	if (at_cmd_write(nw_mode_preferred, NULL, 0, NULL) != 0) {
+		return -EIO;
+	}
+
+	if (at_cmd_write(normal, NULL, 0, NULL) != 0) {
+		return -EIO;
+	}
+
+	return 0;
+}
+#endif /* CONFIG_LTE_LINK_STATE */
+
+#if defined(CONFIG_LTE_PSM_SCHED)
+/* Submits the scheduled transmissions with a deadline before @p until, and
+ * restarts the timer for the remaining ones. Must be called with sched_lock
+ * held.
+ */
+static void tx_queue_process(s64_t until)
+{
+	s64_t next = INT64_MAX;
+	s64_t now = k_uptime_get();
+
+	for (size_t i = 0; i < ARRAY_SIZE(tx_queue); i++) {
+		if (tx_queue[i].work == NULL) {
+			continue;
+		}
+
+		if (tx_queue[i].deadline <= until) {
+			k_work_submit(tx_queue[i].work);
+			tx_queue[i].work = NULL;
+		} else if (tx_queue[i].deadline < next) {
+			next = tx_queue[i].deadline;
+		}
+	}
+
+	if (next == INT64_MAX) {
+		k_delayed_work_cancel(&tx_timer);
+	} else {
+		k_delayed_work_submit(&tx_timer, (s32_t)MAX(next - now, 0));
+	}
+}
+
+static void tx_timer_handler(struct k_work *work)
+{
+	k_mutex_lock(&sched_lock, K_FOREVER);
+	tx_queue_process(k_uptime_get());
+	k_mutex_unlock(&sched_lock);
+}
+
+static void cycle_work_handler(struct k_work *work)
+{
+	struct lte_lc_cycle_stats stats;
+	lte_lc_cycle_handler_t handler;
+
+	k_mutex_lock(&sched_lock, K_FOREVER);
+	stats = cycle_done_stats;
+	handler = cycle_done_handler;
+	k_mutex_unlock(&sched_lock);
+
+	if (handler != NULL) {
+		handler(&stats);
+	}
+}
+
+/* Must be called with sched_lock held. The handler is called from the
+ * work queue, so that it does not run with the lock held or from within
+ * lte_lc_cycle_end().
+ */
+static void cycle_complete(void)
+{
+	cycle_active = false;
+	cycle_ending = false;
+	cycle_done_stats = cycle_stats;
+	cycle_done_handler = cycle_handler;
+
+	LOG_INF("RRC connected %d ms in %d connections, cycle %d ms",
+		cycle_stats.rrc_connected_time, cycle_stats.rrc_connections,
+		cycle_stats.duration);
+
+	k_work_submit(&cycle_work);
+}
+
+/* Called from the link state on RRC mode changes. */
+static void sched_rrc_update(bool connected)
+{
+	s64_t now = k_uptime_get();
+
+	k_mutex_lock(&sched_lock, K_FOREVER);
+
+	if (!sched_ready || (connected == rrc_connected)) {
+		goto exit;
+	}
+
+	rrc_connected = connected;
+
+	if (connected) {
+		rrc_connected_since = now;
+
+		if (cycle_active) {
+			cycle_stats.rrc_connections++;
+		}
+
+		/* Send everything that is scheduled in this connection. */
+		tx_queue_process(INT64_MAX);
+		goto exit;
+	}
+
+	if (!cycle_active) {
+		goto exit;
+	}
+
+	cycle_stats.rrc_connected_time += (u32_t)(now - rrc_connected_since);
+	cycle_stats.duration = (u32_t)(now - cycle_start_time);
+
+	if (cycle_ending) {
+		cycle_complete();
+	}
+
+exit:
+	k_mutex_unlock(&sched_lock);
+}
+
+/* Starts the link state and takes the current RRC mode from it.
+ * Must be called with sched_lock held.
+ */
+static int sched_init(void)
+{
+	int err;
+
+	if (sched_ready) {
+		return 0;
+	}
+
+	err = link_state_init();
+	if (err) {
+		return err;
+	}
+
+	k_delayed_work_init(&tx_timer, tx_timer_handler);
+	k_work_init(&cycle_work, cycle_work_handler);
+
+	k_mutex_lock(&link_state_lock, K_FOREVER);
+	rrc_connected = link_state.rrc_connected;
+	k_mutex_unlock(&link_state_lock);
+
+	rrc_connected_since = k_uptime_get();
+	sched_ready = true;
+
+	return 0;
+}
+
+int lte_lc_tx_schedule(struct k_work *work, s32_t max_delay)
+{
+	int err;
+	struct tx_entry *entry = NULL;
+
+	if (work == NULL || (max_delay < 0 && max_delay != K_FOREVER)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&sched_lock, K_FOREVER);
+
+	err = sched_init();
+	if (err) {
+		goto exit;
+	}
+
+	if (rrc_connected || max_delay == K_NO_WAIT) {
+		k_work_submit(work);
+		goto exit;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(tx_queue); i++) {
+		if (tx_queue[i].work == NULL) {
+			entry = &tx_queue[i];
+			break;
+		}
+	}
+
+	if (entry == NULL) {
+		err = -ENOMEM;
+		goto exit;
+	}
+
+	entry->work = work;
+	entry->deadline = (max_delay == K_FOREVER) ?
+			  INT64_MAX : k_uptime_get() + max_delay;
+
+	tx_queue_process(k_uptime_get());
+
+exit:
+	k_mutex_unlock(&sched_lock);
+
+	return err;
+}
+
+int lte_lc_cycle_start(lte_lc_cycle_handler_t handler)
+{
+	int err;
+
+	k_mutex_lock(&sched_lock, K_FOREVER);
+
+	err = sched_init();
+	if (err) {
+		goto exit;
+	}
+
+	/* The indication requested at the end of the previous cycle would
+	 * release the connection after the first uplink of this one.
+	 */
+	if (rai_current != LTE_LC_RAI_DISABLED) {
+		err = lte_lc_rai_req(LTE_LC_RAI_DISABLED);
+		if (err) {
+			goto exit;
+		}
+
+		rai_current = LTE_LC_RAI_DISABLED;
+	}
+
+	memset(&cycle_stats, 0, sizeof(cycle_stats));
+	cycle_start_time = k_uptime_get();
+	cycle_handler = handler;
+	cycle_active = true;
+	cycle_ending = false;
+
+	if (rrc_connected) {
+		rrc_connected_since = cycle_start_time;
+		cycle_stats.rrc_connections = 1;
+	}
+
+exit:
+	k_mutex_unlock(&sched_lock);
+
+	return err;
+}
+
+int lte_lc_cycle_end(enum lte_lc_rai rai)
+{
+	int err = 0;
+
+	k_mutex_lock(&sched_lock, K_FOREVER);
+
+	if (!cycle_active || cycle_ending) {
+		err = -EALREADY;
+		goto exit;
+	}
+
+	if (rai != rai_current) {
+		err = lte_lc_rai_req(rai);
+		if (err) {
+			goto exit;
+		}
+
+		rai_current = rai;
+	}
+
+	cycle_ending = true;
+
+	if (!rrc_connected) {
+		cycle_complete();
+	}
+
+exit:
+	k_mutex_unlock(&sched_lock);
+
+	return err;
+}
+
+int lte_lc_cycle_stats_get(struct lte_lc_cycle_stats *stats)
+{
+	s64_t now;
+
+	if (stats == NULL) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&sched_lock, K_FOREVER);
+
+	now = k_uptime_get();
+	*stats = cycle_stats;
+
+	if (cycle_active && rrc_connected) {
+		stats->rrc_connected_time += (u32_t)(now - rrc_connected_since);
+		stats->duration = (u32_t)(now - cycle_start_time);
+	}
+
+	k_mutex_unlock(&sched_lock);
+
+	return 0;
+}
+#endif /* CONFIG_LTE_PSM_SCHED */
+
 /**@brief Helper function to check if a response is what was expected
  *
  * @param response Pointer to response prefix
@@ -472,11 +1271,13 @@ static bool response_is_valid(const char *response, size_t response_len,
  *	  registration status if it's available in the string.
  *
  * @param at_response Pointer to buffer with AT response.
+ * @param status_index Index of the status parameter, which differs between
+ *		       notifications and read command responses.
  * @param status Pointer to where the registration status is stored.
  *
  * @return Zero on success or (negative) error code otherwise.
  */
-static int parse_nw_reg_status(const char *at_response,
+static int parse_nw_reg_status(const char *at_response, size_t status_index,
 			       enum lte_lc_nw_reg_status *status)
 {
 	int err, reg_status;
@@ -522,8 +1323,7 @@ static int parse_nw_reg_status(const char *at_response,
 	}
 
 	/* Get the network registration status parameter from the response */
-	err = at_params_int_get(&resp_list, AT_CEREG_REG_STATUS_INDEX,
-				&reg_status);
+	err = at_params_int_get(&resp_list, status_index, &reg_status);
 	if (err) {
 		LOG_ERR("Could not get registration status, error: %d", err);
 		goto clean_exit;
@@ -562,6 +1362,16 @@ int lte_lc_nw_reg_status_get(enum lte_lc_nw_reg_status *status)
 		return -EINVAL;
 	}
 
+#if defined(CONFIG_LTE_LINK_STATE)
+	if (link_state_ready) {
+		k_mutex_lock(&link_state_lock, K_FOREVER);
+		*status = link_state.nw_reg_status;
+		k_mutex_unlock(&link_state_lock);
+
+		return 0;
+	}
+#endif
+
 	/* Enable network registration status with level 5 */
 	err = at_cmd_write(AT_CEREG_5, NULL, 0, NULL);
 	if (err) {
@@ -576,7 +1386,7 @@ int lte_lc_nw_reg_status_get(enum lte_lc_nw_reg_status *status)
 		return err;
 	}
 
-	err = parse_nw_reg_status(buf, status);
+	err = parse_nw_reg_status(buf, AT_CEREG_READ_REG_STATUS_INDEX, status);
 	if (err) {
 		LOG_ERR("Could not parse registration status, err: %d", err);
 		return err;
@@ -19,6 +19,10 @@
  * byte (300 octal) is send before and after the frame, so empty frames
  * produced during SLIP decoding should be ignored.
  *
+ * Each frame is SLIP encoded into a staging buffer and written to RTT with
+ * a single call. Received data is decoded directly into network buffers,
+ * so frames are not copied after decoding.
+ *
  * Specific RTT channel number is not assigned to transfer ethernet frames,
  * so software on PC side have to search for channels named "ETH_RTT".
  * PC side may want to know when device was reset. Driver sends one special
@@ -39,6 +43,7 @@ LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 #include <kernel.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
 #include <net/ethernet.h>
 #include <net/buf.h>
 #include <net/net_pkt.h>
@@ -57,17 +62,14 @@ LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 #define SLIP_ESC_END 0334
 #define SLIP_ESC_ESC 0335
 
-/** Bytes in receive buffer for headers and additional space for SLIP decoder.*/
-#define RX_BUFFER_OVERHEAD 36
+/** Bytes in received frame for headers and CRC. */
+#define RX_FRAME_OVERHEAD 36
 
-/** Size of the buffer used to gather data received from RTT. */
-#define RX_BUFFER_SIZE (CONFIG_ETH_RTT_MTU + RX_BUFFER_OVERHEAD)
+/** Maximum length of received frame including CRC. */
+#define RX_FRAME_MAX_LENGTH (CONFIG_ETH_RTT_MTU + RX_FRAME_OVERHEAD)
 
-/** Number of poll periods that must pass to assume that transfer is
- *  not running for now.
- */
-#define ACTIVE_POLL_COUNT (CONFIG_ETH_POLL_PERIOD_MS / \
-			   CONFIG_ETH_POLL_ACTIVE_PERIOD_MS)
+/** Size of the buffer used to read data from RTT. */
+#define RX_BUFFER_SIZE 256
 
 BUILD_ASSERT_MSG(CONFIG_ETH_RTT_CHANNEL < SEGGER_RTT_MAX_NUM_UP_BUFFERS,
 		 "RTT channel number used in RTT network driver "
@@ -82,10 +84,10 @@ struct eth_rtt_context {
 	/** Network interface associated with this driver. */
 	struct net_if *iface;
 
-	/** Counter that counts down number of polls that must be done before
-	 *  assuming that transfer is not running for now.
+	/** Current poll period in milliseconds. It is shortened when data is
+	 *  transferred and extended when there is no input transfer.
 	 */
-	u16_t active_poll_counter;
+	s32_t poll_period;
 
 	/** CRC of currently sending frame to RTT. */
 	u16_t crc;
@@ -93,15 +95,35 @@ struct eth_rtt_context {
 	/** MAC address of this interface. */
 	u8_t mac_addr[6];
 
-	/** Buffer that contains currently receiving frame from RTT. Frame
-	 *  contained in the buffer is partial and as soon as it gets finalized
-	 *  it will be send to the network stack and removed from the buffer.
-	 *  Data in the buffer are already SLIP decoded.
+	/** Buffer that contains SLIP encoded data of currently sending frame.
+	 *  It is written to RTT at the end of the frame or when it is full.
+	 */
+	u8_t tx_buffer[CONFIG_ETH_RTT_TX_BUFFER_SIZE];
+
+	/** Number of bytes currently occupied in tx_buffer. */
+	size_t tx_buffer_length;
+
+	/** Buffer for data read from RTT. Data is decoded as soon as it is
+	 *  read, so the buffer never holds data between polls.
 	 */
 	u8_t rx_buffer[RX_BUFFER_SIZE];
 
-	/** Number of bytes currently occupied in rx_buffer. */
-	size_t rx_buffer_length;
+	/** Packet of currently receiving frame, NULL if no data was received
+	 *  since the last SLIP END byte.
+	 */
+	struct net_pkt *rx_pkt;
+
+	/** Last fragment of rx_pkt. */
+	struct net_buf *rx_frag;
+
+	/** Number of decoded bytes of currently receiving frame. */
+	size_t rx_length;
+
+	/** Last received byte was SLIP ESC. */
+	bool rx_escape;
+
+	/** Frame is discarded until the next SLIP END byte. */
+	bool rx_discard;
 
 	/** Up buffer used by RTT library */
 	u8_t rtt_up_buffer[CONFIG_ETH_RTT_UP_BUFFER_SIZE];
@@ -164,20 +186,79 @@ static void dbg_hex_dump_end(const char *prefix)
 
 /*********** OUTPUT PART OF THE DRIVER (from network stack to RTT) ***********/
 
-/** Sends start of frame (SLIP_END) to RTT up channel.
+/** Returns number of bytes at the beginning of the data that do not need
+ *  SLIP escaping. Data is scanned a word at a time, as special bytes are
+ *  rare in typical traffic.
+ *  @param ptr       Points data to scan.
+ *  @param len       Number of bytes to scan.
+ */
+static size_t slip_plain_length(const u8_t *ptr, size_t len)
+{
+	static const u32_t ones = 0x01010101;
+	static const u32_t highs = 0x80808080;
+	size_t i = 0;
+
+	for (; i + sizeof(u32_t) <= len; i += sizeof(u32_t)) {
+		u32_t word;
+
+		memcpy(&word, &ptr[i], sizeof(word));
+
+		u32_t end = word ^ (ones * SLIP_END);
+		u32_t esc = word ^ (ones * SLIP_ESC);
+
+		/* Nonzero if any byte of end or esc is zero. */
+		if (((end - ones) & ~end & highs) |
+		    ((esc - ones) & ~esc & highs)) {
+			break;
+		}
+	}
+
+	while ((i < len) && (ptr[i] != SLIP_END) && (ptr[i] != SLIP_ESC)) {
+		i++;
+	}
+
+	return i;
+}
+
+/** Writes contents of the TX buffer to RTT up channel.
  *  @param context   Driver context.
  */
-static void rtt_send_begin(struct eth_rtt_context *context)
+static void rtt_send_flush(struct eth_rtt_context *context)
 {
-	u8_t data = SLIP_END;
+	if (context->tx_buffer_length > 0) {
+		SEGGER_RTT_Write(CONFIG_ETH_RTT_CHANNEL, context->tx_buffer,
+				 context->tx_buffer_length);
+		dbg_hex_dump("RTT<", context->tx_buffer,
+			     context->tx_buffer_length);
+		context->tx_buffer_length = 0;
+	}
+}
 
-	SEGGER_RTT_Write(CONFIG_ETH_RTT_CHANNEL, &data, sizeof(data));
+/** Puts SLIP END byte to the TX buffer.
+ *  @param context   Driver context.
+ */
+static void rtt_send_slip_end(struct eth_rtt_context *context)
+{
+	if (context->tx_buffer_length == sizeof(context->tx_buffer)) {
+		rtt_send_flush(context);
+	}
+
+	context->tx_buffer[context->tx_buffer_length++] = SLIP_END;
+}
+
+/** Starts new frame with SLIP END byte.
+ *  @param context   Driver context.
+ */
+static void rtt_send_begin(struct eth_rtt_context *context)
+{
 	dbg_hex_dump_begin("RTT<");
-	dbg_hex_dump("RTT<", &data, sizeof(data));
+	context->tx_buffer_length = 0;
+	rtt_send_slip_end(context);
 	context->crc = 0xFFFF;
 }
 
-/** Encodes fragment of frame using SLIP and sends it to RTT up channel.
+/** Encodes fragment of frame using SLIP into the TX buffer. The buffer is
+ *  written to RTT up channel when it gets full.
  *  @param context   Driver context.
  *  @param ptr       Points data to send.
  *  @param len       Number of bytes to send.
@@ -185,61 +266,69 @@ static void rtt_send_begin(struct eth_rtt_context *context)
 static void rtt_send_fragment(struct eth_rtt_context *context, const u8_t *ptr,
 			      size_t len)
 {
-	static const u8_t end_stuffed[2] = { SLIP_ESC, SLIP_ESC_END };
-	static const u8_t esc_stuffed[2] = { SLIP_ESC, SLIP_ESC_ESC };
-	const u8_t *end = ptr + len;
-	const u8_t *plain_begin = ptr;
-
 	context->crc = crc16_ccitt(context->crc, ptr, len);
 
-	for (; ptr < end; ptr++) {
-		if (*ptr == SLIP_END || *ptr == SLIP_ESC) {
-			if (ptr > plain_begin) {
-				SEGGER_RTT_Write(CONFIG_ETH_RTT_CHANNEL,
-						 plain_begin,
-						 ptr - plain_begin);
-				dbg_hex_dump("RTT<", plain_begin,
-					     ptr - plain_begin);
-			}
+	while (len > 0) {
+		size_t space = sizeof(context->tx_buffer) -
+			       context->tx_buffer_length;
+		size_t plain = slip_plain_length(ptr, MIN(len, space));
+		u8_t *dst = &context->tx_buffer[context->tx_buffer_length];
+
+		memcpy(dst, ptr, plain);
+		context->tx_buffer_length += plain;
+		ptr += plain;
+		len -= plain;
+
+		if (len == 0) {
+			break;
+		}
 
-			if (*ptr == SLIP_END) {
-				SEGGER_RTT_Write(CONFIG_ETH_RTT_CHANNEL,
-						 end_stuffed,
-						 sizeof(end_stuffed));
-				dbg_hex_dump("RTT<", end_stuffed,
-					     sizeof(end_stuffed));
-			} else if (*ptr == SLIP_ESC) {
-				SEGGER_RTT_Write(CONFIG_ETH_RTT_CHANNEL,
-						 esc_stuffed,
-						 sizeof(esc_stuffed));
-				dbg_hex_dump("RTT<", esc_stuffed,
-					     sizeof(esc_stuffed));
-			}
-			plain_begin = ptr + 1;
+		if (space - plain < 2) {
+			rtt_send_flush(context);
+			continue;
 		}
-	}
 
-	if (ptr > plain_begin) {
-		SEGGER_RTT_Write(CONFIG_ETH_RTT_CHANNEL, plain_begin,
-				 ptr - plain_begin);
-		dbg_hex_dump("RTT<", plain_begin, ptr - plain_begin);
+		dst += plain;
+		dst[0] = SLIP_ESC;
+		dst[1] = (*ptr == SLIP_END) ? SLIP_ESC_END : SLIP_ESC_ESC;
+		context->tx_buffer_length += 2;
+		ptr++;
+		len--;
 	}
 }
 
-/** Sends end of frame (SLIP_END) to RTT up channel.
+/** Ends frame with CRC and SLIP END byte and writes it to RTT up channel.
  *  @param context   Driver context.
  */
 static void rtt_send_end(struct eth_rtt_context *context)
 {
 	u8_t crc_buffer[2] = { context->crc >> 8, context->crc & 0xFF };
-	u8_t data = SLIP_END;
 
 	rtt_send_fragment(context, crc_buffer, sizeof(crc_buffer));
-	SEGGER_RTT_Write(CONFIG_ETH_RTT_CHANNEL, &data, sizeof(data));
-	dbg_hex_dump("RTT<", &data, sizeof(data));
+	rtt_send_slip_end(context);
+	rtt_send_flush(context);
 	dbg_hex_dump_end("RTT<");
 }
 
+/** Delayed work used to do polling RTT down channel */
+static struct k_delayed_work eth_rtt_poll_work;
+
+/** Shortens the poll period, because response to the sent frame is likely.
+ *  @param context   Driver context.
+ */
+static void poll_speed_up(struct eth_rtt_context *context)
+{
+	if (context->poll_period > CONFIG_ETH_POLL_ACTIVE_PERIOD_MS) {
+		context->poll_period = CONFIG_ETH_POLL_ACTIVE_PERIOD_MS;
+
+		if (k_delayed_work_remaining_get(&eth_rtt_poll_work) >
+		    CONFIG_ETH_POLL_ACTIVE_PERIOD_MS) {
+			k_delayed_work_submit(&eth_rtt_poll_work,
+				K_MSEC(CONFIG_ETH_POLL_ACTIVE_PERIOD_MS));
+		}
+	}
+}
+
 /** Callback function called by network stack when new frame arrived to the
  *  interface.
  *  @param iface   Network interface associated with this driver.
@@ -275,85 +364,155 @@ static int eth_send(struct device *dev, struct net_pkt *pkt)
 	dbg_hex_dump_end("ETH>");
 	rtt_send_end(context);
 
+	poll_speed_up(context);
+
 	return 0;
 }
 
 /*********** INPUT PART OF THE DRIVER (from RTT to network stack) ***********/
 
-/** Function called when new frame was received from RTT. It checks CRC and
- *  passes frame to the network stack.
+/** Drops currently receiving frame and prepares for the next one.
  *  @param context   Driver context.
- *  @param data      Frame data to pass to network stack with two bytes of CRC.
- *  @param len       Number of bytes in data parameter.
+ *  @param discard   Discard data until the next SLIP END byte.
  */
-static void recv_frame(struct eth_rtt_context *context, const u8_t *data,
-		       size_t len)
+static void recv_reset(struct eth_rtt_context *context, bool discard)
 {
-	int err;
-	struct net_pkt *pkt;
-	struct net_buf *pkt_buf = NULL;
-	struct net_buf *last_buf = NULL;
-	u16_t crc16;
+	if (context->rx_pkt) {
+		net_pkt_unref(context->rx_pkt);
+	}
 
-	if (len <= 2) {
-		if (len > 0) {
-			LOG_ERR("Invalid frame length");
-		}
+	context->rx_pkt = NULL;
+	context->rx_frag = NULL;
+	context->rx_length = 0;
+	context->rx_escape = false;
+	context->rx_discard = discard;
+}
+
+/** Appends decoded data to currently receiving frame. Data is written
+ *  directly to the fragments of the network packet.
+ *  @param context   Driver context.
+ *  @param data      Decoded data.
+ *  @param len       Number of bytes in data parameter.
+ */
+static void recv_data(struct eth_rtt_context *context, const u8_t *data,
+		      size_t len)
+{
+	if (context->rx_length + len > RX_FRAME_MAX_LENGTH) {
+		LOG_ERR("Frame too long");
+		recv_reset(context, true);
 		return;
 	}
 
-	crc16 = crc16_ccitt(0xFFFF, data, len - 2);
-	if (data[len - 2] != (crc16 >> 8) || data[len - 1] != (crc16 & 0xFF)) {
-		LOG_ERR("Invalid frame CRC");
-		return;
+	if (!context->rx_pkt) {
+		context->rx_pkt = net_pkt_rx_alloc(K_NO_WAIT);
+		if (!context->rx_pkt) {
+			LOG_ERR("Could not allocate rx pkt");
+			recv_reset(context, true);
+			return;
+		}
 	}
 
-	len -= 2;
+	context->rx_length += len;
 
-	LOG_DBG("Received %d byte(s) frame", (int)len);
+	while (len > 0) {
+		struct net_buf *frag = context->rx_frag;
+
+		if (!frag || (net_buf_tailroom(frag) == 0)) {
+			frag = net_pkt_get_frag(context->rx_pkt, K_NO_WAIT);
+			if (!frag) {
+				LOG_ERR("Could not allocate data for rx pkt");
+				recv_reset(context, true);
+				return;
+			}
 
-	pkt = net_pkt_rx_alloc(K_NO_WAIT);
-	if (!pkt) {
-		LOG_ERR("Could not allocate rx pkt");
-		return;
+			if (!context->rx_frag) {
+				net_pkt_frag_insert(context->rx_pkt, frag);
+			} else {
+				net_buf_frag_insert(context->rx_frag, frag);
+			}
+
+			context->rx_frag = frag;
+		}
+
+		size_t frag_len = MIN(len, net_buf_tailroom(frag));
+
+		net_buf_add_mem(frag, data, frag_len);
+		data += frag_len;
+		len -= frag_len;
 	}
+}
 
-	dbg_hex_dump_begin("ETH<");
+/** Function called when SLIP END byte was received. It checks CRC, removes
+ *  it from the frame and passes frame to the network stack.
+ *  @param context   Driver context.
+ */
+static void recv_frame(struct eth_rtt_context *context)
+{
+	struct net_pkt *pkt = context->rx_pkt;
+	struct net_buf *frag;
+	struct net_buf *prev = NULL;
+	size_t len = context->rx_length;
+	u8_t crc_received[2];
+	size_t crc_length = 0;
+	u16_t crc = 0xFFFF;
+	int err;
 
-	while (len > 0) {
-		pkt_buf = net_pkt_get_frag(pkt, K_NO_WAIT);
-		if (!pkt_buf) {
-			LOG_ERR("Could not allocate data for rx pkt");
-			net_pkt_unref(pkt);
-			return;
-		}
+	if (context->rx_discard) {
+		recv_reset(context, false);
+		return;
+	}
 
-		if (!last_buf) {
-			net_pkt_frag_insert(pkt, pkt_buf);
-		} else {
-			net_buf_frag_insert(last_buf, pkt_buf);
+	if (len <= 2) {
+		if (len > 0) {
+			LOG_ERR("Invalid frame length");
 		}
+		recv_reset(context, false);
+		return;
+	}
 
-		last_buf = pkt_buf;
+	len -= 2;
 
-		size_t frag_len = net_buf_tailroom(pkt_buf);
+	/* Calculate CRC and strip it from the frame. CRC may span two
+	 * fragments and the last fragment may contain only CRC.
+	 */
+	for (frag = pkt->frags; frag; frag = frag->frags) {
+		size_t data_len = MIN(frag->len, len);
 
-		if (len < frag_len) {
-			frag_len = len;
+		crc = crc16_ccitt(crc, frag->data, data_len);
+		for (size_t i = data_len; i < frag->len; i++) {
+			crc_received[crc_length++] = frag->data[i];
 		}
 
-		memcpy(pkt_buf->data, data, frag_len);
-
-		dbg_hex_dump("ETH<", data, frag_len);
+		if ((data_len == 0) && prev) {
+			prev->frags = NULL;
+			net_buf_unref(frag);
+			break;
+		}
 
-		len -= frag_len;
-		data += frag_len;
+		frag->len = data_len;
+		len -= data_len;
+		prev = frag;
+	}
 
-		net_buf_add(pkt_buf, frag_len);
+	if ((crc_received[0] != (crc >> 8)) ||
+	    (crc_received[1] != (crc & 0xFF))) {
+		LOG_ERR("Invalid frame CRC");
+		recv_reset(context, false);
+		return;
 	}
 
+	LOG_DBG("Received %d byte(s) frame", (int)(context->rx_length - 2));
+
+	dbg_hex_dump_begin("ETH<");
+	for (frag = pkt->frags; frag; frag = frag->frags) {
+		dbg_hex_dump("ETH<", frag->data, frag->len);
+	}
 	dbg_hex_dump_end("ETH<");
 
+	/* Packet is owned by the network stack or freed from now on. */
+	context->rx_pkt = NULL;
+	recv_reset(context, false);
+
 	err = net_recv_data(context->iface, pkt);
 
 	if (err < 0) {
@@ -363,89 +522,97 @@ static void recv_frame(struct eth_rtt_context *context, const u8_t *data,
 }
 
 /** Functions decodes SLIP data and passes each decoded frame to recv_frame
- *  function. It decodes data from rx_buffer that were recently added to it,
- *  i.e. decoding starts at rx_buffer_length. Decoding is done inplace, so
- *  decoded data are written back to the rx_buffer. If there is unfinished
- *  frame left then it will be moved to the beginning of the rx_buffer and
- *  rx_buffer_length will be updated accordingly. Otherwise rx_buffer will be
- *  cleared.
- *  @param context        Driver context.
- *  @param new_data_size  Number of bytes that have to be decoded.
+ *  function. Decoder state is kept in the context, so frames can span any
+ *  number of calls. Runs of bytes that do not need unescaping are appended
+ *  to the frame at once. SLIP END always ends a frame, and a frame that
+ *  ends with SLIP ESC is dropped.
+ *  @param context   Driver context.
+ *  @param data      Data read from RTT.
+ *  @param len       Number of bytes in data parameter.
  */
 static void decode_new_slip_data(struct eth_rtt_context *context,
-				 size_t new_data_size)
+				 const u8_t *data, size_t len)
 {
-	u8_t *src = &context->rx_buffer[context->rx_buffer_length];
-	u8_t *dst = &context->rx_buffer[context->rx_buffer_length];
-	u8_t *end = src + new_data_size;
-	u8_t *start = context->rx_buffer;
-	u8_t last_byte = context->rx_buffer_length > 0 ? dst[-1] : 0;
-
-	while (src < end) {
-		u8_t byte = *src++;
-		*dst++ = byte;
-		if (byte == SLIP_END) {
-			recv_frame(context, start, dst - start - 1);
-			start = dst;
-		} else if (last_byte == SLIP_ESC) {
+	const u8_t *end = data + len;
+
+	while (data < end) {
+		if (context->rx_discard) {
+			const u8_t *slip_end = memchr(data, SLIP_END,
+						      end - data);
+
+			if (!slip_end) {
+				return;
+			}
+
+			data = slip_end + 1;
+			recv_frame(context);
+			continue;
+		}
+
+		if (context->rx_escape) {
+			u8_t byte = *data++;
+
+			if (byte == SLIP_END) {
+				/* Frame is broken, but END still ends it. */
+				LOG_ERR("Invalid SLIP escape");
+				recv_reset(context, false);
+				continue;
+			}
+
 			if (byte == SLIP_ESC_END) {
-				dst--;
-				dst[-1] = SLIP_END;
+				byte = SLIP_END;
 			} else if (byte == SLIP_ESC_ESC) {
-				dst--;
-				dst[-1] = SLIP_ESC;
+				byte = SLIP_ESC;
 			}
+
+			context->rx_escape = false;
+			recv_data(context, &byte, sizeof(byte));
+			continue;
 		}
-		last_byte = byte;
-	}
 
-	context->rx_buffer_length = dst - start;
+		size_t plain = slip_plain_length(data, end - data);
 
-	if (context->rx_buffer_length > 0 && start != context->rx_buffer) {
-		memmove(context->rx_buffer, start, context->rx_buffer_length);
+		if (plain > 0) {
+			recv_data(context, data, plain);
+			data += plain;
+		} else if (*data++ == SLIP_END) {
+			recv_frame(context);
+		} else {
+			context->rx_escape = true;
+		}
 	}
 }
 
-/** Delayed work used to do polling RTT down channel */
-static struct k_delayed_work eth_rtt_poll_work;
-
 /** Work handler that is submitted to system workqueue by the poll timer.
  *  It is responsible for reading all available data from RTT down buffer.
+ *  Poll period is shortened to the active period when data is received and
+ *  doubled after each poll without data, up to the idle period.
  */
 static void poll_work_handler(struct k_work *work)
 {
 	struct eth_rtt_context *context = &context_data;
 	bool active = false;
-	s32_t period = K_MSEC(CONFIG_ETH_POLL_PERIOD_MS);
 	unsigned num;
 
 	do {
-		if (context->rx_buffer_length >= sizeof(context->rx_buffer)) {
-			LOG_ERR("RX buffer overflow. "
-				"Discarding buffer contents.\n");
-			context->rx_buffer_length = 0;
-		}
 		num = SEGGER_RTT_Read(CONFIG_ETH_RTT_CHANNEL,
-			&context->rx_buffer[context->rx_buffer_length],
-			sizeof(context->rx_buffer) - context->rx_buffer_length);
+				      context->rx_buffer,
+				      sizeof(context->rx_buffer));
 		if (num > 0) {
-			dbg_hex_dump("RTT>",
-				&context->rx_buffer[context->rx_buffer_length],
-				num);
-			decode_new_slip_data(context, num);
+			dbg_hex_dump("RTT>", context->rx_buffer, num);
+			decode_new_slip_data(context, context->rx_buffer, num);
 			active = true;
 		}
 	} while (num > 0);
 
 	if (active) {
-		context->active_poll_counter = ACTIVE_POLL_COUNT;
-		period = K_MSEC(CONFIG_ETH_POLL_ACTIVE_PERIOD_MS);
-	} else if (context->active_poll_counter > 0) {
-		context->active_poll_counter--;
-		period = K_MSEC(CONFIG_ETH_POLL_ACTIVE_PERIOD_MS);
+		context->poll_period = CONFIG_ETH_POLL_ACTIVE_PERIOD_MS;
+	} else {
+		context->poll_period = MIN(2 * context->poll_period,
+					   CONFIG_ETH_POLL_PERIOD_MS);
 	}
 
-	k_delayed_work_submit(&eth_rtt_poll_work, period);
+	k_delayed_work_submit(&eth_rtt_poll_work, K_MSEC(context->poll_period));
 }
 
 /******** COMMON PART OF THE DRIVER (initialization on configuration) ********/
@@ -467,7 +634,8 @@ static void eth_iface_init(struct net_if *iface)
 
 	context->init_done = true;
 	context->iface = iface;
-	context->active_poll_counter = 0;
+	context->poll_period = CONFIG_ETH_POLL_PERIOD_MS;
+	recv_reset(context, false);
 
 #if defined(CONFIG_ETH_RTT_MAC_ADDR)
 	if (CONFIG_ETH_RTT_MAC_ADDR[0] != 0) {
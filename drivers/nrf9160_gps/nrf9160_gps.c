@@ -14,6 +14,7 @@
 #include <logging/log.h>
 #include <nrf_socket.h>
 #include <net/socket.h>
+#include <profiler.h>
 #ifdef CONFIG_NRF9160_GPS_HANDLE_MODEM_CONFIGURATION
 #include <at_cmd.h>
 #include <at_cmd_parser/at_cmd_parser.h>
@@ -213,6 +214,8 @@ static int init_thread(struct device *dev)
 			K_PRIO_PREEMPT(CONFIG_NRF9160_GPS_THREAD_PRIORITY), 0,
 			0);
 
+	profiler_stack_monitor_register(&drv_data->thread);
+
 	return 0;
 }
 
@@ -34,6 +34,19 @@ enum at_cmd_state {
 	AT_CMD_NOTIFICATION,
 };
 
+/**
+ * @brief AT command priorities
+ *
+ * Commands are sent one at a time. Queued commands are sent in order of
+ * priority, and in the order they were queued within a priority.
+ */
+enum at_cmd_prio {
+	AT_CMD_PRIO_HIGH,
+	AT_CMD_PRIO_NORMAL,
+	/** For slow commands, such as network scans. */
+	AT_CMD_PRIO_LOW,
+};
+
 /**
  * @typedefs at_cmd_handler_t
  *
@@ -41,10 +54,14 @@ enum at_cmd_state {
  * sure that the correct thread gets the correct data returned from the AT
  * interface. The at_cmd_write_with_callback() function let the user specify
  * the handler that will process the data from a specific AT command call.
- * Notifications will be handled by the global handler defined using the
- * at_cmd_set_notification_handler() function. Both handlers are of the type
+ * Notifications will be handled by the handlers registered for their prefix
+ * using the at_cmd_notif_register() function. Both handlers are of the type
  * @ref at_cmd_handler_t.
  *
+ * Handlers are called from the AT command driver's notification thread. The
+ * response is valid until the handler returns, unless the handler takes a
+ * reference with at_cmd_response_ref().
+ *
  * @param response     Null terminated string containing the modem message
  *
  */
@@ -125,9 +142,113 @@ int at_cmd_write(const char *const cmd,
 		 size_t buf_len,
 		 enum at_cmd_state *state);
 
+/**
+ * @brief Function to send an AT command with a priority and a timeout
+ *
+ * Same as at_cmd_write(), except that the command is queued with @p prio,
+ * and the function gives up after @p timeout.
+ *
+ * @param cmd     Pointer to null terminated AT command string.
+ * @param buf     Buffer to put the response in. NULL pointer is allowed.
+ * @param buf_len Length of response buffer.
+ * @param state   Pointer to @ref enum at_cmd_state variable that can hold
+ *                the error state returned by the modem. NULL pointer is
+ *                allowed.
+ * @param prio    Priority of the command.
+ * @param timeout Time to wait for the result, including the time spent in
+ *                the queue, in milliseconds. K_FOREVER waits indefinitely.
+ *
+ * @retval -ETIMEDOUT is returned if the command did not complete within
+ *         @p timeout. If the command was sent, its result is dropped.
+ * @retval -EINVAL is returned if @p prio is invalid.
+ *         Other return values are the same as for at_cmd_write().
+ */
+int at_cmd_write_prio(const char *const cmd,
+		      char *buf,
+		      size_t buf_len,
+		      enum at_cmd_state *state,
+		      enum at_cmd_prio prio,
+		      s32_t timeout);
+
+/**
+ * @brief Function to send an AT command and get the response without copying
+ *
+ * The response is passed in the buffer it was received into. The buffer is
+ * one of the CONFIG_AT_CMD_RESPONSE_BUFFER_COUNT reception buffers, so it
+ * must be released with at_cmd_response_unref() as soon as possible.
+ *
+ * @param cmd      Pointer to null terminated AT command string.
+ * @param response Pointer to where the null terminated response is stored,
+ *                 without the result code. Set to NULL if the command fails.
+ * @param state    Pointer to @ref enum at_cmd_state variable that can hold
+ *                 the error state returned by the modem. NULL pointer is
+ *                 allowed.
+ *
+ * @retval 0 If command execution was successful. Other return values are
+ *           the same as for at_cmd_write().
+ * @retval -EINVAL is returned if @p response is NULL.
+ */
+int at_cmd_write_ref(const char *const cmd,
+		     const char **response,
+		     enum at_cmd_state *state);
+
+/**
+ * @brief Function to take a reference to a response
+ *
+ * Keeps a response passed to a handler valid after the handler returns.
+ *
+ * @param response Response passed to an @ref at_cmd_handler_t.
+ */
+void at_cmd_response_ref(const char *response);
+
+/**
+ * @brief Function to release a reference to a response
+ *
+ * @param response Response from at_cmd_write_ref(), or a response that was
+ *                 referenced with at_cmd_response_ref(). NULL is allowed.
+ */
+void at_cmd_response_unref(const char *response);
+
+/**
+ * @brief Function to register a handler for notifications with a prefix
+ *
+ * The handler is called for each notification that starts with @p prefix.
+ * A handler can be registered for several prefixes.
+ *
+ * @param prefix  Notification prefix, for example "+CEREG". The string is
+ *                not copied and must stay valid while registered. NULL
+ *                matches all notifications.
+ * @param handler Pointer to a received notification handler function of type
+ *                @ref at_cmd_handler_t.
+ *
+ * @retval 0 If the handler was registered.
+ * @retval -EINVAL is returned if @p handler is NULL.
+ * @retval -EALREADY is returned if the handler is already registered for
+ *         @p prefix.
+ * @retval -ENOMEM is returned if CONFIG_AT_CMD_NOTIF_HANDLER_COUNT handlers
+ *         are already registered.
+ */
+int at_cmd_notif_register(const char *prefix, at_cmd_handler_t handler);
+
+/**
+ * @brief Function to deregister a notification handler
+ *
+ * @param prefix  Prefix the handler was registered for.
+ * @param handler Handler to deregister.
+ *
+ * @retval 0 If the handler was deregistered.
+ * @retval -ENXIO is returned if the handler is not registered for
+ *         @p prefix.
+ */
+int at_cmd_notif_deregister(const char *prefix, at_cmd_handler_t handler);
+
 /**
  * @brief Function to set AT command global notification handler
  *
+ * The global handler is called for all notifications, after the handlers
+ * registered with at_cmd_notif_register(). Setting it replaces the previous
+ * one, so libraries should register handlers for their prefixes instead.
+ *
  * @param handler Pointer to a received notification handler function of type
  *                @ref at_cmd_handler_t.
  */
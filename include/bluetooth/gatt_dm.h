@@ -247,9 +247,11 @@ const struct bt_gatt_attr *bt_gatt_dm_desc_next(
  * This function is asynchronous. Discovery results are passed through
  * the supplied callback.
  *
- * @note Only one discovery procedure can be started simultaneously. To start
- * another one, wait for the result of the previous procedure to finish
- * and call @ref bt_gatt_dm_data_release if it was successful.
+ * @note Only one discovery procedure can be started simultaneously on
+ * a connection. To start another one, wait for the result of the previous
+ * procedure to finish and call @ref bt_gatt_dm_data_release if it was
+ * successful. Discoveries on different connections can run in parallel,
+ * up to CONFIG_BT_GATT_DM_MAX_INSTANCES.
  *
  * @param[in]     conn Connection object.
  * @param[in]     svc_uuid UUID of target service
@@ -263,6 +265,8 @@ const struct bt_gatt_attr *bt_gatt_dm_desc_next(
  * To process the next service, call @ref bt_gatt_dm_continue.
  *
  * @retval 0 If the operation was successful.
+ * @retval -EALREADY If a discovery is already running on the connection.
+ * @retval -ENOMEM If all discovery manager instances are in use.
  *           Otherwise, a (negative) error code is returned.
  */
 int bt_gatt_dm_start(struct bt_conn *conn,
@@ -503,6 +503,77 @@ void bt_scan_filter_remove_all(void);
  */
 int bt_scan_params_set(struct bt_le_scan_param *scan_param);
 
+#if CONFIG_BT_SCAN_DEVICE_CACHE
+
+/**@brief Device cache statistics.
+ *
+ * @details The cache hit rate is the ratio of dropped reports
+ *          to all received reports.
+ */
+struct bt_scan_cache_stats {
+	/** Number of received advertising reports. */
+	u32_t reports;
+
+	/** Number of reports dropped as duplicates. */
+	u32_t dropped;
+
+	/** Number of devices evicted from the full cache. */
+	u32_t evictions;
+
+	/** Estimated CPU time saved by dropping reports, in microseconds.
+	 *  It is the mean time of processing a delivered report, multiplied
+	 *  by the number of dropped reports, less the time spent in the cache.
+	 */
+	u32_t time_saved_us;
+};
+
+/**@brief RSSI aggregated for a device. */
+struct bt_scan_rssi_stats {
+	/** Minimum RSSI. */
+	s8_t min;
+
+	/** Mean RSSI. */
+	s8_t avg;
+
+	/** Maximum RSSI. */
+	s8_t max;
+
+	/** Number of reports, including the dropped ones. */
+	u32_t cnt;
+};
+
+/**@brief Function for getting the device cache statistics.
+ *
+ * @param[out] stats Pointer to the statistics structure.
+ *
+ * @return 0 If the operation was successful. Otherwise, a (negative) error
+ *	   code is returned.
+ */
+int bt_scan_cache_stats_get(struct bt_scan_cache_stats *stats);
+
+/**@brief Function for getting RSSI aggregated for a cached device.
+ *
+ * @param[in] addr Address of the device.
+ * @param[out] rssi Pointer to the RSSI statistics structure.
+ *
+ * @retval 0 If the operation was successful.
+ * @retval -ENOENT If the device is not in the cache.
+ * @retval -EINVAL If a parameter is NULL.
+ */
+int bt_scan_rssi_stats_get(const bt_addr_le_t *addr,
+			   struct bt_scan_rssi_stats *rssi);
+
+/**@brief Function for clearing the device cache and its statistics.
+ *
+ * @details After this function is called, the next report of every
+ *          device is passed to the application. The next reports are
+ *          also passed, without clearing the statistics, when scanning
+ *          is started or the filters are changed.
+ */
+void bt_scan_cache_clear(void);
+
+#endif /* CONFIG_BT_SCAN_DEVICE_CACHE */
+
 #ifdef __cplusplus
 }
 #endif
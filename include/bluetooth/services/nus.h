@@ -19,6 +19,13 @@
 #include <bluetooth/uuid.h>
 #include <bluetooth/gatt.h>
 
+#if defined(CONFIG_BT_GATT_NUS_STREAM)
+#include <kernel.h>
+#include <atomic.h>
+#include <spinlock.h>
+#include <ring_buffer.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -100,6 +107,141 @@ static inline u32_t bt_gatt_nus_max_send(struct bt_conn *conn)
 	return bt_gatt_get_mtu(conn) - 3;
 }
 
+#if defined(CONFIG_BT_GATT_NUS_STREAM) || defined(__DOXYGEN__)
+
+/** @brief Maximum payload of a stream notification. */
+#define BT_GATT_NUS_STREAM_PAYLOAD_MAX (CONFIG_BT_L2CAP_RX_MTU - 3)
+
+struct bt_gatt_nus_stream;
+
+/** @brief Callback type for stream notifications sent.
+ *
+ * The callback is called when a notification of the stream is sent. Space
+ * in the stream buffer may be available for new data.
+ */
+typedef void (*bt_gatt_nus_stream_sent_cb_t)(struct bt_gatt_nus_stream *stream);
+
+/** @brief Stream statistics. */
+struct bt_gatt_nus_stream_stats {
+	/** Number of bytes passed to the Bluetooth stack. */
+	u32_t tx_bytes;
+
+	/** Number of sent notifications. */
+	u32_t notifications;
+
+	/** Number of notifications delayed because of lack of buffers. */
+	u32_t retries;
+};
+
+/** @brief NUS transmit stream.
+ *
+ * Stream members are internal and should not be accessed directly.
+ */
+struct bt_gatt_nus_stream {
+	struct ring_buf rb;
+	u8_t *buf;
+	u32_t buf_size;
+	struct k_spinlock lock;
+	struct k_sem tx_sem;
+	struct k_delayed_work retry_work;
+	struct bt_conn *conn;
+	bt_gatt_nus_stream_sent_cb_t sent_cb;
+	atomic_t flags;
+	atomic_t in_flight;
+	struct bt_gatt_nus_stream_stats stats;
+	u8_t payload[BT_GATT_NUS_STREAM_PAYLOAD_MAX];
+};
+
+/** @brief Define a NUS transmit stream.
+ *
+ * @param _name Name of the stream.
+ * @param _buf_size Size of the buffer for data waiting for transmission.
+ */
+#define BT_GATT_NUS_STREAM_DEFINE(_name, _buf_size)			\
+	static u8_t _name##_buf[_buf_size];				\
+	static struct bt_gatt_nus_stream _name = {			\
+		.buf = _name##_buf,					\
+		.buf_size = _buf_size,					\
+	}
+
+/**@brief Initialize the stream.
+ *
+ * @param[in] stream  Stream defined with @ref BT_GATT_NUS_STREAM_DEFINE.
+ * @param[in] sent_cb Callback called when notifications are sent.
+ *                    Can be NULL.
+ *
+ * @retval 0 If the operation was successful.
+ *           Otherwise, a negative value is returned.
+ */
+int bt_gatt_nus_stream_init(struct bt_gatt_nus_stream *stream,
+			    bt_gatt_nus_stream_sent_cb_t sent_cb);
+
+/**@brief Start sending the stream over the connection.
+ *
+ * @param[in] stream Stream.
+ * @param[in] conn   Connection object.
+ *
+ * @retval 0 If the operation was successful.
+ * @retval -EALREADY If the stream is already started.
+ */
+int bt_gatt_nus_stream_start(struct bt_gatt_nus_stream *stream,
+			     struct bt_conn *conn);
+
+/**@brief Stop sending the stream.
+ *
+ * Data waiting for transmission is dropped. This function should be called
+ * when the connection is terminated.
+ *
+ * @param[in] stream Stream.
+ */
+void bt_gatt_nus_stream_stop(struct bt_gatt_nus_stream *stream);
+
+/**@brief Write data to the stream.
+ *
+ * @details Data is copied to the stream buffer and sent in notifications
+ *          of the ATT MTU size. Several notifications are kept in flight.
+ *          If the buffer is full, the function waits for the notifications
+ *          to be sent. When the timeout expires, only part of the data is
+ *          written.
+ *
+ *          This function must not be called from the Bluetooth callbacks
+ *          with a timeout other than K_NO_WAIT.
+ *
+ * @param[in] stream  Stream.
+ * @param[in] data    Pointer to the data.
+ * @param[in] len     Length of the data.
+ * @param[in] timeout Time to wait for buffer space in milliseconds,
+ *                    K_NO_WAIT or K_FOREVER.
+ *
+ * @return Number of written bytes. Otherwise, a negative value is returned.
+ * @retval -ENOTCONN If the stream is not started.
+ * @retval -EINVAL If notifications are disabled by the peer.
+ */
+int bt_gatt_nus_stream_write(struct bt_gatt_nus_stream *stream,
+			     const void *data, size_t len, s32_t timeout);
+
+/**@brief Wait until all data written to the stream is sent.
+ *
+ * @param[in] stream  Stream.
+ * @param[in] timeout Time to wait in milliseconds, K_NO_WAIT or K_FOREVER.
+ *
+ * @retval 0 If all data was sent.
+ * @retval -EAGAIN If the timeout expired.
+ * @retval -ENOTCONN If the stream was stopped.
+ */
+int bt_gatt_nus_stream_flush(struct bt_gatt_nus_stream *stream,
+			     s32_t timeout);
+
+/**@brief Get stream statistics.
+ *
+ * @param[in]  stream Stream.
+ * @param[out] stats  Pointer to the structure the statistics are copied to.
+ */
+void bt_gatt_nus_stream_stats_get(struct bt_gatt_nus_stream *stream,
+				  struct bt_gatt_nus_stream_stats *stats);
+
+#endif /* CONFIG_BT_GATT_NUS_STREAM */
+
 #ifdef __cplusplus
 }
 #endif
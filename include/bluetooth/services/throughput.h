@@ -73,9 +73,17 @@ struct bt_gatt_throughput {
 	/** Throughput Characteristic handle. */
 	u16_t char_handle;
 
+	/** Throughput Characteristic CCC descriptor handle, 0 if the peer
+	 *  does not support notifications.
+	 */
+	u16_t ccc_handle;
+
 	/** GATT read parameters for the Throughput Characteristic. */
 	struct bt_gatt_read_params read_params;
 
+	/** GATT subscribe parameters for the Throughput Characteristic. */
+	struct bt_gatt_subscribe_params subscribe_params;
+
 	/** Throughput callback structure. */
 	struct bt_gatt_throughput_cb *cb;
 
@@ -144,6 +152,38 @@ int bt_gatt_throughput_read(struct bt_gatt_throughput *throughput);
 int bt_gatt_throughput_write(struct bt_gatt_throughput *throughput,
 			     const u8_t *data, u16_t len);
 
+/** @brief Subscribe to notifications of the server.
+ *
+ *  Received notifications are counted in the local metrics in the same way
+ *  as received writes. The metrics can be read by the peer.
+ *
+ *  @param[in] throughput Throughput Service instance.
+ *
+ *  @retval 0 If the operation was successful.
+ *            Otherwise, a negative error code is returned.
+ *  @retval (-ENOTSUP) If the server does not support notifications.
+ */
+int bt_gatt_throughput_subscribe(struct bt_gatt_throughput *throughput);
+
+/** @brief Send a notification to the client.
+ *
+ *  Send 1 byte to reset the metrics of the client.
+ *
+ *  @param[in] conn Connection object.
+ *  @param[in] data Data.
+ *  @param[in] len Data length.
+ *  @param[in] func Function called when the notification is sent.
+ *                  Can be NULL.
+ *  @param[in] user_data User data passed to the function.
+ *
+ *  @retval 0 If the operation was successful.
+ *            Otherwise, a negative error code is returned.
+ *  @retval (-EINVAL) If notifications are disabled by the client.
+ */
+int bt_gatt_throughput_notify(struct bt_conn *conn, const u8_t *data,
+			      u16_t len, bt_gatt_complete_func_t func,
+			      void *user_data);
+
 #ifdef __cplusplus
 }
 #endif
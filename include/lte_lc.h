@@ -12,6 +12,8 @@
 #ifndef ZEPHYR_INCLUDE_LTE_LINK_CONTROL_H_
 #define ZEPHYR_INCLUDE_LTE_LINK_CONTROL_H_
 
+#include <zephyr.h>
+
 /* NOTE: enum lte_lc_nw_reg_status maps directly to the registration status
  *	 as returned by the AT command "AT+CEREG?".
  */
@@ -45,6 +47,101 @@ enum lte_lc_func_mode {
 	LTE_LC_FUNC_MODE_OFFLINE_UICC_ON	= 44
 };
 
+/* NOTE: enum lte_lc_rai maps directly to the release assistance indication
+ *	 configuration used by the AT command "AT%XRAI".
+ */
+enum lte_lc_rai {
+	/** No release assistance indication. */
+	LTE_LC_RAI_DISABLED			= 0,
+	/** A single downlink packet is expected after the next uplink. */
+	LTE_LC_RAI_ONE_RESPONSE			= 3,
+	/** No downlink is expected after the next uplink. */
+	LTE_LC_RAI_NO_RESPONSE			= 4
+};
+
+/** @brief RRC connection statistics of a transmit cycle. */
+struct lte_lc_cycle_stats {
+	/** Time spent in RRC connected mode, in milliseconds. */
+	u32_t rrc_connected_time;
+	/** Number of RRC connections. */
+	u32_t rrc_connections;
+	/** Time from the start of the cycle until the last RRC connection
+	 *  was released, in milliseconds.
+	 */
+	u32_t duration;
+};
+
+/** @brief Handler for completed transmit cycles.
+ *
+ * Called from the system work queue when the RRC connection has been
+ * released after lte_lc_cycle_end(), or soon after lte_lc_cycle_end() if
+ * the modem was already in RRC idle mode. No lock of the library is held,
+ * so the handler may start the next cycle.
+ *
+ * @param stats RRC connection statistics of the cycle.
+ */
+typedef void (*lte_lc_cycle_handler_t)(const struct lte_lc_cycle_stats *stats);
+
+/** @brief Link state kept up to date from the modem notifications. */
+struct lte_lc_link_state {
+	/** Network registration status. */
+	enum lte_lc_nw_reg_status nw_reg_status;
+	/** True if the modem is in RRC connected mode. */
+	bool rrc_connected;
+	/** Periodic TAU granted by the network in seconds, -1 if PSM is not
+	 *  granted.
+	 */
+	int tau;
+	/** Active time granted by the network in seconds, -1 if PSM is not
+	 *  granted.
+	 */
+	int active_time;
+	/** Uptime of the next periodic TAU in milliseconds as reported by the
+	 *  last TAU pre-warning, 0 if no pre-warning has been received.
+	 */
+	s64_t next_tau;
+};
+
+enum lte_lc_evt_type {
+	/** The network registration status has changed. */
+	LTE_LC_EVT_NW_REG_STATUS,
+	/** The modem has entered or left RRC connected mode. */
+	LTE_LC_EVT_RRC_UPDATE,
+	/** The PSM timers granted by the network have changed. */
+	LTE_LC_EVT_PSM_UPDATE,
+	/** A periodic TAU is about to be performed. */
+	LTE_LC_EVT_TAU_PRE_WARNING
+};
+
+/** @brief Link state event. */
+struct lte_lc_evt {
+	enum lte_lc_evt_type type;
+	union {
+		/** LTE_LC_EVT_NW_REG_STATUS: New registration status. */
+		enum lte_lc_nw_reg_status nw_reg_status;
+		/** LTE_LC_EVT_RRC_UPDATE: True if RRC connected. */
+		bool rrc_connected;
+		/** LTE_LC_EVT_PSM_UPDATE: New PSM timers in seconds. */
+		struct {
+			int tau;
+			int active_time;
+		} psm_cfg;
+		/** LTE_LC_EVT_TAU_PRE_WARNING: Time until the TAU in
+		 *  milliseconds.
+		 */
+		u32_t time;
+	};
+};
+
+/** @brief Handler for link state events.
+ *
+ * Called from the AT command notification thread. The handler may call the
+ * link state getters, but must not block.
+ *
+ * @param evt The event.
+ */
+typedef void (*lte_lc_evt_handler_t)(const struct lte_lc_evt *evt);
+
 /** @brief Function for initializing
  * the modem.  NOTE: a follow-up call to lte_lc_connect()
  * must be made.
@@ -115,7 +212,118 @@ int lte_lc_psm_get(int *tau, int *active_time);
  */
 int lte_lc_edrx_req(bool enable);
 
+/** @brief Function for requesting the modem to indicate to the network
+ * whether more data is expected after the next uplink, so the network can
+ * release the RRC connection without waiting for the inactivity timer.
+ * For reference see 3GPP 24.301 Ch. 9.9.4.25.
+ *
+ * @param rai Release assistance indication to use for the next uplinks.
+ *
+ * @return Zero on success or (negative) error code otherwise.
+ */
+int lte_lc_rai_req(enum lte_lc_rai rai);
+
+#if defined(CONFIG_LTE_LINK_STATE)
+/**@brief Get the cached link state.
+ *
+ * Does not send any AT commands.
+ *
+ * @param state Pointer to the variable for the link state.
+ *
+ * @return Zero on success or (negative) error code otherwise.
+ *	   -ENODATA if the link state has not been initialized by
+ *	   lte_lc_init(), lte_lc_connect_async() or the PSM scheduler.
+ */
+int lte_lc_link_state_get(struct lte_lc_link_state *state);
+
+/**@brief Register a handler for link state events.
+ *
+ * @param handler The handler.
+ *
+ * @return Zero on success or (negative) error code otherwise.
+ *	   -EALREADY if the handler is already registered.
+ *	   -ENOMEM if CONFIG_LTE_LINK_STATE_HANDLER_COUNT handlers are
+ *	   already registered.
+ */
+int lte_lc_register_handler(lte_lc_evt_handler_t handler);
+
+/**@brief Deregister a handler for link state events.
+ *
+ * @param handler The handler.
+ *
+ * @return Zero on success or (negative) error code otherwise.
+ *	   -ENXIO if the handler is not registered.
+ */
+int lte_lc_deregister_handler(lte_lc_evt_handler_t handler);
+
+/**@brief Start connecting to the network without waiting for the
+ *	  registration.
+ *
+ * The registration is reported by the LTE_LC_EVT_NW_REG_STATUS event.
+ * No fallback network mode is tried.
+ *
+ * @return Zero on success or (negative) error code otherwise.
+ */
+int lte_lc_connect_async(void);
+#endif /* CONFIG_LTE_LINK_STATE */
+
+#if defined(CONFIG_LTE_PSM_SCHED)
+/**@brief Schedule a transmission into the next window where the modem is in
+ *	  RRC connected mode.
+ *
+ * The work item is submitted to the system work queue immediately if the
+ * modem is in RRC connected mode. Otherwise it is submitted when the modem
+ * enters RRC connected mode, for example for a periodic TAU or for another
+ * transmission, or when @p max_delay expires. Transmissions that expire
+ * together are therefore sent in a single RRC connection.
+ *
+ * @param work Work item that sends the data.
+ * @param max_delay Maximum time to wait for the modem to enter RRC connected
+ *		    mode, in milliseconds. K_FOREVER waits indefinitely.
+ *
+ * @return Zero on success or (negative) error code otherwise.
+ *	   -ENOMEM if CONFIG_LTE_PSM_SCHED_QUEUE_SIZE transmissions are
+ *	   already scheduled.
+ */
+int lte_lc_tx_schedule(struct k_work *work, s32_t max_delay);
+
+/**@brief Start a transmit cycle.
+ *
+ * Resets the RRC connection statistics and disables the release assistance
+ * indication requested at the end of the previous cycle.
+ *
+ * @param handler Handler to receive the statistics of the cycle, or NULL.
+ *
+ * @return Zero on success or (negative) error code otherwise.
+ */
+int lte_lc_cycle_start(lte_lc_cycle_handler_t handler);
+
+/**@brief End a transmit cycle after the last expected downlink.
+ *
+ * Requests the release assistance indication, and completes the cycle when
+ * the RRC connection has been released.
+ *
+ * @param rai Release assistance indication to request.
+ *
+ * @return Zero on success or (negative) error code otherwise.
+ *	   -EALREADY if no cycle has been started.
+ */
+int lte_lc_cycle_end(enum lte_lc_rai rai);
+
+/**@brief Get the RRC connection statistics of the current or last transmit
+ *	  cycle.
+ *
+ * @param stats Pointer to the variable for the statistics.
+ *
+ * @return Zero on success or (negative) error code otherwise.
+ */
+int lte_lc_cycle_stats_get(struct lte_lc_cycle_stats *stats);
+#endif /* CONFIG_LTE_PSM_SCHED */
+
 /**@brief Get the current network registration status.
+ *
+ * With CONFIG_LTE_LINK_STATE, the cached status is returned once the link
+ * state has been initialized, without sending any AT commands.
  *
  * @param status Pointer for network registation status.
  *
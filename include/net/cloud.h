@@ -85,6 +85,10 @@ struct cloud_msg {
 	char *buf;
 	size_t len;
 	enum cloud_qos qos;
+	/** Message ID, assigned by cloud_send_async() and reported in
+	 *  CLOUD_EVT_DATA_SENT.
+	 */
+	u16_t id;
 	struct {
 		enum cloud_endpoint type;
 		char *str;
@@ -117,7 +121,8 @@ typedef void (*cloud_evt_handler_t)(const struct cloud_backend *const backend,
 /**
  * @brief Cloud backend API.
  *
- * ping() and user_data_set() can be omitted, the other functions are mandatory.
+ * ping(), send_async() and user_data_set() can be omitted, the other functions
+ * are mandatory.
  */
 struct cloud_api {
 	int (*init)(const struct cloud_backend *const backend,
@@ -128,6 +133,8 @@ struct cloud_api {
 	int (*disconnect)(const struct cloud_backend *const backend);
 	int (*send)(const struct cloud_backend *const backend,
 		    const struct cloud_msg *const msg);
+	int (*send_async)(const struct cloud_backend *const backend,
+			  struct cloud_msg *const msg);
 	int (*ping)(const struct cloud_backend *const backend);
 	int (*input)(const struct cloud_backend *const backend);
 	int (*user_data_set)(const struct cloud_backend *const backend,
@@ -252,6 +259,34 @@ static inline int cloud_send(const struct cloud_backend *const backend,
 	return backend->api->send(backend, msg);
 }
 
+/**@brief Queue data to be sent to a cloud.
+ *
+ * @details The backend copies the message buffer, so it can be reused as soon
+ *	    as this function returns. Queued messages are sent while the
+ *	    backend is connected and processes input, and
+ *	    CLOUD_EVT_DATA_SENT is notified with the message ID once each
+ *	    message has been acknowledged, or handed to the transport for
+ *	    CLOUD_QOS_AT_MOST_ONCE. The event is notified from cloud_input(),
+ *	    never from within this function.
+ *
+ * @param backend Pointer to a cloud backend structure.
+ * @param msg     Pointer to cloud message structure. On success, msg->id is
+ *		  set to the ID of the queued message.
+ *
+ * @return 0 or a negative error code indicating reason of failure.
+ *	   -ENOTSUP if the backend can only send synchronously.
+ */
+static inline int cloud_send_async(const struct cloud_backend *const backend,
+				   struct cloud_msg *msg)
+{
+	if (backend == NULL || backend->api == NULL ||
+	    backend->api->send_async == NULL) {
+		return -ENOTSUP;
+	}
+
+	return backend->api->send_async(backend, msg);
+}
+
 /**
  * @brief Optional API to ping the cloud's remote endpoint periodically.
  *
@@ -15,6 +15,7 @@
  */
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <zephyr/types.h>
 #include <nfc/ndef/record_parser.h>
 #include <nfc/ndef/nfc_ndef_msg.h>
@@ -84,6 +85,79 @@ int nfc_ndef_msg_parse(const u8_t  *result_buf,
 		       const u8_t *raw_data,
 		       u32_t *raw_data_len);
 
+/** @brief Iterator over the records of a raw NDEF message.
+ *
+ *  The iterator parses one record at a time, directly in the raw data.
+ *  It needs no memory for descriptors.
+ */
+struct nfc_ndef_msg_iter {
+	/** Pointer to the raw message data. */
+	const u8_t *data;
+	/** Size of the raw data. */
+	u32_t data_len;
+	/** Offset of the next record. After the last record, size of the
+	 *  parsed message.
+	 */
+	u32_t offset;
+	/** Number of records returned so far. */
+	u32_t record_count;
+	/** True if the last record was returned. */
+	bool end;
+};
+
+/** @brief Initialize an NDEF message iterator.
+ *
+ *  @param[out] iter Pointer to the iterator.
+ *  @param[in] raw_data Pointer to the data to be parsed. The data must stay
+ *                      valid while the iterator and the record views
+ *                      are used.
+ *  @param[in] raw_data_len Size of the NFC data in the @p raw_data buffer.
+ */
+void nfc_ndef_msg_iter_init(struct nfc_ndef_msg_iter *iter,
+			    const u8_t *raw_data,
+			    u32_t raw_data_len);
+
+/** @brief Get the next record of an NDEF message.
+ *
+ *  The record is validated in the same way as by @ref nfc_ndef_msg_parse.
+ *  Records that follow it are not parsed.
+ *
+ *  @param[in,out] iter Pointer to the iterator.
+ *  @param[out] view Pointer to the record view that will be filled with
+ *                   parsed data.
+ *
+ *  @retval 0 If the operation was successful.
+ *  @retval -ENOENT If the last record of the message was already returned.
+ *  @retval -EINVAL If the record does not fit in the data.
+ *  @retval -EFAULT If the record location flags are invalid or the data
+ *                  ends before the last record.
+ */
+int nfc_ndef_msg_iter_next(struct nfc_ndef_msg_iter *iter,
+			   struct nfc_ndef_record_view *view);
+
+/** @brief Find the next record of a given type in an NDEF message.
+ *
+ *  The search starts at the current position of the iterator and stops at
+ *  the first matching record.
+ *
+ *  @param[in,out] iter Pointer to the iterator.
+ *  @param[in] tnf Type Name Format of the record.
+ *  @param[in] type Pointer to the record type.
+ *  @param[in] type_length Length of the record type.
+ *  @param[out] view Pointer to the record view that will be filled with
+ *                   data of the found record.
+ *
+ *  @retval 0 If the record was found.
+ *  @retval -ENOENT If the message contains no further matching record.
+ *            Otherwise, a (negative) error code of
+ *            @ref nfc_ndef_msg_iter_next is returned.
+ */
+int nfc_ndef_msg_record_find(struct nfc_ndef_msg_iter *iter,
+			     enum nfc_ndef_record_tnf tnf,
+			     const u8_t *type,
+			     u8_t type_length,
+			     struct nfc_ndef_record_view *view);
+
 /** @brief Print the parsed contents of an NDEF message.
  *
  *  @param[in] msg_desc Pointer to the descriptor of the message that should
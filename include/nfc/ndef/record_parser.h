@@ -21,6 +21,46 @@ extern "C" {
  */
 
 
+/** @brief NDEF record fields, located in the parsed data.
+ */
+struct nfc_ndef_record_view {
+	/** Value of the Type Name Format (TNF) field. */
+	enum nfc_ndef_record_tnf tnf;
+	/** Location of the record within the NDEF message. */
+	enum nfc_ndef_record_location location;
+	/** Length of the type field. */
+	u8_t type_length;
+	/** Pointer to the type field data. NULL if type_length is 0. */
+	u8_t const *type;
+	/** Length of the ID field. */
+	u8_t id_length;
+	/** Pointer to the ID field data. NULL if id_length is 0. */
+	u8_t const *id;
+	/** Length of the payload. */
+	u32_t payload_length;
+	/** Pointer to the payload. NULL if payload_length is 0. */
+	u8_t const *payload;
+};
+
+/** @brief Parse an NDEF record in place.
+ *
+ *  The record fields are not copied. The view points to the fields in the
+ *  parsed data.
+ *
+ *  @param[out] view Pointer to the record view that will be filled with
+ *                   parsed data.
+ *  @param[in] nfc_data Pointer to the raw data to be parsed.
+ *  @param[in,out] nfc_data_len As input: size of the NFC data in the
+ *                              @p nfc_data buffer. As output: size of the
+ *                              parsed record.
+ *
+ *  @retval 0 If the operation was successful.
+ *  @retval -EINVAL If the record does not fit in the data.
+ */
+int nfc_ndef_record_view_parse(struct nfc_ndef_record_view *view,
+			       const u8_t *nfc_data,
+			       u32_t *nfc_data_len);
+
 /** @brief Parse NDEF records.
  *
  *  This parsing implementation uses the binary payload descriptor
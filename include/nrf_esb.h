@@ -50,7 +50,9 @@ extern "C" {
 		.radio_irq_priority = 1,				       \
 		.event_irq_priority = 2,				       \
 		.payload_length = 32,					       \
-		.selective_auto_ack = false                                    \
+		.selective_auto_ack = false,				       \
+		.burst_length = 1,					       \
+		.ack_aggregation = false				       \
 	}
 
 /** @brief Default legacy radio parameters.
@@ -71,7 +73,9 @@ extern "C" {
 		.radio_irq_priority = 1,				       \
 		.event_irq_priority = 2,				       \
 		.payload_length = 32,					       \
-		.selective_auto_ack = false                                    \
+		.selective_auto_ack = false,				       \
+		.burst_length = 1,					       \
+		.ack_aggregation = false				       \
 	}
 
 /** @brief Macro to create an initializer for a TX data packet.
@@ -244,6 +248,26 @@ struct nrf_esb_config {
 				   *  will be acknowledged ignoring the noack
 				   *  field.
 				   */
+	u8_t burst_length; /**< Maximum number of queued packets sent
+			     *  back-to-back in PTX mode. Only the last packet
+			     *  of a burst requests an acknowledgement, so
+			     *  loss of the other packets is not detected.
+			     *  The PRX must use selective auto
+			     *  acknowledgement. Values 0 and 1 disable
+			     *  bursts. Supported only with
+			     *  @ref NRF_ESB_PROTOCOL_ESB_DPL.
+			     */
+	bool ack_aggregation; /**< ACK payload aggregation. In PRX mode,
+				*  consecutive payloads from the TX FIFO are
+				*  sent together in one ACK packet, also if
+				*  they are queued for different pipes. In PTX
+				*  mode, received ACK payloads are split back
+				*  into separate payloads. Both devices must
+				*  use the same setting, and the PTX must be
+				*  the only device using the pipes. Each
+				*  payload takes two additional bytes in the
+				*  ACK packet.
+				*/
 };
 
 /** @brief Initialize the Enhanced ShockBurst module.
@@ -303,6 +327,62 @@ int nrf_esb_write_payload(const struct nrf_esb_payload *payload);
  */
 int nrf_esb_read_rx_payload(struct nrf_esb_payload *payload);
 
+/** @brief Reserve a TX FIFO slot.
+ *
+ *  The payload is filled in place and queued with
+ *  @ref nrf_esb_commit_payload, which avoids copying it into the FIFO.
+ *  Calling this function again before the commit returns the same slot.
+ *
+ *  The TX FIFO has a single producer. The functions that add payloads must
+ *  not be called from more than one context at a time.
+ *
+ *  @param[out] payload	Pointer to the reserved payload.
+ *
+ * @retval 0 If successful.
+ * @retval -ENOMEM If the TX FIFO is full.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int nrf_esb_reserve_payload(struct nrf_esb_payload **payload);
+
+/** @brief Queue the payload in the reserved TX FIFO slot.
+ *
+ *  The packet ID is assigned by this function. The payload must not be
+ *  accessed after it is committed.
+ *
+ * @retval 0 If successful.
+ * @retval -EMSGSIZE If the payload length is invalid. The slot stays
+ *                   reserved.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int nrf_esb_commit_payload(void);
+
+/** @brief Get the oldest payload in the RX FIFO without copying it.
+ *
+ *  The payload stays in the FIFO until @ref nrf_esb_release_rx_payload is
+ *  called. Calling this function again before the release returns the same
+ *  payload.
+ *
+ *  The RX FIFO has a single consumer. The functions that read payloads must
+ *  not be called from more than one context at a time.
+ *
+ *  @param[out] payload	Pointer to the received payload.
+ *
+ * @retval 0 If successful.
+ * @retval -ENODATA If the RX FIFO is empty.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int nrf_esb_acquire_rx_payload(struct nrf_esb_payload **payload);
+
+/** @brief Remove the oldest payload from the RX FIFO.
+ *
+ *  The payload returned by @ref nrf_esb_acquire_rx_payload must not be
+ *  accessed after it is released.
+ *
+ * @retval 0 If successful.
+ *           Otherwise, a (negative) error code is returned.
+ */
+int nrf_esb_release_rx_payload(void);
+
 /** @brief Start transmitting data.
  *
  * @retval 0 If successful.
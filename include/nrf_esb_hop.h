@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#ifndef __NRF_ESB_HOP_H
+#define __NRF_ESB_HOP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup nrf_esb_hop Enhanced ShockBurst frequency hopping
+ * @{
+ * @ingroup nrf_esb
+ *
+ * @brief Adaptive frequency hopping scheduler for Enhanced ShockBurst.
+ *
+ * Both devices of a link run the same scheduler. Time is divided into hop
+ * slots and the channel of a slot is taken from a pseudo-random permutation
+ * of the used channels, which repeats every cycle. The PTX collects
+ * packet error statistics for each channel and schedules channel map
+ * updates that exclude bad channels. The PTX sends synchronization info with
+ * its packets, and the PRX takes the slot counter and the channel map from
+ * it. Both devices switch to a new map at the same slot.
+ *
+ * The scheduler does not access the radio. The application changes the
+ * channel with @ref nrf_esb_set_rf_channel at every hop.
+ */
+
+/** Number of RF channels that can be used for hopping. */
+#define NRF_ESB_HOP_CHANNEL_COUNT 101
+
+/** Size of a channel map in bytes. Bit n of the map stands for channel n. */
+#define NRF_ESB_HOP_MAP_SIZE ((NRF_ESB_HOP_CHANNEL_COUNT + 7) / 8)
+
+/** Minimum number of channels in a channel map. */
+#define NRF_ESB_HOP_CHANNELS_MIN 2
+
+/** @brief Default scheduler parameters. */
+#define NRF_ESB_HOP_DEFAULT_CONFIG					       \
+	{								       \
+		.seed = 0,						       \
+		.per_threshold = 128,					       \
+		.channels_min = 8,					       \
+		.instant_offset = 16,					       \
+		.blacklist_slots = 4096,				       \
+	}
+
+/** @brief Scheduler configuration. Must be the same on both devices. */
+struct nrf_esb_hop_config {
+	u8_t map[NRF_ESB_HOP_MAP_SIZE];	/**< Channels allowed for hopping. */
+	u32_t seed;		/**< Seed of the hop sequence. */
+	u8_t per_threshold;	/**< Packet error rate (in 1/256 units) above
+				  *  which a channel is excluded.
+				  */
+	u8_t channels_min;	/**< Minimum number of used channels. */
+	u16_t instant_offset;	/**< Number of slots between the creation of
+				  *  a channel map update and its instant.
+				  */
+	u32_t blacklist_slots;	/**< Number of slots after which an excluded
+				  *  channel is used again.
+				  */
+};
+
+/** @brief Synchronization info, sent from the PTX to the PRX.
+ *
+ *  Both the channel map in use and the next one are sent, so that a PRX that
+ *  missed an earlier update hops on the right channels until the next
+ *  instant.
+ */
+struct nrf_esb_hop_sync_info {
+	u8_t map[NRF_ESB_HOP_MAP_SIZE];	/**< Channel map in use. */
+	u8_t next_map[NRF_ESB_HOP_MAP_SIZE]; /**< Latest channel map, the same
+					       *  as map if no update is
+					       *  pending.
+					       */
+	u32_t instant;	/**< First slot that uses the latest channel map. */
+	u32_t slot;	/**< PTX slot when the info was sent. */
+};
+
+/** @brief Length of encoded synchronization info if no update is pending. */
+#define NRF_ESB_HOP_SYNC_INFO_LEN_MIN (4 + NRF_ESB_HOP_MAP_SIZE)
+
+/** @brief Maximum length of encoded synchronization info. */
+#define NRF_ESB_HOP_SYNC_INFO_LEN_MAX \
+	(NRF_ESB_HOP_SYNC_INFO_LEN_MIN + 2 + NRF_ESB_HOP_MAP_SIZE)
+
+/** @brief Scheduler state. */
+struct nrf_esb_hop {
+	struct nrf_esb_hop_config cfg;
+	u8_t map[NRF_ESB_HOP_MAP_SIZE];
+	u8_t seq[NRF_ESB_HOP_CHANNEL_COUNT];
+	u8_t seq_len;
+	u32_t slot;
+	u32_t instant;
+
+	u8_t pending_map[NRF_ESB_HOP_MAP_SIZE];
+	u32_t pending_instant;
+	bool pending;
+
+	u8_t per[NRF_ESB_HOP_CHANNEL_COUNT];
+	u32_t excluded_at[NRF_ESB_HOP_CHANNEL_COUNT];
+};
+
+/** @brief Initialize the scheduler.
+ *
+ *  All channels of the configured map are used at first, and the scheduler
+ *  starts at slot 0.
+ *
+ *  @param hop	Scheduler.
+ *  @param cfg	Configuration.
+ *
+ * @retval 0 If successful.
+ * @retval -EINVAL If the channel map is invalid.
+ */
+int nrf_esb_hop_init(struct nrf_esb_hop *hop,
+		     const struct nrf_esb_hop_config *cfg);
+
+/** @brief Get the channel of the current slot.
+ *
+ *  @param hop	Scheduler.
+ *
+ *  @return RF channel.
+ */
+u8_t nrf_esb_hop_channel(const struct nrf_esb_hop *hop);
+
+/** @brief Move to the next slot.
+ *
+ *  A pending channel map update is applied at its instant.
+ *
+ *  @param hop	Scheduler.
+ *
+ *  @return RF channel of the new slot.
+ */
+u8_t nrf_esb_hop_next(struct nrf_esb_hop *hop);
+
+/** @brief Get the number of slots in a hop cycle.
+ *
+ *  Every used channel is visited once per cycle. A PRX that lost the PTX
+ *  can stop hopping and listen on one channel for a cycle to find it.
+ *
+ *  @param hop	Scheduler.
+ *
+ *  @return Number of slots.
+ */
+u8_t nrf_esb_hop_cycle_len(const struct nrf_esb_hop *hop);
+
+/** @brief Synchronize to a packet received on a channel.
+ *
+ *  Used by the PRX when the packet does not carry synchronization info.
+ *  The current slot is moved to the nearest slot that uses the channel,
+ *  the later one if both are equally near.
+ *
+ *  @param hop		Scheduler.
+ *  @param channel	RF channel of the received packet.
+ *
+ * @retval 0 If successful.
+ * @retval -ENOENT If the channel is not used.
+ */
+int nrf_esb_hop_sync(struct nrf_esb_hop *hop, u8_t channel);
+
+/** @brief Add the result of a transmission to the channel statistics.
+ *
+ *  Used by the PTX, with the values of @ref NRF_ESB_EVENT_TX_SUCCESS and
+ *  @ref NRF_ESB_EVENT_TX_FAILED events.
+ *
+ *  @param hop		Scheduler.
+ *  @param channel	RF channel of the transmission.
+ *  @param tx_attempts	Number of transmission attempts.
+ *  @param success	True if the packet was acknowledged.
+ */
+void nrf_esb_hop_tx_result(struct nrf_esb_hop *hop, u8_t channel,
+			   u32_t tx_attempts, bool success);
+
+/** @brief Schedule a channel map update based on the channel statistics.
+ *
+ *  Used by the PTX. Channels with a packet error rate above the threshold
+ *  are excluded, worst first, as long as enough channels remain. Excluded
+ *  channels are used again after the configured number of slots. The new
+ *  map is used from the slot given by the configured instant offset.
+ *
+ *  @param hop	Scheduler.
+ *
+ *  @return True if an update was scheduled.
+ */
+bool nrf_esb_hop_map_update(struct nrf_esb_hop *hop);
+
+/** @brief Get the synchronization info.
+ *
+ *  Used by the PTX. The info must be sent in the current slot. It should be
+ *  sent often enough to deliver every map update to the PRX before its
+ *  instant.
+ *
+ *  @param hop	Scheduler.
+ *  @param info	Synchronization info.
+ */
+void nrf_esb_hop_sync_info_get(const struct nrf_esb_hop *hop,
+			       struct nrf_esb_hop_sync_info *info);
+
+/** @brief Apply the synchronization info received from the PTX.
+ *
+ *  Used by the PRX, in the slot in which the info was received. The slot
+ *  counter and the channel map in use are taken from the info, and the
+ *  latest channel map is used from its instant.
+ *
+ *  @param hop	Scheduler.
+ *  @param info	Synchronization info.
+ *
+ * @retval 0 If successful.
+ * @retval -EINVAL If a channel map is invalid.
+ */
+int nrf_esb_hop_sync_info_apply(struct nrf_esb_hop *hop,
+				const struct nrf_esb_hop_sync_info *info);
+
+/** @brief Encode synchronization info for transmission.
+ *
+ *  The slot is encoded as a little-endian 32-bit value, followed by the
+ *  channel map in use. If an update is pending, the instant follows as a
+ *  little-endian 16-bit offset from the slot, and then the latest channel
+ *  map.
+ *
+ *  @param info	Synchronization info.
+ *  @param buf	Buffer of at least @ref NRF_ESB_HOP_SYNC_INFO_LEN_MAX bytes.
+ *
+ *  @return Number of bytes written.
+ */
+size_t nrf_esb_hop_sync_info_encode(const struct nrf_esb_hop_sync_info *info,
+				    u8_t *buf);
+
+/** @brief Decode received synchronization info.
+ *
+ *  @param info	Synchronization info.
+ *  @param buf	Encoded synchronization info.
+ *  @param len	Length of the encoded synchronization info.
+ *
+ * @retval 0 If successful.
+ * @retval -EINVAL If the encoded synchronization info is malformed.
+ */
+int nrf_esb_hop_sync_info_decode(struct nrf_esb_hop_sync_info *info,
+				 const u8_t *buf, size_t len);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NRF_ESB_HOP_H */
@@ -194,6 +194,30 @@ static inline void profiler_log_send(struct log_event_buf *buf,
 #endif
 
 
+struct k_thread;
+
+/** @brief Monitor stack usage of a thread.
+ *
+ * Stack high-water mark of every monitored thread is periodically sent to
+ * the host as a profiler event. Registering a thread that is already
+ * monitored has no effect.
+ *
+ * @param thread Pointer to the thread object.
+ *
+ * @retval 0 If the operation was successful.
+ * @retval -ENOMEM If the maximum number of monitored threads is reached.
+ */
+#ifdef CONFIG_PROFILER_SAMPLER
+int profiler_stack_monitor_register(const struct k_thread *thread);
+#else
+static inline int profiler_stack_monitor_register(
+					const struct k_thread *thread)
+{
+	return 0;
+}
+#endif
+
+
 /**
  * @}
  */
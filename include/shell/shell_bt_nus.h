@@ -28,7 +28,6 @@ extern const struct shell_transport_api shell_bt_nus_transport_api;
 /** @brief Instance control block (RW data). */
 struct shell_bt_nus_ctrl_blk {
 	struct bt_conn *conn;
-	atomic_t tx_busy;
 	shell_transport_handler_t handler;
 	void *context;
 };
@@ -36,18 +35,18 @@ struct shell_bt_nus_ctrl_blk {
 /** @brief Instance structure. */
 struct shell_bt_nus {
 	struct shell_bt_nus_ctrl_blk *ctrl_blk;
-	struct ring_buf *tx_ringbuf;
+	struct bt_gatt_nus_stream *tx_stream;
 	struct ring_buf *rx_ringbuf;
 };
 
 /** @brief Macro for creating an instance of the module. */
 #define SHELL_BT_NUS_DEFINE(_name, _tx_ringbuf_size, _rx_ringbuf_size)	\
 	static struct shell_bt_nus_ctrl_blk _name##_ctrl_blk;		\
-	RING_BUF_DECLARE(_name##_tx_ringbuf, _tx_ringbuf_size);		\
+	BT_GATT_NUS_STREAM_DEFINE(_name##_tx_stream, _tx_ringbuf_size);	\
 	RING_BUF_DECLARE(_name##_rx_ringbuf, _rx_ringbuf_size);		\
 	static const struct shell_bt_nus _name##_shell_bt_nus = {	\
 		.ctrl_blk = &_name##_ctrl_blk,				\
-		.tx_ringbuf = &_name##_tx_ringbuf,			\
+		.tx_stream = &_name##_tx_stream,			\
 		.rx_ringbuf = &_name##_rx_ringbuf,			\
 	};								\
 	struct shell_transport _name = {				\
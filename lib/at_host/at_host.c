@@ -59,7 +59,7 @@ static struct k_work cmd_send_work;
 
 
 
-static inline void write_uart_string(char *str)
+static inline void write_uart_string(const char *str)
 {
 	/* Send characters until, but not including, null */
 	for (size_t i = 0; str[i]; i++) {
@@ -76,13 +76,14 @@ static void response_handler(char *response)
 static void cmd_send(struct k_work *work)
 {
 	char              str[19];
+	const char        *response;
 	enum at_cmd_state state;
 	int               err;
 
 	ARG_UNUSED(work);
 
-	err = at_cmd_write(at_buf, at_buf,
-			   sizeof(at_buf), &state);
+	/* The response is written from the driver's reception buffer. */
+	err = at_cmd_write_ref(at_buf, &response, &state);
 	if (err < 0) {
 		LOG_ERR("Error while processing AT command: %d", err);
 		state = AT_CMD_ERROR;
@@ -91,7 +92,7 @@ static void cmd_send(struct k_work *work)
 	/* Handle the various error responses from modem */
 	switch (state) {
 	case AT_CMD_OK:
-		write_uart_string(at_buf);
+		write_uart_string(response);
 		write_uart_string(OK_STR);
 		break;
 	case AT_CMD_ERROR:
@@ -109,6 +110,8 @@ static void cmd_send(struct k_work *work)
 		break;
 	}
 
+	at_cmd_response_unref(response);
+
 	uart_irq_rx_enable(uart_dev);
 }
 
@@ -279,7 +282,12 @@ static int at_host_init(struct device *arg)
 		return -EINVAL;
 	}
 
-	at_cmd_set_notification_handler(response_handler);
+	/* Forward all notifications */
+	err = at_cmd_notif_register(NULL, response_handler);
+	if (err) {
+		LOG_ERR("Could not register notification handler: %d", err);
+		return err;
+	}
 
 	/* Initialize the UART module */
 	err = at_uart_init(uart_dev_name);
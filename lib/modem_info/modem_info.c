@@ -513,9 +513,15 @@ static void modem_info_rsrp_subscribe_handler(char *response)
 
 int modem_info_rsrp_register(rsrp_cb_t cb)
 {
+	int err;
+
 	modem_info_rsrp_cb = cb;
 
-	at_cmd_set_notification_handler(modem_info_rsrp_subscribe_handler);
+	err = at_cmd_notif_register(AT_CMD_CESQ_RESP,
+				    modem_info_rsrp_subscribe_handler);
+	if ((err != 0) && (err != -EALREADY)) {
+		return err;
+	}
 
 	if (at_cmd_write(AT_CMD_CESQ_ON, NULL, 0, NULL) != 0) {
 		return -EIO;
@@ -0,0 +1,71 @@
+#!/usr/bin/env bash
+#
+# Copyright (c) 2019 Nordic Semiconductor
+#
+# SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+#
+# Run the throughput benchmark between two simulated nRF52 devices in
+# BabbleSim and extract the results.
+#
+# Usage: run.sh <tester zephyr.exe> <peer zephyr.exe> [results.csv [baseline.csv]]
+#
+# The executables are built for the nrf52_bsim board with
+# CONFIG_BENCH_ROLE_TESTER and CONFIG_BENCH_ROLE_PEER respectively.
+# If a baseline (results of a previous run) is given, the script fails when
+# throughput of any run drops by more than BENCH_TOLERANCE percent.
+
+set -u
+
+if [ $# -lt 2 ]; then
+	sed -n '10p' "$0" | cut -c3-
+	exit 1
+fi
+
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must point to the BabbleSim installation}"
+
+tester_exe=$(realpath "$1")
+peer_exe=$(realpath "$2")
+results=${3:-bench_results.csv}
+baseline=${4:-}
+sim_id=throughput_bench_$$
+sim_length=${BENCH_SIM_LENGTH_US:-1000000000}
+tolerance=${BENCH_TOLERANCE:-10}
+log=$(mktemp)
+
+trap 'rm -f "${log}"' EXIT
+
+"${tester_exe}" -s=${sim_id} -d=0 > "${log}" 2>&1 &
+"${peer_exe}" -s=${sim_id} -d=1 > /dev/null 2>&1 &
+(cd "${BSIM_OUT_PATH}/bin" && \
+ ./bs_2G4_phy_v1 -s=${sim_id} -D=2 -sim_length=${sim_length}) \
+	> /dev/null 2>&1 &
+
+wait
+
+grep '^bench,' "${log}" | grep -v '^bench,done,' | cut -d, -f2- > "${results}"
+summary=$(grep '^bench,done,' "${log}")
+
+if [ -z "${summary}" ]; then
+	echo "Benchmark did not finish"
+	exit 1
+fi
+
+runs=$(echo "${summary}" | cut -d, -f3)
+failed=$(echo "${summary}" | cut -d, -f4)
+echo "${runs} runs done, ${failed} failed, results in ${results}"
+
+if [ "${failed}" != "0" ]; then
+	exit 1
+fi
+
+if [ -n "${baseline}" ]; then
+	# Column 9 is throughput in kbps, rows are matched by the run index.
+	awk -F, -v tol="${tolerance}" '
+		NR == FNR { if (FNR > 1) base[$1] = $9; next }
+		FNR > 1 && ($1 in base) && ($9 * 100 < base[$1] * (100 - tol)) {
+			printf("Run %s (%s): %s kbps, baseline %s kbps\n",
+			       $1, $2, $9, base[$1])
+			bad = 1
+		}
+		END { exit bad }' "${baseline}" "${results}" || exit 1
+fi
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <misc/printk.h>
+
+#include "bench.h"
+
+#define MTU_MIN	23
+#define MTU_MAX	247
+
+/* Link parameters swept by the benchmark. Edit the tables to change
+ * the sweep.
+ */
+static const u16_t intervals[] = {
+	6,	/* 7.5 ms */
+	24,	/* 30 ms */
+	80,	/* 100 ms */
+};
+
+static const u8_t phys[] = {
+	BENCH_PHY_1M,
+	BENCH_PHY_2M,
+};
+
+static const u16_t data_lens[] = {
+	27,
+	251,
+};
+
+/* Transfers done for every set of link parameters. ATT MTU is exchanged
+ * only once per connection, the lower MTU is emulated by limiting the size
+ * of the ATT payload. NUS stream always uses the exchanged MTU.
+ */
+static const struct {
+	enum bench_mode mode;
+	u16_t mtu;
+} transfers[] = {
+	{BENCH_MODE_WRITE,	MTU_MIN},
+	{BENCH_MODE_WRITE,	MTU_MAX},
+	{BENCH_MODE_NOTIFY,	MTU_MIN},
+	{BENCH_MODE_NOTIFY,	MTU_MAX},
+	{BENCH_MODE_NUS,	MTU_MAX},
+};
+
+static const char * const mode_name[] = {
+	[BENCH_MODE_WRITE] = "write",
+	[BENCH_MODE_NOTIFY] = "notify",
+	[BENCH_MODE_NUS] = "nus",
+};
+
+
+size_t bench_run_count(void)
+{
+	return ARRAY_SIZE(intervals) * ARRAY_SIZE(phys) *
+	       ARRAY_SIZE(data_lens) * ARRAY_SIZE(transfers);
+}
+
+bool bench_run_get(size_t idx, struct bench_run *run)
+{
+	if (idx >= bench_run_count()) {
+		return false;
+	}
+
+	size_t transfer = idx % ARRAY_SIZE(transfers);
+
+	idx /= ARRAY_SIZE(transfers);
+	run->mode = transfers[transfer].mode;
+	run->mtu = transfers[transfer].mtu;
+
+	run->data_len = data_lens[idx % ARRAY_SIZE(data_lens)];
+	idx /= ARRAY_SIZE(data_lens);
+
+	run->phy = phys[idx % ARRAY_SIZE(phys)];
+	idx /= ARRAY_SIZE(phys);
+
+	run->interval = intervals[idx];
+
+	return true;
+}
+
+bool bench_link_changed(const struct bench_run *prev,
+			const struct bench_run *run)
+{
+	return (prev == NULL) ||
+	       (prev->interval != run->interval) ||
+	       (prev->phy != run->phy) ||
+	       (prev->data_len != run->data_len);
+}
+
+void bench_latency_reset(struct bench_latency *lat)
+{
+	lat->min = UINT32_MAX;
+	lat->max = 0;
+	lat->cnt = 0;
+	lat->sum = 0;
+}
+
+void bench_latency_add(struct bench_latency *lat, u32_t value)
+{
+	lat->min = MIN(lat->min, value);
+	lat->max = MAX(lat->max, value);
+	lat->sum += value;
+	lat->cnt++;
+}
+
+u32_t bench_latency_avg(const struct bench_latency *lat)
+{
+	if (!lat->cnt) {
+		return 0;
+	}
+
+	return lat->sum / lat->cnt;
+}
+
+void bench_header_print(void)
+{
+	printk("bench,run,mode,interval_us,phy,data_len,mtu,bytes,time_ms,"
+	       "kbps,lat_min_us,lat_avg_us,lat_max_us,cpu_pct,err\n");
+}
+
+void bench_result_print(size_t idx, const struct bench_run *run,
+			const struct bench_result *res)
+{
+	const struct bench_latency *lat = &res->lat;
+
+	printk("bench,%u,%s,%u,%s,%u,%u,%u,%u,%u,%u,%u,%u,%d,%d\n",
+	       (unsigned int)idx, mode_name[run->mode], res->interval_us,
+	       (run->phy == BENCH_PHY_2M) ? "2M" : "1M", run->data_len,
+	       res->mtu, res->bytes, res->time_ms, res->rate / 1000,
+	       lat->cnt ? lat->min : 0, bench_latency_avg(lat), lat->max,
+	       res->cpu_load, res->err);
+}
+
+void bench_summary_print(size_t run_cnt, size_t fail_cnt)
+{
+	printk("bench,done,%u,%u\n", (unsigned int)run_cnt,
+	       (unsigned int)fail_cnt);
+}
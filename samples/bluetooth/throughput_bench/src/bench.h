@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* PHY values match the PHY preference bits of the LE Set PHY command. */
+#define BENCH_PHY_1M	0x01
+#define BENCH_PHY_2M	0x02
+
+/* Transfer method used in the run. */
+enum bench_mode {
+	BENCH_MODE_WRITE,
+	BENCH_MODE_NOTIFY,
+	BENCH_MODE_NUS,
+
+	BENCH_MODE_COUNT
+};
+
+/* Parameters of a single run. */
+struct bench_run {
+	enum bench_mode mode;
+	u16_t interval;		/* Connection interval in 1.25 ms units. */
+	u8_t phy;		/* BENCH_PHY_* value. */
+	u16_t data_len;		/* LL data length in bytes. */
+	u16_t mtu;		/* ATT MTU used by the run. */
+};
+
+struct bench_latency {
+	u32_t min;
+	u32_t max;
+	u32_t cnt;
+	u64_t sum;
+};
+
+/* Results of a single run. */
+struct bench_result {
+	u32_t bytes;		/* Bytes received by the peer. */
+	u32_t time_ms;		/* Duration of the transfer. */
+	u32_t rate;		/* Throughput in bits per second. */
+	u32_t interval_us;	/* Connection interval during the run. */
+	u16_t mtu;		/* ATT MTU used during the run. */
+	s8_t cpu_load;		/* Tester CPU load in %, -1 if unknown. */
+	struct bench_latency lat;	/* Latency in microseconds. */
+	int err;
+};
+
+/* Number of runs in the sweep. */
+size_t bench_run_count(void);
+
+/* Get parameters of the run with the given index. Runs are ordered so that
+ * link parameters change as rarely as possible.
+ */
+bool bench_run_get(size_t idx, struct bench_run *run);
+
+bool bench_link_changed(const struct bench_run *prev,
+			const struct bench_run *run);
+
+void bench_latency_reset(struct bench_latency *lat);
+void bench_latency_add(struct bench_latency *lat, u32_t value);
+u32_t bench_latency_avg(const struct bench_latency *lat);
+
+/* Results are printed as comma separated lines starting with "bench,". */
+void bench_header_print(void);
+void bench_result_print(size_t idx, const struct bench_run *run,
+			const struct bench_result *res);
+void bench_summary_print(size_t run_cnt, size_t fail_cnt);
+
+/* Benchmark runner, defined in runner.c. The runner registers callbacks of
+ * the Throughput Service and owns the NUS stream.
+ */
+struct bt_conn;
+struct bt_gatt_throughput;
+
+int bench_runner_init(struct bt_gatt_throughput *throughput);
+
+/* Start the sweep on the connection. Handles of the Throughput Service must
+ * be assigned and ATT MTU exchanged.
+ */
+void bench_runner_start(struct bt_conn *conn);
+
+/* Abort the sweep, called when the connection is terminated. */
+void bench_runner_stop(void);
+
+/* Wait for the start and run the whole sweep. */
+void bench_runner_run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BENCH_H_ */
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <kernel.h>
+#include <misc/printk.h>
+#include <zephyr/types.h>
+
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/conn.h>
+#include <bluetooth/gatt.h>
+#include <bluetooth/hci.h>
+#include <bluetooth/uuid.h>
+#include <bluetooth/services/throughput.h>
+#include <bluetooth/services/nus.h>
+#include <bluetooth/services/nus_c.h>
+#include <bluetooth/scan.h>
+#include <bluetooth/gatt_dm.h>
+
+#include "bench.h"
+
+#define DEVICE_NAME	CONFIG_BT_DEVICE_NAME
+#define DEVICE_NAME_LEN (sizeof(DEVICE_NAME) - 1)
+#define INTERVAL_MIN	0x28	/* 40 units, 50 ms */
+#define INTERVAL_MAX	0x28	/* 40 units, 50 ms */
+
+#define IS_TESTER_ONLY	IS_ENABLED(CONFIG_BENCH_ROLE_TESTER)
+#define IS_PEER_ONLY	IS_ENABLED(CONFIG_BENCH_ROLE_PEER)
+
+static struct bt_conn *default_conn;
+static struct bt_gatt_throughput gatt_throughput;
+static struct bt_gatt_nus_c gatt_nus_c;
+static struct bt_gatt_exchange_params exchange_params;
+static struct bt_le_conn_param *conn_param =
+	BT_LE_CONN_PARAM(INTERVAL_MIN, INTERVAL_MAX, 0, 400);
+
+static const struct bt_data ad[] = {
+	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
+	BT_DATA_BYTES(BT_DATA_UUID128_ALL,
+		0xBB, 0x4A, 0xFF, 0x4F, 0xAD, 0x03, 0x41, 0x5D,
+		0xA9, 0x6C, 0x9D, 0x6C, 0xDD, 0xDA, 0x83, 0x04),
+};
+
+static const struct bt_data sd[] = {
+	BT_DATA(BT_DATA_NAME_COMPLETE, DEVICE_NAME, DEVICE_NAME_LEN),
+};
+
+static void scan_connecting_error(struct bt_scan_device_info *device_info)
+{
+	printk("Connecting failed\n");
+}
+
+BT_SCAN_CB_INIT(scan_cb, NULL, NULL, scan_connecting_error, NULL);
+
+static void exchange_func(struct bt_conn *conn, u8_t err,
+			  struct bt_gatt_exchange_params *params)
+{
+	printk("MTU exchange %s, MTU %u\n", err == 0 ? "successful" : "failed",
+	       bt_gatt_get_mtu(conn));
+
+	bench_runner_start(conn);
+}
+
+static void nus_discovery_complete(struct bt_gatt_dm *dm, void *context)
+{
+	struct bt_gatt_nus_c *nus_c = context;
+	int err;
+
+	printk("NUS discovery completed\n");
+
+	bt_gatt_nus_c_handles_assign(dm, nus_c);
+	bt_gatt_dm_data_release(dm);
+
+	err = bt_gatt_nus_c_tx_notif_enable(nus_c);
+	if (err) {
+		printk("NUS subscription failed (err %d)\n", err);
+	}
+}
+
+static void discovery_service_not_found(struct bt_conn *conn,
+					void *context)
+{
+	printk("Service not found\n");
+}
+
+static void discovery_error(struct bt_conn *conn,
+			    int err,
+			    void *context)
+{
+	printk("Error while discovering GATT database: (%d)\n", err);
+}
+
+static struct bt_gatt_dm_cb nus_discovery_cb = {
+	.completed         = nus_discovery_complete,
+	.service_not_found = discovery_service_not_found,
+	.error_found       = discovery_error,
+};
+
+static void peer_subscribe(struct bt_conn *conn)
+{
+	int err;
+
+	/* Tester sends notifications of both services to the peer. */
+	err = bt_gatt_throughput_subscribe(&gatt_throughput);
+	if (err) {
+		printk("Throughput subscription failed (err %d)\n", err);
+	}
+
+	err = bt_gatt_dm_start(conn, BT_UUID_NUS_SERVICE, &nus_discovery_cb,
+			       &gatt_nus_c);
+	if (err) {
+		printk("NUS discovery failed (err %d)\n", err);
+	}
+}
+
+static void discovery_complete(struct bt_gatt_dm *dm,
+			       void *context)
+{
+	struct bt_gatt_throughput *throughput = context;
+	struct bt_conn *conn = bt_gatt_dm_conn_get(dm);
+	struct bt_conn_info info = {0};
+	int err;
+
+	printk("Service discovery completed\n");
+
+	bt_gatt_throughput_handles_assign(dm, throughput);
+	bt_gatt_dm_data_release(dm);
+
+	err = bt_conn_get_info(conn, &info);
+	if (err) {
+		printk("Error %d while getting bt conn info\n", err);
+		return;
+	}
+
+	if (info.role != BT_CONN_ROLE_MASTER) {
+		peer_subscribe(conn);
+		return;
+	}
+
+	exchange_params.func = exchange_func;
+
+	err = bt_gatt_exchange_mtu(conn, &exchange_params);
+	if (err) {
+		printk("MTU exchange failed (err %d)\n", err);
+	} else {
+		printk("MTU exchange pending\n");
+	}
+}
+
+static struct bt_gatt_dm_cb discovery_cb = {
+	.completed         = discovery_complete,
+	.service_not_found = discovery_service_not_found,
+	.error_found       = discovery_error,
+};
+
+static void connected(struct bt_conn *conn, u8_t err)
+{
+	struct bt_conn_info info = {0};
+
+	if (err) {
+		printk("Connection failed (err %u)\n", err);
+		return;
+	}
+
+	default_conn = bt_conn_ref(conn);
+	err = bt_conn_get_info(default_conn, &info);
+	if (err) {
+		printk("Error %u while getting bt conn info\n", err);
+	}
+
+	printk("Connected as %s\n",
+	       info.role == BT_CONN_ROLE_MASTER ? "tester" : "peer");
+
+	/* make sure we're not scanning or advertising */
+	if (!IS_TESTER_ONLY) {
+		bt_le_adv_stop();
+	}
+	if (!IS_PEER_ONLY) {
+		bt_scan_stop();
+	}
+
+	/* Both devices are GATT clients of each other. */
+	err = bt_gatt_dm_start(default_conn, BT_UUID_THROUGHPUT,
+			       &discovery_cb, &gatt_throughput);
+	if (err) {
+		printk("Discover failed (err %d)\n", err);
+	}
+}
+
+static void scan_init(void)
+{
+	int err;
+	struct bt_le_scan_param scan_param = {
+	    .type = BT_HCI_LE_SCAN_PASSIVE,
+	    .filter_dup = BT_HCI_LE_SCAN_FILTER_DUP_ENABLE,
+	    .interval = 0x0010,
+	    .window = 0x0010,
+	};
+
+	struct bt_scan_init_param scan_init = {
+		.connect_if_match = 1,
+		.scan_param = &scan_param,
+		.conn_param = conn_param
+	};
+
+	bt_scan_init(&scan_init);
+	bt_scan_cb_register(&scan_cb);
+
+	err = bt_scan_filter_add(BT_SCAN_FILTER_TYPE_UUID, BT_UUID_THROUGHPUT);
+	if (err) {
+		printk("Scanning filters cannot be set\n");
+
+		return;
+	}
+
+	err = bt_scan_filter_enable(BT_SCAN_UUID_FILTER, false);
+	if (err) {
+		printk("Filters cannot be turned on\n");
+	}
+}
+
+static void advertise_and_scan(void)
+{
+	int err;
+
+	if (!IS_TESTER_ONLY) {
+		err = bt_le_adv_start(BT_LE_ADV_CONN, ad, ARRAY_SIZE(ad), sd,
+				      ARRAY_SIZE(sd));
+		if (err) {
+			printk("Advertising failed to start (err %d)\n", err);
+			return;
+		}
+
+		printk("Advertising successfully started\n");
+	}
+
+	if (!IS_PEER_ONLY) {
+		err = bt_scan_start(BT_SCAN_TYPE_SCAN_PASSIVE);
+		if (err) {
+			printk("Starting scanning failed (err %d)\n", err);
+			return;
+		}
+
+		printk("Scanning successfully started\n");
+	}
+}
+
+static void disconnected(struct bt_conn *conn, u8_t reason)
+{
+	printk("Disconnected (reason %u)\n", reason);
+
+	bench_runner_stop();
+
+	if (default_conn) {
+		bt_conn_unref(default_conn);
+		default_conn = NULL;
+	}
+
+	advertise_and_scan();
+}
+
+static bool le_param_req(struct bt_conn *conn, struct bt_le_conn_param *param)
+{
+	/* Connection parameters are controlled by the tester. */
+	return false;
+}
+
+static u8_t nus_data_received(const u8_t *data, u16_t len)
+{
+	return BT_GATT_ITER_CONTINUE;
+}
+
+static void bt_ready(int err)
+{
+	struct bt_gatt_nus_c_init_param nus_c_init = {
+		.cbs = {
+			.data_received = nus_data_received,
+		},
+	};
+
+	if (err) {
+		printk("Bluetooth init failed (err %d)\n", err);
+		return;
+	}
+
+	printk("Bluetooth initialized\n");
+
+	if (!IS_PEER_ONLY) {
+		scan_init();
+	}
+
+	err = bench_runner_init(&gatt_throughput);
+	if (!err) {
+		err = bt_gatt_nus_init(NULL);
+	}
+	if (!err) {
+		err = bt_gatt_nus_c_init(&gatt_nus_c, &nus_c_init);
+	}
+	if (err) {
+		printk("Services initialization failed (err %d)\n", err);
+		return;
+	}
+
+	advertise_and_scan();
+}
+
+void main(void)
+{
+	int err;
+
+	static struct bt_conn_cb conn_callbacks = {
+	    .connected = connected,
+	    .disconnected = disconnected,
+	    .le_param_req = le_param_req,
+	};
+
+	err = bt_enable(bt_ready);
+	if (err) {
+		printk("Bluetooth init failed (err %d)\n", err);
+		return;
+	}
+
+	bt_conn_cb_register(&conn_callbacks);
+
+	for (;;) {
+		bench_runner_run();
+	}
+}
@@ -0,0 +1,600 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <misc/printk.h>
+#include <misc/byteorder.h>
+#include <string.h>
+
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/conn.h>
+#include <bluetooth/gatt.h>
+#include <bluetooth/hci.h>
+#include <bluetooth/services/throughput.h>
+#include <bluetooth/services/nus.h>
+
+#ifdef CONFIG_TRACING_CPU_STATS
+#include <tracing_cpu_stats.h>
+#endif
+
+#include "bench.h"
+
+#define READ_TIMEOUT		K_SECONDS(5)
+#define SUBSCRIBE_TIMEOUT_MS	5000
+#define SUBSCRIBE_RETRY		K_MSEC(100)
+#define NOTIFY_RETRY		K_MSEC(1)
+#define SUPERVISION_TIMEOUT	400	/* 4 s */
+
+enum {
+	RUNNER_BUSY,
+	RUNNER_CONNECTED,
+	RUNNER_PROBING,
+	RUNNER_READ_PENDING,
+};
+
+BT_GATT_NUS_STREAM_DEFINE(nus_stream, CONFIG_BENCH_NUS_BUF_SIZE);
+
+static struct bt_gatt_throughput *peer;
+static struct bt_conn *start_conn;
+static atomic_t flags;
+
+static K_SEM_DEFINE(start_sem, 0, 1);
+static K_SEM_DEFINE(read_sem, 0, 1);
+static K_SEM_DEFINE(credits, CONFIG_BENCH_NOTIFY_CREDITS,
+		    CONFIG_BENCH_NOTIFY_CREDITS);
+
+static struct k_delayed_work probe_work;
+static struct bench_latency latency;
+static u32_t read_start;
+static struct bt_gatt_throughput_metrics peer_met;
+
+/* Link parameters currently requested on the connection. */
+static struct bench_run link;
+static bool link_valid;
+
+static u8_t payload[CONFIG_BT_L2CAP_TX_MTU];
+
+
+static u32_t cycles_to_us(u32_t cycles)
+{
+	return SYS_CLOCK_HW_CYCLES_TO_NS64(cycles) / NSEC_PER_USEC;
+}
+
+static bool is_connected(void)
+{
+	return atomic_test_bit(&flags, RUNNER_CONNECTED);
+}
+
+static u8_t data_read(const struct bt_gatt_throughput_metrics *met)
+{
+	u32_t rtt = cycles_to_us(k_cycle_get_32() - read_start);
+
+	if (atomic_test_bit(&flags, RUNNER_PROBING)) {
+		bench_latency_add(&latency, rtt);
+	}
+
+	peer_met = *met;
+	atomic_clear_bit(&flags, RUNNER_READ_PENDING);
+	k_sem_give(&read_sem);
+
+	return BT_GATT_ITER_STOP;
+}
+
+static const struct bt_gatt_throughput_cb throughput_cb = {
+	.data_read = data_read,
+};
+
+static int peer_read(void)
+{
+	if (atomic_test_and_set_bit(&flags, RUNNER_READ_PENDING)) {
+		return -EBUSY;
+	}
+
+	read_start = k_cycle_get_32();
+
+	int err = bt_gatt_throughput_read(peer);
+
+	if (err) {
+		atomic_clear_bit(&flags, RUNNER_READ_PENDING);
+	}
+
+	return err;
+}
+
+static void probe_work_fn(struct k_work *work)
+{
+	if (!atomic_test_bit(&flags, RUNNER_PROBING)) {
+		return;
+	}
+
+	/* Skip the probe if the previous one is not answered yet. */
+	(void)peer_read();
+
+	k_delayed_work_submit(&probe_work, CONFIG_BENCH_LATENCY_PROBE_MS);
+}
+
+static void probe_start(void)
+{
+	bench_latency_reset(&latency);
+	atomic_set_bit(&flags, RUNNER_PROBING);
+	k_delayed_work_submit(&probe_work, CONFIG_BENCH_LATENCY_PROBE_MS);
+}
+
+static void probe_stop(void)
+{
+	atomic_clear_bit(&flags, RUNNER_PROBING);
+	k_delayed_work_cancel(&probe_work);
+}
+
+static int peer_metrics_get(struct bt_gatt_throughput_metrics *met)
+{
+	/* Wait for the response to the last latency probe. */
+	while (atomic_test_bit(&flags, RUNNER_READ_PENDING)) {
+		if (!is_connected()) {
+			return -ENOTCONN;
+		}
+
+		if (k_sem_take(&read_sem, READ_TIMEOUT)) {
+			atomic_clear_bit(&flags, RUNNER_READ_PENDING);
+			return -ETIMEDOUT;
+		}
+	}
+
+	k_sem_reset(&read_sem);
+
+	int err = peer_read();
+
+	if (err) {
+		return err;
+	}
+
+	if (k_sem_take(&read_sem, READ_TIMEOUT)) {
+		atomic_clear_bit(&flags, RUNNER_READ_PENDING);
+		return -ETIMEDOUT;
+	}
+
+	*met = peer_met;
+
+	return 0;
+}
+
+static void cpu_load_reset(void)
+{
+#ifdef CONFIG_TRACING_CPU_STATS
+	cpu_stats_reset_counters();
+#endif
+}
+
+static s8_t cpu_load_get(void)
+{
+#ifdef CONFIG_TRACING_CPU_STATS
+	return cpu_stats_non_idle_and_sched_get_percent();
+#else
+	return -1;
+#endif
+}
+
+static int phy_set(struct bt_conn *conn, u8_t phy)
+{
+	struct bt_hci_cp_le_set_phy *cp;
+	struct net_buf *buf;
+	u16_t handle;
+	int err;
+
+	err = bt_hci_get_conn_handle(conn, &handle);
+	if (err) {
+		return err;
+	}
+
+	buf = bt_hci_cmd_create(BT_HCI_OP_LE_SET_PHY, sizeof(*cp));
+	if (!buf) {
+		return -ENOBUFS;
+	}
+
+	cp = net_buf_add(buf, sizeof(*cp));
+	cp->handle = sys_cpu_to_le16(handle);
+	cp->all_phys = 0;
+	cp->tx_phys = phy;
+	cp->rx_phys = phy;
+	cp->phy_opts = 0;
+
+	return bt_hci_cmd_send_sync(BT_HCI_OP_LE_SET_PHY, buf, NULL);
+}
+
+static int data_len_set(struct bt_conn *conn, u16_t data_len)
+{
+	struct bt_hci_cp_le_set_data_len *cp;
+	struct net_buf *buf;
+	u16_t handle;
+	int err;
+
+	err = bt_hci_get_conn_handle(conn, &handle);
+	if (err) {
+		return err;
+	}
+
+	buf = bt_hci_cmd_create(BT_HCI_OP_LE_SET_DATA_LEN, sizeof(*cp));
+	if (!buf) {
+		return -ENOBUFS;
+	}
+
+	/* Transmission time of the packet on 1M PHY, in microseconds. */
+	cp = net_buf_add(buf, sizeof(*cp));
+	cp->handle = sys_cpu_to_le16(handle);
+	cp->tx_octets = sys_cpu_to_le16(data_len);
+	cp->tx_time = sys_cpu_to_le16((data_len + 14) * 8);
+
+	return bt_hci_cmd_send_sync(BT_HCI_OP_LE_SET_DATA_LEN, buf, NULL);
+}
+
+static int link_configure(struct bt_conn *conn, const struct bench_run *run)
+{
+	int err;
+
+	if (!link_valid || (link.interval != run->interval)) {
+		err = bt_conn_le_param_update(conn,
+				BT_LE_CONN_PARAM(run->interval, run->interval,
+						 0, SUPERVISION_TIMEOUT));
+		if (err && (err != -EALREADY)) {
+			return err;
+		}
+		k_sleep(CONFIG_BENCH_SETTLE_MS);
+	}
+
+	if (!link_valid || (link.phy != run->phy)) {
+		err = phy_set(conn, run->phy);
+		if (err) {
+			return err;
+		}
+		k_sleep(CONFIG_BENCH_SETTLE_MS);
+	}
+
+	if (!link_valid || (link.data_len != run->data_len)) {
+		err = data_len_set(conn, run->data_len);
+		if (err) {
+			return err;
+		}
+		k_sleep(CONFIG_BENCH_SETTLE_MS);
+	}
+
+	link = *run;
+	link_valid = true;
+
+	return 0;
+}
+
+static bool run_timeout(u32_t start)
+{
+	return (k_uptime_get_32() - start) > CONFIG_BENCH_RUN_TIMEOUT_MS;
+}
+
+static int write_transfer(u16_t len, u32_t *sent)
+{
+	u32_t start = k_uptime_get_32();
+	int err;
+
+	/* Reset peer metrics. */
+	err = bt_gatt_throughput_write(peer, payload, 1);
+
+	while (!err && (*sent < CONFIG_BENCH_RUN_BYTES)) {
+		if (!is_connected()) {
+			return -ENOTCONN;
+		}
+
+		if (run_timeout(start)) {
+			return -ETIMEDOUT;
+		}
+
+		/* Write without response blocks until the stack has a free
+		 * buffer, so the number of writes in flight is limited by
+		 * the stack.
+		 */
+		err = bt_gatt_throughput_write(peer, payload, len);
+		if (!err) {
+			*sent += len;
+		}
+	}
+
+	return err;
+}
+
+static void notify_sent(struct bt_conn *conn, void *user_data)
+{
+	k_sem_give(&credits);
+}
+
+static int notify_send(struct bt_conn *conn, u16_t len)
+{
+	int err;
+
+	if (k_sem_take(&credits, CONFIG_BENCH_RUN_TIMEOUT_MS)) {
+		return -ETIMEDOUT;
+	}
+
+	do {
+		err = bt_gatt_throughput_notify(conn, payload, len,
+						notify_sent, NULL);
+		if (err == -ENOMEM) {
+			/* Credits are not returned before the notifications
+			 * leave the host, wait for the buffers.
+			 */
+			k_sleep(NOTIFY_RETRY);
+		}
+	} while ((err == -ENOMEM) && is_connected());
+
+	if (err) {
+		k_sem_give(&credits);
+	}
+
+	return err;
+}
+
+static int notify_flush(void)
+{
+	size_t taken;
+	int err = 0;
+
+	for (taken = 0; taken < CONFIG_BENCH_NOTIFY_CREDITS; taken++) {
+		if (k_sem_take(&credits, CONFIG_BENCH_RUN_TIMEOUT_MS)) {
+			err = -ETIMEDOUT;
+			break;
+		}
+	}
+
+	while (taken > 0) {
+		k_sem_give(&credits);
+		taken--;
+	}
+
+	return err;
+}
+
+static int notify_transfer(struct bt_conn *conn, u16_t len, u32_t *sent)
+{
+	u32_t start = k_uptime_get_32();
+	int err;
+
+	/* Reset peer metrics. The peer may still be subscribing. */
+	while ((err = notify_send(conn, 1)) == -EINVAL) {
+		if (k_uptime_get_32() - start > SUBSCRIBE_TIMEOUT_MS) {
+			return err;
+		}
+		k_sleep(SUBSCRIBE_RETRY);
+	}
+
+	while (!err && (*sent < CONFIG_BENCH_RUN_BYTES)) {
+		if (run_timeout(start)) {
+			return -ETIMEDOUT;
+		}
+
+		err = notify_send(conn, len);
+		if (!err) {
+			*sent += len;
+		}
+	}
+
+	if (!err) {
+		err = notify_flush();
+	}
+
+	return err;
+}
+
+static int nus_transfer(u16_t len, u32_t *sent)
+{
+	u32_t start = k_uptime_get_32();
+
+	while (*sent < CONFIG_BENCH_RUN_BYTES) {
+		int ret = bt_gatt_nus_stream_write(&nus_stream, payload, len,
+						   CONFIG_BENCH_RUN_TIMEOUT_MS);
+
+		if ((ret == -EINVAL) && (*sent == 0) &&
+		    (k_uptime_get_32() - start < SUBSCRIBE_TIMEOUT_MS)) {
+			/* The peer is still subscribing. */
+			k_sleep(SUBSCRIBE_RETRY);
+			continue;
+		}
+
+		if (ret < 0) {
+			return ret;
+		}
+
+		if ((ret == 0) || run_timeout(start)) {
+			return -ETIMEDOUT;
+		}
+
+		*sent += ret;
+	}
+
+	return bt_gatt_nus_stream_flush(&nus_stream,
+					CONFIG_BENCH_RUN_TIMEOUT_MS);
+}
+
+static void run_execute(struct bt_conn *conn, const struct bench_run *run,
+			struct bench_result *res)
+{
+	struct bt_gatt_nus_stream_stats nus_start;
+	struct bt_gatt_nus_stream_stats nus_end;
+	struct bt_conn_info info = {0};
+	u16_t len;
+	u32_t sent = 0;
+	u32_t start;
+	int err;
+
+	memset(res, 0, sizeof(*res));
+	res->cpu_load = -1;
+	bench_latency_reset(&res->lat);
+
+	err = link_configure(conn, run);
+	if (!err) {
+		err = bt_conn_get_info(conn, &info);
+	}
+
+	if (err) {
+		res->err = err;
+		return;
+	}
+
+	res->interval_us = info.le.interval * 1250;
+
+	if (run->mode == BENCH_MODE_NUS) {
+		res->mtu = bt_gatt_get_mtu(conn);
+		len = sizeof(payload);
+	} else {
+		res->mtu = MIN(run->mtu, bt_gatt_get_mtu(conn));
+		len = res->mtu - 3;
+	}
+
+	bt_gatt_nus_stream_stats_get(&nus_stream, &nus_start);
+	cpu_load_reset();
+	probe_start();
+	start = k_uptime_get_32();
+
+	switch (run->mode) {
+	case BENCH_MODE_WRITE:
+		err = write_transfer(len, &sent);
+		break;
+
+	case BENCH_MODE_NOTIFY:
+		err = notify_transfer(conn, len, &sent);
+		break;
+
+	case BENCH_MODE_NUS:
+		err = nus_transfer(len, &sent);
+		break;
+
+	default:
+		err = -ENOTSUP;
+		break;
+	}
+
+	res->time_ms = k_uptime_get_32() - start;
+	probe_stop();
+	res->cpu_load = cpu_load_get();
+	res->lat = latency;
+
+	if (err) {
+		res->err = err;
+		return;
+	}
+
+	if (run->mode == BENCH_MODE_NUS) {
+		/* The peer does not count NUS data, sent notifications are
+		 * already acknowledged by the link layer.
+		 */
+		bt_gatt_nus_stream_stats_get(&nus_stream, &nus_end);
+		res->bytes = nus_end.tx_bytes - nus_start.tx_bytes;
+		res->rate = res->time_ms ?
+			((u64_t)res->bytes * 8 * MSEC_PER_SEC) / res->time_ms :
+			0;
+	} else {
+		struct bt_gatt_throughput_metrics met;
+
+		/* The response is sent by the peer after all data sent
+		 * before the request is processed.
+		 */
+		err = peer_metrics_get(&met);
+		if (err) {
+			res->err = err;
+			return;
+		}
+
+		res->bytes = met.write_len;
+		res->rate = met.write_rate;
+	}
+
+	if (res->bytes != sent) {
+		res->err = -EIO;
+	}
+}
+
+int bench_runner_init(struct bt_gatt_throughput *throughput)
+{
+	int err;
+
+	peer = throughput;
+	memset(payload, 0xAA, sizeof(payload));
+	k_delayed_work_init(&probe_work, probe_work_fn);
+
+	err = bt_gatt_throughput_init(throughput, &throughput_cb);
+	if (err) {
+		return err;
+	}
+
+	return bt_gatt_nus_stream_init(&nus_stream, NULL);
+}
+
+void bench_runner_start(struct bt_conn *conn)
+{
+	if (atomic_test_and_set_bit(&flags, RUNNER_BUSY)) {
+		printk("Benchmark is already running\n");
+		return;
+	}
+
+	start_conn = bt_conn_ref(conn);
+	atomic_set_bit(&flags, RUNNER_CONNECTED);
+
+	int err = bt_gatt_nus_stream_start(&nus_stream, conn);
+
+	if (err) {
+		printk("NUS stream start failed (err %d)\n", err);
+	}
+
+	k_sem_give(&start_sem);
+}
+
+void bench_runner_stop(void)
+{
+	atomic_clear_bit(&flags, RUNNER_CONNECTED);
+	bt_gatt_nus_stream_stop(&nus_stream);
+
+	/* Unblock waiting for notification credits and read responses. */
+	for (size_t i = 0; i < CONFIG_BENCH_NOTIFY_CREDITS; i++) {
+		if (k_sem_count_get(&credits) < CONFIG_BENCH_NOTIFY_CREDITS) {
+			k_sem_give(&credits);
+		}
+	}
+	k_sem_give(&read_sem);
+}
+
+void bench_runner_run(void)
+{
+	struct bench_run run;
+	struct bench_result res;
+	size_t run_cnt = 0;
+	size_t fail_cnt = 0;
+
+	k_sem_take(&start_sem, K_FOREVER);
+
+	struct bt_conn *conn = start_conn;
+
+	link_valid = false;
+	k_sem_reset(&credits);
+	for (size_t i = 0; i < CONFIG_BENCH_NOTIFY_CREDITS; i++) {
+		k_sem_give(&credits);
+	}
+
+	printk("Running %u benchmark runs\n",
+	       (unsigned int)bench_run_count());
+	bench_header_print();
+
+	while (bench_run_get(run_cnt, &run) && is_connected()) {
+		run_execute(conn, &run, &res);
+		bench_result_print(run_cnt, &run, &res);
+
+		if (res.err) {
+			fail_cnt++;
+		}
+		run_cnt++;
+	}
+
+	/* Runs not done because of disconnection are failed. */
+	fail_cnt += bench_run_count() - run_cnt;
+	bench_summary_print(run_cnt, fail_cnt);
+
+	bt_conn_unref(conn);
+	atomic_clear_bit(&flags, RUNNER_BUSY);
+}
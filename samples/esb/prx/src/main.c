@@ -18,6 +18,7 @@ LOG_MODULE_REGISTER(esb_prx);
 #define LED_OFF 1
 
 static struct device *led_port;
+static u32_t rx_bytes;
 static struct nrf_esb_payload rx_payload;
 static struct nrf_esb_payload tx_payload = NRF_ESB_CREATE_PAYLOAD(0,
 	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17);
@@ -73,7 +74,14 @@ void esb_event_handler(struct nrf_esb_evt const *event)
 		LOG_DBG("TX FAILED EVENT");
 		break;
 	case NRF_ESB_EVENT_RX_RECEIVED:
-		if (nrf_esb_read_rx_payload(&rx_payload) == 0) {
+		if (IS_ENABLED(CONFIG_ESB_THROUGHPUT_MODE)) {
+			struct nrf_esb_payload *payload;
+
+			while (nrf_esb_acquire_rx_payload(&payload) == 0) {
+				rx_bytes += payload->length;
+				nrf_esb_release_rx_payload();
+			}
+		} else if (nrf_esb_read_rx_payload(&rx_payload) == 0) {
 			LOG_DBG("Packet received, len %d : "
 				"0x%02x, 0x%02x, 0x%02x, 0x%02x, "
 				"0x%02x, 0x%02x, 0x%02x, 0x%02x",
@@ -129,6 +137,7 @@ int esb_init(void)
 	config.mode = NRF_ESB_MODE_PRX;
 	config.event_handler = esb_event_handler;
 	config.selective_auto_ack = true;
+	config.ack_aggregation = IS_ENABLED(CONFIG_ESB_ACK_AGGREGATION);
 
 	err = nrf_esb_init(&config);
 	if (err) {
@@ -153,6 +162,35 @@ int esb_init(void)
 	return 0;
 }
 
+static void throughput_run(void)
+{
+	u32_t start = k_uptime_get_32();
+
+	while (1) {
+		struct nrf_esb_payload *payload;
+
+		/* Keep ACK payloads queued. */
+		while (nrf_esb_reserve_payload(&payload) == 0) {
+			*payload = tx_payload;
+
+			if (nrf_esb_commit_payload()) {
+				break;
+			}
+		}
+
+		u32_t elapsed = k_uptime_get_32() - start;
+
+		if (elapsed >= MSEC_PER_SEC) {
+			LOG_INF("RX %u kbps", rx_bytes * 8 / elapsed);
+
+			start += elapsed;
+			rx_bytes = 0;
+		}
+
+		k_sleep(1);
+	}
+}
+
 void main(void)
 {
 	int err;
@@ -188,6 +226,10 @@ void main(void)
 		return;
 	}
 
+	if (IS_ENABLED(CONFIG_ESB_THROUGHPUT_MODE)) {
+		throughput_run();
+	}
+
 	while (1) {
 		/* do nothing */
 	}
@@ -18,6 +18,8 @@ LOG_MODULE_REGISTER(esb_ptx);
 #define LED_OFF 1
 
 static bool ready = true;
+static u32_t rx_bytes;
+static u32_t tx_failed_cnt;
 static struct device *led_port;
 static struct nrf_esb_payload rx_payload;
 static struct nrf_esb_payload tx_payload = NRF_ESB_CREATE_PAYLOAD(0,
@@ -38,8 +40,17 @@ void esb_event_handler(struct nrf_esb_evt const *event)
 		break;
 	case NRF_ESB_EVENT_TX_FAILED:
 		LOG_DBG("TX FAILED EVENT");
+		if (IS_ENABLED(CONFIG_ESB_THROUGHPUT_MODE)) {
+			/* Drop the packet, main loop restarts the transfer. */
+			tx_failed_cnt++;
+			nrf_esb_pop_tx();
+		}
 		break;
 	case NRF_ESB_EVENT_RX_RECEIVED:
+		while (IS_ENABLED(CONFIG_ESB_THROUGHPUT_MODE) &&
+		       (nrf_esb_read_rx_payload(&rx_payload) == 0)) {
+			rx_bytes += rx_payload.length;
+		}
 		while (nrf_esb_read_rx_payload(&rx_payload) == 0) {
 			LOG_DBG("Packet received, len %d : "
 				"0x%02x, 0x%02x, 0x%02x, 0x%02x, "
@@ -93,6 +104,8 @@ int esb_init(void)
 	config.event_handler = esb_event_handler;
 	config.mode = NRF_ESB_MODE_PTX;
 	config.selective_auto_ack = true;
+	config.burst_length = CONFIG_ESB_BURST_LENGTH;
+	config.ack_aggregation = IS_ENABLED(CONFIG_ESB_ACK_AGGREGATION);
 
 	err = nrf_esb_init(&config);
 
@@ -159,6 +172,48 @@ static void leds_update(u8_t value)
 	}
 }
 
+static void throughput_run(void)
+{
+	u32_t start = k_uptime_get_32();
+	u32_t tx_bytes = 0;
+	u8_t seq = 0;
+
+	while (1) {
+		struct nrf_esb_payload *payload;
+
+		while (nrf_esb_reserve_payload(&payload) == 0) {
+			u8_t length = CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH;
+
+			payload->pipe = 0;
+			payload->noack = false;
+			payload->length = length;
+			payload->data[0] = seq;
+
+			if (nrf_esb_commit_payload()) {
+				break;
+			}
+
+			seq++;
+			tx_bytes += length;
+		}
+
+		u32_t elapsed = k_uptime_get_32() - start;
+
+		if (elapsed >= MSEC_PER_SEC) {
+			LOG_INF("TX %u kbps, ACK payload %u kbps, failed %u",
+				tx_bytes * 8 / elapsed, rx_bytes * 8 / elapsed,
+				tx_failed_cnt);
+
+			start += elapsed;
+			tx_bytes = 0;
+			rx_bytes = 0;
+			tx_failed_cnt = 0;
+		}
+
+		k_sleep(1);
+	}
+}
+
 void main(void)
 {
 	int err;
@@ -179,6 +234,12 @@ void main(void)
 	}
 
 	LOG_INF("Initialization complete");
+
+	if (IS_ENABLED(CONFIG_ESB_THROUGHPUT_MODE)) {
+		LOG_INF("Measuring throughput");
+		throughput_run();
+	}
+
 	LOG_INF("Sending test packet");
 
 	tx_payload.noack = false;
@@ -0,0 +1,320 @@
+#
+# Copyright (c) 2019 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+
+"""Local MQTT broker standing in for the Bifravst cloud.
+
+Measures what a connection of the bifravst_cloud library costs: the MQTT
+bytes sent and received until the client is subscribed, and the time until
+CONNACK. Sessions of clients that connect without the clean session flag
+are kept, so reconnects with BIFRAVST_CLOUD_PERSISTENT_SESSION can be
+compared against reconnects with a clean session.
+
+Serve a device, which must be built with BIFRAVST_CLOUD_HOST_NAME pointing
+to this host and have the certificate provisioned in its security tag:
+
+    broker_standin.py serve --cert cert.pem --key key.pem
+
+Replay the packets of the library over loopback, without a device:
+
+    broker_standin.py replay --reconnects 10 --delay 100
+
+The delay is added before every packet sent by the broker, to stand in for
+the round trip time of the cellular link. Bytes are counted at the MQTT
+layer, TLS records and the DNS lookup are not included.
+"""
+
+import argparse
+import socket
+import ssl
+import struct
+import threading
+import time
+
+
+CONNECT = 1
+CONNACK = 2
+PUBLISH = 3
+PUBACK = 4
+SUBSCRIBE = 8
+SUBACK = 9
+PINGREQ = 12
+PINGRESP = 13
+DISCONNECT = 14
+
+# Values used by bifravst_cloud.c.
+IMEI = '352656100000000'
+KEEPALIVE = 60
+SUBSCRIBE_ID = 1234
+SUBSCRIBE_TOPICS = ('$aws/things/{}/shadow/get/accepted/desired/cfg',
+                    '$aws/things/{}/shadow/get/rejected',
+                    '$aws/things/{}/shadow/update/delta')
+
+
+def encode_length(length):
+    """Encode the remaining length of a packet."""
+    out = bytearray()
+    while True:
+        byte = length % 128
+        length //= 128
+        out.append(byte | (0x80 if length else 0))
+        if not length:
+            return bytes(out)
+
+
+def encode_string(value):
+    data = value.encode()
+    return struct.pack('>H', len(data)) + data
+
+
+def packet(packet_type, flags, body):
+    return bytes([(packet_type << 4) | flags]) + encode_length(len(body)) + \
+        body
+
+
+def recv_exact(sock, length):
+    data = bytearray()
+    while len(data) < length:
+        chunk = sock.recv(length - len(data))
+        if not chunk:
+            raise ConnectionError('Connection closed')
+        data += chunk
+    return bytes(data)
+
+
+def recv_packet(sock):
+    """Receive a packet, return its type, flags, body and total size."""
+    header = recv_exact(sock, 1)[0]
+    length = 0
+    size = 1
+    for shift in range(0, 28, 7):
+        byte = recv_exact(sock, 1)[0]
+        size += 1
+        length |= (byte & 0x7f) << shift
+        if not byte & 0x80:
+            break
+    body = recv_exact(sock, length)
+    return header >> 4, header & 0x0f, body, size + length
+
+
+class Broker:
+    """Minimal MQTT 3.1.1 broker keeping subscriptions of persistent
+    sessions."""
+
+    def __init__(self, delay, context=None):
+        self.delay = delay
+        self.context = context
+        self.sessions = {}
+        self.lock = threading.Lock()
+
+    def send(self, sock, stats, data):
+        time.sleep(self.delay)
+        sock.sendall(data)
+        stats['tx'] += len(data)
+
+    def connect(self, sock, stats, body):
+        name_len = struct.unpack('>H', body[:2])[0]
+        flags = body[2 + name_len + 1]
+        id_len = struct.unpack('>H', body[2 + name_len + 4:
+                                          2 + name_len + 6])[0]
+        offset = 2 + name_len + 6
+        client_id = body[offset:offset + id_len].decode()
+        clean = bool(flags & 0x02)
+
+        with self.lock:
+            if clean:
+                self.sessions.pop(client_id, None)
+                present = False
+            else:
+                present = client_id in self.sessions
+                self.sessions.setdefault(client_id, set())
+
+        stats.update(client=client_id, clean=clean, present=present)
+        self.send(sock, stats, packet(CONNACK, 0,
+                                      bytes([int(present), 0])))
+        stats['connack_ms'] = (time.monotonic() - stats['start']) * 1000
+        return client_id, clean
+
+    def subscribe(self, sock, stats, client_id, clean, body):
+        msg_id = body[:2]
+        offset = 2
+        codes = bytearray()
+        while offset < len(body):
+            length = struct.unpack('>H', body[offset:offset + 2])[0]
+            topic = body[offset + 2:offset + 2 + length].decode()
+            qos = body[offset + 2 + length]
+            offset += 3 + length
+            codes.append(min(qos, 1))
+            if not clean:
+                with self.lock:
+                    self.sessions[client_id].add(topic)
+        stats['subscribe'] += 1
+        self.send(sock, stats, packet(SUBACK, 0, msg_id + bytes(codes)))
+        stats['ready_ms'] = (time.monotonic() - stats['start']) * 1000
+
+    def handle(self, sock):
+        """Serve one connection and return its statistics."""
+        stats = {'start': time.monotonic(), 'rx': 0, 'tx': 0,
+                 'subscribe': 0, 'client': None}
+        client_id = None
+        clean = True
+
+        try:
+            if self.context:
+                sock = self.context.wrap_socket(sock, server_side=True)
+            while True:
+                packet_type, flags, body, size = recv_packet(sock)
+                stats['rx'] += size
+                if packet_type == CONNECT:
+                    client_id, clean = self.connect(sock, stats, body)
+                    stats['ready_ms'] = stats['connack_ms']
+                elif packet_type == SUBSCRIBE:
+                    self.subscribe(sock, stats, client_id, clean, body)
+                elif packet_type == PUBLISH and flags & 0x06:
+                    topic_len = struct.unpack('>H', body[:2])[0]
+                    self.send(sock, stats,
+                              packet(PUBACK, 0,
+                                     body[2 + topic_len:4 + topic_len]))
+                elif packet_type == PINGREQ:
+                    self.send(sock, stats, packet(PINGRESP, 0, b''))
+                elif packet_type == DISCONNECT:
+                    break
+        except (ConnectionError, ssl.SSLError, OSError):
+            pass
+        finally:
+            sock.close()
+
+        return stats
+
+    def serve(self, listener, count=None):
+        """Accept connections and report each of them."""
+        served = 0
+        while count is None or served < count:
+            sock, addr = listener.accept()
+            stats = self.handle(sock)
+            served += 1
+            if stats['client'] is None:
+                print('{}: no CONNECT'.format(addr[0]))
+                continue
+            print('{}: client {}, clean session {:d}, session present {:d}, '
+                  'CONNACK {:.0f} ms, subscribed {:.0f} ms, {} SUBSCRIBE, '
+                  '{} bytes from client, {} bytes to client'.format(
+                      addr[0], stats['client'], stats['clean'],
+                      stats['present'], stats['connack_ms'],
+                      stats['ready_ms'], stats['subscribe'], stats['rx'],
+                      stats['tx']), flush=True)
+
+
+def client_connect(port, clean):
+    """Connect as bifravst_cloud does and return the bytes sent and
+    received and the times to CONNACK and to being subscribed."""
+    start = time.monotonic()
+    sock = socket.create_connection(('127.0.0.1', port))
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    tx = 0
+    rx = 0
+
+    body = encode_string('MQTT') + bytes([4, 0x02 if clean else 0]) + \
+        struct.pack('>H', KEEPALIVE) + encode_string(IMEI)
+    data = packet(CONNECT, 0, body)
+    sock.sendall(data)
+    tx += len(data)
+
+    packet_type, _, body, size = recv_packet(sock)
+    rx += size
+    connack_ms = (time.monotonic() - start) * 1000
+    present = bool(body[0] & 0x01)
+
+    # The library subscribes unless the persistent session was kept.
+    if clean or not present:
+        body = struct.pack('>H', SUBSCRIBE_ID)
+        for topic in SUBSCRIBE_TOPICS:
+            body += encode_string(topic.format(IMEI)) + bytes([1])
+        data = packet(SUBSCRIBE, 0x02, body)
+        sock.sendall(data)
+        tx += len(data)
+        packet_type, _, body, size = recv_packet(sock)
+        rx += size
+
+    ready_ms = (time.monotonic() - start) * 1000
+
+    data = packet(DISCONNECT, 0, b'')
+    sock.sendall(data)
+    tx += len(data)
+    sock.close()
+
+    return tx, rx, connack_ms, ready_ms
+
+
+def replay(args):
+    """Compare reconnects with clean and persistent sessions."""
+    broker = Broker(args.delay / 1000)
+    listener = socket.socket()
+    listener.bind(('127.0.0.1', 0))
+    listener.listen(1)
+    port = listener.getsockname()[1]
+    connections = 2 * (args.reconnects + 1)
+    thread = threading.Thread(target=broker.serve,
+                              args=(listener, connections), daemon=True)
+    thread.start()
+
+    print('Broker delay {} ms, {} reconnects after the first connection'
+          .format(args.delay, args.reconnects))
+    for clean in (True, False):
+        results = [client_connect(port, clean)
+                   for _ in range(args.reconnects + 1)]
+        first = results[0]
+        rest = results[1:]
+        print('{} session:'.format('Clean' if clean else 'Persistent'))
+        print('  first:     {:4d} bytes, CONNACK {:5.0f} ms, subscribed '
+              '{:5.0f} ms'.format(first[0] + first[1], first[2], first[3]))
+        if rest:
+            print('  reconnect: {:4.0f} bytes, CONNACK {:5.0f} ms, '
+                  'subscribed {:5.0f} ms'.format(
+                      sum(r[0] + r[1] for r in rest) / len(rest),
+                      sum(r[2] for r in rest) / len(rest),
+                      sum(r[3] for r in rest) / len(rest)))
+
+    thread.join()
+    listener.close()
+
+
+def serve(args):
+    context = None
+    if args.cert:
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(args.cert, args.key)
+    broker = Broker(args.delay / 1000, context)
+    listener = socket.socket()
+    listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    listener.bind(('', args.port))
+    listener.listen(1)
+    print('Listening on port {}'.format(args.port), flush=True)
+    broker.serve(listener)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--delay', type=float, default=0,
+                        help='Delay before each broker packet (ms)')
+    commands = parser.add_subparsers(dest='command')
+    commands.required = True
+
+    serve_parser = commands.add_parser('serve', help='Serve a device')
+    serve_parser.add_argument('--port', type=int, default=8883)
+    serve_parser.add_argument('--cert', help='Server certificate (PEM)')
+    serve_parser.add_argument('--key', help='Server key (PEM)')
+    serve_parser.set_defaults(func=serve)
+
+    replay_parser = commands.add_parser(
+        'replay', help='Replay the library connection over loopback')
+    replay_parser.add_argument('--reconnects', type=int, default=10)
+    replay_parser.set_defaults(func=replay)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()
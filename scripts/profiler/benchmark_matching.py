@@ -0,0 +1,90 @@
+#
+# Copyright (c) 2019 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+
+from events import Event
+from processed_events import EventMatcher
+
+from itertools import islice
+import argparse
+import random
+import time
+
+
+CHUNK_SIZE = 1000000
+EVENT_TYPES_CNT = 8
+PROC_START_ID = EVENT_TYPES_CNT
+PROC_END_ID = EVENT_TYPES_CNT + 1
+
+
+def generate_events(events_cnt, max_queue_len, seed):
+    """Generate a synthetic capture of submissions and event processing.
+
+    Every submitted event is followed (possibly after other submissions) by
+    processing start and end with the same memory address. Addresses are
+    reused after the event is processed, as on the device.
+    """
+    rnd = random.Random(seed)
+    free_addresses = list(range(0x20000000,
+                                0x20000000 + 16 * max_queue_len, 16))
+    queue = []
+    timestamp = 0.0
+    generated = 0
+
+    while generated + 3 <= events_cnt:
+        timestamp += 0.00001
+        if queue and (len(queue) == max_queue_len or rnd.random() < 0.5):
+            mem_address = queue.pop(0)
+            yield Event(PROC_START_ID, timestamp, [mem_address])
+            timestamp += 0.00001
+            yield Event(PROC_END_ID, timestamp, [mem_address])
+            free_addresses.append(mem_address)
+            generated += 2
+        else:
+            mem_address = free_addresses.pop()
+            queue.append(mem_address)
+            yield Event(rnd.randrange(EVENT_TYPES_CNT), timestamp,
+                        [mem_address])
+            generated += 1
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Benchmark of matching event submissions and processing.')
+    parser.add_argument('--events', type=int, default=10000000,
+                        help='Number of generated events')
+    parser.add_argument('--queue', type=int, default=32,
+                        help='Maximum number of events waiting in queue')
+    parser.add_argument('--seed', type=int, default=0,
+                        help='Random generator seed')
+    args = parser.parse_args()
+
+    generator = generate_events(args.events, args.queue, args.seed)
+    matcher = EventMatcher(PROC_START_ID, PROC_END_ID)
+    feed = matcher.feed
+    events_cnt = 0
+    tracked_cnt = 0
+    duration = 0
+
+    # Events are generated in chunks to keep memory usage bounded. Only
+    # matching is measured.
+    while True:
+        events = list(islice(generator, CHUNK_SIZE))
+        if not events:
+            break
+
+        start = time.perf_counter()
+        for ev in events:
+            if feed(ev) is not None:
+                tracked_cnt += 1
+        duration += time.perf_counter() - start
+        events_cnt += len(events)
+
+    print("Matched {} of {} events in {:.2f}s ({:.0f} events/s)".format(
+          tracked_cnt, events_cnt, duration, events_cnt / duration))
+    print("Max queue depth: {}".format(max(matcher.queue_depth_values)))
+
+
+if __name__ == "__main__":
+    main()
@@ -4,9 +4,70 @@
 # SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
 
 from events import EventsData, TrackedEvent
+from array import array
 import logging
 import sys
 
+
+class EventMatcher():
+    """Streaming matcher of event submissions and event processing.
+
+    Events are fed one by one in the order they were received. Submitted
+    events are kept in a dictionary keyed by memory address until processing
+    of the event starts, so every event is matched in constant time.
+    """
+    def __init__(self, event_processing_start_id, event_processing_end_id):
+        self.event_processing_start_id = event_processing_start_id
+        self.event_processing_end_id = event_processing_end_id
+
+        # memory address -> last event submitted at this address
+        self.submitted = {}
+        # memory address -> (submit event, processing start timestamp)
+        self.in_progress = {}
+
+        self.queue_depth = 0
+        self.queue_depth_times = array('d')
+        self.queue_depth_values = array('l')
+
+    def _record_queue_depth(self, timestamp):
+        self.queue_depth_times.append(timestamp)
+        self.queue_depth_values.append(self.queue_depth)
+
+    def feed(self, event):
+        """Process single event.
+
+        Returns TrackedEvent when processing of the event ends, None
+        otherwise.
+        """
+        if not event.data:
+            return None
+
+        # comparing memory addresses of event submit, processing start and
+        # processing end to identify matching events
+        mem_address = event.data[0]
+
+        if event.type_id == self.event_processing_start_id:
+            submit_event = self.submitted.pop(mem_address, None)
+            if submit_event is not None:
+                self.in_progress[mem_address] = (submit_event,
+                                                 event.timestamp)
+                self.queue_depth -= 1
+                self._record_queue_depth(event.timestamp)
+            return None
+
+        if event.type_id == self.event_processing_end_id:
+            started = self.in_progress.pop(mem_address, None)
+            if started is None:
+                return None
+            return TrackedEvent(started[0], started[1], event.timestamp)
+
+        if mem_address not in self.submitted:
+            self.queue_depth += 1
+            self._record_queue_depth(event.timestamp)
+        self.submitted[mem_address] = event
+        return None
+
+
 class ProcessedEvents():
     def __init__(self):
         self.raw_data = EventsData([], {})
@@ -19,6 +80,8 @@ class ProcessedEvents():
         self.submit_event = None
         self.start_event = None
 
+        self.matcher = None
+
         self.logger = logging.getLogger('Processed Events')
         self.logger_console = logging.StreamHandler()
         self.logger.setLevel(logging.WARNING)
@@ -40,24 +103,12 @@ class ProcessedEvents():
                 self.tracked_events.append(TrackedEvent(ev, None, None))
             return
 
-        for i in range(1, len(self.raw_data.events)):
-            if self.raw_data.events[i].type_id == self.event_processing_start_id:
-                self.start_event = self.raw_data.events[i]
-                for j in range(i - 1, -1, -1):
-                    # comparing memory addresses of event processing start
-                    # and event submit to identify matching events
-                    if self.raw_data.events[j].data[0] == self.start_event.data[0]:
-                        self.submit_event = self.raw_data.events[j]
-                        break
-
-            # comparing memory addresses of event processing start and end
-            # to identify matching events
-            if self.raw_data.events[i].type_id == self.event_processing_end_id:
-                if self.submit_event is not None \
-                        and self.raw_data.events[i].data[0] == self.start_event.data[0]:
-                    self.tracked_events.append(
-                        TrackedEvent(
-                            self.submit_event,
-                            self.start_event.timestamp,
-                            self.raw_data.events[i].timestamp))
-                    self.submit_event = None
+        self.matcher = EventMatcher(self.event_processing_start_id,
+                                    self.event_processing_end_id)
+        feed = self.matcher.feed
+        append = self.tracked_events.append
+
+        for ev in self.raw_data.events:
+            tracked = feed(ev)
+            if tracked is not None:
+                append(tracked)
@@ -0,0 +1,181 @@
+#
+# Copyright (c) 2019 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+
+from events import EventsData
+from rtt_nordic_config import RttNordicConfig
+from bisect import bisect_right
+from collections import Counter
+import argparse
+import logging
+import subprocess
+
+
+LISTENER_SYMBOL_PREFIX = '__event_listener_'
+# Program counter of samples that interrupted another interrupt handler.
+PC_NESTED_INTERRUPT = 0
+
+
+class SymbolTable():
+    def __init__(self, elf_filename=None, nm='arm-none-eabi-nm'):
+        self.addresses = []
+        self.names = []
+
+        self.logger = logging.getLogger('Sampler Report')
+        self.logger_console = logging.StreamHandler()
+        self.logger.setLevel(logging.WARNING)
+        self.log_format = logging.Formatter(
+            '[%(levelname)s] %(name)s: %(message)s')
+        self.logger_console.setFormatter(self.log_format)
+        self.logger.addHandler(self.logger_console)
+
+        if elf_filename is not None:
+            self._read_symbols(elf_filename, nm)
+
+    def _read_symbols(self, elf_filename, nm):
+        try:
+            out = subprocess.check_output([nm, '--numeric-sort',
+                                           '--defined-only', elf_filename],
+                                          universal_newlines=True)
+        except (OSError, subprocess.CalledProcessError):
+            self.logger.error("Cannot read symbols from: " + elf_filename)
+            return
+
+        for line in out.splitlines():
+            fields = line.split()
+            if len(fields) != 3:
+                continue
+            # Thumb functions have the lowest address bit set
+            self.addresses.append(int(fields[0], 16) & ~1)
+            self.names.append(fields[2])
+
+    def resolve(self, address):
+        idx = bisect_right(self.addresses, address) - 1
+        if idx < 0:
+            return "0x{:08x}".format(address)
+
+        name = self.names[idx]
+        offset = address - self.addresses[idx]
+        if name.startswith(LISTENER_SYMBOL_PREFIX):
+            name = name[len(LISTENER_SYMBOL_PREFIX):]
+        if offset == 0:
+            return name
+        return "{}+0x{:x}".format(name, offset)
+
+    def resolve_function(self, address):
+        return self.resolve(address).split('+')[0]
+
+
+class SamplerReport():
+    def __init__(self, events_data, symbols,
+                 ms_per_tick=RttNordicConfig['ms_per_timestamp_tick']):
+        self.events_data = events_data
+        self.symbols = symbols
+        self.ms_per_tick = ms_per_tick
+
+    def _events(self, type_name):
+        type_id = self.events_data.get_event_type_id(type_name)
+        if type_id is None:
+            return []
+        return [ev for ev in self.events_data.events if ev.type_id == type_id]
+
+    def cpu_load(self, top_functions):
+        samples = self._events('cpu_sample')
+        if not samples:
+            print("No CPU samples recorded")
+            return
+
+        threads = Counter(ev.data[0] for ev in samples)
+        functions = Counter(ev.data[1] for ev in samples)
+
+        print("CPU samples: {}".format(len(samples)))
+        print("{:<40} {:>10}".format("Thread", "CPU[%]"))
+        for thread, cnt in threads.most_common():
+            print("{:<40} {:>10.2f}".format(self.symbols.resolve(thread),
+                                            100 * cnt / len(samples)))
+
+        by_function = Counter()
+        for pc, cnt in functions.items():
+            if pc == PC_NESTED_INTERRUPT:
+                by_function['<interrupt>'] += cnt
+            else:
+                by_function[self.symbols.resolve_function(pc)] += cnt
+
+        print("\n{:<40} {:>10}".format("Function", "CPU[%]"))
+        for function, cnt in by_function.most_common(top_functions):
+            print("{:<40} {:>10.2f}".format(function,
+                                            100 * cnt / len(samples)))
+
+    def listeners(self):
+        executions = self._events('listener_execution')
+        if not executions:
+            print("No listener executions recorded")
+            return
+
+        # listener -> [notifications, total ticks, max ticks]
+        stats = {}
+        for ev in executions:
+            s = stats.setdefault(ev.data[0], [0, 0, 0])
+            s[0] += 1
+            s[1] += ev.data[1]
+            s[2] = max(s[2], ev.data[1])
+
+        print("{:<32} {:>10} {:>12} {:>10} {:>10}".format(
+              "Listener", "Calls", "Total[ms]", "Mean[ms]", "Max[ms]"))
+        for listener, (cnt, total, longest) in sorted(
+                stats.items(), key=lambda x: x[1][1], reverse=True):
+            print("{:<32} {:>10} {:>12.3f} {:>10.3f} {:>10.3f}".format(
+                  self.symbols.resolve(listener), cnt,
+                  total * self.ms_per_tick,
+                  total * self.ms_per_tick / cnt,
+                  longest * self.ms_per_tick))
+
+    def stack_usage(self):
+        reports = self._events('stack_usage')
+        if not reports:
+            print("No stack usage recorded")
+            return
+
+        # thread -> (stack size, minimal unused space)
+        stats = {}
+        for ev in reports:
+            thread, size, unused = ev.data
+            prev = stats.get(thread, (size, unused))
+            stats[thread] = (size, min(prev[1], unused))
+
+        print("{:<40} {:>8} {:>8} {:>8}".format(
+              "Thread", "Size", "Used", "Used[%]"))
+        for thread, (size, unused) in sorted(stats.items()):
+            print("{:<40} {:>8} {:>8} {:>8.1f}".format(
+                  self.symbols.resolve(thread), size, size - unused,
+                  100 * (size - unused) / size))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Summary of CPU samples, listener execution times and '
+                    'stack usage.')
+    parser.add_argument('dataset_name', help='Name of dataset')
+    parser.add_argument('--elf', help='Firmware ELF file used to resolve '
+                                      'thread, listener and function names')
+    parser.add_argument('--nm', default='arm-none-eabi-nm',
+                        help='nm executable used to read ELF symbols')
+    parser.add_argument('--top', type=int, default=20,
+                        help='Number of displayed functions')
+    args = parser.parse_args()
+
+    events_data = EventsData([], {})
+    events_data.read_data_from_files(args.dataset_name + ".csv",
+                                     args.dataset_name + ".json")
+
+    report = SamplerReport(events_data, SymbolTable(args.elf, args.nm))
+    report.cpu_load(args.top)
+    print()
+    report.listeners()
+    print()
+    report.stack_usage()
+
+
+if __name__ == "__main__":
+    main()
@@ -56,6 +56,10 @@ class StatsNordic():
                                  0.05, start_meas, end_meas)
         plt.show()
 
+    def calculate_latency_stats(self, start_meas, end_meas):
+        self.latency_percentiles(start_meas=start_meas, end_meas=end_meas)
+        self.queue_depth_over_time(start_meas, end_meas)
+
     def _get_timestamps(self, event_name, event_state, start_meas, end_meas):
         event_type_id = self.processed_data.raw_data.get_event_type_id(event_name)
         if event_type_id == None:
@@ -108,6 +112,78 @@ class StatsNordic():
 
         return stats_text
 
+    def _output_dir(self, start_meas, end_meas):
+        dir_name = "{}{}_{}_{}/".format(OUTPUT_FOLDER, self.data_name,
+                                        int(start_meas), int(end_meas))
+        if not os.path.exists(dir_name):
+            os.makedirs(dir_name)
+
+        return dir_name
+
+    def latency_percentiles(self, percentiles=(50, 90, 99, 99.9),
+                            start_meas=0, end_meas=float('inf')):
+        if not self.processed_data.tracking_execution:
+            self.logger.error("Events processing is not tracked")
+            return
+
+        # event type id -> (queueing latencies, processing times)
+        latencies = {}
+        for ev in self.processed_data.tracked_events:
+            if not (start_meas < ev.submit.timestamp < end_meas):
+                continue
+            queued, processed = latencies.setdefault(ev.submit.type_id,
+                                                     ([], []))
+            queued.append(ev.proc_start_time - ev.submit.timestamp)
+            processed.append(ev.proc_end_time - ev.proc_start_time)
+
+        if len(latencies) == 0:
+            self.logger.error("No tracked events logged")
+            return
+
+        fieldnames = ['event', 'stage', 'records'] + \
+                     ['p{}[ms]'.format(p) for p in percentiles]
+        filename = self._output_dir(start_meas, end_meas) + \
+                   'latency_percentiles.csv'
+
+        registered = self.processed_data.raw_data.registered_events_types
+        with open(filename, 'w', newline='') as csvfile:
+            wr = csv.writer(csvfile, delimiter=',')
+            wr.writerow(fieldnames)
+            for type_id, (queued, processed) in sorted(latencies.items()):
+                name = registered[type_id].name
+                for stage, times in (("queued", queued),
+                                     ("processing", processed)):
+                    values = np.percentile(np.array(times) * 1000,
+                                           percentiles)
+                    self.logger.info("{} {}: ".format(name, stage) +
+                                     ", ".join("p{}={:.3f}ms".format(p, v)
+                                     for p, v in zip(percentiles, values)))
+                    wr.writerow([name, stage, len(times)] +
+                                ["{0:.3f}".format(v) for v in values])
+
+    def queue_depth_over_time(self, start_meas=0, end_meas=float('inf')):
+        matcher = self.processed_data.matcher
+        if matcher is None or len(matcher.queue_depth_times) == 0:
+            self.logger.error("Events processing is not tracked")
+            return
+
+        times = np.frombuffer(matcher.queue_depth_times, dtype=np.float64)
+        depths = np.frombuffer(matcher.queue_depth_values,
+                               dtype=np.dtype('l'))
+        selected = np.where((times > start_meas) & (times < end_meas))
+
+        plt.figure()
+        plt.step(times[selected], depths[selected], where='post')
+        plt.xlabel('Time[s]')
+        plt.ylabel('Events waiting for processing')
+
+        title = "Event queue depth (" + self.data_name + ')'
+        plt.title(title)
+        plt.grid(True)
+
+        plt.savefig(self._output_dir(start_meas, end_meas) +
+                    title.lower().replace(' ', '_') + '.png')
+
     def time_between_events(self, start_event_name, start_event_state,
                             end_event_name, end_event_state, hist_bin_width=0.01,
                             start_meas=0, end_meas=float('inf')):
@@ -179,10 +255,6 @@ class StatsNordic():
         plt.yscale('log')
         plt.grid(True)
 
-        dir_name = "{}{}_{}_{}/".format(OUTPUT_FOLDER, self.data_name,
-                                        int(start_meas), int(end_meas))
-        if not os.path.exists(dir_name):
-            os.makedirs(dir_name)
-
+        dir_name = self._output_dir(start_meas, end_meas)
         plt.savefig(dir_name +
                     title.lower().replace(' ', '_').replace('\n', '_') +'.png')
@@ -58,8 +58,11 @@ struct bt_gatt_dm {
 	const struct bt_gatt_dm_cb *callback;
 };
 
-/* Currently only one instance is supported */
-static struct bt_gatt_dm bt_gatt_dm_inst;
+/* Pool of instances, one is used for each discovery in progress */
+static struct bt_gatt_dm bt_gatt_dm_inst[CONFIG_BT_GATT_DM_MAX_INSTANCES];
+
+/* Protects instance allocation */
+static struct k_spinlock bt_gatt_dm_inst_lock;
 
 
 static void *user_data_store(struct bt_gatt_dm *dm,
@@ -396,24 +399,24 @@ static u8_t discovery_callback(struct bt_conn *conn,
 		LOG_DBG("Attr: handle %u", attr->handle);
 	}
 
-	if (conn != bt_gatt_dm_inst.conn) {
+	/* Discovery parameters are a part of the instance */
+	struct bt_gatt_dm *dm = CONTAINER_OF(params, struct bt_gatt_dm,
+					     discover_params);
+
+	if (conn != dm->conn) {
 		LOG_ERR("Unexpected conn object. Aborting.");
-		discovery_complete_error(&bt_gatt_dm_inst, -EFAULT);
+		discovery_complete_error(dm, -EFAULT);
 		return BT_GATT_ITER_STOP;
 	}
 
 	switch (params->type) {
 	case BT_GATT_DISCOVER_PRIMARY:
 	case BT_GATT_DISCOVER_SECONDARY:
-		return discovery_process_service(&bt_gatt_dm_inst,
-						 attr, params);
+		return discovery_process_service(dm, attr, params);
 	case BT_GATT_DISCOVER_ATTRIBUTE:
-		return discovery_process_attribute(&bt_gatt_dm_inst,
-						   attr, params);
+		return discovery_process_attribute(dm, attr, params);
 	case BT_GATT_DISCOVER_CHARACTERISTIC:
-		return discovery_process_characteristic(&bt_gatt_dm_inst,
-							attr,
-							params);
+		return discovery_process_characteristic(dm, attr, params);
 	default:
 		/* This should not be possible */
 		__ASSERT(false, "Unknown param type.");
@@ -547,6 +550,41 @@ const struct bt_gatt_attr *bt_gatt_dm_desc_next(
 	return curr;
 }
 
+static int inst_alloc(struct bt_conn *conn, struct bt_gatt_dm **dm)
+{
+	struct bt_gatt_dm *free_inst = NULL;
+	k_spinlock_key_t key = k_spin_lock(&bt_gatt_dm_inst_lock);
+
+	for (size_t i = 0; i < ARRAY_SIZE(bt_gatt_dm_inst); i++) {
+		struct bt_gatt_dm *inst = &bt_gatt_dm_inst[i];
+
+		if (!atomic_test_bit(inst->state_flags, STATE_ATTRS_LOCKED)) {
+			if (!free_inst) {
+				free_inst = inst;
+			}
+		} else if (inst->conn == conn) {
+			/* Only one discovery per connection */
+			k_spin_unlock(&bt_gatt_dm_inst_lock, key);
+			return -EALREADY;
+		}
+	}
+
+	if (free_inst) {
+		atomic_set_bit(free_inst->state_flags, STATE_ATTRS_LOCKED);
+		free_inst->conn = conn;
+	}
+
+	k_spin_unlock(&bt_gatt_dm_inst_lock, key);
+
+	if (!free_inst) {
+		LOG_ERR("No free discovery manager instance");
+		return -ENOMEM;
+	}
+
+	*dm = free_inst;
+
+	return 0;
+}
 
 int bt_gatt_dm_start(struct bt_conn *conn,
 		     const struct bt_uuid *svc_uuid,
@@ -566,13 +604,11 @@ int bt_gatt_dm_start(struct bt_conn *conn,
 		return -EINVAL;
 	}
 
-	dm = &bt_gatt_dm_inst;
-
-	if (atomic_test_and_set_bit(dm->state_flags, STATE_ATTRS_LOCKED)) {
-		return -EALREADY;
+	err = inst_alloc(conn, &dm);
+	if (err) {
+		return err;
 	}
 
-	dm->conn = conn;
 	dm->context = context;
 	dm->callback = cb;
 	dm->cur_attr_id = 0;
@@ -588,6 +624,7 @@ int bt_gatt_dm_start(struct bt_conn *conn,
 	err = bt_gatt_discover(conn, &dm->discover_params);
 	if (err) {
 		LOG_ERR("Discover failed, error: %d.", err);
+		svc_attr_memory_release(dm);
 		atomic_clear_bit(dm->state_flags, STATE_ATTRS_LOCKED);
 	}
 
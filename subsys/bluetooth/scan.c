@@ -9,15 +9,25 @@
 #include <string.h>
 #include <bluetooth/scan.h>
 
+#include "scan_index.h"
+#include "scan_cache.h"
+
 #include <logging/log.h>
 LOG_MODULE_REGISTER(nrf_bt_scan, CONFIG_BT_SCAN_LOG_LEVEL);
 
 #define BT_SCAN_UUID_128_SIZE 16
 
+#define UUID_MASK_WORDS ((CONFIG_BT_SCAN_UUID_CNT / 32) + 1)
+
 #define MODE_CHECK (BT_SCAN_NAME_FILTER | BT_SCAN_ADDR_FILTER | \
 	BT_SCAN_SHORT_NAME_FILTER | BT_SCAN_APPEARANCE_FILTER | \
 	BT_SCAN_UUID_FILTER | BT_SCAN_MANUFACTURER_DATA_FILTER)
 
+BUILD_ASSERT_MSG(CONFIG_BT_SCAN_NAME_CNT <= SCAN_INDEX_TRIE_MAX_NAMES,
+		 "Too many name filters");
+BUILD_ASSERT_MSG(CONFIG_BT_SCAN_SHORT_NAME_CNT <= SCAN_INDEX_TRIE_MAX_NAMES,
+		 "Too many short name filters");
+
 /* Scan filter add mutex. */
 K_MUTEX_DEFINE(scan_add_mutex);
 
@@ -223,8 +233,222 @@ static struct bt_scan {
 
 } bt_scan;
 
+/* Filter index storage. */
+static u8_t addr_slots[SCAN_INDEX_SLOTS(CONFIG_BT_SCAN_ADDRESS_CNT)];
+static u8_t uuid_slots[SCAN_INDEX_SLOTS(CONFIG_BT_SCAN_UUID_CNT)];
+static struct scan_uuid_key uuid_keys[CONFIG_BT_SCAN_UUID_CNT];
+static struct scan_trie_node name_nodes[
+	SCAN_INDEX_TRIE_NODES(CONFIG_BT_SCAN_NAME_CNT,
+			      CONFIG_BT_SCAN_NAME_MAX_LEN)];
+static struct scan_trie_node short_name_nodes[
+	SCAN_INDEX_TRIE_NODES(CONFIG_BT_SCAN_SHORT_NAME_CNT,
+			      CONFIG_BT_SCAN_SHORT_NAME_MAX_LEN)];
+
+/* Filter index. Address, UUID and name filters are indexed, so that
+ * an advertising report is classified without iterating over all filters.
+ */
+static struct bt_scan_index {
+	/* Hashed address filters. */
+	struct scan_addr_set addr;
+
+	/* Hashed UUID filters. */
+	struct scan_uuid_set uuid;
+
+	/* Name filters prefix trie. */
+	struct scan_trie name;
+
+	/* Short name filters prefix trie. */
+	struct scan_trie short_name;
+} scan_index = {
+	.addr = {
+		.addrs = bt_scan.scan_filters.addr.target_addr,
+		.slots = addr_slots,
+		.size = sizeof(addr_slots),
+	},
+	.uuid = {
+		.keys = uuid_keys,
+		.slots = uuid_slots,
+		.size = sizeof(uuid_slots),
+	},
+	.name = {
+		.nodes = name_nodes,
+		.max_nodes = ARRAY_SIZE(name_nodes),
+		.node_cnt = 1,
+	},
+	.short_name = {
+		.nodes = short_name_nodes,
+		.max_nodes = ARRAY_SIZE(short_name_nodes),
+		.node_cnt = 1,
+	},
+};
+
+#if CONFIG_BT_SCAN_DEVICE_CACHE
+static struct scan_cache_entry cache_entries[CONFIG_BT_SCAN_DEVICE_CACHE_SIZE];
+
+/* Device cache. Reports that repeat the previous report of a device
+ * are dropped before filter evaluation.
+ */
+static struct bt_scan_device_cache {
+	struct scan_cache cache;
+
+	/* Protects the cache, which is used from the Bluetooth RX thread
+	 * and from the application.
+	 */
+	struct k_spinlock lock;
+
+	/* Cycles spent on the dropped reports. */
+	u64_t dropped_cycles;
+
+	/* Cycles spent on the delivered reports. */
+	u64_t delivered_cycles;
+} device_cache = {
+	.cache = {
+		.entries = cache_entries,
+		.size = ARRAY_SIZE(cache_entries),
+		.window = CONFIG_BT_SCAN_DEVICE_CACHE_WINDOW_MS,
+	},
+};
+#endif
+
 static sys_slist_t callback_list;
 
+static void scan_index_reset(void)
+{
+	scan_addr_set_reset(&scan_index.addr);
+	scan_uuid_set_reset(&scan_index.uuid);
+	scan_trie_reset(&scan_index.name);
+	scan_trie_reset(&scan_index.short_name);
+}
+
+#if CONFIG_BT_SCAN_DEVICE_CACHE
+static void device_cache_invalidate(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&device_cache.lock);
+
+	scan_cache_invalidate(&device_cache.cache);
+
+	k_spin_unlock(&device_cache.lock, key);
+}
+
+static bool is_report_repeated(const bt_addr_le_t *addr, s8_t rssi,
+			       u8_t type, struct net_buf_simple *ad,
+			       u32_t start)
+{
+	enum scan_cache_pdu pdu = (type == BT_LE_ADV_SCAN_RSP) ?
+		SCAN_CACHE_PDU_SCAN_RSP : SCAN_CACHE_PDU_ADV;
+	u32_t hash = scan_cache_data_hash(ad->data, ad->len);
+	u32_t now = k_uptime_get_32();
+
+	k_spinlock_key_t key = k_spin_lock(&device_cache.lock);
+
+	bool repeated = scan_cache_report(&device_cache.cache, addr, pdu,
+					  hash, rssi, now);
+
+	if (repeated) {
+		device_cache.dropped_cycles += k_cycle_get_32() - start;
+	}
+
+	k_spin_unlock(&device_cache.lock, key);
+
+	return repeated;
+}
+
+static void report_delivered(u32_t start)
+{
+	k_spinlock_key_t key = k_spin_lock(&device_cache.lock);
+
+	device_cache.delivered_cycles += k_cycle_get_32() - start;
+
+	k_spin_unlock(&device_cache.lock, key);
+}
+
+int bt_scan_cache_stats_get(struct bt_scan_cache_stats *stats)
+{
+	if (!stats) {
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&device_cache.lock);
+
+	const struct scan_cache *cache = &device_cache.cache;
+	u64_t saved = 0;
+
+	if (cache->misses > 0) {
+		saved = (device_cache.delivered_cycles / cache->misses) *
+			cache->hits;
+	}
+
+	if (saved > device_cache.dropped_cycles) {
+		saved -= device_cache.dropped_cycles;
+	} else {
+		saved = 0;
+	}
+
+	stats->reports = cache->hits + cache->misses;
+	stats->dropped = cache->hits;
+	stats->evictions = cache->evictions;
+
+	k_spin_unlock(&device_cache.lock, key);
+
+	stats->time_saved_us = SYS_CLOCK_HW_CYCLES_TO_NS64(saved) /
+			       NSEC_PER_USEC;
+
+	return 0;
+}
+
+int bt_scan_rssi_stats_get(const bt_addr_le_t *addr,
+			   struct bt_scan_rssi_stats *rssi)
+{
+	struct scan_cache_rssi cached;
+	int err;
+
+	if (!addr || !rssi) {
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&device_cache.lock);
+
+	err = scan_cache_rssi_get(&device_cache.cache, addr, &cached);
+
+	k_spin_unlock(&device_cache.lock, key);
+
+	if (!err) {
+		rssi->min = cached.min;
+		rssi->avg = cached.avg;
+		rssi->max = cached.max;
+		rssi->cnt = cached.cnt;
+	}
+
+	return err;
+}
+
+void bt_scan_cache_clear(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&device_cache.lock);
+
+	scan_cache_clear(&device_cache.cache);
+	device_cache.dropped_cycles = 0;
+	device_cache.delivered_cycles = 0;
+
+	k_spin_unlock(&device_cache.lock, key);
+}
+#else
+static void device_cache_invalidate(void)
+{
+}
+
+static bool is_report_repeated(const bt_addr_le_t *addr, s8_t rssi,
+			       u8_t type, struct net_buf_simple *ad,
+			       u32_t start)
+{
+	return false;
+}
+
+static void report_delivered(u32_t start)
+{
+}
+#endif
+
 void bt_scan_cb_register(struct bt_scan_cb *cb)
 {
 	if (!cb) {
@@ -318,17 +542,15 @@ static bool adv_addr_compare(const bt_addr_le_t *target_addr,
 {
 	const bt_addr_le_t *addr =
 			bt_scan.scan_filters.addr.target_addr;
-	u8_t counter = bt_scan.scan_filters.addr.cnt;
+	int idx = scan_addr_set_find(&scan_index.addr, target_addr);
 
-	for (size_t i = 0; i < counter; i++) {
-		if (bt_addr_le_cmp(target_addr, &addr[i]) == 0) {
-			control->filter_status.addr.addr = &addr[i];
-
-			return true;
-		}
+	if (idx < 0) {
+		return false;
 	}
 
-	return false;
+	control->filter_status.addr.addr = &addr[idx];
+
+	return true;
 }
 
 static bool is_addr_filter_enabled(void)
@@ -363,15 +585,19 @@ static int scan_addr_filter_add(const bt_addr_le_t *target_addr)
 	}
 
 	/* Check for duplicated filter. */
-	for (size_t i = 0; i < counter; i++) {
-		if (bt_addr_le_cmp(target_addr, &addr_filter[i]) == 0) {
-			return 0;
-		}
+	if (scan_addr_set_find(&scan_index.addr, target_addr) >= 0) {
+		return 0;
 	}
 
 	/* Add target address to filter. */
 	bt_addr_le_copy(&addr_filter[counter], target_addr);
 
+	int err = scan_addr_set_add(&scan_index.addr, counter);
+
+	if (err) {
+		return err;
+	}
+
 	LOG_DBG("Filter set on address type %i",
 		addr_filter[counter].type);
 
@@ -385,36 +611,27 @@ static int scan_addr_filter_add(const bt_addr_le_t *target_addr)
 	return 0;
 }
 
-static bool adv_name_cmp(const u8_t *data,
-			 u8_t data_len,
-			 const char *target_name)
-{
-	return strncmp(target_name, data, data_len) == 0;
-}
-
 static bool adv_name_compare(const struct bt_data *data,
 			     struct bt_scan_control *control)
 {
 	struct bt_scan_name_filter const *name_filter =
 			&bt_scan.scan_filters.name;
-	u8_t counter = bt_scan.scan_filters.name.cnt;
 	u8_t data_len = data->data_len;
 
 	/* Compare the name found with the name filter. */
-	for (size_t i = 0; i < counter; i++) {
-		if (adv_name_cmp(data->data,
-				 data_len,
-				 name_filter->target_name[i])) {
-
-			control->filter_status.name.name =
-				name_filter->target_name[i];
-			control->filter_status.name.len = data_len;
+	u32_t match = scan_trie_match(&scan_index.name, data->data, data_len);
 
-			return true;
-		}
+	if (!match) {
+		return false;
 	}
 
-	return false;
+	/* Filter added first takes precedence. */
+	size_t i = __builtin_ctz(match);
+
+	control->filter_status.name.name = name_filter->target_name[i];
+	control->filter_status.name.len = data_len;
+
+	return true;
 }
 
 static bool is_name_filter_enabled(void)
@@ -461,6 +678,12 @@ static int scan_name_filter_add(const char *name)
 	}
 
 	/* Add name to filter. */
+	int err = scan_trie_add(&scan_index.name, name, counter);
+
+	if (err) {
+		return err;
+	}
+
 	memcpy(bt_scan.scan_filters.name.target_name[counter],
 	       name, name_len);
 
@@ -471,40 +694,30 @@ static int scan_name_filter_add(const char *name)
 	return 0;
 }
 
-static bool adv_short_name_cmp(const u8_t *data,
-			       u8_t data_len,
-			       const char *target_name,
-			       u8_t short_name_min_len)
-{
-	if ((data_len >= short_name_min_len) &&
-	    (strncmp(target_name, data, data_len) == 0)) {
-		return true;
-	}
-
-	return false;
-}
-
 static bool adv_short_name_compare(const struct bt_data *data,
 				   struct bt_scan_control *control)
 {
 	const struct bt_scan_short_name_filter *name_filter =
 			&bt_scan.scan_filters.short_name;
-	u8_t counter = bt_scan.scan_filters.short_name.cnt;
 	u8_t data_len = data->data_len;
 
 	/* Compare the name found with the name filters. */
-	for (size_t i = 0; i < counter; i++) {
-		if (adv_short_name_cmp(data->data,
-				       data_len,
-				       name_filter->name[i].target_name,
-				       name_filter->name[i].min_len)) {
+	u32_t match = scan_trie_match(&scan_index.short_name, data->data,
+				      data_len);
 
+	/* Filters added first take precedence. */
+	while (match) {
+		size_t i = __builtin_ctz(match);
+
+		if (data_len >= name_filter->name[i].min_len) {
 			control->filter_status.short_name.name =
 				name_filter->name[i].target_name;
 			control->filter_status.short_name.len = data_len;
 
 			return true;
 		}
+
+		match &= match - 1;
 	}
 
 	return false;
@@ -559,6 +772,13 @@ static int scan_short_name_filter_add(const struct bt_scan_short_name *short_nam
 	}
 
 	/* Add name to the filter. */
+	int err = scan_trie_add(&scan_index.short_name, short_name->name,
+				counter);
+
+	if (err) {
+		return err;
+	}
+
 	short_name_filter->name[counter].min_len = short_name->min_len;
 	memcpy(short_name_filter->name[counter].target_name,
 	       short_name->name,
@@ -571,65 +791,48 @@ static int scan_short_name_filter_add(const struct bt_scan_short_name *short_nam
 	return 0;
 }
 
-static bool find_uuid(const u8_t *data,
-		      u8_t data_len,
-		      u8_t uuid_type,
-		      const struct bt_scan_uuid *target_uuid)
+static u8_t uuid_len_get(u8_t uuid_type)
 {
-	u8_t uuid_len;
-
 	switch (uuid_type) {
 	case BT_UUID_TYPE_16:
-		uuid_len = sizeof(u16_t);
-		break;
+		return sizeof(u16_t);
 
 	case BT_UUID_TYPE_32:
-		uuid_len = sizeof(u32_t);
-		break;
+		return sizeof(u32_t);
 
 	case BT_UUID_TYPE_128:
-		uuid_len = BT_SCAN_UUID_128_SIZE * sizeof(u8_t);
-		break;
+		return BT_SCAN_UUID_128_SIZE * sizeof(u8_t);
 
 	default:
-		return false;
+		return 0;
 	}
+}
 
-	for (size_t i = 0; i < data_len; i += uuid_len) {
-		struct bt_uuid *uuid;
-		u16_t uuid_16;
-		u32_t uuid_32;
-		struct bt_uuid_128 uuid_128 = {
-			.uuid.type = BT_UUID_TYPE_128,
-		};
-
-
-		switch (uuid_type) {
-		case BT_UUID_TYPE_16:
-			memcpy(&uuid_16, &data[i], uuid_len);
-			uuid = BT_UUID_DECLARE_16(sys_le16_to_cpu(uuid_16));
-			break;
-
-		case BT_UUID_TYPE_32:
-			memcpy(&uuid_32, &data[i], uuid_len);
-			uuid = BT_UUID_DECLARE_32(sys_le32_to_cpu(uuid_32));
-			break;
+static void find_uuids(const u8_t *data,
+		       u8_t data_len,
+		       u8_t uuid_type,
+		       u32_t *found)
+{
+	u8_t uuid_len = uuid_len_get(uuid_type);
 
-		case BT_UUID_TYPE_128:
-			memcpy(uuid_128.val, &data[i], uuid_len);
-			uuid = (struct bt_uuid *)&uuid_128;
-			break;
+	if (uuid_len == 0) {
+		return;
+	}
 
-		default:
-			return false;
-		}
+	/* Mark the filters matching the advertised UUIDs. */
+	for (size_t i = 0; i + uuid_len <= data_len; i += uuid_len) {
+		int idx = scan_uuid_set_find(&scan_index.uuid, &data[i],
+					     uuid_len);
 
-		if (bt_uuid_cmp(uuid, target_uuid->uuid) == 0) {
-			return true;
+		if (idx >= 0) {
+			found[idx / 32] |= BIT(idx % 32);
 		}
 	}
+}
 
-	return false;
+static bool is_uuid_found(const u32_t *found, size_t idx)
+{
+	return (found[idx / 32] & BIT(idx % 32)) != 0;
 }
 
 static bool adv_uuid_compare(const struct bt_data *data, u8_t uuid_type,
@@ -641,11 +844,13 @@ static bool adv_uuid_compare(const struct bt_data *data, u8_t uuid_type,
 	const u8_t counter = bt_scan.scan_filters.uuid.cnt;
 	u8_t data_len = data->data_len;
 	u8_t uuid_match_cnt = 0;
+	u32_t found[UUID_MASK_WORDS] = {0};
+
+	find_uuids(data->data, data_len, uuid_type, found);
 
 	for (size_t i = 0; i < counter; i++) {
 
-		if (find_uuid(data->data, data_len, uuid_type,
-			      &uuid_filter->uuid[i])) {
+		if (is_uuid_found(found, i)) {
 			control->filter_status.uuid.uuid[uuid_match_cnt] =
 				uuid_filter->uuid[i].uuid;
 
@@ -746,6 +951,12 @@ static int scan_uuid_filter_add(struct bt_uuid *uuid)
 		return -EINVAL;
 	}
 
+	int err = scan_uuid_set_add(&scan_index.uuid, uuid, counter);
+
+	if (err) {
+		return err;
+	}
+
 	bt_scan.scan_filters.uuid.cnt++;
 	LOG_DBG("Added filter on UUID type %x", uuid->type);
 
@@ -1020,6 +1231,10 @@ int bt_scan_filter_add(enum bt_scan_filter_type type,
 
 	k_mutex_unlock(&scan_add_mutex);
 
+	if (!err) {
+		device_cache_invalidate();
+	}
+
 	return err;
 }
 
@@ -1051,7 +1266,11 @@ void bt_scan_filter_remove_all(void)
 		&bt_scan.scan_filters.manufacturer_data;
 	manufacturer_data_filter->cnt = 0;
 
+	scan_index_reset();
+
 	k_mutex_unlock(&scan_add_mutex);
+
+	device_cache_invalidate();
 }
 
 void bt_scan_filter_disable(void)
@@ -1063,6 +1282,8 @@ void bt_scan_filter_disable(void)
 	bt_scan.scan_filters.uuid.enabled = false;
 	bt_scan.scan_filters.appearance.enabled = false;
 	bt_scan.scan_filters.manufacturer_data.enabled = false;
+
+	device_cache_invalidate();
 }
 
 int bt_scan_filter_enable(u8_t mode, bool match_all)
@@ -1142,6 +1363,7 @@ void bt_scan_init(const struct bt_scan_init_param *init)
 {
 	/* Disable all scanning filters. */
 	memset(&bt_scan.scan_filters, 0, sizeof(bt_scan.scan_filters));
+	scan_index_reset();
 
 	/* If the pointer to the initialization structure exist,
 	 * use it to scan the configuration.
@@ -1279,6 +1501,14 @@ static void scan_device_found(const bt_addr_le_t *addr, s8_t rssi, u8_t type,
 			      struct net_buf_simple *ad)
 {
 	struct bt_scan_control scan_control;
+	u32_t start = k_cycle_get_32();
+
+	/* Drop the report before filter evaluation if it repeats
+	 * the previous report of the device.
+	 */
+	if (is_report_repeated(addr, rssi, type, ad, start)) {
+		return;
+	}
 
 	memset(&scan_control, 0, sizeof(scan_control));
 
@@ -1308,6 +1538,8 @@ static void scan_device_found(const bt_addr_le_t *addr, s8_t rssi, u8_t type,
 	 * If the event handler is not NULL, notify the main application.
 	 */
 	filter_state_check(&scan_control, addr);
+
+	report_delivered(start);
 }
 
 int bt_scan_start(enum bt_scan_type scan_type)
@@ -1325,6 +1557,9 @@ int bt_scan_start(enum bt_scan_type scan_type)
 		return -EINVAL;
 	}
 
+	/* Deliver the first report of every device after restart. */
+	device_cache_invalidate();
+
 	/* Start the scanning. */
 	int err = bt_le_scan_start(&bt_scan.scan_param, scan_device_found);
 
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <errno.h>
+#include <string.h>
+
+#include "scan_cache.h"
+
+#define FNV_OFFSET_BASIS 0x811c9dc5
+#define FNV_PRIME        0x01000193
+
+/* RSSI values are summed with no overflow up to this number of reports. */
+#define RSSI_CNT_MAX     BIT(24)
+
+
+static bool is_entry_used(const struct scan_cache_entry *entry)
+{
+	return entry->rssi_cnt > 0;
+}
+
+static struct scan_cache_entry *entry_find(const struct scan_cache *cache,
+					   const bt_addr_le_t *addr)
+{
+	for (size_t i = 0; i < cache->size; i++) {
+		struct scan_cache_entry *entry = &cache->entries[i];
+
+		if (is_entry_used(entry) && !bt_addr_le_cmp(&entry->addr, addr)) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static struct scan_cache_entry *entry_alloc(struct scan_cache *cache,
+					    const bt_addr_le_t *addr)
+{
+	struct scan_cache_entry *victim = &cache->entries[0];
+
+	for (size_t i = 0; i < cache->size; i++) {
+		struct scan_cache_entry *entry = &cache->entries[i];
+
+		if (!is_entry_used(entry)) {
+			victim = entry;
+			break;
+		}
+
+		/* Use counter may wrap around. */
+		if ((s32_t)(entry->last_use - victim->last_use) < 0) {
+			victim = entry;
+		}
+	}
+
+	if (is_entry_used(victim)) {
+		cache->evictions++;
+	}
+
+	memset(victim, 0, sizeof(*victim));
+	bt_addr_le_copy(&victim->addr, addr);
+
+	return victim;
+}
+
+static void rssi_add(struct scan_cache_entry *entry, s8_t rssi)
+{
+	if ((entry->rssi_cnt == 0) || (rssi < entry->rssi_min)) {
+		entry->rssi_min = rssi;
+	}
+
+	if ((entry->rssi_cnt == 0) || (rssi > entry->rssi_max)) {
+		entry->rssi_max = rssi;
+	}
+
+	/* Halve the history rather than overflow the sum. */
+	if (entry->rssi_cnt >= RSSI_CNT_MAX) {
+		entry->rssi_sum /= 2;
+		entry->rssi_cnt /= 2;
+	}
+
+	entry->rssi_sum += rssi;
+	entry->rssi_cnt++;
+}
+
+void scan_cache_clear(struct scan_cache *cache)
+{
+	memset(cache->entries, 0, cache->size * sizeof(cache->entries[0]));
+	cache->use_cnt = 0;
+	cache->hits = 0;
+	cache->misses = 0;
+	cache->evictions = 0;
+}
+
+void scan_cache_invalidate(struct scan_cache *cache)
+{
+	for (size_t i = 0; i < cache->size; i++) {
+		cache->entries[i].delivered = 0;
+	}
+}
+
+u32_t scan_cache_data_hash(const u8_t *data, u16_t len)
+{
+	u32_t hash = FNV_OFFSET_BASIS;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= data[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+bool scan_cache_report(struct scan_cache *cache, const bt_addr_le_t *addr,
+		       enum scan_cache_pdu pdu, u32_t data_hash, s8_t rssi,
+		       u32_t now)
+{
+	__ASSERT_NO_MSG(pdu < SCAN_CACHE_PDU_COUNT);
+
+	if (cache->size == 0) {
+		cache->misses++;
+		return false;
+	}
+
+	struct scan_cache_entry *entry = entry_find(cache, addr);
+
+	if (!entry) {
+		entry = entry_alloc(cache, addr);
+	}
+
+	entry->last_use = cache->use_cnt++;
+	rssi_add(entry, rssi);
+
+	if ((entry->delivered & BIT(pdu)) &&
+	    (entry->data_hash[pdu] == data_hash) &&
+	    ((now - entry->delivered_at[pdu]) < cache->window)) {
+		cache->hits++;
+		return true;
+	}
+
+	entry->delivered |= BIT(pdu);
+	entry->data_hash[pdu] = data_hash;
+	entry->delivered_at[pdu] = now;
+	cache->misses++;
+
+	return false;
+}
+
+int scan_cache_rssi_get(const struct scan_cache *cache,
+			const bt_addr_le_t *addr,
+			struct scan_cache_rssi *rssi)
+{
+	const struct scan_cache_entry *entry = entry_find(cache, addr);
+
+	if (!entry) {
+		return -ENOENT;
+	}
+
+	rssi->min = entry->rssi_min;
+	rssi->max = entry->rssi_max;
+	rssi->avg = entry->rssi_sum / (s32_t)entry->rssi_cnt;
+	rssi->cnt = entry->rssi_cnt;
+
+	return 0;
+}
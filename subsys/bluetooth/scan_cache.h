@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Scan device cache.
+ *
+ * Private header of the Scanning Module. Least recently used cache of
+ * advertising devices, used to drop reports that repeat the previous
+ * report of a device and to aggregate RSSI of the device. The cache uses
+ * storage provided by the caller and is not thread safe.
+ */
+
+#ifndef BT_SCAN_CACHE_H_
+#define BT_SCAN_CACHE_H_
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <bluetooth/addr.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Advertising reports and scan responses of a device carry different data,
+ * so they are tracked separately.
+ */
+enum scan_cache_pdu {
+	SCAN_CACHE_PDU_ADV,
+	SCAN_CACHE_PDU_SCAN_RSP,
+
+	SCAN_CACHE_PDU_COUNT
+};
+
+struct scan_cache_entry {
+	bt_addr_le_t addr;
+
+	/* Hash of the last delivered data, per PDU kind. */
+	u32_t data_hash[SCAN_CACHE_PDU_COUNT];
+
+	/* Time of the last delivered report, per PDU kind. */
+	u32_t delivered_at[SCAN_CACHE_PDU_COUNT];
+
+	/* Value of the cache use counter when the entry was last used. */
+	u32_t last_use;
+
+	s32_t rssi_sum;
+	u32_t rssi_cnt;
+	s8_t rssi_min;
+	s8_t rssi_max;
+
+	/* Bitmask of PDU kinds that have been delivered. */
+	u8_t delivered;
+};
+
+struct scan_cache {
+	struct scan_cache_entry *entries;
+	u16_t size;
+
+	/* Time during which unchanged reports are dropped, in milliseconds. */
+	u32_t window;
+
+	u32_t use_cnt;
+
+	u32_t hits;
+	u32_t misses;
+	u32_t evictions;
+};
+
+/* RSSI aggregated for a device. */
+struct scan_cache_rssi {
+	s8_t min;
+	s8_t avg;
+	s8_t max;
+	u32_t cnt;
+};
+
+void scan_cache_clear(struct scan_cache *cache);
+
+/* Forget the delivered reports, so that the next report of every device is
+ * delivered. Aggregated RSSI and statistics are kept.
+ */
+void scan_cache_invalidate(struct scan_cache *cache);
+
+/* Hash of the advertising data. */
+u32_t scan_cache_data_hash(const u8_t *data, u16_t len);
+
+/* Record a report of the device.
+ *
+ * Returns true if the report carries the same data as the last delivered
+ * report of the same PDU kind and the window has not expired yet, in which
+ * case the report should be dropped. Otherwise, the report is recorded as
+ * delivered.
+ */
+bool scan_cache_report(struct scan_cache *cache, const bt_addr_le_t *addr,
+		       enum scan_cache_pdu pdu, u32_t data_hash, s8_t rssi,
+		       u32_t now);
+
+/* Get RSSI aggregated for the device.
+ *
+ * Returns 0 or -ENOENT if the device is not cached.
+ */
+int scan_cache_rssi_get(const struct scan_cache *cache,
+			const bt_addr_le_t *addr,
+			struct scan_cache_rssi *rssi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BT_SCAN_CACHE_H_ */
@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <errno.h>
+#include <string.h>
+#include <misc/byteorder.h>
+
+#include "scan_index.h"
+
+#define FNV_OFFSET_BASIS 0x811c9dc5
+#define FNV_PRIME        0x01000193
+
+#define UUID_BASE_PREFIX_LEN 12
+
+/* Bluetooth Base UUID (00000000-0000-1000-8000-00805F9B34FB) without
+ * the 32-bit value, in the little-endian order.
+ */
+static const u8_t uuid_base_prefix[UUID_BASE_PREFIX_LEN] = {
+	0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80,
+	0x00, 0x10, 0x00, 0x00
+};
+
+
+static u32_t hash_calc(u32_t hash, const u8_t *data, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		hash ^= data[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+static u32_t addr_hash(const bt_addr_le_t *addr)
+{
+	u32_t hash = hash_calc(FNV_OFFSET_BASIS, &addr->type,
+			       sizeof(addr->type));
+
+	return hash_calc(hash, addr->a.val, sizeof(addr->a.val));
+}
+
+void scan_addr_set_reset(struct scan_addr_set *set)
+{
+	memset(set->slots, 0, set->size);
+}
+
+int scan_addr_set_add(struct scan_addr_set *set, u8_t idx)
+{
+	if (set->size == 0) {
+		return -ENOMEM;
+	}
+
+	u16_t slot = addr_hash(&set->addrs[idx]) % set->size;
+
+	for (size_t i = 0; i < set->size; i++) {
+		if (set->slots[slot] == 0) {
+			set->slots[slot] = idx + 1;
+			return 0;
+		}
+
+		slot = (slot + 1) % set->size;
+	}
+
+	return -ENOMEM;
+}
+
+int scan_addr_set_find(const struct scan_addr_set *set,
+		       const bt_addr_le_t *addr)
+{
+	if (set->size == 0) {
+		return -ENOENT;
+	}
+
+	u16_t slot = addr_hash(addr) % set->size;
+
+	for (size_t i = 0; i < set->size; i++) {
+		u8_t entry = set->slots[slot];
+
+		if (entry == 0) {
+			break;
+		}
+
+		if (!bt_addr_le_cmp(&set->addrs[entry - 1], addr)) {
+			return entry - 1;
+		}
+
+		slot = (slot + 1) % set->size;
+	}
+
+	return -ENOENT;
+}
+
+static void uuid_key_from_data(struct scan_uuid_key *key, const u8_t *data,
+			       u8_t uuid_len)
+{
+	switch (uuid_len) {
+	case sizeof(u16_t):
+		key->is_long = false;
+		key->val = sys_get_le16(data);
+		break;
+
+	case sizeof(u32_t):
+		key->is_long = false;
+		key->val = sys_get_le32(data);
+		break;
+
+	default:
+		if (!memcmp(data, uuid_base_prefix, UUID_BASE_PREFIX_LEN)) {
+			key->is_long = false;
+			key->val = sys_get_le32(&data[UUID_BASE_PREFIX_LEN]);
+		} else {
+			key->is_long = true;
+			memcpy(key->long_val, data, sizeof(key->long_val));
+		}
+		break;
+	}
+}
+
+static u32_t uuid_key_hash(const struct scan_uuid_key *key)
+{
+	if (key->is_long) {
+		return hash_calc(FNV_OFFSET_BASIS, key->long_val,
+				 sizeof(key->long_val));
+	}
+
+	u8_t val[sizeof(u32_t)];
+
+	sys_put_le32(key->val, val);
+
+	return hash_calc(FNV_OFFSET_BASIS, val, sizeof(val));
+}
+
+static bool uuid_key_cmp(const struct scan_uuid_key *k1,
+			 const struct scan_uuid_key *k2)
+{
+	if (k1->is_long != k2->is_long) {
+		return false;
+	}
+
+	if (k1->is_long) {
+		return !memcmp(k1->long_val, k2->long_val,
+			       sizeof(k1->long_val));
+	}
+
+	return k1->val == k2->val;
+}
+
+static int uuid_key_find(const struct scan_uuid_set *set,
+			 const struct scan_uuid_key *key)
+{
+	if (set->size == 0) {
+		return -ENOENT;
+	}
+
+	u16_t slot = uuid_key_hash(key) % set->size;
+
+	for (size_t i = 0; i < set->size; i++) {
+		u8_t entry = set->slots[slot];
+
+		if (entry == 0) {
+			break;
+		}
+
+		if (uuid_key_cmp(&set->keys[entry - 1], key)) {
+			return entry - 1;
+		}
+
+		slot = (slot + 1) % set->size;
+	}
+
+	return -ENOENT;
+}
+
+void scan_uuid_set_reset(struct scan_uuid_set *set)
+{
+	memset(set->slots, 0, set->size);
+}
+
+int scan_uuid_set_add(struct scan_uuid_set *set, const struct bt_uuid *uuid,
+		      u8_t idx)
+{
+	struct scan_uuid_key *key = &set->keys[idx];
+	u8_t val[sizeof(u32_t)];
+
+	switch (uuid->type) {
+	case BT_UUID_TYPE_16:
+		sys_put_le16(BT_UUID_16(uuid)->val, val);
+		uuid_key_from_data(key, val, sizeof(u16_t));
+		break;
+
+	case BT_UUID_TYPE_32:
+		sys_put_le32(BT_UUID_32(uuid)->val, val);
+		uuid_key_from_data(key, val, sizeof(u32_t));
+		break;
+
+	case BT_UUID_TYPE_128:
+		uuid_key_from_data(key, BT_UUID_128(uuid)->val,
+				   sizeof(BT_UUID_128(uuid)->val));
+		break;
+
+	default:
+		return -EINVAL;
+	}
+
+	if (set->size == 0) {
+		return -ENOMEM;
+	}
+
+	u16_t slot = uuid_key_hash(key) % set->size;
+
+	for (size_t i = 0; i < set->size; i++) {
+		if (set->slots[slot] == 0) {
+			set->slots[slot] = idx + 1;
+			return 0;
+		}
+
+		slot = (slot + 1) % set->size;
+	}
+
+	return -ENOMEM;
+}
+
+int scan_uuid_set_find(const struct scan_uuid_set *set, const u8_t *data,
+		       u8_t uuid_len)
+{
+	struct scan_uuid_key key;
+
+	uuid_key_from_data(&key, data, uuid_len);
+
+	return uuid_key_find(set, &key);
+}
+
+void scan_trie_reset(struct scan_trie *trie)
+{
+	__ASSERT_NO_MSG(trie->max_nodes > 0);
+
+	memset(&trie->nodes[0], 0, sizeof(trie->nodes[0]));
+	trie->node_cnt = 1;
+}
+
+static u16_t trie_child_find(const struct scan_trie *trie, u16_t node, u8_t c)
+{
+	for (u16_t child = trie->nodes[node].child;
+	     child != 0;
+	     child = trie->nodes[child].sibling) {
+		if ((u8_t)trie->nodes[child].c == c) {
+			return child;
+		}
+	}
+
+	return 0;
+}
+
+int scan_trie_add(struct scan_trie *trie, const char *name, u8_t idx)
+{
+	if (idx >= SCAN_INDEX_TRIE_MAX_NAMES) {
+		return -ENOMEM;
+	}
+
+	/* Reserve nodes for the whole name, so that a partially added name
+	 * never matches.
+	 */
+	if (trie->node_cnt + strlen(name) > trie->max_nodes) {
+		return -ENOMEM;
+	}
+
+	u32_t mask = BIT(idx);
+	u16_t node = 0;
+
+	trie->nodes[node].subtree_mask |= mask;
+
+	for (; *name != '\0'; name++) {
+		u16_t child = trie_child_find(trie, node, *name);
+
+		if (child == 0) {
+			child = trie->node_cnt++;
+
+			memset(&trie->nodes[child], 0,
+			       sizeof(trie->nodes[child]));
+			trie->nodes[child].c = *name;
+			trie->nodes[child].sibling = trie->nodes[node].child;
+			trie->nodes[node].child = child;
+		}
+
+		node = child;
+		trie->nodes[node].subtree_mask |= mask;
+	}
+
+	trie->nodes[node].end_mask |= mask;
+
+	return 0;
+}
+
+u32_t scan_trie_match(const struct scan_trie *trie, const u8_t *data,
+		      u8_t data_len)
+{
+	u16_t node = 0;
+
+	for (size_t i = 0; i < data_len; i++) {
+		/* Both strings end at the same position. */
+		if (data[i] == '\0') {
+			return trie->nodes[node].end_mask;
+		}
+
+		node = trie_child_find(trie, node, data[i]);
+		if (node == 0) {
+			return 0;
+		}
+	}
+
+	return trie->nodes[node].subtree_mask;
+}
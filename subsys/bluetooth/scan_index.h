@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Scan filter index.
+ *
+ * Private header of the Scanning Module. Data structures used to classify
+ * advertising reports against scan filters without iterating over all
+ * filters of a given type. All structures use storage provided by
+ * the caller.
+ */
+
+#ifndef BT_SCAN_INDEX_H_
+#define BT_SCAN_INDEX_H_
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <bluetooth/addr.h>
+#include <bluetooth/uuid.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of hash slots used to index cnt filters. */
+#define SCAN_INDEX_SLOTS(cnt) (2 * (cnt) + 1)
+
+/* Maximum number of trie nodes needed to index cnt names. */
+#define SCAN_INDEX_TRIE_NODES(cnt, max_len) ((cnt) * (max_len) + 1)
+
+/* Maximum number of names indexed by a single trie. */
+#define SCAN_INDEX_TRIE_MAX_NAMES 32
+
+/* Address set. Slots keep indexes of the addresses incremented by one,
+ * zero marks an empty slot.
+ */
+struct scan_addr_set {
+	const bt_addr_le_t *addrs;
+	u8_t *slots;
+	u16_t size;
+};
+
+/* UUID in the canonical form. UUIDs derived from the Bluetooth Base UUID
+ * are kept as 32-bit values, so that matching is consistent with
+ * bt_uuid_cmp.
+ */
+struct scan_uuid_key {
+	bool is_long;
+	union {
+		u32_t val;
+		u8_t long_val[16];
+	};
+};
+
+/* UUID set. Slots keep indexes of the keys incremented by one,
+ * zero marks an empty slot.
+ */
+struct scan_uuid_set {
+	struct scan_uuid_key *keys;
+	u8_t *slots;
+	u16_t size;
+};
+
+struct scan_trie_node {
+	/* Index of the first child, zero if none. */
+	u16_t child;
+
+	/* Index of the next sibling, zero if none. */
+	u16_t sibling;
+
+	/* Names that have the path to this node as a prefix. */
+	u32_t subtree_mask;
+
+	/* Names that end at this node. */
+	u32_t end_mask;
+
+	char c;
+};
+
+/* Name prefix trie. Node zero is the root. */
+struct scan_trie {
+	struct scan_trie_node *nodes;
+	u16_t max_nodes;
+	u16_t node_cnt;
+};
+
+void scan_addr_set_reset(struct scan_addr_set *set);
+
+/* Index the address that is stored at position idx of the addrs array. */
+int scan_addr_set_add(struct scan_addr_set *set, u8_t idx);
+
+/* Returns the index of the matching address or -ENOENT. */
+int scan_addr_set_find(const struct scan_addr_set *set,
+		       const bt_addr_le_t *addr);
+
+void scan_uuid_set_reset(struct scan_uuid_set *set);
+
+int scan_uuid_set_add(struct scan_uuid_set *set, const struct bt_uuid *uuid,
+		      u8_t idx);
+
+/* Find an advertised UUID. The UUID is given in the little-endian form as
+ * received over the air; uuid_len is 2, 4 or 16.
+ *
+ * Returns the index of the matching UUID or -ENOENT.
+ */
+int scan_uuid_set_find(const struct scan_uuid_set *set, const u8_t *data,
+		       u8_t uuid_len);
+
+void scan_trie_reset(struct scan_trie *trie);
+
+int scan_trie_add(struct scan_trie *trie, const char *name, u8_t idx);
+
+/* Returns the mask of names for which
+ * strncmp(name, data, data_len) == 0.
+ */
+u32_t scan_trie_match(const struct scan_trie *trie, const u8_t *data,
+		      u8_t data_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BT_SCAN_INDEX_H_ */
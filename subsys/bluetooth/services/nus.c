@@ -121,3 +121,358 @@ int bt_gatt_nus_send(struct bt_conn *conn, const u8_t *data, uint16_t len)
 		return -EINVAL;
 	}
 }
+
+#if CONFIG_BT_GATT_NUS_STREAM
+
+#define STREAM_RETRY_DELAY K_MSEC(10)
+
+enum {
+	STREAM_TX_BUSY,
+	STREAM_TX_AGAIN,
+	STREAM_RESET,
+};
+
+static void stream_tx_process(struct bt_gatt_nus_stream *stream);
+
+static void stream_on_sent(struct bt_conn *conn, void *user_data)
+{
+	struct bt_gatt_nus_stream *stream = user_data;
+
+	__ASSERT_NO_MSG(atomic_get(&stream->in_flight) > 0);
+	atomic_dec(&stream->in_flight);
+	stream->stats.notifications++;
+
+	stream_tx_process(stream);
+	k_sem_give(&stream->tx_sem);
+
+	if (stream->sent_cb) {
+		stream->sent_cb(stream);
+	}
+}
+
+static void stream_retry_fn(struct k_work *work)
+{
+	struct bt_gatt_nus_stream *stream =
+		CONTAINER_OF(work, struct bt_gatt_nus_stream, retry_work);
+
+	stream_tx_process(stream);
+}
+
+static u32_t stream_claim(struct bt_gatt_nus_stream *stream, u32_t len,
+			  u8_t **data)
+{
+	u32_t size;
+
+	k_spinlock_key_t key = k_spin_lock(&stream->lock);
+
+	u32_t avail = (stream->buf_size - 1) - ring_buf_space_get(&stream->rb);
+
+	size = ring_buf_get_claim(&stream->rb, data, len);
+	if ((size > 0) && (size < MIN(len, avail))) {
+		/* Data wraps around the buffer end. Copy it to get a full
+		 * notification.
+		 */
+		u8_t *next;
+		u32_t next_size;
+
+		memcpy(stream->payload, *data, size);
+		next_size = ring_buf_get_claim(&stream->rb, &next,
+					       MIN(len, avail) - size);
+		memcpy(&stream->payload[size], next, next_size);
+
+		*data = stream->payload;
+		size += next_size;
+	}
+
+	k_spin_unlock(&stream->lock, key);
+
+	return size;
+}
+
+static void stream_finish(struct bt_gatt_nus_stream *stream, u32_t size)
+{
+	k_spinlock_key_t key = k_spin_lock(&stream->lock);
+	int err = ring_buf_get_finish(&stream->rb, size);
+
+	k_spin_unlock(&stream->lock, key);
+
+	__ASSERT_NO_MSG(!err);
+	ARG_UNUSED(err);
+}
+
+static void stream_tx(struct bt_gatt_nus_stream *stream)
+{
+	struct bt_gatt_notify_params params = {
+		.attr = &nus_svc.attrs[2],
+		.func = stream_on_sent,
+		.user_data = stream,
+	};
+
+	while (atomic_get(&stream->in_flight) <
+	       CONFIG_BT_GATT_NUS_STREAM_IN_FLIGHT) {
+		k_spinlock_key_t key = k_spin_lock(&stream->lock);
+		struct bt_conn *conn = stream->conn;
+
+		if (conn) {
+			bt_conn_ref(conn);
+		}
+		k_spin_unlock(&stream->lock, key);
+
+		if (!conn) {
+			return;
+		}
+
+		u32_t len = MIN(bt_gatt_nus_max_send(conn),
+				BT_GATT_NUS_STREAM_PAYLOAD_MAX);
+		u8_t *data;
+		u32_t size = stream_claim(stream, len, &data);
+
+		if ((size == 0) ||
+		    ((size < len) && (atomic_get(&stream->in_flight) > 0))) {
+			/* Wait for more data to fill the notification. It will
+			 * be sent when the notifications in flight complete.
+			 */
+			stream_finish(stream, 0);
+			bt_conn_unref(conn);
+			return;
+		}
+
+		params.data = data;
+		params.len = size;
+
+		atomic_inc(&stream->in_flight);
+		int err = bt_gatt_notify_cb(conn, &params);
+
+		bt_conn_unref(conn);
+
+		if (err) {
+			atomic_dec(&stream->in_flight);
+			stream_finish(stream, 0);
+
+			if (err != -ENOMEM) {
+				LOG_WRN("Cannot send stream data (err %d)",
+					err);
+				return;
+			}
+
+			stream->stats.retries++;
+			if (atomic_get(&stream->in_flight) == 0) {
+				/* No completion will trigger retry. */
+				k_delayed_work_submit(&stream->retry_work,
+						      STREAM_RETRY_DELAY);
+			}
+
+			return;
+		}
+
+		stream_finish(stream, size);
+		stream->stats.tx_bytes += size;
+		k_sem_give(&stream->tx_sem);
+	}
+}
+
+static void stream_tx_process(struct bt_gatt_nus_stream *stream)
+{
+	/* Only one context sends the stream data. Other contexts request
+	 * another pass of the sending one.
+	 */
+	do {
+		if (atomic_test_and_set_bit(&stream->flags, STREAM_TX_BUSY)) {
+			atomic_set_bit(&stream->flags, STREAM_TX_AGAIN);
+			return;
+		}
+
+		atomic_clear_bit(&stream->flags, STREAM_TX_AGAIN);
+
+		if (atomic_test_and_clear_bit(&stream->flags, STREAM_RESET)) {
+			/* Data of the stopped stream is dropped here, where
+			 * no part of the buffer is claimed.
+			 */
+			k_spinlock_key_t key = k_spin_lock(&stream->lock);
+
+			ring_buf_reset(&stream->rb);
+			k_spin_unlock(&stream->lock, key);
+		}
+
+		stream_tx(stream);
+		atomic_clear_bit(&stream->flags, STREAM_TX_BUSY);
+	} while (atomic_test_bit(&stream->flags, STREAM_TX_AGAIN));
+}
+
+static s32_t timeout_remaining(s32_t timeout, s64_t start)
+{
+	if ((timeout == K_FOREVER) || (timeout == K_NO_WAIT)) {
+		return timeout;
+	}
+
+	s64_t remaining = timeout - (k_uptime_get() - start);
+
+	return (remaining > 0) ? remaining : K_NO_WAIT;
+}
+
+int bt_gatt_nus_stream_init(struct bt_gatt_nus_stream *stream,
+			    bt_gatt_nus_stream_sent_cb_t sent_cb)
+{
+	if (!stream->buf || !stream->buf_size) {
+		return -EINVAL;
+	}
+
+	ring_buf_init(&stream->rb, stream->buf_size, stream->buf);
+	k_sem_init(&stream->tx_sem, 0, 1);
+	k_delayed_work_init(&stream->retry_work, stream_retry_fn);
+	atomic_set(&stream->flags, 0);
+	atomic_set(&stream->in_flight, 0);
+	memset(&stream->stats, 0, sizeof(stream->stats));
+	stream->sent_cb = sent_cb;
+	stream->conn = NULL;
+
+	return 0;
+}
+
+int bt_gatt_nus_stream_start(struct bt_gatt_nus_stream *stream,
+			     struct bt_conn *conn)
+{
+	int err = 0;
+	k_spinlock_key_t key = k_spin_lock(&stream->lock);
+
+	if (stream->conn) {
+		err = -EALREADY;
+	} else {
+		stream->conn = bt_conn_ref(conn);
+	}
+
+	k_spin_unlock(&stream->lock, key);
+
+	return err;
+}
+
+void bt_gatt_nus_stream_stop(struct bt_gatt_nus_stream *stream)
+{
+	k_spinlock_key_t key = k_spin_lock(&stream->lock);
+	struct bt_conn *conn = stream->conn;
+
+	stream->conn = NULL;
+
+	k_spin_unlock(&stream->lock, key);
+
+	k_delayed_work_cancel(&stream->retry_work);
+
+	if (conn) {
+		bt_conn_unref(conn);
+	}
+
+	/* The buffer is reset by the context sending the stream, which may
+	 * be in the middle of a claim now.
+	 */
+	atomic_set_bit(&stream->flags, STREAM_RESET);
+	stream_tx_process(stream);
+
+	/* Wake up waiting writers. */
+	k_sem_give(&stream->tx_sem);
+}
+
+static int stream_check(struct bt_gatt_nus_stream *stream)
+{
+	int err = 0;
+	k_spinlock_key_t key = k_spin_lock(&stream->lock);
+
+	if (!stream->conn) {
+		err = -ENOTCONN;
+	} else if (!is_notification_enabled(stream->conn,
+					    nus_svc.attrs[2].user_data)) {
+		err = -EINVAL;
+	}
+
+	k_spin_unlock(&stream->lock, key);
+
+	return err;
+}
+
+int bt_gatt_nus_stream_write(struct bt_gatt_nus_stream *stream,
+			     const void *data, size_t len, s32_t timeout)
+{
+	const u8_t *src = data;
+	size_t written = 0;
+	s64_t start = k_uptime_get();
+
+	while (true) {
+		int err = stream_check(stream);
+
+		if (err) {
+			return (written > 0) ? written : err;
+		}
+
+		k_spinlock_key_t key = k_spin_lock(&stream->lock);
+
+		if (!stream->conn) {
+			/* Stopped after the check. */
+			k_spin_unlock(&stream->lock, key);
+			return (written > 0) ? written : -ENOTCONN;
+		}
+
+		written += ring_buf_put(&stream->rb, &src[written],
+					len - written);
+
+		k_spin_unlock(&stream->lock, key);
+
+		stream_tx_process(stream);
+
+		if (written == len) {
+			break;
+		}
+
+		/* Buffer is full, wait until notifications are sent. */
+		s32_t remaining = timeout_remaining(timeout, start);
+
+		if ((remaining == K_NO_WAIT) ||
+		    k_sem_take(&stream->tx_sem, remaining)) {
+			break;
+		}
+	}
+
+	LOG_DBG("Stream write %zu, accepted %zu", len, written);
+
+	return written;
+}
+
+int bt_gatt_nus_stream_flush(struct bt_gatt_nus_stream *stream,
+			     s32_t timeout)
+{
+	s64_t start = k_uptime_get();
+
+	while (true) {
+		k_spinlock_key_t key = k_spin_lock(&stream->lock);
+		bool connected = (stream->conn != NULL);
+		bool empty = ring_buf_is_empty(&stream->rb);
+
+		k_spin_unlock(&stream->lock, key);
+
+		if (!connected) {
+			return -ENOTCONN;
+		}
+
+		if (empty && (atomic_get(&stream->in_flight) == 0)) {
+			return 0;
+		}
+
+		/* Partially filled notification is sent when nothing is in
+		 * flight.
+		 */
+		stream_tx_process(stream);
+
+		s32_t remaining = timeout_remaining(timeout, start);
+
+		if ((remaining == K_NO_WAIT) ||
+		    k_sem_take(&stream->tx_sem, remaining)) {
+			return -EAGAIN;
+		}
+	}
+}
+
+void bt_gatt_nus_stream_stats_get(struct bt_gatt_nus_stream *stream,
+				  struct bt_gatt_nus_stream_stats *stats)
+{
+	*stats = stream->stats;
+}
+
+#endif /* CONFIG_BT_GATT_NUS_STREAM */
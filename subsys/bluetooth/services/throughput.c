@@ -23,6 +23,7 @@ LOG_MODULE_REGISTER(bt_gatt_throughput, CONFIG_BT_GATT_THROUGHPUT_LOG_LEVEL);
 
 static struct bt_gatt_throughput_metrics met;
 static const struct bt_gatt_throughput_cb *callbacks;
+static atomic_t notify_enabled;
 
 static u8_t read_fn(struct bt_conn *conn, u8_t err,
 		    struct bt_gatt_read_params *params, const void *data,
@@ -44,23 +45,18 @@ static u8_t read_fn(struct bt_conn *conn, u8_t err,
 	return BT_GATT_ITER_STOP;
 }
 
-static ssize_t write_callback(struct bt_conn *conn,
-			      const struct bt_gatt_attr *attr, const void *buf,
-			      u16_t len, u16_t offset, u8_t flags)
+static void data_receive(struct bt_gatt_throughput_metrics *met_data,
+			 u16_t len)
 {
 	static u32_t clock_cycles;
-	static u32_t kb;
 
 	u64_t delta;
 
-	struct bt_gatt_throughput_metrics *met_data = attr->user_data;
-
 	delta = k_cycle_get_32() - clock_cycles;
 	delta = SYS_CLOCK_HW_CYCLES_TO_NS64(delta);
 
 	if (len == 1) {
 		/* reset metrics */
-		kb = 0;
 		met_data->write_count = 0;
 		met_data->write_len = 0;
 		met_data->write_rate = 0;
@@ -72,15 +68,48 @@ static ssize_t write_callback(struct bt_conn *conn,
 		    ((u64_t)met_data->write_len << 3) * 1000000000 / delta;
 	}
 
-	LOG_DBG("Received data.");
-
 	if (callbacks->data_received) {
 		callbacks->data_received(met_data);
 	}
+}
+
+static ssize_t write_callback(struct bt_conn *conn,
+			      const struct bt_gatt_attr *attr, const void *buf,
+			      u16_t len, u16_t offset, u8_t flags)
+{
+	LOG_DBG("Received data.");
+
+	data_receive(attr->user_data, len);
 
 	return len;
 }
 
+static u8_t notify_fn(struct bt_conn *conn,
+		      struct bt_gatt_subscribe_params *params,
+		      const void *data, u16_t len)
+{
+	if (!data) {
+		LOG_DBG("Unsubscribed.");
+		params->value_handle = 0;
+		return BT_GATT_ITER_STOP;
+	}
+
+	LOG_DBG("Received notification.");
+
+	data_receive(&met, len);
+
+	return BT_GATT_ITER_CONTINUE;
+}
+
+static void ccc_cfg_changed(const struct bt_gatt_attr *attr, u16_t value)
+{
+	bool enabled = (value == BT_GATT_CCC_NOTIFY);
+
+	LOG_DBG("Notifications %s.", enabled ? "enabled" : "disabled");
+
+	atomic_set(&notify_enabled, enabled);
+}
+
 static ssize_t read_callback(struct bt_conn *conn,
 			     const struct bt_gatt_attr *attr, void *buf,
 			     u16_t len, u16_t offset)
@@ -103,9 +132,11 @@ static ssize_t read_callback(struct bt_conn *conn,
 BT_GATT_SERVICE_DEFINE(throughput_svc,
 BT_GATT_PRIMARY_SERVICE(BT_UUID_THROUGHPUT),
 	BT_GATT_CHARACTERISTIC(BT_UUID_THROUGHPUT_CHAR,
-		BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+		BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE_WITHOUT_RESP |
+		BT_GATT_CHRC_NOTIFY,
 		BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
 		read_callback, write_callback, &met),
+	BT_GATT_CCC(ccc_cfg_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
 );
 
 int bt_gatt_throughput_init(struct bt_gatt_throughput *throughput,
@@ -152,6 +183,15 @@ int bt_gatt_throughput_handles_assign(struct bt_gatt_dm *dm,
 	LOG_DBG("Found handle for Throughput characteristic.");
 	throughput->char_handle = gatt_desc->handle;
 
+	/* Notifications are optional, older servers do not support them. */
+	gatt_desc = bt_gatt_dm_desc_by_uuid(dm, gatt_chrc, BT_UUID_GATT_CCC);
+	if (gatt_desc) {
+		LOG_DBG("Found handle for CCC of Throughput characteristic.");
+		throughput->ccc_handle = gatt_desc->handle;
+	} else {
+		throughput->ccc_handle = 0;
+	}
+
 	/* Assign connection object. */
 	throughput->conn = bt_gatt_dm_conn_get(dm);
 	return 0;
@@ -181,3 +221,44 @@ int bt_gatt_throughput_write(struct bt_gatt_throughput *throughput,
 					      throughput->char_handle,
 					      data, len, false);
 }
+
+int bt_gatt_throughput_subscribe(struct bt_gatt_throughput *throughput)
+{
+	int err;
+
+	if (!throughput->ccc_handle) {
+		return -ENOTSUP;
+	}
+
+	throughput->subscribe_params.notify = notify_fn;
+	throughput->subscribe_params.value = BT_GATT_CCC_NOTIFY;
+	throughput->subscribe_params.value_handle = throughput->char_handle;
+	throughput->subscribe_params.ccc_handle = throughput->ccc_handle;
+
+	err = bt_gatt_subscribe(throughput->conn,
+				&throughput->subscribe_params);
+	if (err) {
+		LOG_ERR("Subscribe failed (err %d)", err);
+	}
+
+	return err;
+}
+
+int bt_gatt_throughput_notify(struct bt_conn *conn, const u8_t *data,
+			      u16_t len, bt_gatt_complete_func_t func,
+			      void *user_data)
+{
+	struct bt_gatt_notify_params params = {
+		.attr = &throughput_svc.attrs[2],
+		.data = data,
+		.len = len,
+		.func = func,
+		.user_data = user_data,
+	};
+
+	if (!atomic_get(&notify_enabled)) {
+		return -EINVAL;
+	}
+
+	return bt_gatt_notify_cb(conn, &params);
+}
@@ -45,6 +45,9 @@
  /* The maximum value for PID. */
 #define PID_MAX 3
 
+/* Header of a payload in an aggregated ACK packet: pipe and length. */
+#define ACK_ELEM_HDR_LEN 2
+
 #define BIT_MASK_UINT_8(x) (0xFF >> (8 - (x)))
 
 #define RADIO_SHORTS_COMMON                                                    \
@@ -117,26 +120,35 @@ struct pipe_info {
 			   * Used to detect retransmits.
 			   */
 	bool ack_payload; /* State of the transmission of ACK payloads. */
+	u8_t ack_cnt;	  /* Number of TX FIFO payloads in the last ACK. */
 };
 
-/* First-in, first-out queue of payloads to be transmitted. */
+/* The payload FIFOs are single-producer, single-consumer queues. Only the
+ * producer moves the back index and only the consumer moves the front
+ * index, so neither side needs to mask interrupts. The indices run from 0 to
+ * twice the queue size to tell a full queue from an empty one.
+ */
+
+/* First-in, first-out queue of payloads to be transmitted.
+ * Produced by the application, consumed by the radio interrupt.
+ */
 struct payload_tx_fifo {
 	 /* Payload queue */
 	struct nrf_esb_payload *payload[CONFIG_NRF_ESB_TX_FIFO_SIZE];
 
-	u32_t back;	/* Back of the queue (last in). */
-	u32_t front;	/* Front of queue (first out). */
-	u32_t count;	/* Number of elements in the queue. */
+	volatile u32_t back;	/* Back of the queue (last in). */
+	volatile u32_t front;	/* Front of queue (first out). */
 };
 
-/* First-in, first-out queue of received payloads. */
+/* First-in, first-out queue of received payloads.
+ * Produced by the radio interrupt, consumed by the application.
+ */
 struct payload_rx_fifo {
 	 /* Payload queue */
 	struct nrf_esb_payload *payload[CONFIG_NRF_ESB_RX_FIFO_SIZE];
 
-	u32_t back;	/* Back of the queue (last in). */
-	u32_t front;	/* Front of queue (first out). */
-	u32_t count;	/* Number of elements in the queue. */
+	volatile u32_t back;	/* Back of the queue (last in). */
+	volatile u32_t front;	/* Front of queue (first out). */
 };
 
 /* Enhanced ShockBurst address.
@@ -181,6 +193,7 @@ static struct nrf_esb_payload *current_payload;
 /* FIFOs and buffers */
 static struct payload_tx_fifo tx_fifo;
 static struct payload_rx_fifo rx_fifo;
+static bool tx_slot_reserved;
 static u8_t tx_payload_buffer[CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH + 2];
 static u8_t rx_payload_buffer[CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH + 2];
 
@@ -191,6 +204,7 @@ static volatile u32_t interrupt_flags;
 static volatile u32_t retransmits_remaining;
 static volatile u32_t last_tx_attempts;
 static volatile u32_t wait_for_ack_timeout_us;
+static u8_t burst_cnt;
 
 static u32_t radio_shorts_common = RADIO_SHORTS_COMMON;
 
@@ -432,11 +446,24 @@ static bool update_radio_crc(void)
 	return true;
 }
 
+static void update_radio_ramp_up(void)
+{
+#if defined(RADIO_MODECNF0_RU_Msk)
+	/* Fast ramp-up shortens the gap between packets of a burst. */
+	u32_t ru = (esb_cfg.burst_length > 1) ? RADIO_MODECNF0_RU_Fast :
+						RADIO_MODECNF0_RU_Default;
+
+	NRF_RADIO->MODECNF0 = (NRF_RADIO->MODECNF0 & ~RADIO_MODECNF0_RU_Msk) |
+			      (ru << RADIO_MODECNF0_RU_Pos);
+#endif
+}
+
 static bool update_radio_parameters(void)
 {
 	bool params_valid = true;
 
 	update_radio_tx_power();
+	update_radio_ramp_up();
 	params_valid &= update_radio_bitrate();
 	params_valid &= update_radio_protocol();
 	params_valid &= update_radio_crc();
@@ -447,15 +474,48 @@ static bool update_radio_parameters(void)
 	return params_valid;
 }
 
+static u32_t fifo_count(u32_t back, u32_t front, u32_t size)
+{
+	return (back >= front) ? (back - front) : (back + 2 * size - front);
+}
+
+static u32_t fifo_next(u32_t idx, u32_t size)
+{
+	return (idx + 1 < 2 * size) ? (idx + 1) : 0;
+}
+
+static u32_t fifo_slot(u32_t idx, u32_t size)
+{
+	return (idx < size) ? idx : (idx - size);
+}
+
+static u32_t tx_fifo_count(void)
+{
+	return fifo_count(tx_fifo.back, tx_fifo.front,
+			  CONFIG_NRF_ESB_TX_FIFO_SIZE);
+}
+
+static struct nrf_esb_payload *tx_fifo_front(void)
+{
+	return tx_fifo.payload[fifo_slot(tx_fifo.front,
+					 CONFIG_NRF_ESB_TX_FIFO_SIZE)];
+}
+
+static u32_t rx_fifo_count(void)
+{
+	return fifo_count(rx_fifo.back, rx_fifo.front,
+			  CONFIG_NRF_ESB_RX_FIFO_SIZE);
+}
+
 static void reset_fifos(void)
 {
 	tx_fifo.back = 0;
 	tx_fifo.front = 0;
-	tx_fifo.count = 0;
+	tx_slot_reserved = false;
+	burst_cnt = 0;
 
 	rx_fifo.back = 0;
 	rx_fifo.front = 0;
-	rx_fifo.count = 0;
 }
 
 static void initialize_fifos(void)
@@ -476,18 +536,38 @@ static void initialize_fifos(void)
 
 static void tx_fifo_remove_last(void)
 {
-	if (tx_fifo.count == 0) {
+	if (tx_fifo_count() == 0) {
 		return;
 	}
 
-	u32_t key = irq_lock();
+	/* Payload must not be accessed after the slot is released. */
+	__DMB();
+	tx_fifo.front = fifo_next(tx_fifo.front, CONFIG_NRF_ESB_TX_FIFO_SIZE);
+}
 
-	tx_fifo.count--;
-	if (++tx_fifo.front >= CONFIG_NRF_ESB_TX_FIFO_SIZE) {
-		tx_fifo.front = 0;
+static bool rx_fifo_push(u8_t pipe, u8_t pid, const u8_t *data, u8_t length)
+{
+	if (rx_fifo_count() >= CONFIG_NRF_ESB_RX_FIFO_SIZE) {
+		return false;
 	}
 
-	irq_unlock(key);
+	struct nrf_esb_payload *payload =
+		rx_fifo.payload[fifo_slot(rx_fifo.back,
+					  CONFIG_NRF_ESB_RX_FIFO_SIZE)];
+
+	memcpy(payload->data, data, length);
+
+	payload->length = length;
+	payload->pipe = pipe;
+	payload->rssi = NRF_RADIO->RSSISAMPLE;
+	payload->pid = pid;
+	payload->noack = !(rx_payload_buffer[1] & 0x01);
+
+	/* Payload must be complete before it is published. */
+	__DMB();
+	rx_fifo.back = fifo_next(rx_fifo.back, CONFIG_NRF_ESB_RX_FIFO_SIZE);
+
+	return true;
 }
 
 /*  Function to push the content of the rx_buffer to the RX FIFO.
@@ -504,36 +584,59 @@ static void tx_fifo_remove_last(void)
  */
 static bool rx_fifo_push_rfbuf(u8_t pipe, u8_t pid)
 {
-	if (rx_fifo.count >= CONFIG_NRF_ESB_RX_FIFO_SIZE) {
-		return false;
-	}
+	u8_t length;
 
 	if (esb_cfg.protocol == NRF_ESB_PROTOCOL_ESB_DPL) {
 		if (rx_payload_buffer[0] > CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH) {
 			return false;
 		}
-		rx_fifo.payload[rx_fifo.back]->length = rx_payload_buffer[0];
+		length = rx_payload_buffer[0];
 	} else if (esb_cfg.mode == NRF_ESB_MODE_PTX) {
 		/* Received packet is an acknowledgment */
-		rx_fifo.payload[rx_fifo.back]->length = 0;
+		length = 0;
 	} else {
-		rx_fifo.payload[rx_fifo.back]->length = esb_cfg.payload_length;
+		length = esb_cfg.payload_length;
+	}
+
+	return rx_fifo_push(pipe, pid, &rx_payload_buffer[2], length);
+}
+
+/*  Function to split an aggregated ACK payload from the rx_buffer into
+ *  separate payloads in the RX FIFO. Payloads that do not fit in the RX FIFO
+ *  are dropped.
+ *
+ *  @param  pid  Packet ID.
+ *
+ *  @retval true   At least one payload was pushed.
+ *  @retval false  Operation failed.
+ */
+static bool rx_fifo_push_aggregated(u8_t pid)
+{
+	u32_t length = rx_payload_buffer[0];
+	const u8_t *elem = &rx_payload_buffer[2];
+	bool pushed = false;
+
+	if (length > CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH) {
+		return false;
 	}
 
-	memcpy(rx_fifo.payload[rx_fifo.back]->data, &rx_payload_buffer[2],
-	       rx_fifo.payload[rx_fifo.back]->length);
+	while (length >= ACK_ELEM_HDR_LEN) {
+		u8_t pipe = elem[0];
+		u8_t elem_len = elem[1];
 
-	rx_fifo.payload[rx_fifo.back]->pipe = pipe;
-	rx_fifo.payload[rx_fifo.back]->rssi = NRF_RADIO->RSSISAMPLE;
-	rx_fifo.payload[rx_fifo.back]->pid = pid;
-	rx_fifo.payload[rx_fifo.back]->noack = !(rx_payload_buffer[1] & 0x01);
+		if ((pipe >= CONFIG_NRF_ESB_PIPE_COUNT) ||
+		    (ACK_ELEM_HDR_LEN + elem_len > length) ||
+		    !rx_fifo_push(pipe, pid, &elem[ACK_ELEM_HDR_LEN],
+				  elem_len)) {
+			break;
+		}
 
-	if (++rx_fifo.back >= CONFIG_NRF_ESB_RX_FIFO_SIZE) {
-		rx_fifo.back = 0;
+		pushed = true;
+		elem += ACK_ELEM_HDR_LEN + elem_len;
+		length -= ACK_ELEM_HDR_LEN + elem_len;
 	}
-	rx_fifo.count++;
 
-	return true;
+	return pushed;
 }
 
 static void sys_timer_init(void)
@@ -568,13 +671,42 @@ static void ppi_init(void)
 		(u32_t)&NRF_RADIO->TASKS_TXEN;
 }
 
+/* Check if the current payload is sent as a part of a burst, that is,
+ * without waiting for the acknowledgment. The burst ends with the first
+ * payload for another pipe.
+ */
+static bool burst_continues(void)
+{
+	if ((esb_cfg.burst_length <= 1) ||
+	    (esb_cfg.tx_mode == NRF_ESB_TXMODE_MANUAL) ||
+	    (burst_cnt + 1 >= esb_cfg.burst_length) ||
+	    (tx_fifo_count() < 2)) {
+		burst_cnt = 0;
+		return false;
+	}
+
+	u32_t next = fifo_next(tx_fifo.front, CONFIG_NRF_ESB_TX_FIFO_SIZE);
+	const struct nrf_esb_payload *next_payload =
+		tx_fifo.payload[fifo_slot(next, CONFIG_NRF_ESB_TX_FIFO_SIZE)];
+
+	if (next_payload->pipe != current_payload->pipe) {
+		burst_cnt = 0;
+		return false;
+	}
+
+	burst_cnt++;
+
+	return true;
+}
+
 static void start_tx_transaction(void)
 {
 	bool ack;
+	bool burst;
 
 	last_tx_attempts = 1;
 	/* Prepare the payload */
-	current_payload = tx_fifo.payload[tx_fifo.front];
+	current_payload = tx_fifo_front();
 
 	switch (esb_cfg.protocol) {
 	case NRF_ESB_PROTOCOL_ESB:
@@ -596,10 +728,13 @@ static void start_tx_transaction(void)
 		break;
 
 	case NRF_ESB_PROTOCOL_ESB_DPL:
-		ack = !current_payload->noack || !esb_cfg.selective_auto_ack;
+		burst = burst_continues();
+		ack = !burst &&
+		      (!current_payload->noack || !esb_cfg.selective_auto_ack);
 		tx_payload_buffer[0] = current_payload->length;
 		tx_payload_buffer[1] = current_payload->pid << 1;
-		tx_payload_buffer[1] |= current_payload->noack ? 0x00 : 0x01;
+		tx_payload_buffer[1] |=
+			(current_payload->noack || burst) ? 0x00 : 0x01;
 		memcpy(&tx_payload_buffer[2], current_payload->data,
 		       current_payload->length);
 
@@ -650,7 +785,7 @@ static void on_radio_disabled_tx_noack(void)
 	interrupt_flags |= INT_TX_SUCCESS_MSK;
 	tx_fifo_remove_last();
 
-	if (tx_fifo.count == 0) {
+	if (tx_fifo_count() == 0) {
 		esb_state = ESB_STATE_IDLE;
 		NVIC_SetPendingIRQ(ESB_EVT_IRQ);
 	} else {
@@ -716,14 +851,23 @@ static void on_radio_disabled_tx_wait_for_ack(void)
 
 		if (esb_cfg.protocol != NRF_ESB_PROTOCOL_ESB &&
 		    rx_payload_buffer[0] > 0) {
-			if (rx_fifo_push_rfbuf((u8_t)NRF_RADIO->TXADDRESS,
-					       rx_payload_buffer[1] >> 1)) {
+			u8_t pid = rx_payload_buffer[1] >> 1;
+			bool pushed;
+
+			if (esb_cfg.ack_aggregation) {
+				pushed = rx_fifo_push_aggregated(pid);
+			} else {
+				pushed = rx_fifo_push_rfbuf(
+					(u8_t)NRF_RADIO->TXADDRESS, pid);
+			}
+
+			if (pushed) {
 				interrupt_flags |=
 					INT_RX_DATA_RECEIVED_MSK;
 			}
 		}
 
-		if ((tx_fifo.count == 0) ||
+		if ((tx_fifo_count() == 0) ||
 		    (esb_cfg.tx_mode == NRF_ESB_TXMODE_MANUAL)) {
 			esb_state = ESB_STATE_IDLE;
 			NVIC_SetPendingIRQ(ESB_EVT_IRQ);
@@ -782,36 +926,86 @@ static void clear_events_restart_rx(void)
 	NRF_RADIO->TASKS_RXEN = 1;
 }
 
+/* Put payloads from the front of the TX FIFO into one ACK packet.
+ *
+ * @param max_cnt	Maximum number of payloads.
+ *
+ * @return Number of payloads in the ACK packet.
+ */
+static u8_t ack_payload_aggregate(u8_t max_cnt)
+{
+	u32_t idx = tx_fifo.front;
+	u32_t avail = tx_fifo_count();
+	u32_t length = 0;
+	u8_t cnt = 0;
+
+	while ((cnt < avail) && (cnt < max_cnt)) {
+		const struct nrf_esb_payload *payload =
+			tx_fifo.payload[fifo_slot(idx,
+						  CONFIG_NRF_ESB_TX_FIFO_SIZE)];
+		u8_t *elem = &tx_payload_buffer[2 + length];
+
+		if (length + ACK_ELEM_HDR_LEN + payload->length >
+		    CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH) {
+			break;
+		}
+
+		elem[0] = payload->pipe;
+		elem[1] = payload->length;
+		memcpy(&elem[ACK_ELEM_HDR_LEN], payload->data,
+		       payload->length);
+
+		length += ACK_ELEM_HDR_LEN + payload->length;
+		idx = fifo_next(idx, CONFIG_NRF_ESB_TX_FIFO_SIZE);
+		cnt++;
+	}
+
+	update_rf_payload_format(length);
+	tx_payload_buffer[0] = length;
+
+	return cnt;
+}
+
 static void on_radio_disabled_rx_dpl(bool retransmit_payload,
 				     struct pipe_info *pipe_info)
 {
-	if (tx_fifo.count > 0 &&
-	    (tx_fifo.payload[tx_fifo.front]->pipe == NRF_RADIO->RXMATCH)) {
-		/* Pipe stays in ACK with payload until TX FIFO is empty */
-		/* Do not report TX success on first ack payload or retransmit
+	/* Do not report TX success on first ack payload or retransmit */
+	if (pipe_info->ack_payload && !retransmit_payload &&
+	    tx_fifo_count() > 0 &&
+	    (tx_fifo_front()->pipe == NRF_RADIO->RXMATCH)) {
+		for (u8_t i = 0; i < pipe_info->ack_cnt; i++) {
+			tx_fifo_remove_last();
+		}
+
+		/* ACK payloads also require TX_DS */
+		/* (page 40 of the
+		 * 'nRF24LE1_Product_Specification_rev1_6.pdf').
 		 */
-		if (pipe_info->ack_payload && !retransmit_payload) {
-			if (++tx_fifo.front >= CONFIG_NRF_ESB_TX_FIFO_SIZE) {
-				tx_fifo.front = 0;
-			}
+		interrupt_flags |= INT_TX_SUCCESS_MSK;
+	}
 
-			tx_fifo.count--;
+	/* Pipe stays in ACK with payload until TX FIFO is empty */
+	if (tx_fifo_count() > 0 &&
+	    (tx_fifo_front()->pipe == NRF_RADIO->RXMATCH)) {
+		if (esb_cfg.ack_aggregation) {
+			/* Retransmitted ACK must carry the same payloads. */
+			u8_t max_cnt = (pipe_info->ack_payload &&
+					retransmit_payload) ?
+				       pipe_info->ack_cnt : UINT8_MAX;
 
-			/* ACK payloads also require TX_DS */
-			/* (page 40 of the
-			 * 'nRF24LE1_Product_Specification_rev1_6.pdf').
-			 */
-			interrupt_flags |= INT_TX_SUCCESS_MSK;
-		}
+			pipe_info->ack_cnt = ack_payload_aggregate(max_cnt);
+		} else {
+			current_payload = tx_fifo_front();
 
-		pipe_info->ack_payload = true;
+			update_rf_payload_format(current_payload->length);
+			tx_payload_buffer[0] = current_payload->length;
+			memcpy(&tx_payload_buffer[2], current_payload->data,
+			       current_payload->length);
 
-		current_payload = tx_fifo.payload[tx_fifo.front];
+			pipe_info->ack_cnt = 1;
+		}
 
-		update_rf_payload_format(current_payload->length);
-		tx_payload_buffer[0] = current_payload->length;
-		memcpy(&tx_payload_buffer[2], current_payload->data,
-		       current_payload->length);
+		pipe_info->ack_payload = (pipe_info->ack_cnt > 0);
 	} else {
 		pipe_info->ack_payload = false;
 		update_rf_payload_format(0);
@@ -832,7 +1026,7 @@ static void on_radio_disabled_rx(void)
 		return;
 	}
 
-	if (rx_fifo.count >= CONFIG_NRF_ESB_RX_FIFO_SIZE) {
+	if (rx_fifo_count() >= CONFIG_NRF_ESB_RX_FIFO_SIZE) {
 		clear_events_restart_rx();
 		return;
 	}
@@ -995,6 +1189,10 @@ int nrf_esb_init(const struct nrf_esb_config *config)
 	if (config == NULL) {
 		return -EINVAL;
 	}
+	if ((config->burst_length > 1) &&
+	    (config->protocol != NRF_ESB_PROTOCOL_ESB_DPL)) {
+		return -EINVAL;
+	}
 
 	if (esb_initialized) {
 		nrf_esb_disable();
@@ -1140,7 +1338,7 @@ bool nrf_esb_is_idle(void)
 	return (esb_state == ESB_STATE_IDLE);
 }
 
-int nrf_esb_write_payload(const struct nrf_esb_payload *payload)
+int nrf_esb_reserve_payload(struct nrf_esb_payload **payload)
 {
 	if (!esb_initialized) {
 		return -EACCES;
@@ -1148,34 +1346,51 @@ int nrf_esb_write_payload(const struct nrf_esb_payload *payload)
 	if (payload == NULL) {
 		return -EINVAL;
 	}
+	if (tx_fifo_count() >= CONFIG_NRF_ESB_TX_FIFO_SIZE) {
+		return -ENOMEM;
+	}
+
+	*payload = tx_fifo.payload[fifo_slot(tx_fifo.back,
+					     CONFIG_NRF_ESB_TX_FIFO_SIZE)];
+	tx_slot_reserved = true;
+
+	return 0;
+}
+
+int nrf_esb_commit_payload(void)
+{
+	if (!esb_initialized) {
+		return -EACCES;
+	}
+	if (!tx_slot_reserved) {
+		return -EINVAL;
+	}
+
+	struct nrf_esb_payload *payload =
+		tx_fifo.payload[fifo_slot(tx_fifo.back,
+					  CONFIG_NRF_ESB_TX_FIFO_SIZE)];
+
 	if (payload->length == 0 ||
 	    payload->length > CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH ||
 	    (esb_cfg.protocol == NRF_ESB_PROTOCOL_ESB &&
-	     payload->length > esb_cfg.payload_length)) {
+	     payload->length > esb_cfg.payload_length) ||
+	    (esb_cfg.mode == NRF_ESB_MODE_PRX && esb_cfg.ack_aggregation &&
+	     payload->length + ACK_ELEM_HDR_LEN >
+	     CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH)) {
 		return -EMSGSIZE;
 	}
-	if (tx_fifo.count >= CONFIG_NRF_ESB_TX_FIFO_SIZE) {
-		return -ENOMEM;
-	}
 	if (payload->pipe >= CONFIG_NRF_ESB_PIPE_COUNT) {
 		return -EINVAL;
 	}
 
-	u32_t key = irq_lock();
-
-	memcpy(tx_fifo.payload[tx_fifo.back], payload,
-	       sizeof(struct nrf_esb_payload));
-
 	pids[payload->pipe] = (pids[payload->pipe] + 1) % (PID_MAX + 1);
-	tx_fifo.payload[tx_fifo.back]->pid = pids[payload->pipe];
+	payload->pid = pids[payload->pipe];
 
-	if (++tx_fifo.back >= CONFIG_NRF_ESB_TX_FIFO_SIZE) {
-		tx_fifo.back = 0;
-	}
+	tx_slot_reserved = false;
 
-	tx_fifo.count++;
-
-	irq_unlock(key);
+	/* Payload must be complete before it is published. */
+	__DMB();
+	tx_fifo.back = fifo_next(tx_fifo.back, CONFIG_NRF_ESB_TX_FIFO_SIZE);
 
 	if (esb_cfg.mode == NRF_ESB_MODE_PTX &&
 	    esb_cfg.tx_mode == NRF_ESB_TXMODE_AUTO &&
@@ -1186,7 +1401,31 @@ int nrf_esb_write_payload(const struct nrf_esb_payload *payload)
 	return 0;
 }
 
-int nrf_esb_read_rx_payload(struct nrf_esb_payload *payload)
+int nrf_esb_write_payload(const struct nrf_esb_payload *payload)
+{
+	struct nrf_esb_payload *slot;
+
+	if (payload == NULL) {
+		return -EINVAL;
+	}
+
+	int err = nrf_esb_reserve_payload(&slot);
+
+	if (err) {
+		return err;
+	}
+
+	memcpy(slot, payload, sizeof(*slot));
+
+	err = nrf_esb_commit_payload();
+	if (err) {
+		tx_slot_reserved = false;
+	}
+
+	return err;
+}
+
+int nrf_esb_acquire_rx_payload(struct nrf_esb_payload **payload)
 {
 	if (!esb_initialized) {
 		return -EACCES;
@@ -1194,30 +1433,56 @@ int nrf_esb_read_rx_payload(struct nrf_esb_payload *payload)
 	if (payload == NULL) {
 		return -EINVAL;
 	}
+	if (rx_fifo_count() == 0) {
+		return -ENODATA;
+	}
+
+	/* Payload must not be read before it is published. */
+	__DMB();
+	*payload = rx_fifo.payload[fifo_slot(rx_fifo.front,
+					     CONFIG_NRF_ESB_RX_FIFO_SIZE)];
+
+	return 0;
+}
 
-	if (rx_fifo.count == 0) {
+int nrf_esb_release_rx_payload(void)
+{
+	if (!esb_initialized) {
+		return -EACCES;
+	}
+	if (rx_fifo_count() == 0) {
 		return -ENODATA;
 	}
 
-	u32_t key = irq_lock();
+	/* Payload must not be accessed after the slot is released. */
+	__DMB();
+	rx_fifo.front = fifo_next(rx_fifo.front, CONFIG_NRF_ESB_RX_FIFO_SIZE);
+
+	return 0;
+}
 
-	payload->length = rx_fifo.payload[rx_fifo.front]->length;
-	payload->pipe = rx_fifo.payload[rx_fifo.front]->pipe;
-	payload->rssi = rx_fifo.payload[rx_fifo.front]->rssi;
-	payload->pid = rx_fifo.payload[rx_fifo.front]->pid;
-	payload->noack = rx_fifo.payload[rx_fifo.front]->noack;
-	memcpy(payload->data, rx_fifo.payload[rx_fifo.front]->data,
-	       payload->length);
+int nrf_esb_read_rx_payload(struct nrf_esb_payload *payload)
+{
+	struct nrf_esb_payload *slot;
 
-	if (++rx_fifo.front >= CONFIG_NRF_ESB_RX_FIFO_SIZE) {
-		rx_fifo.front = 0;
+	if (payload == NULL) {
+		return -EINVAL;
 	}
 
-	rx_fifo.count--;
+	int err = nrf_esb_acquire_rx_payload(&slot);
 
-	irq_unlock(key);
+	if (err) {
+		return err;
+	}
 
-	return 0;
+	payload->length = slot->length;
+	payload->pipe = slot->pipe;
+	payload->rssi = slot->rssi;
+	payload->pid = slot->pid;
+	payload->noack = slot->noack;
+	memcpy(payload->data, slot->data, payload->length);
+
+	return nrf_esb_release_rx_payload();
 }
 
 int nrf_esb_start_tx(void)
@@ -1226,7 +1491,7 @@ int nrf_esb_start_tx(void)
 		return -EBUSY;
 	}
 
-	if (tx_fifo.count == 0) {
+	if (tx_fifo_count() == 0) {
 		return -ENODATA;
 	}
 
@@ -1294,9 +1559,9 @@ int nrf_esb_flush_tx(void)
 
 	u32_t key = irq_lock();
 
-	tx_fifo.count = 0;
 	tx_fifo.back = 0;
 	tx_fifo.front = 0;
+	tx_slot_reserved = false;
 
 	irq_unlock(key);
 
@@ -1308,16 +1573,14 @@ int nrf_esb_pop_tx(void)
 	if (!esb_initialized) {
 		return -EACCES;
 	}
-	if (tx_fifo.count == 0) {
+	if (tx_fifo_count() == 0) {
 		return -ENODATA;
 	}
 
+	/* Front is owned by the radio interrupt. */
 	u32_t key = irq_lock();
 
-	if (++tx_fifo.back >= CONFIG_NRF_ESB_TX_FIFO_SIZE) {
-		tx_fifo.back = 0;
-	}
-	tx_fifo.count--;
+	tx_fifo_remove_last();
 
 	irq_unlock(key);
 
@@ -1332,7 +1595,6 @@ int nrf_esb_flush_rx(void)
 
 	u32_t key = irq_lock();
 
-	rx_fifo.count = 0;
 	rx_fifo.back = 0;
 	rx_fifo.front = 0;
 
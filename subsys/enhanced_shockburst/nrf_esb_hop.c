@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <errno.h>
+#include <string.h>
+#include <misc/util.h>
+#include <misc/byteorder.h>
+#include <toolchain/common.h>
+#include <nrf_esb_hop.h>
+
+/* Seed used when the configured seed is zero, which would stop xorshift. */
+#define SEED_DEFAULT 0x2545F491
+
+/* Weight of the previous packet error rate in the moving average. */
+#define PER_WEIGHT 7
+#define PER_DIVISOR (PER_WEIGHT + 1)
+#define PER_MAX 255
+
+/* Channel 103 does not exist, its bit in the encoded channel map in use
+ * flags a pending update.
+ */
+#define SYNC_PENDING_BYTE (4 + NRF_ESB_HOP_MAP_SIZE - 1)
+#define SYNC_PENDING_BIT BIT(7)
+
+BUILD_ASSERT_MSG(NRF_ESB_HOP_SYNC_INFO_LEN_MAX <=
+		 CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH,
+		 "Synchronization info does not fit in a payload");
+
+static bool map_test(const u8_t *map, u8_t channel)
+{
+	return (map[channel / 8] & (1 << (channel % 8))) != 0;
+}
+
+static void map_set(u8_t *map, u8_t channel)
+{
+	map[channel / 8] |= (1 << (channel % 8));
+}
+
+static void map_clear(u8_t *map, u8_t channel)
+{
+	map[channel / 8] &= ~(1 << (channel % 8));
+}
+
+static bool map_valid(const u8_t *map)
+{
+	size_t cnt = 0;
+
+	for (size_t i = 0; i < NRF_ESB_HOP_MAP_SIZE * 8; i++) {
+		if (!map_test(map, i)) {
+			continue;
+		}
+		if (i >= NRF_ESB_HOP_CHANNEL_COUNT) {
+			return false;
+		}
+		cnt++;
+	}
+
+	return cnt >= NRF_ESB_HOP_CHANNELS_MIN;
+}
+
+static u32_t xorshift32(u32_t *state)
+{
+	u32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+/* The hop sequence is a permutation of the used channels. It depends only
+ * on the seed and the channel map, so both devices build the same sequence.
+ */
+static void seq_build(struct nrf_esb_hop *hop)
+{
+	u32_t state = hop->cfg.seed ? hop->cfg.seed : SEED_DEFAULT;
+	u8_t len = 0;
+
+	for (u8_t ch = 0; ch < NRF_ESB_HOP_CHANNEL_COUNT; ch++) {
+		if (map_test(hop->map, ch)) {
+			hop->seq[len++] = ch;
+		}
+	}
+
+	/* Fisher-Yates shuffle. */
+	for (u8_t i = len - 1; i > 0; i--) {
+		u8_t j = xorshift32(&state) % (i + 1);
+		u8_t tmp = hop->seq[i];
+
+		hop->seq[i] = hop->seq[j];
+		hop->seq[j] = tmp;
+	}
+
+	hop->seq_len = len;
+}
+
+static void map_apply(struct nrf_esb_hop *hop, const u8_t *map, u32_t instant)
+{
+	memcpy(hop->map, map, sizeof(hop->map));
+	hop->instant = instant;
+	hop->pending = false;
+	seq_build(hop);
+}
+
+static bool instant_passed(u32_t slot, u32_t instant)
+{
+	return (s32_t)(slot - instant) >= 0;
+}
+
+int nrf_esb_hop_init(struct nrf_esb_hop *hop,
+		     const struct nrf_esb_hop_config *cfg)
+{
+	if (!map_valid(cfg->map)) {
+		return -EINVAL;
+	}
+
+	memset(hop, 0, sizeof(*hop));
+	hop->cfg = *cfg;
+	map_apply(hop, cfg->map, 0);
+
+	return 0;
+}
+
+u8_t nrf_esb_hop_channel(const struct nrf_esb_hop *hop)
+{
+	return hop->seq[hop->slot % hop->seq_len];
+}
+
+u8_t nrf_esb_hop_next(struct nrf_esb_hop *hop)
+{
+	hop->slot++;
+
+	if (hop->pending && instant_passed(hop->slot, hop->pending_instant)) {
+		map_apply(hop, hop->pending_map, hop->pending_instant);
+	}
+
+	return nrf_esb_hop_channel(hop);
+}
+
+u8_t nrf_esb_hop_cycle_len(const struct nrf_esb_hop *hop)
+{
+	return hop->seq_len;
+}
+
+int nrf_esb_hop_sync(struct nrf_esb_hop *hop, u8_t channel)
+{
+	u8_t len = hop->seq_len;
+	u8_t pos;
+
+	for (pos = 0; pos < len; pos++) {
+		if (hop->seq[pos] == channel) {
+			break;
+		}
+	}
+
+	if (pos == len) {
+		return -ENOENT;
+	}
+
+	u8_t fwd = (pos + len - hop->slot % len) % len;
+	u8_t back = (len - fwd) % len;
+
+	/* Moving back before slot 0 would break the slot to position
+	 * mapping, so the slot is moved forward instead.
+	 */
+	if ((back < fwd) && (hop->slot >= back)) {
+		hop->slot -= back;
+	} else {
+		hop->slot += fwd;
+	}
+
+	return 0;
+}
+
+void nrf_esb_hop_tx_result(struct nrf_esb_hop *hop, u8_t channel,
+			   u32_t tx_attempts, bool success)
+{
+	if ((channel >= NRF_ESB_HOP_CHANNEL_COUNT) || (tx_attempts == 0)) {
+		return;
+	}
+
+	u32_t errors = success ? (tx_attempts - 1) : tx_attempts;
+	u32_t sample = errors * PER_MAX / tx_attempts;
+
+	hop->per[channel] = (hop->per[channel] * PER_WEIGHT + sample) /
+			    PER_DIVISOR;
+}
+
+bool nrf_esb_hop_map_update(struct nrf_esb_hop *hop)
+{
+	u8_t map[NRF_ESB_HOP_MAP_SIZE];
+	u8_t used = 0;
+	u8_t used_min = MAX(hop->cfg.channels_min, NRF_ESB_HOP_CHANNELS_MIN);
+
+	if (hop->pending) {
+		return false;
+	}
+
+	memcpy(map, hop->map, sizeof(map));
+
+	for (u8_t ch = 0; ch < NRF_ESB_HOP_CHANNEL_COUNT; ch++) {
+		if (map_test(map, ch)) {
+			used++;
+		} else if (map_test(hop->cfg.map, ch) &&
+			   (hop->slot - hop->excluded_at[ch] >=
+			    hop->cfg.blacklist_slots)) {
+			/* Give the channel another chance. */
+			map_set(map, ch);
+			hop->per[ch] = hop->cfg.per_threshold / 2;
+			used++;
+		}
+	}
+
+	while (used > used_min) {
+		u8_t worst = NRF_ESB_HOP_CHANNEL_COUNT;
+
+		for (u8_t ch = 0; ch < NRF_ESB_HOP_CHANNEL_COUNT; ch++) {
+			if (!map_test(map, ch) ||
+			    (hop->per[ch] <= hop->cfg.per_threshold)) {
+				continue;
+			}
+			if ((worst == NRF_ESB_HOP_CHANNEL_COUNT) ||
+			    (hop->per[ch] > hop->per[worst])) {
+				worst = ch;
+			}
+		}
+
+		if (worst == NRF_ESB_HOP_CHANNEL_COUNT) {
+			break;
+		}
+
+		map_clear(map, worst);
+		hop->excluded_at[worst] = hop->slot;
+		used--;
+	}
+
+	if (!memcmp(map, hop->map, sizeof(map))) {
+		return false;
+	}
+
+	memcpy(hop->pending_map, map, sizeof(map));
+	hop->pending_instant = hop->slot + hop->cfg.instant_offset;
+	hop->pending = true;
+
+	return true;
+}
+
+void nrf_esb_hop_sync_info_get(const struct nrf_esb_hop *hop,
+			       struct nrf_esb_hop_sync_info *info)
+{
+	memcpy(info->map, hop->map, sizeof(info->map));
+	if (hop->pending) {
+		memcpy(info->next_map, hop->pending_map,
+		       sizeof(info->next_map));
+		info->instant = hop->pending_instant;
+	} else {
+		memcpy(info->next_map, hop->map, sizeof(info->next_map));
+		info->instant = hop->instant;
+	}
+	info->slot = hop->slot;
+}
+
+int nrf_esb_hop_sync_info_apply(struct nrf_esb_hop *hop,
+				const struct nrf_esb_hop_sync_info *info)
+{
+	if (!map_valid(info->map) || !map_valid(info->next_map)) {
+		return -EINVAL;
+	}
+
+	hop->slot = info->slot;
+
+	/* Map in use differs if an earlier update was missed. */
+	if (memcmp(info->map, hop->map, sizeof(hop->map))) {
+		map_apply(hop, info->map, info->slot);
+	}
+
+	if (!memcmp(info->next_map, hop->map, sizeof(hop->map))) {
+		hop->pending = false;
+	} else if (instant_passed(hop->slot, info->instant)) {
+		map_apply(hop, info->next_map, info->instant);
+	} else {
+		memcpy(hop->pending_map, info->next_map,
+		       sizeof(hop->pending_map));
+		hop->pending_instant = info->instant;
+		hop->pending = true;
+	}
+
+	return 0;
+}
+
+size_t nrf_esb_hop_sync_info_encode(const struct nrf_esb_hop_sync_info *info,
+				    u8_t *buf)
+{
+	sys_put_le32(info->slot, buf);
+	memcpy(&buf[4], info->map, sizeof(info->map));
+
+	if (!memcmp(info->next_map, info->map, sizeof(info->map))) {
+		return NRF_ESB_HOP_SYNC_INFO_LEN_MIN;
+	}
+
+	buf[SYNC_PENDING_BYTE] |= SYNC_PENDING_BIT;
+	sys_put_le16(info->instant - info->slot,
+		     &buf[NRF_ESB_HOP_SYNC_INFO_LEN_MIN]);
+	memcpy(&buf[NRF_ESB_HOP_SYNC_INFO_LEN_MIN + 2], info->next_map,
+	       sizeof(info->next_map));
+
+	return NRF_ESB_HOP_SYNC_INFO_LEN_MAX;
+}
+
+int nrf_esb_hop_sync_info_decode(struct nrf_esb_hop_sync_info *info,
+				 const u8_t *buf, size_t len)
+{
+	bool pending;
+
+	if (len < NRF_ESB_HOP_SYNC_INFO_LEN_MIN) {
+		return -EINVAL;
+	}
+
+	pending = (buf[SYNC_PENDING_BYTE] & SYNC_PENDING_BIT) != 0;
+	if (len != (pending ? NRF_ESB_HOP_SYNC_INFO_LEN_MAX :
+			      NRF_ESB_HOP_SYNC_INFO_LEN_MIN)) {
+		return -EINVAL;
+	}
+
+	info->slot = sys_get_le32(buf);
+	memcpy(info->map, &buf[4], sizeof(info->map));
+	info->map[NRF_ESB_HOP_MAP_SIZE - 1] &= ~SYNC_PENDING_BIT;
+
+	if (pending) {
+		info->instant = info->slot +
+			sys_get_le16(&buf[NRF_ESB_HOP_SYNC_INFO_LEN_MIN]);
+		memcpy(info->next_map, &buf[NRF_ESB_HOP_SYNC_INFO_LEN_MIN + 2],
+		       sizeof(info->next_map));
+	} else {
+		info->instant = info->slot;
+		memcpy(info->next_map, info->map, sizeof(info->next_map));
+	}
+
+	return 0;
+}
@@ -127,6 +127,38 @@ static void trace_event_execution(const struct event_header *eh, bool is_start)
 	profiler_log_send(&buf, trace_evt_id);
 }
 
+static u32_t trace_listener_start(void)
+{
+	if (!IS_ENABLED(CONFIG_DESKTOP_EVENT_MANAGER_TRACE_LISTENER_EXECUTION)) {
+		return 0;
+	}
+
+	return k_cycle_get_32();
+}
+
+static void trace_listener_execution(const struct event_listener *el,
+				     u32_t start_time)
+{
+	if (!IS_ENABLED(CONFIG_DESKTOP_EVENT_MANAGER_TRACE_LISTENER_EXECUTION)) {
+		return;
+	}
+
+	size_t event_cnt = __stop_event_types - __start_event_types;
+	size_t trace_evt_id = profiler_event_ids[event_cnt + 2];
+
+	if (!is_profiling_enabled(trace_evt_id)) {
+		return;
+	}
+
+	struct log_event_buf buf;
+	ARG_UNUSED(buf);
+
+	profiler_log_start(&buf);
+	profiler_log_add_mem_address(&buf, el);
+	profiler_log_encode_u32(&buf, k_cycle_get_32() - start_time);
+	profiler_log_send(&buf, trace_evt_id);
+}
+
 static void trace_event_submission(const struct event_header *eh)
 {
 	if (!IS_ENABLED(CONFIG_DESKTOP_EVENT_MANAGER_PROFILER_ENABLED)) {
@@ -181,6 +213,21 @@ static void trace_register_execution_tracking_events(void)
 	profiler_event_ids[event_cnt + 1] = profiler_event_id;
 }
 
+static void trace_register_listener_tracking_events(void)
+{
+	const char *labels[] = {"listener", "cycles"};
+	enum profiler_arg types[] = {PROFILER_ARG_U32, PROFILER_ARG_U32};
+	size_t event_cnt = __stop_event_types - __start_event_types;
+
+	ARG_UNUSED(types);
+	ARG_UNUSED(labels);
+
+	/* Listener execution event after event execution events. */
+	profiler_event_ids[event_cnt + 2] = profiler_register_event_type(
+				"listener_execution",
+				labels, types, ARRAY_SIZE(types));
+}
+
 static void trace_register_events(void)
 {
 	for (const struct event_type *et = __start_event_types;
@@ -201,6 +248,10 @@ static void trace_register_events(void)
 	if (IS_ENABLED(CONFIG_DESKTOP_EVENT_MANAGER_TRACE_EVENT_EXECUTION)) {
 		trace_register_execution_tracking_events();
 	}
+
+	if (IS_ENABLED(CONFIG_DESKTOP_EVENT_MANAGER_TRACE_LISTENER_EXECUTION)) {
+		trace_register_listener_tracking_events();
+	}
 }
 
 static int trace_event_init(void)
@@ -268,8 +319,12 @@ static void event_processor_fn(struct k_work *work)
 
 				log_event_progress(et, el);
 
+				u32_t start_time = trace_listener_start();
+
 				consumed = el->notification(eh);
 
+				trace_listener_execution(el, start_time);
+
 				if (consumed) {
 					log_event_consumed(et);
 				}
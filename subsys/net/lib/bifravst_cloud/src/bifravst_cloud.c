@@ -84,8 +84,45 @@ static struct mqtt_client client;
 
 static struct sockaddr_storage broker;
 
+#if defined(CONFIG_BIFRAVST_CLOUD_DNS_CACHE)
+/* Broker address is valid until this uptime (ms), 0 if not resolved. */
+static s64_t broker_expiry;
+#endif
+
+/* Uptime (ms) when the last connection attempt started. */
+static s64_t connect_start;
+
 static struct cloud_backend *bifravst_cloud_backend;
 
+static atomic_t message_id;
+
+#if defined(CONFIG_BIFRAVST_CLOUD_SEND_QUEUE)
+struct bifravst_cloud_queued_msg {
+	char *buf;
+	size_t len;
+	u8_t *topic;
+	enum mqtt_qos qos;
+	enum cloud_endpoint endpoint;
+	u16_t id;
+	bool published;
+	bool done;
+};
+
+/* Messages in [queue_head, queue_tail) are waiting to be acknowledged, the
+ * ones in [queue_next, queue_tail) have not been published on the current
+ * connection. The counters run freely and are reduced modulo the queue size
+ * when indexing.
+ */
+static struct bifravst_cloud_queued_msg
+	send_queue[CONFIG_BIFRAVST_CLOUD_SEND_QUEUE_SIZE];
+static u32_t queue_head;
+static u32_t queue_next;
+static u32_t queue_tail;
+static bool mqtt_connected;
+
+K_MUTEX_DEFINE(send_queue_lock);
+#endif
+
 static int mqtt_client_id_get(char *id)
 {
 	int err;
@@ -208,8 +245,34 @@ static int bifravst_init(const struct cloud_backend *const backend,
 	return err;	
 }
 
+static u16_t message_id_next(void)
+{
+	u16_t id;
+
+	/* 0 is not a valid message ID, and the subscription has its own. */
+	do {
+		id = (u16_t)(atomic_inc(&message_id) + 1);
+	} while (id == 0 || id == CC_SUBSCRIBE_ID);
+
+	return id;
+}
+
+static u8_t *endpoint_topic_get(enum cloud_endpoint type)
+{
+	switch (type) {
+	case CLOUD_EP_TOPIC_PAIR:
+		return get_topic;
+	case CLOUD_EP_TOPIC_MSG:
+		return update_topic;
+	case CLOUD_EP_TOPIC_BATCH:
+		return batch_topic;
+	default:
+		return NULL;
+	}
+}
+
 static int mqtt_data_publish(struct mqtt_client *c, enum mqtt_qos qos, u8_t *data,
-			size_t len, u8_t *topic)
+			size_t len, u8_t *topic, u16_t id, bool dup)
 {
 	struct mqtt_publish_param param;
 
@@ -218,8 +281,8 @@ static int mqtt_data_publish(struct mqtt_client *c, enum mqtt_qos qos, u8_t *dat
 	param.message.topic.topic.size = strlen(topic);
 	param.message.payload.data = data;
 	param.message.payload.len = len;
-	param.message_id = sys_rand32_get();
-	param.dup_flag = 0;
+	param.message_id = id;
+	param.dup_flag = dup;
 	param.retain_flag = 0;
 
 	LOG_DBG("Publishing to topic: %s", param.message.topic.topic.utf8);
@@ -227,6 +290,146 @@ static int mqtt_data_publish(struct mqtt_client *c, enum mqtt_qos qos, u8_t *dat
 	return mqtt_publish(c, &param);
 }
 
+#if defined(CONFIG_BIFRAVST_CLOUD_SEND_QUEUE)
+static void send_queue_complete(struct bifravst_cloud_queued_msg *queued)
+{
+	struct cloud_event cloud_evt = {
+		.type = CLOUD_EVT_DATA_SENT,
+		.data.msg = {
+			.buf = queued->buf,
+			.len = queued->len,
+			.qos = (enum cloud_qos)queued->qos,
+			.id = queued->id,
+			.endpoint.type = queued->endpoint
+		}
+	};
+
+	LOG_DBG("Message %d sent", queued->id);
+
+	cloud_notify_event(bifravst_cloud_backend, &cloud_evt,
+			   bifravst_cloud_backend->config->user_data);
+
+	k_free(queued->buf);
+	queued->buf = NULL;
+	queued->done = true;
+
+	while (queue_head != queue_tail &&
+	       send_queue[queue_head % ARRAY_SIZE(send_queue)].done) {
+		queue_head++;
+	}
+}
+
+static void send_queue_ack(u16_t id)
+{
+	k_mutex_lock(&send_queue_lock, K_FOREVER);
+
+	for (u32_t i = queue_head; i != queue_next; i++) {
+		struct bifravst_cloud_queued_msg *queued =
+			&send_queue[i % ARRAY_SIZE(send_queue)];
+
+		if (!queued->done && queued->id == id) {
+			send_queue_complete(queued);
+			break;
+		}
+	}
+
+	k_mutex_unlock(&send_queue_lock);
+}
+
+static void send_queue_connected_set(bool connected)
+{
+	k_mutex_lock(&send_queue_lock, K_FOREVER);
+
+	mqtt_connected = connected;
+
+	/* Unacknowledged messages are published again with the DUP flag
+	 * on the new connection.
+	 */
+	if (connected) {
+		queue_next = queue_head;
+	}
+
+	k_mutex_unlock(&send_queue_lock);
+}
+
+static int send_queue_drain(void)
+{
+	int err = 0;
+
+	k_mutex_lock(&send_queue_lock, K_FOREVER);
+
+	while (mqtt_connected && queue_next != queue_tail) {
+		struct bifravst_cloud_queued_msg *queued =
+			&send_queue[queue_next % ARRAY_SIZE(send_queue)];
+
+		/* QoS 0 messages are not published again, not even after
+		 * a reconnect, as they are never acknowledged.
+		 */
+		if (queued->done ||
+		    (queued->published &&
+		     queued->qos == MQTT_QOS_0_AT_MOST_ONCE)) {
+			queue_next++;
+			continue;
+		}
+
+		err = mqtt_data_publish(&client, queued->qos, queued->buf,
+					queued->len, queued->topic, queued->id,
+					queued->published);
+		if (err != 0) {
+			LOG_ERR("Publishing message %d failed, error: %d",
+				queued->id, err);
+			break;
+		}
+
+		queued->published = true;
+		queue_next++;
+	}
+
+	k_mutex_unlock(&send_queue_lock);
+
+	return err;
+}
+
+/* No acknowledgment will come for QoS 0, so the messages are completed
+ * once published. This is done from cloud_input() and not when they are
+ * published, so that CLOUD_EVT_DATA_SENT is never notified from within
+ * cloud_send_async().
+ */
+static void send_queue_complete_unacked(void)
+{
+	k_mutex_lock(&send_queue_lock, K_FOREVER);
+
+	for (u32_t i = queue_head; i != queue_tail; i++) {
+		struct bifravst_cloud_queued_msg *queued =
+			&send_queue[i % ARRAY_SIZE(send_queue)];
+
+		if (!queued->done && queued->published &&
+		    queued->qos == MQTT_QOS_0_AT_MOST_ONCE) {
+			send_queue_complete(queued);
+		}
+	}
+
+	k_mutex_unlock(&send_queue_lock);
+}
+#else
+static inline void send_queue_ack(u16_t id)
+{
+}
+
+static inline void send_queue_connected_set(bool connected)
+{
+}
+
+static inline int send_queue_drain(void)
+{
+	return 0;
+}
+
+static inline void send_queue_complete_unacked(void)
+{
+}
+#endif
+
 static int mqtt_ep_subscribe(void)
 {
 	const struct mqtt_subscription_list subscription_list = {
@@ -272,9 +475,19 @@ static void mqtt_evt_handler(struct mqtt_client *const c,
 
 	switch (mqtt_evt->type) {
 	case MQTT_EVT_CONNACK:
-		LOG_DBG("MQTT client connected!");
+		LOG_DBG("MQTT client connected in %d ms, session present: %d",
+			(int)(k_uptime_get() - connect_start),
+			mqtt_evt->param.connack.session_present_flag);
+
+		/* Subscriptions are kept by the broker in a persistent
+		 * session, so they are only renewed when it was lost.
+		 */
+		if (!IS_ENABLED(CONFIG_BIFRAVST_CLOUD_PERSISTENT_SESSION) ||
+		    !mqtt_evt->param.connack.session_present_flag) {
+			mqtt_ep_subscribe();
+		}
 
-		mqtt_ep_subscribe();	
+		send_queue_connected_set(true);
 
 		cloud_evt.type = CLOUD_EVT_CONNECTED;
 		cloud_notify_event(bifravst_cloud_backend, &cloud_evt,
@@ -284,6 +497,8 @@ static void mqtt_evt_handler(struct mqtt_client *const c,
 	case MQTT_EVT_DISCONNECT:
 		LOG_DBG("MQTT_EVT_DISCONNECT: result=%d", mqtt_evt->result);
 
+		send_queue_connected_set(false);
+
 		cloud_evt.type = CLOUD_EVT_DISCONNECTED;
 		cloud_notify_event(bifravst_cloud_backend, &cloud_evt,
 				   config->user_data);
@@ -314,6 +529,38 @@ static void mqtt_evt_handler(struct mqtt_client *const c,
 		LOG_DBG("MQTT_EVT_PUBACK: id=%d result=%d",
 			mqtt_evt->param.puback.message_id,
 			mqtt_evt->result);
+
+		if (mqtt_evt->result == 0) {
+			send_queue_ack(mqtt_evt->param.puback.message_id);
+		}
+		break;
+
+	case MQTT_EVT_PUBREC: {
+		const struct mqtt_pubrel_param pubrel = {
+			.message_id = mqtt_evt->param.pubrec.message_id
+		};
+
+		LOG_DBG("MQTT_EVT_PUBREC: id=%d result=%d",
+			mqtt_evt->param.pubrec.message_id,
+			mqtt_evt->result);
+
+		if (mqtt_evt->result == 0) {
+			err = mqtt_publish_qos2_release(c, &pubrel);
+			if (err != 0) {
+				LOG_ERR("mqtt_publish_qos2_release: Failed! %d",
+					err);
+			}
+		}
+	} break;
+
+	case MQTT_EVT_PUBCOMP:
+		LOG_DBG("MQTT_EVT_PUBCOMP: id=%d result=%d",
+			mqtt_evt->param.pubcomp.message_id,
+			mqtt_evt->result);
+
+		if (mqtt_evt->result == 0) {
+			send_queue_ack(mqtt_evt->param.pubcomp.message_id);
+		}
 		break;
 
 	case MQTT_EVT_SUBACK:
@@ -345,9 +592,34 @@ static int mqtt_broker_init(void)
 	return err;
 }
 #else
+static bool broker_cache_valid(void)
+{
+#if defined(CONFIG_BIFRAVST_CLOUD_DNS_CACHE)
+	return (broker_expiry != 0) && (k_uptime_get() < broker_expiry);
+#else
+	return false;
+#endif
+}
+
+static void broker_cache_update(void)
+{
+#if defined(CONFIG_BIFRAVST_CLOUD_DNS_CACHE)
+	broker_expiry = k_uptime_get() +
+			K_SECONDS(CONFIG_BIFRAVST_CLOUD_DNS_CACHE_TTL);
+#endif
+}
+
+static void broker_cache_invalidate(void)
+{
+#if defined(CONFIG_BIFRAVST_CLOUD_DNS_CACHE)
+	broker_expiry = 0;
+#endif
+}
+
 static int mqtt_broker_init(void)
 {
 	int err;
+	bool found = false;
 	struct addrinfo *result;
 	struct addrinfo *addr;
 	struct addrinfo hints = {
@@ -355,6 +627,11 @@ static int mqtt_broker_init(void)
 		.ai_socktype = SOCK_STREAM
 	};
 
+	if (broker_cache_valid()) {
+		LOG_DBG("Using cached broker address");
+		return 0;
+	}
+
 	err = getaddrinfo(CONFIG_BIFRAVST_CLOUD_HOST_NAME, NULL, &hints, &result);
 	if (err) {
 		LOG_ERR("getaddrinfo failed %d", err);
@@ -379,6 +656,7 @@ static int mqtt_broker_init(void)
 			inet_ntop(AF_INET, &broker4->sin_addr.s_addr, ipv4_addr,
 				  sizeof(ipv4_addr));
 			LOG_DBG("IPv4 Address found %s", ipv4_addr);	
+			found = true;
 			break;
 		} else if ((addr->ai_addrlen == sizeof(struct sockaddr_in6)) &&
 			   (BIFRAVST_CLOUD_AF_FAMILY == AF_INET6)) {
@@ -396,6 +674,7 @@ static int mqtt_broker_init(void)
 			inet_ntop(AF_INET, &broker6->sin6_addr.s6_addr, ipv6_addr,
 				  sizeof(ipv6_addr));
 			LOG_DBG("IPv4 Address found %s", ipv6_addr);
+			found = true;
 			break;
 		} else {
 			LOG_DBG("ai_addrlen = %u should be %u or %u",
@@ -410,6 +689,10 @@ static int mqtt_broker_init(void)
 
 	freeaddrinfo(result);
 
+	if (found) {
+		broker_cache_update();
+	}
+
 	return 0;
 }
 #endif
@@ -437,6 +720,8 @@ static int mqtt_client_broker_init(struct mqtt_client *client)
 	client->tx_buf			= tx_buffer;
 	client->tx_buf_size		= sizeof(tx_buffer);
 	client->transport.type		= MQTT_TRANSPORT_SECURE;
+	client->clean_session		=
+		!IS_ENABLED(CONFIG_BIFRAVST_CLOUD_PERSISTENT_SESSION);
 
 	static sec_tag_t sec_tag_list[] = { CONFIG_BIFRAVST_CLOUD_SEC_TAG };
 	struct mqtt_sec_config *tls_cfg = &(client->transport).tls.config;
@@ -455,6 +740,8 @@ static int bifravst_connect(const struct cloud_backend *const backend)
 {
 	int err;
 
+	connect_start = k_uptime_get();
+
 	err = mqtt_client_broker_init(&client);
 	if (err != 0) {
 		LOG_ERR("Client not initialized, error: %d", err);
@@ -464,6 +751,10 @@ static int bifravst_connect(const struct cloud_backend *const backend)
 	err = mqtt_connect(&client);
 	if (err != 0) {
 		LOG_ERR("MQTT not connected, error: %d", err);
+#if !defined(CONFIG_BIFRAVST_CLOUD_STATIC_IPV4)
+		/* The broker may have moved, resolve it again next time. */
+		broker_cache_invalidate();
+#endif
 		return err;
 	}
 
@@ -484,29 +775,85 @@ static int bifravst_send(const struct cloud_backend *const backend,
 		.buf 	= msg->buf,
 		.len 	= msg->len,
 		.qos	= msg->qos,
+		.topic	= endpoint_topic_get(msg->endpoint.type),
 	};
 
-	switch (msg->endpoint.type) {
-	case CLOUD_EP_TOPIC_PAIR:
-		cloud_tx_data.topic = get_topic;
-		break;
-	case CLOUD_EP_TOPIC_MSG:
-		cloud_tx_data.topic = update_topic;
-		break;
-	case CLOUD_EP_TOPIC_BATCH:
-		cloud_tx_data.topic = batch_topic;
-		break;
-	default:
-		break;
+	if (cloud_tx_data.topic == NULL) {
+		return -EINVAL;
 	}
 
 	return mqtt_data_publish(&client, cloud_tx_data.qos, cloud_tx_data.buf,
-				cloud_tx_data.len, cloud_tx_data.topic);
+				cloud_tx_data.len, cloud_tx_data.topic,
+				message_id_next(), false);
+}
+
+#if defined(CONFIG_BIFRAVST_CLOUD_SEND_QUEUE)
+static int bifravst_send_async(const struct cloud_backend *const backend,
+			       struct cloud_msg *const msg)
+{
+	struct bifravst_cloud_queued_msg *queued;
+	u8_t *topic = endpoint_topic_get(msg->endpoint.type);
+	char *buf = NULL;
+
+	if (topic == NULL) {
+		return -EINVAL;
+	}
+
+	if (msg->len > 0) {
+		buf = k_malloc(msg->len);
+		if (buf == NULL) {
+			return -ENOMEM;
+		}
+
+		memcpy(buf, msg->buf, msg->len);
+	}
+
+	k_mutex_lock(&send_queue_lock, K_FOREVER);
+
+	if (queue_tail - queue_head == ARRAY_SIZE(send_queue)) {
+		k_mutex_unlock(&send_queue_lock);
+		k_free(buf);
+		return -ENOBUFS;
+	}
+
+	queued = &send_queue[queue_tail % ARRAY_SIZE(send_queue)];
+	queued->buf = buf;
+	queued->len = msg->len;
+	queued->topic = topic;
+	queued->qos = (enum mqtt_qos)msg->qos;
+	queued->endpoint = msg->endpoint.type;
+	queued->id = message_id_next();
+	queued->published = false;
+	queued->done = false;
+	queue_tail++;
+
+	msg->id = queued->id;
+
+	k_mutex_unlock(&send_queue_lock);
+
+	LOG_DBG("Message %d queued", msg->id);
+
+	/* A failed publish leaves the message queued, it is retried the
+	 * next time input is processed.
+	 */
+	(void)send_queue_drain();
+
+	return 0;
 }
+#endif
 
 static int bifravst_input(const struct cloud_backend *const backend)
 {
-	return mqtt_input(&client);
+	int err;
+
+	err = mqtt_input(&client);
+	if (err != 0) {
+		return err;
+	}
+
+	send_queue_complete_unacked();
+
+	return send_queue_drain();
 }
 
 static int bifravst_ping(const struct cloud_backend *const backend)
@@ -519,6 +866,9 @@ static const struct cloud_api bifravst_cloud_api = {
 	.connect	= bifravst_connect,
 	.disconnect	= bifravst_disconnect,
 	.send		= bifravst_send,
+#if defined(CONFIG_BIFRAVST_CLOUD_SEND_QUEUE)
+	.send_async	= bifravst_send_async,
+#endif
 	.ping		= bifravst_ping,
 	.input		= bifravst_input
 };
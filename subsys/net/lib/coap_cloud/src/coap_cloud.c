@@ -0,0 +1,1110 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <net/coap.h>
+#include <net/socket.h>
+#include <net/cloud.h>
+#include <net/cloud_backend.h>
+
+#include <logging/log.h>
+
+LOG_MODULE_REGISTER(coap_cloud, CONFIG_COAP_CLOUD_LOG_LEVEL);
+
+#define COAP_VERSION 1
+#define TOKEN_LEN 8
+
+/* Block1 and Block2 option value fields, see RFC 7959. */
+#define BLOCK_NUM(val) ((val) >> 4)
+#define BLOCK_MORE(val) (((val) >> 3) & 0x01)
+#define BLOCK_SZX(val) ((val) & 0x07)
+#define BLOCK_VALUE(num, more, szx) (((num) << 4) | ((more) << 3) | (szx))
+#define BLOCK_BYTES(szx) (16 << (szx))
+#define BLOCK_SZX_MAX 6
+
+/* Observe sequence numbers are 24-bit, see RFC 7641 section 3.4. A
+ * notification arriving this long after the previous one is always fresh.
+ */
+#define OBSERVE_HALF_RANGE (1 << 23)
+#define OBSERVE_FRESH_MS K_SECONDS(128)
+
+/* Time a message ID can be repeated by the server, see RFC 7252 section
+ * 4.8.2, with MAX_LATENCY of 100 s and ACK_RANDOM_FACTOR of 1.5.
+ */
+#define MAX_LATENCY_MS K_SECONDS(100)
+#define MAX_TRANSMIT_SPAN_MS (CONFIG_COAP_CLOUD_ACK_TIMEOUT_MS *	\
+			      ((1 << CONFIG_COAP_CLOUD_MAX_RETRANSMIT) - 1) *	\
+			      3 / 2)
+#define EXCHANGE_LIFETIME_MS (MAX_TRANSMIT_SPAN_MS + 2 * MAX_LATENCY_MS + \
+			      CONFIG_COAP_CLOUD_ACK_TIMEOUT_MS)
+
+/* Number of confirmable messages from the server remembered to answer
+ * their duplicates.
+ */
+#define REPLY_CACHE_SIZE 4
+
+/* Space for CoAP header, token and options in front of a block. */
+#define MESSAGE_OVERHEAD 64
+
+BUILD_ASSERT_MSG((CONFIG_COAP_CLOUD_BLOCK_SIZE &
+		  (CONFIG_COAP_CLOUD_BLOCK_SIZE - 1)) == 0,
+		 "CoAP block size must be a power of two");
+BUILD_ASSERT_MSG(CONFIG_COAP_CLOUD_MESSAGE_SIZE >=
+		 CONFIG_COAP_CLOUD_BLOCK_SIZE + MESSAGE_OVERHEAD,
+		 "CoAP message buffer cannot hold a block");
+
+/**@brief Confirmable request waiting for its response. */
+struct coap_cloud_request {
+	u8_t token[TOKEN_LEN];
+	u16_t id;
+	bool acked;
+	bool done;
+	int err;
+	u8_t code;
+	bool has_observe;
+	bool has_block1;
+	bool has_block2;
+	u32_t observe;
+	u32_t block1;
+	u32_t block2;
+	/* Buffer for the response payload, NULL to ignore it. */
+	u8_t *rsp_buf;
+	size_t rsp_buf_size;
+	size_t rsp_len;
+};
+
+static u8_t tx_buf[CONFIG_COAP_CLOUD_MESSAGE_SIZE];
+static u8_t rx_buf[CONFIG_COAP_CLOUD_MESSAGE_SIZE];
+static u8_t payload_buf[CONFIG_COAP_CLOUD_PAYLOAD_SIZE + 1];
+
+static int sock = -1;
+static struct sockaddr_storage server;
+static struct cloud_backend *coap_cloud_backend;
+static struct coap_cloud_request *pending;
+
+/**@brief Reply sent to a confirmable message from the server. */
+struct coap_cloud_reply {
+	u16_t id;
+	u8_t type;
+	/* Uptime (ms) until which duplicates are expected, 0 if unused. */
+	s64_t expiry;
+};
+
+static struct coap_cloud_reply reply_cache[REPLY_CACHE_SIZE];
+static u8_t reply_cache_next;
+
+/* Observation of the configuration resource. */
+static u8_t cfg_token[TOKEN_LEN];
+static bool cfg_observing;
+static bool cfg_fetching;
+static bool cfg_fetch_pending;
+static u32_t cfg_observe_seq;
+static s64_t cfg_observe_time;
+
+/* The API can be used from the application and from work queue handlers. */
+K_MUTEX_DEFINE(coap_cloud_lock);
+
+static u8_t block_szx_get(void)
+{
+	u8_t szx = 0;
+
+	while (BLOCK_BYTES(szx) < CONFIG_COAP_CLOUD_BLOCK_SIZE) {
+		szx++;
+	}
+
+	return szx;
+}
+
+static bool option_get(const struct coap_packet *pkt, u16_t code,
+		       u32_t *value)
+{
+	struct coap_option option;
+
+	if (coap_find_options(pkt, code, &option, 1) != 1) {
+		return false;
+	}
+
+	*value = coap_option_value_to_int(&option);
+
+	return true;
+}
+
+static bool observe_is_fresh(u32_t last, u32_t seq, s64_t last_time)
+{
+	return ((last < seq) && (seq - last < OBSERVE_HALF_RANGE)) ||
+	       ((last > seq) && (last - seq > OBSERVE_HALF_RANGE)) ||
+	       (k_uptime_get() > last_time + OBSERVE_FRESH_MS);
+}
+
+static void data_received_notify(u8_t *buf, size_t len)
+{
+	struct cloud_backend_config *config = coap_cloud_backend->config;
+	struct cloud_event cloud_evt = {
+		.type = CLOUD_EVT_DATA_RECEIVED
+	};
+
+	/* Payload is usually JSON, which the application parses as string. */
+	buf[len] = '\0';
+
+	cloud_evt.data.msg.buf = (char *)buf;
+	cloud_evt.data.msg.len = len;
+
+	cloud_notify_event(coap_cloud_backend, &cloud_evt, config->user_data);
+}
+
+static void event_notify(enum cloud_event_type type)
+{
+	struct cloud_backend_config *config = coap_cloud_backend->config;
+	struct cloud_event cloud_evt = {
+		.type = type
+	};
+
+	cloud_notify_event(coap_cloud_backend, &cloud_evt, config->user_data);
+}
+
+/**@brief Sends message without token and code, that is ACK or RST. */
+static int empty_send(u8_t type, u16_t id)
+{
+	int err;
+	u8_t buf[4];
+	struct coap_packet pkt;
+
+	err = coap_packet_init(&pkt, buf, sizeof(buf), COAP_VERSION, type,
+			       0, NULL, COAP_CODE_EMPTY, id);
+	if (err < 0) {
+		return err;
+	}
+
+	err = send(sock, pkt.data, pkt.offset, 0);
+	if (err < 0) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+/**@brief Replies to a confirmable message and remembers the reply, so that
+ *        a retransmission of the message gets the same reply, see RFC 7252
+ *        section 4.5.
+ */
+static void reply_send(u8_t type, u16_t id)
+{
+	struct coap_cloud_reply *reply = &reply_cache[reply_cache_next];
+
+	reply->id = id;
+	reply->type = type;
+	reply->expiry = k_uptime_get() + EXCHANGE_LIFETIME_MS;
+	reply_cache_next = (reply_cache_next + 1) % REPLY_CACHE_SIZE;
+
+	(void)empty_send(type, id);
+}
+
+/**@brief Replies again to a retransmitted confirmable message.
+ *
+ * @return true if the message is a duplicate and must not be processed.
+ */
+static bool reply_resend(u16_t id)
+{
+	s64_t now = k_uptime_get();
+
+	for (size_t i = 0; i < ARRAY_SIZE(reply_cache); i++) {
+		struct coap_cloud_reply *reply = &reply_cache[i];
+
+		if ((reply->expiry != 0) && (now < reply->expiry) &&
+		    (reply->id == id)) {
+			(void)empty_send(reply->type, id);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void response_store(struct coap_cloud_request *req,
+			   const struct coap_packet *pkt, u8_t code)
+{
+	const u8_t *payload;
+	u16_t payload_len;
+
+	req->code = code;
+	req->has_observe = option_get(pkt, COAP_OPTION_OBSERVE,
+				      &req->observe);
+	req->has_block1 = option_get(pkt, COAP_OPTION_BLOCK1, &req->block1);
+	req->has_block2 = option_get(pkt, COAP_OPTION_BLOCK2, &req->block2);
+
+	payload = coap_packet_get_payload(pkt, &payload_len);
+	if (req->rsp_buf && payload) {
+		if (payload_len > req->rsp_buf_size) {
+			LOG_ERR("Response payload too large: %d", payload_len);
+			req->err = -ENOMEM;
+			payload_len = req->rsp_buf_size;
+		}
+
+		memcpy(req->rsp_buf, payload, payload_len);
+		req->rsp_len = payload_len;
+	}
+
+	req->done = true;
+}
+
+static void cfg_notification_handle(const struct coap_packet *pkt, u8_t code)
+{
+	const u8_t *payload;
+	u16_t payload_len;
+	u32_t seq;
+	u32_t block2;
+
+	if (code != COAP_RESPONSE_CODE_CONTENT) {
+		LOG_WRN("Configuration observation ended, code %d.%02d",
+			code >> 5, code & 0x1F);
+		cfg_observing = false;
+		return;
+	}
+
+	/* A notification without the Observe option is the last one. */
+	if (!option_get(pkt, COAP_OPTION_OBSERVE, &seq)) {
+		cfg_observing = false;
+	} else if (!observe_is_fresh(cfg_observe_seq, seq, cfg_observe_time)) {
+		LOG_DBG("Reordered notification ignored");
+		return;
+	} else {
+		cfg_observe_seq = seq;
+		cfg_observe_time = k_uptime_get();
+	}
+
+	/* Configuration being fetched is at least as new as this one. */
+	if (cfg_fetching) {
+		return;
+	}
+
+	/* Notifications carry only the first block of large configuration,
+	 * the rest is fetched with a new request from cloud_input().
+	 */
+	if (option_get(pkt, COAP_OPTION_BLOCK2, &block2) &&
+	    BLOCK_MORE(block2)) {
+		cfg_fetch_pending = true;
+		return;
+	}
+
+	payload = coap_packet_get_payload(pkt, &payload_len);
+	if (!payload) {
+		payload_len = 0;
+	}
+
+	if (payload_len > CONFIG_COAP_CLOUD_PAYLOAD_SIZE) {
+		LOG_ERR("Configuration too large: %d", payload_len);
+		return;
+	}
+
+	memcpy(payload_buf, payload, payload_len);
+	data_received_notify(payload_buf, payload_len);
+}
+
+static void packet_handle(u8_t *buf, size_t len)
+{
+	int err;
+	struct coap_packet pkt;
+	u8_t token[TOKEN_LEN];
+	u8_t token_len;
+	u8_t type;
+	u8_t code;
+	u16_t id;
+	u32_t observe;
+	bool is_pending;
+	bool is_cfg;
+
+	err = coap_packet_parse(&pkt, buf, len, NULL, 0);
+	if (err < 0) {
+		LOG_DBG("Malformed message received: %d", err);
+		return;
+	}
+
+	type = coap_header_get_type(&pkt);
+	code = coap_header_get_code(&pkt);
+	id = coap_header_get_id(&pkt);
+	token_len = coap_header_get_token(&pkt, token);
+
+	if (pending && (id == pending->id) &&
+	    ((type == COAP_TYPE_ACK) || (type == COAP_TYPE_RESET))) {
+		if (type == COAP_TYPE_RESET) {
+			pending->err = -ECONNRESET;
+			pending->done = true;
+			return;
+		}
+
+		/* Empty ACK means the response comes separately. */
+		pending->acked = true;
+	}
+
+	if (code == COAP_CODE_EMPTY) {
+		/* CoAP ping is answered with RST. */
+		if (type == COAP_TYPE_CON) {
+			(void)empty_send(COAP_TYPE_RESET, id);
+		}
+		return;
+	}
+
+	/* Our reply was lost and the server retransmitted the message. It
+	 * may belong to an exchange that is already completed.
+	 */
+	if ((type == COAP_TYPE_CON) && reply_resend(id)) {
+		LOG_DBG("Duplicate message, id %d", id);
+		return;
+	}
+
+	is_pending = pending && (token_len == TOKEN_LEN) &&
+		     !memcmp(token, pending->token, TOKEN_LEN);
+	is_cfg = cfg_observing && (token_len == TOKEN_LEN) &&
+		 !memcmp(token, cfg_token, TOKEN_LEN);
+
+	/* Messages that nobody waits for are rejected, which also cancels
+	 * observations that are no longer needed. Other non-confirmable
+	 * messages are ignored to save transmissions.
+	 */
+	if (type == COAP_TYPE_CON) {
+		reply_send((is_pending || is_cfg) ?
+			   COAP_TYPE_ACK : COAP_TYPE_RESET, id);
+	} else if ((type == COAP_TYPE_NON_CON) && !is_pending && !is_cfg &&
+		   option_get(&pkt, COAP_OPTION_OBSERVE, &observe)) {
+		(void)empty_send(COAP_TYPE_RESET, id);
+	}
+
+	if (is_pending) {
+		response_store(pending, &pkt, code);
+	} else if (is_cfg) {
+		cfg_notification_handle(&pkt, code);
+	} else {
+		LOG_DBG("Unexpected message, id %d", id);
+	}
+}
+
+/**@brief Reads one message from the socket, if there is any. */
+static int packet_receive(void)
+{
+	int len;
+
+	len = recv(sock, rx_buf, sizeof(rx_buf), MSG_DONTWAIT);
+	if (len < 0) {
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+			return -EAGAIN;
+		}
+		return -errno;
+	}
+
+	if (len > 0) {
+		packet_handle(rx_buf, len);
+	}
+
+	return 0;
+}
+
+/* Returns 0 if data is available.
+ * Returns -EAGAIN if timeout occured and there is no data.
+ * Returns other, negative error code in case of poll error.
+ */
+static int packet_wait(int timeout)
+{
+	struct pollfd fds = {
+		.fd = sock,
+		.events = POLLIN
+	};
+	int ret = poll(&fds, 1, timeout);
+
+	if (ret < 0) {
+		return -errno;
+	}
+
+	if (ret == 0) {
+		return -EAGAIN;
+	}
+
+	if ((fds.revents & POLLERR) == POLLERR) {
+		return -EIO;
+	}
+
+	if ((fds.revents & POLLNVAL) == POLLNVAL) {
+		return -EBADF;
+	}
+
+	return 0;
+}
+
+static int response_wait(struct coap_cloud_request *req, s32_t timeout)
+{
+	int err;
+	s64_t deadline = k_uptime_get() + timeout;
+
+	while (!req->done) {
+		s64_t remaining = deadline - k_uptime_get();
+
+		if (remaining <= 0) {
+			return -EAGAIN;
+		}
+
+		err = packet_wait(remaining);
+		if (err < 0) {
+			return err;
+		}
+
+		err = packet_receive();
+		if ((err < 0) && (err != -EAGAIN)) {
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+/**@brief Sends confirmable request from the TX buffer and waits for its
+ *        response. The request is retransmitted with exponential back-off
+ *        until it is acknowledged, see RFC 7252 section 4.2.
+ */
+static int request_do(struct coap_cloud_request *req,
+		      const struct coap_packet *pkt)
+{
+	int err;
+	int retransmissions = 0;
+	s32_t timeout = CONFIG_COAP_CLOUD_ACK_TIMEOUT_MS;
+
+	req->id = coap_header_get_id(pkt);
+	pending = req;
+
+	while (true) {
+		/* Separate response is not retransmitted by the client. */
+		if (req->acked) {
+			timeout = CONFIG_COAP_CLOUD_RESPONSE_TIMEOUT_MS;
+			err = response_wait(req, timeout);
+			break;
+		}
+
+		if (retransmissions > CONFIG_COAP_CLOUD_MAX_RETRANSMIT) {
+			err = -EAGAIN;
+			break;
+		}
+
+		if (retransmissions > 0) {
+			LOG_DBG("Retransmission %d of message %d",
+				retransmissions, req->id);
+		}
+
+		err = send(sock, pkt->data, pkt->offset, 0);
+		if (err < 0) {
+			err = -errno;
+			break;
+		}
+
+		err = response_wait(req, timeout);
+		if (err != -EAGAIN) {
+			break;
+		}
+
+		retransmissions++;
+		timeout *= 2;
+	}
+
+	pending = NULL;
+
+	if (err == -EAGAIN) {
+		LOG_ERR("No response to message %d", req->id);
+		return -ETIMEDOUT;
+	}
+
+	return err ? err : req->err;
+}
+
+static int path_append(struct coap_packet *pkt, const char *path, size_t len)
+{
+	int err;
+
+	while (len > 0) {
+		const char *end = memchr(path, '/', len);
+		size_t segment_len = end ? (size_t)(end - path) : len;
+
+		if (segment_len > 0) {
+			err = coap_packet_append_option(pkt,
+							COAP_OPTION_URI_PATH,
+							(const u8_t *)path,
+							segment_len);
+			if (err < 0) {
+				return err;
+			}
+		}
+
+		if (!end) {
+			break;
+		}
+
+		segment_len++;
+		path += segment_len;
+		len -= segment_len;
+	}
+
+	return 0;
+}
+
+/**@brief Creates request in the TX buffer. Options with numbers lower than
+ *        Uri-Path (Observe) are added here, the caller adds the others.
+ */
+static int request_create(struct coap_packet *pkt, u8_t type, u8_t method,
+			  const u8_t *token, int observe, const char *path,
+			  size_t path_len)
+{
+	int err;
+
+	err = coap_packet_init(pkt, tx_buf, sizeof(tx_buf), COAP_VERSION,
+			       type, TOKEN_LEN, (u8_t *)token, method,
+			       coap_next_id());
+	if (err < 0) {
+		return err;
+	}
+
+	if (observe >= 0) {
+		err = coap_append_option_int(pkt, COAP_OPTION_OBSERVE,
+					     observe);
+		if (err < 0) {
+			return err;
+		}
+	}
+
+	return path_append(pkt, path, path_len);
+}
+
+static bool code_is_success(u8_t code)
+{
+	return (code >> 5) == 2;
+}
+
+/**@brief Fetches the configuration resource, using Block2 when the server
+ *        splits it, and passes it to the application.
+ *
+ * @param observe Register for notifications about configuration changes.
+ */
+static int cfg_get(bool observe)
+{
+	int err = 0;
+	u32_t num = 0;
+	u8_t szx = block_szx_get();
+	size_t len = 0;
+
+	cfg_fetching = true;
+	cfg_fetch_pending = false;
+
+	while (true) {
+		struct coap_packet pkt;
+		struct coap_cloud_request req = {
+			.rsp_buf = &payload_buf[len],
+			.rsp_buf_size = CONFIG_COAP_CLOUD_PAYLOAD_SIZE - len
+		};
+
+		memcpy(req.token, coap_next_token(), TOKEN_LEN);
+
+		err = request_create(&pkt, COAP_TYPE_CON, COAP_METHOD_GET,
+				     req.token,
+				     (observe && (num == 0)) ? 0 : -1,
+				     CONFIG_COAP_CLOUD_CONFIG_RESOURCE,
+				     strlen(CONFIG_COAP_CLOUD_CONFIG_RESOURCE));
+		if (err == 0) {
+			err = coap_append_option_int(&pkt, COAP_OPTION_BLOCK2,
+						     BLOCK_VALUE(num, 0, szx));
+		}
+		if (err < 0) {
+			break;
+		}
+
+		err = request_do(&req, &pkt);
+		if (err < 0) {
+			break;
+		}
+
+		if (req.code != COAP_RESPONSE_CODE_CONTENT) {
+			LOG_ERR("Configuration not fetched, code %d.%02d",
+				req.code >> 5, req.code & 0x1F);
+			err = -EBADMSG;
+			break;
+		}
+
+		if (observe && (num == 0)) {
+			cfg_observing = req.has_observe;
+			cfg_observe_seq = req.observe;
+			cfg_observe_time = k_uptime_get();
+			memcpy(cfg_token, req.token, TOKEN_LEN);
+			if (!cfg_observing) {
+				LOG_WRN("Configuration is not observable");
+			}
+		}
+
+		len += req.rsp_len;
+
+		if (!req.has_block2 || !BLOCK_MORE(req.block2)) {
+			break;
+		}
+
+		if (BLOCK_SZX(req.block2) > BLOCK_SZX_MAX) {
+			err = -EBADMSG;
+			break;
+		}
+
+		/* Server may use smaller blocks than requested. */
+		szx = BLOCK_SZX(req.block2);
+		num = BLOCK_NUM(req.block2) + 1;
+
+		if (len != num * BLOCK_BYTES(szx)) {
+			LOG_ERR("Unexpected configuration block");
+			err = -EBADMSG;
+			break;
+		}
+	}
+
+	cfg_fetching = false;
+
+	if (err == 0) {
+		data_received_notify(payload_buf, len);
+	}
+
+	return err;
+}
+
+static int payload_append(struct coap_packet *pkt, const u8_t *data,
+			  size_t len)
+{
+	int err;
+
+	if (len == 0) {
+		return 0;
+	}
+
+	err = coap_packet_append_payload_marker(pkt);
+	if (err < 0) {
+		return err;
+	}
+
+	return coap_packet_append_payload(pkt, (u8_t *)data, len);
+}
+
+/**@brief Sends data in a single message, confirmable or not. */
+static int data_send(u8_t type, const char *path, size_t path_len,
+		     const u8_t *data, size_t len)
+{
+	int err;
+	struct coap_packet pkt;
+	struct coap_cloud_request req = { 0 };
+
+	memcpy(req.token, coap_next_token(), TOKEN_LEN);
+
+	err = request_create(&pkt, type, COAP_METHOD_POST, req.token, -1,
+			     path, path_len);
+	if (err == 0) {
+		err = coap_append_option_int(&pkt, COAP_OPTION_CONTENT_FORMAT,
+					     COAP_CONTENT_FORMAT_APP_JSON);
+	}
+	if (err == 0) {
+		err = payload_append(&pkt, data, len);
+	}
+	if (err < 0) {
+		return err;
+	}
+
+	if (type == COAP_TYPE_NON_CON) {
+		err = send(sock, pkt.data, pkt.offset, 0);
+		return (err < 0) ? -errno : 0;
+	}
+
+	err = request_do(&req, &pkt);
+	if (err < 0) {
+		return err;
+	}
+
+	if (!code_is_success(req.code)) {
+		LOG_ERR("Data rejected, code %d.%02d",
+			req.code >> 5, req.code & 0x1F);
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+/**@brief Sends data that does not fit in one message with Block1. Blocks
+ *        are always confirmable, as the server acknowledges each of them.
+ */
+static int data_send_blockwise(const char *path, size_t path_len,
+			       const u8_t *data, size_t len)
+{
+	int err;
+	u8_t szx = block_szx_get();
+	size_t offset = 0;
+
+	while (offset < len) {
+		struct coap_packet pkt;
+		struct coap_cloud_request req = { 0 };
+		size_t block_len = MIN(BLOCK_BYTES(szx), len - offset);
+		bool more = (offset + block_len) < len;
+		u32_t num = offset / BLOCK_BYTES(szx);
+
+		memcpy(req.token, coap_next_token(), TOKEN_LEN);
+
+		err = request_create(&pkt, COAP_TYPE_CON, COAP_METHOD_POST,
+				     req.token, -1, path, path_len);
+		if (err == 0) {
+			err = coap_append_option_int(&pkt,
+					COAP_OPTION_CONTENT_FORMAT,
+					COAP_CONTENT_FORMAT_APP_JSON);
+		}
+		if (err == 0) {
+			err = coap_append_option_int(&pkt, COAP_OPTION_BLOCK1,
+					BLOCK_VALUE(num, more, szx));
+		}
+		if ((err == 0) && (num == 0)) {
+			err = coap_append_option_int(&pkt, COAP_OPTION_SIZE1,
+						     len);
+		}
+		if (err == 0) {
+			err = payload_append(&pkt, &data[offset], block_len);
+		}
+		if (err < 0) {
+			return err;
+		}
+
+		err = request_do(&req, &pkt);
+		if (err < 0) {
+			return err;
+		}
+
+		if (more && (req.code != COAP_RESPONSE_CODE_CONTINUE)) {
+			LOG_ERR("Block %d rejected, code %d.%02d", num,
+				req.code >> 5, req.code & 0x1F);
+			return -EBADMSG;
+		}
+
+		if (!more && !code_is_success(req.code)) {
+			LOG_ERR("Data rejected, code %d.%02d",
+				req.code >> 5, req.code & 0x1F);
+			return -EBADMSG;
+		}
+
+		offset += block_len;
+
+		/* Server may ask for smaller blocks. Offset stays aligned,
+		 * because block sizes are powers of two.
+		 */
+		if (req.has_block1 && (BLOCK_SZX(req.block1) < szx)) {
+			szx = BLOCK_SZX(req.block1);
+		}
+	}
+
+	return 0;
+}
+
+#if defined(CONFIG_COAP_CLOUD_STATIC_IPV4)
+static int server_resolve(void)
+{
+	struct sockaddr_in *server4 = ((struct sockaddr_in *)&server);
+
+	inet_pton(AF_INET, CONFIG_COAP_CLOUD_STATIC_IPV4_ADDR,
+		  &server4->sin_addr);
+	server4->sin_family = AF_INET;
+	server4->sin_port = htons(CONFIG_COAP_CLOUD_PORT);
+
+	LOG_DBG("IPv4 Address %s", CONFIG_COAP_CLOUD_STATIC_IPV4_ADDR);
+
+	return 0;
+}
+#else
+static int server_resolve(void)
+{
+	int err;
+	struct addrinfo *result;
+	struct addrinfo hints = {
+		.ai_family = AF_INET,
+		.ai_socktype = SOCK_DGRAM
+	};
+	struct sockaddr_in *server4 = ((struct sockaddr_in *)&server);
+	char ipv4_addr[NET_IPV4_ADDR_LEN];
+
+	err = getaddrinfo(CONFIG_COAP_CLOUD_HOST_NAME, NULL, &hints, &result);
+	if (err != 0) {
+		LOG_ERR("getaddrinfo failed %d", err);
+		return -EIO;
+	}
+
+	if (result == NULL) {
+		LOG_ERR("Address not found");
+		return -ENOENT;
+	}
+
+	server4->sin_addr.s_addr =
+		((struct sockaddr_in *)result->ai_addr)->sin_addr.s_addr;
+	server4->sin_family = AF_INET;
+	server4->sin_port = htons(CONFIG_COAP_CLOUD_PORT);
+
+	inet_ntop(AF_INET, &server4->sin_addr.s_addr, ipv4_addr,
+		  sizeof(ipv4_addr));
+	LOG_DBG("IPv4 Address found %s", ipv4_addr);
+
+	freeaddrinfo(result);
+
+	return 0;
+}
+#endif
+
+#if defined(CONFIG_COAP_CLOUD_DTLS)
+static int dtls_setup(int fd)
+{
+	int err;
+	int verify = 2;
+	static sec_tag_t sec_tag_list[] = { CONFIG_COAP_CLOUD_SEC_TAG };
+
+	err = setsockopt(fd, SOL_TLS, TLS_PEER_VERIFY, &verify,
+			 sizeof(verify));
+	if (err) {
+		LOG_ERR("Failed to setup peer verification, %d", errno);
+		return -errno;
+	}
+
+	err = setsockopt(fd, SOL_TLS, TLS_SEC_TAG_LIST, sec_tag_list,
+			 sizeof(sec_tag_list));
+	if (err) {
+		LOG_ERR("Failed to setup credentials, %d", errno);
+		return -errno;
+	}
+
+	err = setsockopt(fd, SOL_TLS, TLS_HOSTNAME,
+			 CONFIG_COAP_CLOUD_HOST_NAME,
+			 strlen(CONFIG_COAP_CLOUD_HOST_NAME));
+	if (err) {
+		LOG_ERR("Failed to setup TLS hostname, %d", errno);
+		return -errno;
+	}
+
+	return 0;
+}
+#endif
+
+static void socket_close(const struct cloud_backend *const backend)
+{
+	(void)close(sock);
+	sock = -1;
+	backend->config->socket = -1;
+	cfg_observing = false;
+	cfg_fetch_pending = false;
+	memset(reply_cache, 0, sizeof(reply_cache));
+}
+
+static int coap_cloud_init(const struct cloud_backend *const backend,
+			   cloud_evt_handler_t handler)
+{
+	backend->config->handler = handler;
+	backend->config->socket = -1;
+	coap_cloud_backend = (struct cloud_backend *)backend;
+
+	return 0;
+}
+
+static int coap_cloud_connect(const struct cloud_backend *const backend)
+{
+	int err;
+	int proto = IS_ENABLED(CONFIG_COAP_CLOUD_DTLS) ?
+		    IPPROTO_DTLS_1_2 : IPPROTO_UDP;
+
+	k_mutex_lock(&coap_cloud_lock, K_FOREVER);
+
+	if (sock >= 0) {
+		err = -EALREADY;
+		goto exit;
+	}
+
+	err = server_resolve();
+	if (err) {
+		goto exit;
+	}
+
+	sock = socket(AF_INET, SOCK_DGRAM, proto);
+	if (sock < 0) {
+		LOG_ERR("Failed to create CoAP socket: %d", errno);
+		err = -errno;
+		goto exit;
+	}
+
+#if defined(CONFIG_COAP_CLOUD_DTLS)
+	err = dtls_setup(sock);
+	if (err) {
+		socket_close(backend);
+		goto exit;
+	}
+#endif
+
+	/* With DTLS, the handshake is done here. */
+	err = connect(sock, (struct sockaddr *)&server,
+		      sizeof(struct sockaddr_in));
+	if (err < 0) {
+		LOG_ERR("Connect failed: %d", errno);
+		err = -errno;
+		socket_close(backend);
+		goto exit;
+	}
+
+	backend->config->socket = sock;
+
+	/* Configuration is observed, so the server pushes changes instead of
+	 * the device polling for them.
+	 */
+	err = cfg_get(true);
+	if (err) {
+		LOG_ERR("Configuration not observed, error: %d", err);
+		socket_close(backend);
+		goto exit;
+	}
+
+	event_notify(CLOUD_EVT_CONNECTED);
+
+exit:
+	k_mutex_unlock(&coap_cloud_lock);
+
+	return err;
+}
+
+static int coap_cloud_disconnect(const struct cloud_backend *const backend)
+{
+	int err = 0;
+
+	k_mutex_lock(&coap_cloud_lock, K_FOREVER);
+
+	if (sock < 0) {
+		err = -ENOTCONN;
+		goto exit;
+	}
+
+	/* Deregister from the server with Observe 1, without waiting for
+	 * the response. The server also ends the observation when the next
+	 * notification is rejected.
+	 */
+	if (cfg_observing) {
+		struct coap_packet pkt;
+
+		err = request_create(&pkt, COAP_TYPE_NON_CON, COAP_METHOD_GET,
+				     cfg_token, 1,
+				     CONFIG_COAP_CLOUD_CONFIG_RESOURCE,
+				     strlen(CONFIG_COAP_CLOUD_CONFIG_RESOURCE));
+		if (err == 0) {
+			(void)send(sock, pkt.data, pkt.offset, 0);
+		}
+	}
+
+	socket_close(backend);
+	event_notify(CLOUD_EVT_DISCONNECTED);
+	err = 0;
+
+exit:
+	k_mutex_unlock(&coap_cloud_lock);
+
+	return err;
+}
+
+static int coap_cloud_send(const struct cloud_backend *const backend,
+			   const struct cloud_msg *const msg)
+{
+	int err;
+	const char *path;
+	size_t path_len;
+
+	switch (msg->endpoint.type) {
+	case CLOUD_EP_TOPIC_MSG:
+	case CLOUD_EP_TOPIC_STATE:
+		path = CONFIG_COAP_CLOUD_STATE_RESOURCE;
+		path_len = strlen(path);
+		break;
+	case CLOUD_EP_TOPIC_BATCH:
+		path = CONFIG_COAP_CLOUD_BATCH_RESOURCE;
+		path_len = strlen(path);
+		break;
+	case CLOUD_EP_TOPIC_PAIR:
+	case CLOUD_EP_TOPIC_CONFIG:
+		path = NULL;
+		path_len = 0;
+		break;
+	case CLOUD_EP_URI:
+		path = msg->endpoint.str;
+		path_len = msg->endpoint.len;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&coap_cloud_lock, K_FOREVER);
+
+	if (sock < 0) {
+		err = -ENOTCONN;
+		goto exit;
+	}
+
+	/* Event handlers called while waiting for a response must not
+	 * start another request.
+	 */
+	if (pending) {
+		err = -EBUSY;
+		goto exit;
+	}
+
+	if (!path) {
+		/* Requested configuration is passed as received data. */
+		err = cfg_get(false);
+	} else if (msg->len > CONFIG_COAP_CLOUD_BLOCK_SIZE) {
+		err = data_send_blockwise(path, path_len, (u8_t *)msg->buf,
+					  msg->len);
+	} else {
+		err = data_send(msg->qos == CLOUD_QOS_AT_MOST_ONCE ?
+				COAP_TYPE_NON_CON : COAP_TYPE_CON,
+				path, path_len, (u8_t *)msg->buf, msg->len);
+	}
+
+	if (err == 0) {
+		event_notify(CLOUD_EVT_DATA_SENT);
+	}
+
+exit:
+	k_mutex_unlock(&coap_cloud_lock);
+
+	return err;
+}
+
+static int coap_cloud_input(const struct cloud_backend *const backend)
+{
+	int err;
+
+	k_mutex_lock(&coap_cloud_lock, K_FOREVER);
+
+	if (sock < 0) {
+		err = -ENOTCONN;
+		goto exit;
+	}
+
+	do {
+		err = packet_receive();
+	} while (err == 0);
+
+	if (err == -EAGAIN) {
+		err = 0;
+	}
+
+	if ((err == 0) && cfg_fetch_pending && !pending) {
+		err = cfg_get(false);
+	}
+
+exit:
+	k_mutex_unlock(&coap_cloud_lock);
+
+	return err;
+}
+
+static const struct cloud_api coap_cloud_api = {
+	.init		= coap_cloud_init,
+	.connect	= coap_cloud_connect,
+	.disconnect	= coap_cloud_disconnect,
+	.send		= coap_cloud_send,
+	.input		= coap_cloud_input
+};
+
+CLOUD_BACKEND_DEFINE(COAP_CLOUD, coap_cloud_api);
@@ -12,6 +12,7 @@
 #include <net/socket.h>
 #include <net/tls_credentials.h>
 #include <net/download_client.h>
+#include <profiler.h>
 #include <logging/log.h>
 
 LOG_MODULE_REGISTER(download_client, CONFIG_DOWNLOAD_CLIENT_LOG_LEVEL);
@@ -516,6 +517,8 @@ int download_client_init(struct download_client *const client,
 				download_thread, client, NULL, NULL,
 				K_LOWEST_APPLICATION_THREAD_PRIO, 0, K_NO_WAIT);
 
+	profiler_stack_monitor_register(&client->thread);
+
 	return 0;
 }
 
@@ -3,7 +3,10 @@
  *
  * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
  */
+#include <errno.h>
+#include <string.h>
 #include <logging/log.h>
+#include <nfc/ndef/msg_parser.h>
 #include "msg_parser_local.h"
 
 LOG_MODULE_REGISTER(nfc_ndef_parser);
@@ -31,6 +34,77 @@ int nfc_ndef_msg_parse(const u8_t *result_buf,
 	return err;
 }
 
+void nfc_ndef_msg_iter_init(struct nfc_ndef_msg_iter *iter,
+			    const u8_t *raw_data,
+			    u32_t raw_data_len)
+{
+	iter->data = raw_data;
+	iter->data_len = raw_data_len;
+	iter->offset = 0;
+	iter->record_count = 0;
+	iter->end = false;
+}
+
+int nfc_ndef_msg_iter_next(struct nfc_ndef_msg_iter *iter,
+			   struct nfc_ndef_record_view *view)
+{
+	u32_t record_len = iter->data_len - iter->offset;
+	int err;
+
+	if (iter->end) {
+		return -ENOENT;
+	}
+
+	if (record_len == 0) {
+		return -EFAULT;
+	}
+
+	err = nfc_ndef_record_view_parse(view, &iter->data[iter->offset],
+					 &record_len);
+	if (err) {
+		return err;
+	}
+
+	/* Verify the records location flags. */
+	if (iter->record_count == 0) {
+		if ((view->location != NDEF_FIRST_RECORD) &&
+		    (view->location != NDEF_LONE_RECORD)) {
+			return -EFAULT;
+		}
+	} else {
+		if ((view->location != NDEF_MIDDLE_RECORD) &&
+		    (view->location != NDEF_LAST_RECORD)) {
+			return -EFAULT;
+		}
+	}
+
+	iter->offset += record_len;
+	iter->record_count++;
+	iter->end = (view->location == NDEF_LAST_RECORD) ||
+		    (view->location == NDEF_LONE_RECORD);
+
+	return 0;
+}
+
+int nfc_ndef_msg_record_find(struct nfc_ndef_msg_iter *iter,
+			     enum nfc_ndef_record_tnf tnf,
+			     const u8_t *type,
+			     u8_t type_length,
+			     struct nfc_ndef_record_view *view)
+{
+	int err;
+
+	while ((err = nfc_ndef_msg_iter_next(iter, view)) == 0) {
+		if ((view->tnf == tnf) &&
+		    (view->type_length == type_length) &&
+		    ((type_length == 0) ||
+		     !memcmp(view->type, type, type_length))) {
+			return 0;
+		}
+	}
+
+	return err;
+}
 
 void nfc_ndef_msg_printout(const struct nfc_ndef_msg_desc *msg_desc)
 {
@@ -19,93 +19,118 @@ LOG_MODULE_DECLARE(nfc_ndef_parser);
 #define NDEF_RECORD_BASE_SHORT_LEN (2 + NDEF_RECORD_PAYLOAD_LEN_SHORT_SIZE)
 
 
-int nfc_ndef_record_parse(struct nfc_ndef_bin_payload_desc *bin_pay_desc,
-			  struct nfc_ndef_record_desc *rec_desc,
-			  enum nfc_ndef_record_location *record_location,
-			  const u8_t *nfc_data,
-			  u32_t *nfc_data_len)
+int nfc_ndef_record_view_parse(struct nfc_ndef_record_view *view,
+			       const u8_t *nfc_data,
+			       u32_t *nfc_data_len)
 {
-	u32_t expected_rec_size = NDEF_RECORD_BASE_SHORT_LEN;
+	u32_t data_left = *nfc_data_len;
+	u32_t header_len = NDEF_RECORD_BASE_SHORT_LEN;
 
-	if (expected_rec_size > *nfc_data_len) {
+	if (header_len > data_left) {
 		return -EINVAL;
 	}
 
-	rec_desc->tnf = (enum nfc_ndef_record_tnf) ((*nfc_data) & NDEF_RECORD_TNF_MASK);
+	u8_t flags = nfc_data[0];
+
+	view->tnf = (enum nfc_ndef_record_tnf) (flags & NDEF_RECORD_TNF_MASK);
 
 	/* An NDEF parser that receives an NDEF record with an unknown
 	 * or unsupported TNF field value
 	 * SHOULD treat it as Unknown. See NFCForum-TS-NDEF_1.0
 	 */
-	if (rec_desc->tnf == TNF_RESERVED) {
-		rec_desc->tnf = TNF_UNKNOWN_TYPE;
+	if (view->tnf == TNF_RESERVED) {
+		view->tnf = TNF_UNKNOWN_TYPE;
 	}
 
-	*record_location = (enum nfc_ndef_record_location) ((*nfc_data) & NDEF_RECORD_LOCATION_MASK);
+	view->location = (enum nfc_ndef_record_location)
+			 (flags & NDEF_RECORD_LOCATION_MASK);
+	view->type_length = nfc_data[1];
 
-	u8_t flags = *(nfc_data++);
+	if (!(flags & NDEF_RECORD_SR_MASK)) {
+		header_len += NDEF_RECORD_PAYLOAD_LEN_LONG_SIZE -
+			      NDEF_RECORD_PAYLOAD_LEN_SHORT_SIZE;
+	}
 
-	rec_desc->type_length = *(nfc_data++);
+	if (flags & NDEF_RECORD_IL_MASK) {
+		header_len += NDEF_RECORD_ID_LEN_SIZE;
+	}
 
-	u32_t payload_length;
+	if (header_len > data_left) {
+		return -EINVAL;
+	}
 
 	if (flags & NDEF_RECORD_SR_MASK) {
-		payload_length = *(nfc_data++);
+		view->payload_length = nfc_data[2];
+		nfc_data += NDEF_RECORD_BASE_SHORT_LEN;
 	} else {
-		expected_rec_size +=
-			NDEF_RECORD_PAYLOAD_LEN_LONG_SIZE - NDEF_RECORD_PAYLOAD_LEN_SHORT_SIZE;
-
-		if (expected_rec_size > *nfc_data_len) {
-			return -EINVAL;
-		}
-
-		payload_length = sys_get_be32(nfc_data);
-		nfc_data += NDEF_RECORD_PAYLOAD_LEN_LONG_SIZE;
+		view->payload_length = sys_get_be32(&nfc_data[2]);
+		nfc_data += NDEF_RECORD_BASE_SHORT_LEN +
+			    NDEF_RECORD_PAYLOAD_LEN_LONG_SIZE -
+			    NDEF_RECORD_PAYLOAD_LEN_SHORT_SIZE;
 	}
 
 	if (flags & NDEF_RECORD_IL_MASK) {
-		expected_rec_size += NDEF_RECORD_ID_LEN_SIZE;
-
-		if (expected_rec_size > *nfc_data_len) {
-			return -EINVAL;
-		}
-
-		rec_desc->id_length = *(nfc_data++);
+		view->id_length = *(nfc_data++);
 	} else {
-		rec_desc->id_length = 0;
-		rec_desc->id        = NULL;
+		view->id_length = 0;
 	}
 
-	expected_rec_size += rec_desc->type_length + rec_desc->id_length + payload_length;
+	/* Compare lengths with the data left, so that a long payload length
+	 * cannot wrap the record size around.
+	 */
+	data_left -= header_len;
 
-	if (expected_rec_size > *nfc_data_len) {
+	if ((u32_t)view->type_length + view->id_length > data_left) {
 		return -EINVAL;
 	}
 
-	if (rec_desc->type_length > 0) {
-		rec_desc->type = nfc_data;
-		nfc_data += rec_desc->type_length;
-	} else {
-		rec_desc->type = NULL;
-	}
+	data_left -= view->type_length + view->id_length;
 
-	if (rec_desc->id_length > 0) {
-		rec_desc->id = nfc_data;
-		nfc_data += rec_desc->id_length;
+	if (view->payload_length > data_left) {
+		return -EINVAL;
 	}
 
-	if (payload_length == 0) {
-		bin_pay_desc->payload = NULL;
-	} else {
-		bin_pay_desc->payload = nfc_data;
+	view->type = (view->type_length > 0) ? nfc_data : NULL;
+	nfc_data += view->type_length;
+
+	view->id = (view->id_length > 0) ? nfc_data : NULL;
+	nfc_data += view->id_length;
+
+	view->payload = (view->payload_length > 0) ? nfc_data : NULL;
+
+	*nfc_data_len = header_len + view->type_length + view->id_length +
+			view->payload_length;
+
+	return 0;
+}
+
+int nfc_ndef_record_parse(struct nfc_ndef_bin_payload_desc *bin_pay_desc,
+			  struct nfc_ndef_record_desc *rec_desc,
+			  enum nfc_ndef_record_location *record_location,
+			  const u8_t *nfc_data,
+			  u32_t *nfc_data_len)
+{
+	struct nfc_ndef_record_view view;
+	int err;
+
+	err = nfc_ndef_record_view_parse(&view, nfc_data, nfc_data_len);
+	if (err) {
+		return err;
 	}
 
-	bin_pay_desc->payload_length = payload_length;
+	rec_desc->tnf = view.tnf;
+	rec_desc->type_length = view.type_length;
+	rec_desc->type = view.type;
+	rec_desc->id_length = view.id_length;
+	rec_desc->id = view.id;
+
+	bin_pay_desc->payload = view.payload;
+	bin_pay_desc->payload_length = view.payload_length;
 
 	rec_desc->payload_descriptor = bin_pay_desc;
 	rec_desc->payload_constructor  = (payload_constructor_t) nfc_ndef_bin_payload_memcopy;
 
-	*nfc_data_len = expected_rec_size;
+	*record_location = view.location;
 
 	return 0;
 }
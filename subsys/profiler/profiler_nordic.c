@@ -14,6 +14,8 @@
 #include <profiler.h>
 #include <string.h>
 
+#include "profiler_sampler.h"
+
 
 /* By default, when there is no shell, all events are profiled. */
 #ifndef CONFIG_SHELL
@@ -155,11 +157,15 @@ int profiler_init(void)
 			(k_thread_entry_t) profiler_nordic_thread_fn,
 			NULL, NULL, NULL,
 			CONFIG_PROFILER_NORDIC_THREAD_PRIORITY, 0, 0);
+
+	profiler_sampler_init();
+
 	return 0;
 }
 
 void profiler_term(void)
 {
+	profiler_sampler_term();
 	sending_events = false;
 	protocol_running = false;
 	k_wakeup(protocol_thread_id);
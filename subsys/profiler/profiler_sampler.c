@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <kernel_structs.h>
+#include <misc/stack.h>
+#include <spinlock.h>
+#include <profiler.h>
+
+#ifdef CONFIG_CPU_CORTEX_M
+#include <arch/arm/cortex_m/cmsis.h>
+#endif
+
+#include "profiler_sampler.h"
+
+
+static u16_t cpu_sample_event_id;
+static u16_t stack_usage_event_id;
+
+static const struct k_thread *monitored_threads[
+					CONFIG_PROFILER_SAMPLER_MAX_THREADS];
+static size_t monitored_thread_cnt;
+static struct k_spinlock lock;
+
+static struct k_timer cpu_sample_timer;
+static struct k_delayed_work stack_usage_work;
+
+
+/* Program counter reported when the sample interrupted another interrupt. */
+#define PC_NESTED_INTERRUPT 0
+
+static u32_t interrupted_pc_get(void)
+{
+#ifdef CONFIG_CPU_CORTEX_M
+#ifdef SCB_ICSR_RETTOBASE_Msk
+	/* If another exception is active, the sample interrupted it, and its
+	 * exception frame is on the main stack, not on the process stack.
+	 * The outermost frame on the process stack would blame the thread.
+	 */
+	if (!(SCB->ICSR & SCB_ICSR_RETTOBASE_Msk)) {
+		return PC_NESTED_INTERRUPT;
+	}
+#endif
+	/* Exception frame of the interrupted thread is stored on the process
+	 * stack: r0-r3, r12, lr, pc, xpsr.
+	 */
+	const u32_t *esf = (const u32_t *)__get_PSP();
+
+	return esf[6];
+#else
+	return 0;
+#endif
+}
+
+static void cpu_sample_fn(struct k_timer *timer)
+{
+	ARG_UNUSED(timer);
+
+	if (!is_profiling_enabled(cpu_sample_event_id)) {
+		return;
+	}
+
+	struct log_event_buf buf;
+
+	profiler_log_start(&buf);
+	profiler_log_add_mem_address(&buf, k_current_get());
+	profiler_log_encode_u32(&buf, interrupted_pc_get());
+	profiler_log_send(&buf, cpu_sample_event_id);
+}
+
+static void send_stack_usage(const struct k_thread *thread)
+{
+	const char *stack = (const char *)thread->stack_info.start;
+	size_t size = thread->stack_info.size;
+	struct log_event_buf buf;
+
+	profiler_log_start(&buf);
+	profiler_log_add_mem_address(&buf, thread);
+	profiler_log_encode_u32(&buf, size);
+	profiler_log_encode_u32(&buf, stack_unused_space_get(stack, size));
+	profiler_log_send(&buf, stack_usage_event_id);
+}
+
+static void stack_usage_work_fn(struct k_work *work)
+{
+	if (is_profiling_enabled(stack_usage_event_id)) {
+		k_spinlock_key_t key = k_spin_lock(&lock);
+		size_t cnt = monitored_thread_cnt;
+
+		k_spin_unlock(&lock, key);
+
+		for (size_t i = 0; i < cnt; i++) {
+			send_stack_usage(monitored_threads[i]);
+		}
+	}
+
+	k_delayed_work_submit(&stack_usage_work,
+			      CONFIG_PROFILER_SAMPLER_STACK_PERIOD_MS);
+}
+
+int profiler_stack_monitor_register(const struct k_thread *thread)
+{
+	__ASSERT_NO_MSG(thread != NULL);
+
+	int err = 0;
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	for (size_t i = 0; i < monitored_thread_cnt; i++) {
+		if (monitored_threads[i] == thread) {
+			k_spin_unlock(&lock, key);
+			return 0;
+		}
+	}
+
+	if (monitored_thread_cnt < ARRAY_SIZE(monitored_threads)) {
+		monitored_threads[monitored_thread_cnt] = thread;
+		monitored_thread_cnt++;
+	} else {
+		err = -ENOMEM;
+	}
+
+	k_spin_unlock(&lock, key);
+
+	return err;
+}
+
+void profiler_sampler_init(void)
+{
+	static const char *cpu_sample_labels[] = {"thread", "pc"};
+	static const enum profiler_arg cpu_sample_types[] = {
+		PROFILER_ARG_U32, PROFILER_ARG_U32
+	};
+	static const char *stack_usage_labels[] = {"thread", "size", "unused"};
+	static const enum profiler_arg stack_usage_types[] = {
+		PROFILER_ARG_U32, PROFILER_ARG_U32, PROFILER_ARG_U32
+	};
+
+	cpu_sample_event_id = profiler_register_event_type(
+				"cpu_sample", cpu_sample_labels,
+				cpu_sample_types,
+				ARRAY_SIZE(cpu_sample_types));
+	stack_usage_event_id = profiler_register_event_type(
+				"stack_usage", stack_usage_labels,
+				stack_usage_types,
+				ARRAY_SIZE(stack_usage_types));
+
+	k_timer_init(&cpu_sample_timer, cpu_sample_fn, NULL);
+	k_timer_start(&cpu_sample_timer,
+		      K_MSEC(CONFIG_PROFILER_SAMPLER_PERIOD_MS),
+		      K_MSEC(CONFIG_PROFILER_SAMPLER_PERIOD_MS));
+
+	k_delayed_work_init(&stack_usage_work, stack_usage_work_fn);
+	k_delayed_work_submit(&stack_usage_work,
+			      CONFIG_PROFILER_SAMPLER_STACK_PERIOD_MS);
+}
+
+void profiler_sampler_term(void)
+{
+	k_timer_stop(&cpu_sample_timer);
+	k_delayed_work_cancel(&stack_usage_work);
+}
@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef _PROFILER_SAMPLER_H_
+#define _PROFILER_SAMPLER_H_
+
+/* Profiler sampler private header, used only by profiler backends. */
+
+#ifdef CONFIG_PROFILER_SAMPLER
+void profiler_sampler_init(void);
+void profiler_sampler_term(void);
+#else
+static inline void profiler_sampler_init(void) {}
+static inline void profiler_sampler_term(void) {}
+#endif
+
+#endif /* _PROFILER_SAMPLER_H_ */
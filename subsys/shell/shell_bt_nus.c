@@ -35,41 +35,12 @@ static void rx_callback(struct bt_conn *conn, const u8_t *const data, u16_t len)
 				  bt_nus->ctrl_blk->context);
 }
 
-static void tx_try(const struct shell_bt_nus *bt_nus)
-{
-	u8_t *buf;
-	u32_t size;
-	u32_t req_len = bt_gatt_nus_max_send(bt_nus->ctrl_blk->conn);
-
-	size = ring_buf_get_claim(bt_nus->tx_ringbuf, &buf, req_len);
-
-	if (size) {
-		int err, err2;
-
-		err = bt_gatt_nus_send(bt_nus->ctrl_blk->conn, buf, size);
-		err2 = ring_buf_get_finish(bt_nus->tx_ringbuf, size);
-		__ASSERT_NO_MSG(err2 == 0);
-
-		if (err == 0) {
-			LOG_DBG("Sent %d bytes", size);
-		} else {
-			LOG_INF("Failed to send %d bytes (%d error)",
-								size, err);
-			bt_nus->ctrl_blk->tx_busy = 0;
-		}
-	} else {
-		bt_nus->ctrl_blk->tx_busy = 0;
-	}
-}
-
-static void tx_callback(struct bt_conn *conn)
+static void tx_callback(struct bt_gatt_nus_stream *stream)
 {
 	const struct shell_bt_nus *bt_nus =
 		(const struct shell_bt_nus *)shell_transport_bt_nus.ctx;
 
-
 	LOG_DBG("Sent operation completed");
-	tx_try(bt_nus);
 	bt_nus->ctrl_blk->handler(SHELL_TRANSPORT_EVT_TX_RDY,
 				  bt_nus->ctrl_blk->context);
 }
@@ -130,13 +101,22 @@ static int write(const struct shell_transport *transport,
 		return 0;
 	}
 
-	*cnt = ring_buf_put(bt_nus->tx_ringbuf, data, length);
-	LOG_DBG("Write req:%d accept:%d", length, *cnt);
+	int ret = bt_gatt_nus_stream_write(bt_nus->tx_stream, data, length,
+					   K_NO_WAIT);
 
-	if (atomic_set(&bt_nus->ctrl_blk->tx_busy, 1) == 0) {
-		tx_try(bt_nus);
+	if (ret == -ENOTCONN) {
+		/* Disconnected, output has nowhere to go. */
+		*cnt = length;
+		return 0;
+	} else if (ret < 0) {
+		LOG_INF("Failed to send %zu bytes (%d error)", length, ret);
+		*cnt = 0;
+		return ret;
 	}
 
+	*cnt = ret;
+	LOG_DBG("Write req:%zu accept:%zu", length, *cnt);
+
 	return 0;
 }
 
@@ -146,6 +126,7 @@ void shell_bt_nus_disable(void)
 			(const struct shell_bt_nus *)shell_transport_bt_nus.ctx;
 
 	bt_nus->ctrl_blk->conn = NULL;
+	bt_gatt_nus_stream_stop(bt_nus->tx_stream);
 }
 
 void shell_bt_nus_enable(struct bt_conn *conn)
@@ -160,6 +141,9 @@ void shell_bt_nus_enable(struct bt_conn *conn)
 
 	bt_nus->ctrl_blk->conn = conn;
 
+	err = bt_gatt_nus_stream_start(bt_nus->tx_stream, conn);
+	__ASSERT_NO_MSG(err == 0);
+
 	if (!is_init) {
 		err = shell_init(&shell_bt_nus, NULL, true, log_backend, level);
 		__ASSERT_NO_MSG(err == 0);
@@ -177,10 +161,16 @@ const struct shell_transport_api shell_bt_nus_transport_api = {
 
 int shell_bt_nus_init(void)
 {
+	const struct shell_bt_nus *bt_nus =
+			(const struct shell_bt_nus *)shell_transport_bt_nus.ctx;
 	struct bt_gatt_nus_cb callbacks = {
 		.received_cb = rx_callback,
-		.sent_cb = tx_callback
 	};
+	int err = bt_gatt_nus_stream_init(bt_nus->tx_stream, tx_callback);
+
+	if (err) {
+		return err;
+	}
 
 	return bt_gatt_nus_init(&callbacks);
 }
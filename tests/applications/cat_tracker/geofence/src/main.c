@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <errno.h>
+#include <misc/util.h>
+
+#include "geofence.h"
+
+/* Micro degrees of latitude per meter, rounded. */
+#define UDEG_PER_M	9
+
+static struct geofence_set set;
+static struct geofence_event events[GEOFENCE_MAX_COUNT];
+
+static const struct geofence_point center = {
+	.lat = 63430000,
+	.lon = 10390000,
+};
+
+/* U shape, open to the north. */
+static const struct geofence_point u_shape[] = {
+	{ .lat = 0, .lon = 0 },
+	{ .lat = 0, .lon = 3000 },
+	{ .lat = 3000, .lon = 3000 },
+	{ .lat = 3000, .lon = 2000 },
+	{ .lat = 1000, .lon = 2000 },
+	{ .lat = 1000, .lon = 1000 },
+	{ .lat = 3000, .lon = 1000 },
+	{ .lat = 3000, .lon = 0 },
+};
+
+static void setup(void)
+{
+	geofence_init(&set);
+}
+
+static struct geofence_point point(s32_t lat, s32_t lon)
+{
+	struct geofence_point pos = { .lat = lat, .lon = lon };
+
+	return pos;
+}
+
+static void test_udeg(void)
+{
+	zassert_equal(geofence_udeg(63.4305), 63430500, "Positive");
+	zassert_equal(geofence_udeg(-10.0000004), -10000000, "Negative");
+	zassert_equal(geofence_udeg(-10.0000006), -10000001, "Rounded");
+}
+
+static void test_circle(void)
+{
+	struct geofence_point pos;
+
+	zassert_equal(geofence_add_circle(&set, 1, &center, 100), 0, NULL);
+
+	/* One degree of longitude is about 0.447 degrees of latitude here. */
+	pos = point(center.lat + 80 * UDEG_PER_M, center.lon);
+	zassert_true(geofence_test(&set, 0, &pos), "80 m north is inside");
+	pos = point(center.lat - 120 * UDEG_PER_M, center.lon);
+	zassert_false(geofence_test(&set, 0, &pos), "120 m south is outside");
+	pos = point(center.lat, center.lon + 80 * UDEG_PER_M * 100 / 45);
+	zassert_true(geofence_test(&set, 0, &pos), "80 m east is inside");
+	pos = point(center.lat, center.lon - 120 * UDEG_PER_M * 100 / 44);
+	zassert_false(geofence_test(&set, 0, &pos), "120 m west is outside");
+}
+
+static void test_polygon(void)
+{
+	struct geofence_point pos;
+
+	zassert_equal(geofence_add_polygon(&set, 2, u_shape,
+					   ARRAY_SIZE(u_shape)), 0, NULL);
+
+	pos = point(500, 1500);
+	zassert_true(geofence_test(&set, 0, &pos), "Bottom is inside");
+	pos = point(2000, 500);
+	zassert_true(geofence_test(&set, 0, &pos), "Left arm is inside");
+	pos = point(2000, 1500);
+	zassert_false(geofence_test(&set, 0, &pos), "Notch is outside");
+	pos = point(2000, 3500);
+	zassert_false(geofence_test(&set, 0, &pos), "East is outside");
+	pos = point(-1, 1500);
+	zassert_false(geofence_test(&set, 0, &pos), "South is outside");
+}
+
+static void test_invalid(void)
+{
+	zassert_equal(geofence_add_circle(&set, 1, &center, 0), -EINVAL,
+		      "Empty circle");
+	zassert_equal(geofence_add_polygon(&set, 1, u_shape, 2), -EINVAL,
+		      "Polygon of two vertices");
+	zassert_equal(geofence_add_polygon(&set, 1, u_shape,
+					   ARRAY_SIZE(u_shape)), 0, NULL);
+	zassert_equal(geofence_add_polygon(&set, 1, u_shape, 3), -EEXIST,
+		      "Polygon with the same id");
+	zassert_equal(geofence_add_circle(&set, 1, &center, 10), -EEXIST,
+		      "Circle with the same id");
+	zassert_equal(geofence_add_polygon(&set, 2, u_shape,
+					   ARRAY_SIZE(u_shape)), 0, NULL);
+	zassert_equal(geofence_add_polygon(&set, 3, u_shape, 3), -ENOMEM,
+		      "Out of vertices");
+
+	for (size_t i = set.count; i < GEOFENCE_MAX_COUNT; i++) {
+		zassert_equal(geofence_add_circle(&set, i + 1, &center, 10), 0,
+			      NULL);
+	}
+
+	zassert_equal(geofence_add_circle(&set, 0, &center, 10), -ENOMEM,
+		      "Out of geofences");
+}
+
+static void test_index_full(void)
+{
+	/* Large geofences overlap every cell of the grid. */
+	for (size_t i = 0; i < 4; i++) {
+		zassert_equal(geofence_add_circle(&set, i, &center, 1000), 0,
+			      NULL);
+	}
+
+	zassert_equal(geofence_index(&set), 0, "Four fill the grid");
+
+	zassert_equal(geofence_add_circle(&set, 4, &center, 1000), 0, NULL);
+	zassert_equal(geofence_index(&set), -ENOMEM, "Five do not fit");
+	zassert_equal(geofence_update(&set, &center, events,
+				      ARRAY_SIZE(events)), 0,
+		      "Not indexed");
+}
+
+static void test_events(void)
+{
+	struct geofence_point pos = point(2000, 1500);
+	struct geofence_point circle = point(2000, 5000);
+
+	zassert_equal(geofence_add_polygon(&set, 10, u_shape,
+					   ARRAY_SIZE(u_shape)), 0, NULL);
+	zassert_equal(geofence_add_circle(&set, 20, &circle, 100), 0, NULL);
+	zassert_equal(geofence_update(&set, &pos, events, ARRAY_SIZE(events)),
+		      0, "Not indexed");
+	zassert_equal(geofence_index(&set), 0, NULL);
+
+	pos = point(500, 500);
+	zassert_equal(geofence_update(&set, &pos, events, ARRAY_SIZE(events)),
+		      0, "First fix has no crossings");
+
+	pos = point(500, 600);
+	zassert_equal(geofence_update(&set, &pos, events, ARRAY_SIZE(events)),
+		      0, "Still inside");
+
+	pos = point(2000, 1500);
+	zassert_equal(geofence_update(&set, &pos, events, ARRAY_SIZE(events)),
+		      1, "Left into the notch");
+	zassert_equal(events[0].id, 10, NULL);
+	zassert_false(events[0].inside, NULL);
+
+	pos = point(2000, 5000);
+	zassert_equal(geofence_update(&set, &pos, events, ARRAY_SIZE(events)),
+		      1, "Entered the circle");
+	zassert_equal(events[0].id, 20, NULL);
+	zassert_true(events[0].inside, NULL);
+
+	pos = point(500, 2500);
+	zassert_equal(geofence_update(&set, &pos, events, 0), 0,
+		      "No room for crossings");
+	zassert_equal(geofence_update(&set, &pos, events, 1), 1,
+		      "Crossings beyond the limit are kept");
+	zassert_equal(events[0].id, 10, NULL);
+	zassert_true(events[0].inside, NULL);
+	zassert_equal(geofence_update(&set, &pos, events, 1), 1,
+		      "Kept crossing reported by the next fix");
+	zassert_equal(events[0].id, 20, NULL);
+	zassert_false(events[0].inside, NULL);
+
+	pos = point(1000000, 1000000);
+	zassert_equal(geofence_update(&set, &pos, events, ARRAY_SIZE(events)),
+		      1, "Left outside the grid");
+	zassert_equal(events[0].id, 10, NULL);
+	zassert_false(events[0].inside, NULL);
+}
+
+static void test_replace(void)
+{
+	struct geofence_point pos = point(500, 500);
+	struct geofence_point circle = point(500, 5000);
+	u16_t inside[GEOFENCE_MAX_COUNT];
+	int count;
+
+	zassert_equal(geofence_inside_get(&set, inside), -ENODATA,
+		      "No fix yet");
+
+	zassert_equal(geofence_add_polygon(&set, 10, u_shape,
+					   ARRAY_SIZE(u_shape)), 0, NULL);
+	zassert_equal(geofence_add_circle(&set, 20, &circle, 100), 0, NULL);
+	zassert_equal(geofence_index(&set), 0, NULL);
+	zassert_equal(geofence_update(&set, &pos, events, ARRAY_SIZE(events)),
+		      0, NULL);
+
+	count = geofence_inside_get(&set, inside);
+	zassert_equal(count, 1, NULL);
+	zassert_equal(inside[0], 10, NULL);
+
+	/* Same polygon, in another order with a new circle around it. */
+	geofence_init(&set);
+	zassert_equal(geofence_add_circle(&set, 30, &pos, 100), 0, NULL);
+	zassert_equal(geofence_add_polygon(&set, 10, u_shape,
+					   ARRAY_SIZE(u_shape)), 0, NULL);
+	zassert_equal(geofence_index(&set), 0, NULL);
+	geofence_inside_set(&set, inside, count);
+
+	zassert_equal(geofence_update(&set, &pos, events, ARRAY_SIZE(events)),
+		      1, "Only the new geofence is crossed");
+	zassert_equal(events[0].id, 30, NULL);
+	zassert_true(events[0].inside, NULL);
+
+	pos = point(2000, 1500);
+	zassert_equal(geofence_update(&set, &pos, events, ARRAY_SIZE(events)),
+		      2, "Both left");
+}
+
+/* The grid must give the same crossings as testing every geofence. */
+static void test_index_matches_scan(void)
+{
+	bool inside[GEOFENCE_MAX_COUNT] = { false };
+	u32_t seed = 1;
+
+	for (size_t i = 0; i < GEOFENCE_MAX_COUNT; i++) {
+		struct geofence_point c = point(center.lat + i * 1500,
+						center.lon + (i % 3) * 2000);
+
+		zassert_equal(geofence_add_circle(&set, i, &c, 100), 0, NULL);
+	}
+
+	zassert_equal(geofence_index(&set), 0, NULL);
+
+	for (size_t n = 0; n < 2000; n++) {
+		struct geofence_point pos;
+		size_t count;
+		size_t expected = 0;
+
+		seed = seed * 1103515245 + 12345;
+		pos.lat = center.lat - 1000 + (seed >> 8) % 14000;
+		seed = seed * 1103515245 + 12345;
+		pos.lon = center.lon - 1000 + (seed >> 8) % 7000;
+
+		count = geofence_update(&set, &pos, events,
+					ARRAY_SIZE(events));
+
+		for (size_t i = 0; i < GEOFENCE_MAX_COUNT; i++) {
+			bool now = geofence_test(&set, i, &pos);
+
+			expected += (n > 0) && (now != inside[i]);
+			inside[i] = now;
+		}
+
+		zassert_equal(count, expected, "Crossings differ");
+
+		for (size_t i = 0; i < count; i++) {
+			zassert_equal(events[i].inside, inside[events[i].id],
+				      "Wrong direction");
+		}
+	}
+}
+
+void test_main(void)
+{
+	ztest_test_suite(geofence_test,
+			 ztest_unit_test(test_udeg),
+			 ztest_unit_test_setup_teardown(test_circle,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_polygon,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_invalid,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_index_full,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_events,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_replace,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_index_matches_scan,
+							setup, unit_test_noop)
+			 );
+
+	ztest_run_test_suite(geofence_test);
+}
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <misc/util.h>
+
+#include "motion_features.h"
+#include "activity.h"
+
+#define TAG_X		0
+#define TAG_Y		1
+#define TAG_Z		2
+#define TAG_TEMP	3
+
+static const struct activity_model model = {
+	.rest_var_max = 1600,
+	.run_var_min = 90000,
+	.run_peaks_min = 6,
+	.climb_horizontal_min = 700,
+};
+
+static struct motion_block block;
+static struct motion_features features;
+static u8_t fifo[3 * 2 * (MOTION_BLOCK_SIZE + 2)];
+static size_t fifo_len;
+
+static void setup(void)
+{
+	memset(&block, 0, sizeof(block));
+	memset(&features, 0, sizeof(features));
+	fifo_len = 0;
+}
+
+static void fifo_add(u8_t tag, s16_t value)
+{
+	u16_t entry = (value & 0x3FFF) | (tag << 14);
+
+	fifo[fifo_len++] = entry & 0xFF;
+	fifo[fifo_len++] = entry >> 8;
+}
+
+static void fifo_add_sample(s16_t x, s16_t y, s16_t z)
+{
+	fifo_add(TAG_X, x);
+	fifo_add(TAG_Y, y);
+	fifo_add(TAG_Z, z);
+}
+
+static void block_fill(const s16_t *z, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		block.x[i] = 0;
+		block.y[i] = 0;
+		block.z[i] = z[i];
+	}
+
+	block.count = count;
+}
+
+static void test_decode(void)
+{
+	fifo_add_sample(1, -2, 250);
+	fifo_add_sample(-2048, 2047, -250);
+
+	zassert_equal(motion_block_decode(&block, fifo, fifo_len, 4), 2,
+		      "Two samples should be decoded");
+	zassert_equal(block.count, 2, "Two samples should be in the block");
+	zassert_equal(block.x[0], 4, "Sample should be scaled");
+	zassert_equal(block.y[0], -8, "Sample should be sign extended");
+	zassert_equal(block.z[0], 1000, "Sample should be scaled");
+	zassert_equal(block.x[1], -8192, "Sample should be sign extended");
+	zassert_equal(block.y[1], 8188, "Sample should be scaled");
+	zassert_equal(block.z[1], -1000, "Sample should be sign extended");
+}
+
+static void test_decode_resync(void)
+{
+	/* Tail of a sample that was partly read before. */
+	fifo_add(TAG_Y, 5);
+	fifo_add(TAG_Z, 5);
+	fifo_add_sample(1, 2, 3);
+	fifo_add(TAG_TEMP, 100);
+	/* Sample with a missing entry. */
+	fifo_add(TAG_X, 7);
+	fifo_add(TAG_Z, 7);
+	fifo_add_sample(4, 5, 6);
+	/* Incomplete sample at the end. */
+	fifo_add(TAG_X, 8);
+
+	zassert_equal(motion_block_decode(&block, fifo, fifo_len, 1), 2,
+		      "Only whole samples should be decoded");
+	zassert_equal(block.x[0], 1, "First whole sample should be kept");
+	zassert_equal(block.z[0], 3, "First whole sample should be kept");
+	zassert_equal(block.x[1], 4, "Second whole sample should be kept");
+	zassert_equal(block.z[1], 6, "Second whole sample should be kept");
+}
+
+static void test_decode_full(void)
+{
+	for (size_t i = 0; i < MOTION_BLOCK_SIZE + 2; i++) {
+		fifo_add_sample(i, 0, 0);
+	}
+
+	zassert_equal(motion_block_decode(&block, fifo, fifo_len, 1),
+		      MOTION_BLOCK_SIZE, "Block should be filled");
+	zassert_equal(block.x[MOTION_BLOCK_SIZE - 1], MOTION_BLOCK_SIZE - 1,
+		      "Samples should be in order");
+	zassert_equal(motion_block_decode(&block, fifo, fifo_len, 1), 0,
+		      "Full block should not take samples");
+}
+
+static void test_features_rest(void)
+{
+	for (size_t i = 0; i < MOTION_BLOCK_SIZE; i++) {
+		block.x[i] = -30;
+		block.y[i] = 40;
+		block.z[i] = -1000;
+	}
+
+	block.count = MOTION_BLOCK_SIZE;
+
+	motion_features_get(&block, 100, 1, &features);
+
+	zassert_equal(features.mean[0], -30, "Wrong mean");
+	zassert_equal(features.mean[1], 40, "Wrong mean");
+	zassert_equal(features.mean[2], -1000, "Wrong mean");
+	/* sqrt(30^2 + 40^2 + 1000^2) = 1001.2 */
+	zassert_equal(features.mag_mean, 1001, "Wrong magnitude");
+	zassert_equal(features.mag_dev_max, 0, "Gravity is not movement");
+	zassert_equal(block.mag[0], 1001, "Magnitude should be set");
+	zassert_equal(features.mag_var, 0, "Wrong variance");
+	zassert_equal(features.peak_count, 0, "No peaks at rest");
+}
+
+static void test_features_variance(void)
+{
+	s16_t z[MOTION_BLOCK_SIZE];
+
+	for (size_t i = 0; i < ARRAY_SIZE(z); i++) {
+		z[i] = (i % 2) ? 1100 : 900;
+	}
+
+	block_fill(z, ARRAY_SIZE(z));
+	motion_features_get(&block, 500, 1, &features);
+
+	zassert_equal(features.mag_mean, 1000, "Wrong magnitude");
+	zassert_equal(features.mag_var, 100 * 100, "Wrong variance");
+	zassert_equal(features.mag_dev_max, 100, "Wrong deviation");
+	zassert_equal(features.peak_count, 0, "Peaks should be high enough");
+}
+
+static void test_features_peaks(void)
+{
+	s16_t z[MOTION_BLOCK_SIZE];
+
+	/* Steps every eight samples, with a smaller bump after each. */
+	for (size_t i = 0; i < ARRAY_SIZE(z); i++) {
+		switch (i % 8) {
+		case 3:
+			z[i] = 1300;
+			break;
+		case 4:
+			z[i] = 1600;
+			break;
+		case 5:
+			z[i] = 1200;
+			break;
+		case 6:
+			z[i] = 1500;
+			break;
+		default:
+			z[i] = 900;
+			break;
+		}
+	}
+
+	block_fill(z, ARRAY_SIZE(z));
+
+	motion_features_get(&block, 200, 1, &features);
+	zassert_equal(features.peak_count, 2 * MOTION_BLOCK_SIZE / 8,
+		      "Every local maximum should count");
+
+	motion_features_get(&block, 200, 4, &features);
+	zassert_equal(features.peak_count, MOTION_BLOCK_SIZE / 8,
+		      "Peaks too close should not count");
+
+	motion_features_get(&block, 1000, 1, &features);
+	zassert_equal(features.peak_count, 0, "Peaks should be high enough");
+}
+
+static void test_features_empty(void)
+{
+	motion_features_get(&block, 100, 1, &features);
+
+	zassert_equal(features.mag_mean, 0, "Empty block has no magnitude");
+	zassert_equal(features.peak_count, 0, "Empty block has no peaks");
+}
+
+static void test_activity_classify(void)
+{
+	features.mag_var = 100;
+	zassert_equal(activity_classify(&model, &features), ACTIVITY_REST,
+		      "Steady magnitude is rest");
+
+	features.peak_count = 1;
+	zassert_equal(activity_classify(&model, &features), ACTIVITY_WALK,
+		      "A peak is not rest");
+
+	features.mag_var = 10000;
+	features.peak_count = 3;
+	zassert_equal(activity_classify(&model, &features), ACTIVITY_WALK,
+		      "Few peaks is walk");
+
+	features.peak_count = 6;
+	zassert_equal(activity_classify(&model, &features), ACTIVITY_RUN,
+		      "Many peaks is run");
+
+	features.peak_count = 0;
+	features.mag_var = 90000;
+	zassert_equal(activity_classify(&model, &features), ACTIVITY_RUN,
+		      "Large variance is run");
+
+	features.mean[0] = 500;
+	features.mean[1] = -500;
+	zassert_equal(activity_classify(&model, &features), ACTIVITY_CLIMB,
+		      "Horizontal gravity is climb");
+
+	features.mean[1] = -400;
+	zassert_equal(activity_classify(&model, &features), ACTIVITY_RUN,
+		      "Tilted is not climb");
+}
+
+static void test_activity_move_min(void)
+{
+	struct activity_model moving = model;
+
+	features.mag_var = 10000;
+	features.peak_count = 3;
+	features.mag_dev_max = 150;
+	zassert_equal(activity_classify(&moving, &features), ACTIVITY_WALK,
+		      "No threshold by default");
+
+	moving.move_min = 150;
+	zassert_equal(activity_classify(&moving, &features), ACTIVITY_WALK,
+		      "Threshold reached is moving");
+
+	moving.move_min = 151;
+	zassert_equal(activity_classify(&moving, &features), ACTIVITY_REST,
+		      "Below the threshold is rest");
+}
+
+static void test_activity_hysteresis(void)
+{
+	struct activity_classifier classifier;
+	struct motion_features rest = { .mag_var = 100 };
+	struct motion_features walk = { .mag_var = 10000, .peak_count = 2 };
+
+	activity_init(&classifier, &model, 2);
+	zassert_equal(classifier.activity, ACTIVITY_REST, "Starts at rest");
+
+	zassert_false(activity_update(&classifier, &walk),
+		      "Single window is not taken");
+	zassert_false(activity_update(&classifier, &rest),
+		      "Back at rest");
+	zassert_false(activity_update(&classifier, &walk),
+		      "Candidate starts over");
+	zassert_true(activity_update(&classifier, &walk),
+		     "Two windows are taken");
+	zassert_equal(classifier.activity, ACTIVITY_WALK, "Walking");
+	zassert_false(activity_update(&classifier, &walk), "No change");
+
+	activity_init(&classifier, &model, 1);
+	zassert_true(activity_update(&classifier, &walk),
+		     "Taken at once");
+}
+
+static void test_activity_name(void)
+{
+	zassert_true(strcmp(activity_name(ACTIVITY_REST), "rest") == 0, NULL);
+	zassert_true(strcmp(activity_name(ACTIVITY_WALK), "walk") == 0, NULL);
+	zassert_true(strcmp(activity_name(ACTIVITY_RUN), "run") == 0, NULL);
+	zassert_true(strcmp(activity_name(ACTIVITY_CLIMB), "climb") == 0,
+		     NULL);
+	zassert_true(strcmp(activity_name(-1), "unknown") == 0, NULL);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(motion_features_test,
+			 ztest_unit_test_setup_teardown(test_decode,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_decode_resync,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_decode_full,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_features_rest,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_features_variance,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_features_peaks,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_features_empty,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_activity_classify,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_activity_move_min,
+							setup, unit_test_noop),
+			 ztest_unit_test(test_activity_hysteresis),
+			 ztest_unit_test(test_activity_name)
+			 );
+
+	ztest_run_test_suite(motion_features_test);
+}
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <misc/util.h>
+
+#include "hid_eventq.h"
+
+#define QUEUE_SIZE	12
+#define EXPIRATION	500
+#define USAGE_COUNT	6
+#define STORM_STEPS	20000
+
+static struct hid_eventq_event events[QUEUE_SIZE];
+static struct hid_eventq eventq = HID_EVENTQ_INITIALIZER(events);
+
+/* Reference queue. Events are kept in a plain array and removed with the
+ * algorithm previously used on the linked list.
+ */
+static struct hid_eventq_event ref_events[QUEUE_SIZE];
+static size_t ref_len;
+
+static u32_t rand_state;
+
+static u32_t rand_get(void)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+
+	return rand_state >> 16;
+}
+
+static void ref_append(u16_t usage_id, s16_t value, u32_t timestamp)
+{
+	zassert_true(ref_len < QUEUE_SIZE, "Reference queue overflow");
+
+	ref_events[ref_len].usage_id = usage_id;
+	ref_events[ref_len].value = value;
+	ref_events[ref_len].timestamp = timestamp;
+	ref_len++;
+}
+
+static size_t ref_cleanup(u32_t timestamp)
+{
+	size_t first_valid;
+
+	for (first_valid = 0; first_valid < ref_len; first_valid++) {
+		if (timestamp - ref_events[first_valid].timestamp < EXPIRATION) {
+			break;
+		}
+	}
+
+	size_t maxfound = 0;
+	size_t purge_cnt = 0;
+
+	for (size_t cur = 0; cur < first_valid; cur++) {
+		if (ref_events[cur].value > 0) {
+			unsigned int hit_count = ref_events[cur].value;
+			size_t j;
+
+			for (j = cur + 1; j < first_valid; j++) {
+				if (ref_events[j].usage_id ==
+				    ref_events[cur].usage_id) {
+					hit_count += ref_events[j].value;
+					if (hit_count == 0) {
+						break;
+					}
+				}
+			}
+
+			if (j == first_valid) {
+				break;
+			}
+
+			maxfound = MAX(maxfound, j);
+		}
+
+		if (cur == maxfound) {
+			purge_cnt = cur + 1;
+		}
+	}
+
+	memmove(ref_events, &ref_events[purge_cnt],
+		(ref_len - purge_cnt) * sizeof(ref_events[0]));
+	ref_len -= purge_cnt;
+
+	return purge_cnt;
+}
+
+static void queue_compare(void)
+{
+	zassert_equal(eventq.len, ref_len, "Invalid queue length");
+
+	for (size_t i = 0; i < ref_len; i++) {
+		const struct hid_eventq_event *event =
+			hid_eventq_peek(&eventq, i);
+
+		zassert_equal(event->usage_id, ref_events[i].usage_id,
+			      "Invalid usage");
+		zassert_equal(event->value, ref_events[i].value,
+			      "Invalid value");
+		zassert_equal(event->timestamp, ref_events[i].timestamp,
+			      "Invalid timestamp");
+	}
+}
+
+static void setup(void)
+{
+	hid_eventq_reset(&eventq);
+	ref_len = 0;
+	rand_state = 0x5eed;
+}
+
+static void test_fifo_wraparound(void)
+{
+	struct hid_eventq_event event;
+
+	/* Move head across the end of the ring several times. */
+	for (u16_t i = 0; i < 5 * QUEUE_SIZE; i++) {
+		hid_eventq_append(&eventq, i, 1, i);
+		if (eventq.len == QUEUE_SIZE - 1) {
+			for (size_t j = 0; j < QUEUE_SIZE / 2; j++) {
+				zassert_true(hid_eventq_get(&eventq, &event),
+					     "Queue empty");
+			}
+		}
+
+		zassert_false(hid_eventq_is_full(&eventq), "Queue full");
+	}
+
+	u16_t expected = eventq.events[eventq.head].usage_id;
+
+	while (hid_eventq_get(&eventq, &event)) {
+		zassert_equal(event.usage_id, expected, "Invalid order");
+		expected++;
+	}
+
+	zassert_equal(expected, 5 * QUEUE_SIZE, "Events lost");
+	zassert_true(hid_eventq_is_empty(&eventq), "Queue not empty");
+}
+
+static void test_full(void)
+{
+	for (size_t i = 0; i < QUEUE_SIZE; i++) {
+		zassert_false(hid_eventq_is_full(&eventq), "Queue full");
+		hid_eventq_append(&eventq, i, 1, 0);
+	}
+
+	zassert_true(hid_eventq_is_full(&eventq), "Queue not full");
+
+	hid_eventq_reset(&eventq);
+	zassert_true(hid_eventq_is_empty(&eventq), "Queue not empty");
+}
+
+static void test_unpaired_key_down_kept(void)
+{
+	/* Key A is pressed and never released. Key B is clicked. */
+	hid_eventq_append(&eventq, 0xA, 1, 0);
+	hid_eventq_append(&eventq, 0xB, 1, 10);
+	hid_eventq_append(&eventq, 0xB, -1, 20);
+
+	zassert_equal(hid_eventq_cleanup(&eventq, 1000, EXPIRATION), 0,
+		      "Unpaired key down removed");
+	zassert_equal(eventq.len, 3, "Events removed");
+
+	/* Release of A pairs the whole region. */
+	hid_eventq_append(&eventq, 0xA, -1, 1000);
+	zassert_equal(hid_eventq_cleanup(&eventq, 1000 + EXPIRATION,
+					 EXPIRATION),
+		      4, "Paired events not removed");
+	zassert_true(hid_eventq_is_empty(&eventq), "Queue not empty");
+}
+
+static void test_partial_purge(void)
+{
+	/* Click of A, then B pressed and released only after the
+	 * expiration point. Only the click of A can be removed.
+	 */
+	hid_eventq_append(&eventq, 0xA, 1, 0);
+	hid_eventq_append(&eventq, 0xA, -1, 10);
+	hid_eventq_append(&eventq, 0xB, 1, 20);
+	hid_eventq_append(&eventq, 0xB, -1, 400);
+
+	zassert_equal(hid_eventq_cleanup(&eventq, 600, EXPIRATION), 2,
+		      "Invalid number of removed events");
+	zassert_equal(hid_eventq_peek(&eventq, 0)->usage_id, 0xB,
+		      "Invalid head");
+	zassert_equal(hid_eventq_peek(&eventq, 0)->value, 1,
+		      "Key down of B removed");
+}
+
+static void test_key_storm(void)
+{
+	bool pressed[USAGE_COUNT] = {0};
+	u32_t timestamp = 0;
+	size_t purged = 0;
+	u32_t cycles = 0;
+
+	for (size_t step = 0; step < STORM_STEPS; step++) {
+		u16_t usage_id = rand_get() % USAGE_COUNT;
+		s16_t value = pressed[usage_id] ? -1 : 1;
+
+		timestamp += rand_get() % 120;
+
+		/* Key down cannot be removed without its key up, so the sum
+		 * of removed values cannot be positive for any usage. It can
+		 * be negative if key down was already consumed by a report.
+		 */
+		s32_t sum[USAGE_COUNT] = {0};
+
+		for (size_t i = 0; i < eventq.len; i++) {
+			const struct hid_eventq_event *event =
+				hid_eventq_peek(&eventq, i);
+
+			sum[event->usage_id] += event->value;
+		}
+
+		u32_t start = k_cycle_get_32();
+		size_t cnt = hid_eventq_cleanup(&eventq, timestamp,
+						EXPIRATION);
+
+		cycles += k_cycle_get_32() - start;
+
+		zassert_equal(cnt, ref_cleanup(timestamp),
+			      "Invalid number of removed events");
+		queue_compare();
+
+		for (size_t i = 0; i < eventq.len; i++) {
+			const struct hid_eventq_event *event =
+				hid_eventq_peek(&eventq, i);
+
+			sum[event->usage_id] -= event->value;
+		}
+
+		for (size_t i = 0; i < ARRAY_SIZE(sum); i++) {
+			zassert_true(sum[i] <= 0, "Unpaired key down removed");
+		}
+
+		purged += cnt;
+
+		if (hid_eventq_is_full(&eventq)) {
+			/* Report is sent, the oldest event is consumed. */
+			struct hid_eventq_event event;
+
+			zassert_true(hid_eventq_get(&eventq, &event),
+				     "Queue empty");
+			memmove(ref_events, &ref_events[1],
+				(ref_len - 1) * sizeof(ref_events[0]));
+			ref_len--;
+		}
+
+		hid_eventq_append(&eventq, usage_id, value, timestamp);
+		ref_append(usage_id, value, timestamp);
+		pressed[usage_id] = !pressed[usage_id];
+	}
+
+	queue_compare();
+	zassert_true(purged > 0, "No events were purged");
+
+	printk("%zu events purged, cleanup took %u cycles on average\n",
+	       purged, cycles / STORM_STEPS);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(hid_eventq_tests,
+			 ztest_unit_test_setup_teardown(test_fifo_wraparound,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_full,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(
+				test_unpaired_key_down_kept,
+				setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_partial_purge,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_key_storm,
+							setup, unit_test_noop)
+			 );
+
+	ztest_run_test_suite(hid_eventq_tests);
+}
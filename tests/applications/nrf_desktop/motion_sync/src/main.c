@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <limits.h>
+#include <misc/util.h>
+
+#include "motion_sync.h"
+
+/* Times are given in microseconds. */
+#define PERIOD_MAX	20000
+#define MARGIN		1000
+#define BLE_INTERVAL	7500
+#define SLOT_COUNT	1000
+
+static struct motion_sync ms;
+
+static void setup(void)
+{
+	ms = (struct motion_sync)MOTION_SYNC_INITIALIZER(PERIOD_MAX);
+}
+
+static void test_accumulate(void)
+{
+	s16_t dx;
+	s16_t dy;
+	u32_t timestamp;
+
+	zassert_false(motion_sync_publish(&ms, &dx, &dy, &timestamp),
+		      "Published without motion");
+
+	motion_sync_add(&ms, 0, 0, 10);
+	zassert_false(motion_sync_publish(&ms, &dx, &dy, &timestamp),
+		      "Published without motion");
+
+	motion_sync_add(&ms, 5, -3, 20);
+	motion_sync_add(&ms, 7, 1, 30);
+	zassert_true(motion_sync_publish(&ms, &dx, &dy, &timestamp),
+		     "Motion not published");
+	zassert_equal(dx, 12, "Invalid dx");
+	zassert_equal(dy, -2, "Invalid dy");
+	zassert_equal(timestamp, 30, "Invalid timestamp");
+	zassert_equal(ms.sample_time, 20, "Invalid sample time");
+
+	zassert_false(motion_sync_publish(&ms, &dx, &dy, &timestamp),
+		      "Motion published twice");
+}
+
+static void test_saturation(void)
+{
+	s16_t dx;
+	s16_t dy;
+	u32_t timestamp;
+
+	motion_sync_add(&ms, SHRT_MAX, SHRT_MIN, 10);
+	motion_sync_add(&ms, 100, -100, 20);
+
+	zassert_true(motion_sync_publish(&ms, &dx, &dy, &timestamp),
+		     "Motion not published");
+	zassert_equal(dx, SHRT_MAX, "Invalid dx");
+	zassert_equal(dy, SHRT_MIN, "Invalid dy");
+
+	/* Remainder is sent in the next report. */
+	zassert_true(motion_sync_publish(&ms, &dx, &dy, &timestamp),
+		     "Remainder not published");
+	zassert_equal(dx, 100, "Invalid dx");
+	zassert_equal(dy, -100, "Invalid dy");
+}
+
+static void publish(u32_t time)
+{
+	s16_t dx;
+	s16_t dy;
+	u32_t timestamp;
+
+	motion_sync_add(&ms, 1, 1, time);
+	zassert_true(motion_sync_publish(&ms, &dx, &dy, &timestamp),
+		     "Motion not published");
+}
+
+static void test_period_estimation(void)
+{
+	u32_t time = 0;
+
+	for (size_t i = 0; i < 3; i++) {
+		publish(time);
+		time += BLE_INTERVAL;
+		motion_sync_report_sent(&ms, time);
+	}
+	zassert_equal(ms.period, BLE_INTERVAL, "Invalid period");
+
+	/* Missed slot is not used for the estimation. */
+	publish(time);
+	time += 2 * BLE_INTERVAL;
+	motion_sync_report_sent(&ms, time);
+	zassert_equal(ms.period, BLE_INTERVAL, "Missed slot used");
+
+	/* Report without motion breaks the measurement. */
+	motion_sync_report_sent(&ms, time + 100);
+	publish(time + 200);
+	motion_sync_report_sent(&ms, time + 300);
+	zassert_equal(ms.period, BLE_INTERVAL, "Report without motion used");
+
+	motion_sync_reset(&ms);
+	zassert_equal(ms.period, 0, "Period not reset");
+}
+
+static void test_period_increase(void)
+{
+	u32_t time = 0;
+	u32_t interval = 2 * BLE_INTERVAL;
+
+	for (size_t i = 0; i < 3; i++) {
+		publish(time);
+		time += BLE_INTERVAL;
+		motion_sync_report_sent(&ms, time);
+	}
+	zassert_equal(ms.period, BLE_INTERVAL, "Invalid period");
+
+	/* Connection interval got longer. First samples look like missed
+	 * slots, but the estimation follows once they keep coming.
+	 */
+	for (size_t i = 0; i < 3; i++) {
+		publish(time);
+		time += interval;
+		motion_sync_report_sent(&ms, time);
+	}
+	zassert_equal(ms.period, BLE_INTERVAL, "Changed on a few samples");
+
+	publish(time);
+	time += interval;
+	motion_sync_report_sent(&ms, time);
+	zassert_equal(ms.period, interval, "Longer period not followed");
+
+	/* Single missed slot after that does not matter. */
+	publish(time);
+	time += 2 * interval;
+	motion_sync_report_sent(&ms, time);
+	publish(time);
+	time += interval;
+	motion_sync_report_sent(&ms, time);
+	zassert_equal(ms.period, interval, "Missed slot used");
+}
+
+static void test_period_max(void)
+{
+	u32_t time = 0;
+
+	for (size_t i = 0; i < 3; i++) {
+		publish(time);
+		time += PERIOD_MAX + 1;
+		motion_sync_report_sent(&ms, time);
+	}
+	zassert_equal(ms.period, 0, "Too long period estimated");
+	zassert_equal(motion_sync_read_delay(&ms, time, MARGIN), 0,
+		      "Read delayed without period");
+}
+
+static void test_read_delay(void)
+{
+	u32_t time = UINT32_MAX - BLE_INTERVAL;
+
+	/* Time wraps around during the test. */
+	for (size_t i = 0; i < 3; i++) {
+		publish(time);
+		time += BLE_INTERVAL;
+		motion_sync_report_sent(&ms, time);
+	}
+
+	zassert_equal(motion_sync_read_delay(&ms, time, MARGIN),
+		      BLE_INTERVAL - MARGIN, "Invalid delay");
+	zassert_equal(motion_sync_read_delay(&ms, time + BLE_INTERVAL, MARGIN),
+		      0, "Late read delayed");
+
+	/* Slot without motion moves the read to the next slot. */
+	motion_sync_slot_skip(&ms, time + BLE_INTERVAL - MARGIN);
+	zassert_equal(motion_sync_read_delay(&ms, time + BLE_INTERVAL, MARGIN),
+		      BLE_INTERVAL - MARGIN, "Invalid delay after skip");
+
+	/* Skip long after the slot does not schedule read in the past. */
+	motion_sync_slot_skip(&ms, time + 10 * BLE_INTERVAL);
+	zassert_equal(motion_sync_read_delay(&ms, time + 10 * BLE_INTERVAL,
+					     MARGIN),
+		      BLE_INTERVAL - MARGIN, "Invalid delay after late skip");
+}
+
+/* Simulate continuous motion on a BLE link. Report is sent on the first
+ * connection event after the motion was published.
+ */
+static u32_t simulate(void)
+{
+	struct motion_sync_stats stats;
+	u32_t time = 0;
+
+	for (size_t i = 0; i < SLOT_COUNT; i++) {
+		u32_t read_time = time + motion_sync_read_delay(&ms, time,
+								MARGIN);
+
+		zassert_true(read_time - time < BLE_INTERVAL, "Slot missed");
+
+		publish(read_time);
+		time += BLE_INTERVAL;
+		motion_sync_report_sent(&ms, time);
+	}
+
+	motion_sync_stats_get(&ms, &stats);
+	zassert_equal(stats.cnt, SLOT_COUNT, "Invalid report count");
+	zassert_true(stats.min <= stats.avg, "Invalid minimum");
+	zassert_true(stats.avg <= stats.max, "Invalid maximum");
+
+	return stats.avg;
+}
+
+static void test_latency(void)
+{
+	u32_t synced = simulate();
+
+	/* Without period estimation sensor is read right after the
+	 * previous report is sent.
+	 */
+	ms = (struct motion_sync)MOTION_SYNC_INITIALIZER(0);
+	u32_t unsynced = simulate();
+
+	printk("Average latency: %u us synchronized, %u us unsynchronized\n",
+	       synced, unsynced);
+
+	zassert_equal(unsynced, BLE_INTERVAL, "Invalid latency");
+	zassert_true(synced < MARGIN + BLE_INTERVAL / 10,
+		     "Synchronized latency too long");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(motion_sync_tests,
+			 ztest_unit_test_setup_teardown(test_accumulate,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_saturation,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_period_estimation,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_period_increase,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_period_max,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_read_delay,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_latency,
+							setup, unit_test_noop)
+			 );
+
+	ztest_run_test_suite(motion_sync_tests);
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <stdio.h>
+#include <net/socket.h>
+#include <net/socket_offload.h>
+#include "at_socket_mock.h"
+
+#define MOCK_SOCKET_FD		1
+#define MOCK_FRAME_MAX_LEN	96
+#define MOCK_FRAME_COUNT	16
+/* Frames kept free for replies, so that sending a command never blocks on
+ * notifications that are waiting to be received.
+ */
+#define MOCK_REPLY_FRAMES	2
+#define MOCK_CMD_MAX_LEN	64
+#define MOCK_CMD_LOG_LEN	16
+
+struct mock_frame {
+	char data[MOCK_FRAME_MAX_LEN];
+	bool notif;
+};
+
+static struct mock_frame frames[MOCK_FRAME_COUNT];
+static size_t frame_rd;
+static size_t frame_wr;
+static K_MUTEX_DEFINE(frame_lock);
+static K_SEM_DEFINE(frames_ready, 0, MOCK_FRAME_COUNT);
+static K_SEM_DEFINE(notif_space, MOCK_FRAME_COUNT - MOCK_REPLY_FRAMES,
+		    MOCK_FRAME_COUNT - MOCK_REPLY_FRAMES);
+
+static char sent[MOCK_CMD_LOG_LEN][MOCK_CMD_MAX_LEN];
+static size_t sent_count;
+static bool hold;
+static char held_reply[MOCK_FRAME_MAX_LEN];
+static K_MUTEX_DEFINE(cmd_lock);
+
+static void frame_push(const char *data, bool notif)
+{
+	struct mock_frame *frame;
+
+	k_mutex_lock(&frame_lock, K_FOREVER);
+
+	frame = &frames[frame_wr];
+	frame_wr = (frame_wr + 1) % ARRAY_SIZE(frames);
+
+	strncpy(frame->data, data, sizeof(frame->data) - 1);
+	frame->data[sizeof(frame->data) - 1] = '\0';
+	frame->notif = notif;
+
+	k_mutex_unlock(&frame_lock);
+
+	k_sem_give(&frames_ready);
+}
+
+static void reply_get(const char *cmd, char *reply, size_t len)
+{
+	if (strncmp(cmd, "AT+ECHO=", 8) == 0) {
+		snprintf(reply, len, "+ECHO: %s\r\nOK\r\n", cmd + 8);
+	} else if (strcmp(cmd, "AT+ERR") == 0) {
+		snprintf(reply, len, "ERROR\r\n");
+	} else if (strncmp(cmd, "AT+CME=", 7) == 0) {
+		snprintf(reply, len, "+CME ERROR: %s\r\n", cmd + 7);
+	} else if (strncmp(cmd, "AT+CMS=", 7) == 0) {
+		snprintf(reply, len, "+CMS ERROR: %s\r\n", cmd + 7);
+	} else {
+		snprintf(reply, len, "OK\r\n");
+	}
+}
+
+static int mock_socket(int family, int type, int proto)
+{
+	return MOCK_SOCKET_FD;
+}
+
+static int mock_close(int sd)
+{
+	return 0;
+}
+
+static ssize_t mock_send(int sd, const void *buf, size_t len, int flags)
+{
+	char cmd[MOCK_CMD_MAX_LEN];
+	char reply[MOCK_FRAME_MAX_LEN];
+
+	len = MIN(len, sizeof(cmd) - 1);
+	memcpy(cmd, buf, len);
+	cmd[len] = '\0';
+
+	reply_get(cmd, reply, sizeof(reply));
+
+	k_mutex_lock(&cmd_lock, K_FOREVER);
+
+	if (sent_count < ARRAY_SIZE(sent)) {
+		strcpy(sent[sent_count], cmd);
+	}
+
+	sent_count++;
+
+	if (hold) {
+		strcpy(held_reply, reply);
+		k_mutex_unlock(&cmd_lock);
+		return len;
+	}
+
+	k_mutex_unlock(&cmd_lock);
+
+	if (strcmp(cmd, "AT+NOTIF") == 0) {
+		frame_push("+NOTIF: 1\r\n", false);
+	}
+
+	frame_push(reply, false);
+
+	return len;
+}
+
+static ssize_t mock_recv(int sd, void *buf, size_t max_len, int flags)
+{
+	struct mock_frame *frame;
+	size_t len;
+	bool notif;
+
+	k_sem_take(&frames_ready, K_FOREVER);
+	k_mutex_lock(&frame_lock, K_FOREVER);
+
+	frame = &frames[frame_rd];
+	frame_rd = (frame_rd + 1) % ARRAY_SIZE(frames);
+
+	len = MIN(strlen(frame->data) + 1, max_len);
+	memcpy(buf, frame->data, len);
+	notif = frame->notif;
+
+	k_mutex_unlock(&frame_lock);
+
+	if (notif) {
+		k_sem_give(&notif_space);
+	}
+
+	return len;
+}
+
+static const struct socket_offload mock_socket_ops = {
+	.socket = mock_socket,
+	.close = mock_close,
+	.recv = mock_recv,
+	.send = mock_send,
+};
+
+void at_socket_mock_init(void)
+{
+	socket_offload_register(&mock_socket_ops);
+}
+
+void at_socket_mock_reset(void)
+{
+	k_mutex_lock(&cmd_lock, K_FOREVER);
+
+	memset(sent, 0, sizeof(sent));
+	sent_count = 0;
+	hold = false;
+
+	k_mutex_unlock(&cmd_lock);
+}
+
+void at_socket_mock_hold(void)
+{
+	k_mutex_lock(&cmd_lock, K_FOREVER);
+
+	hold = true;
+	held_reply[0] = '\0';
+
+	k_mutex_unlock(&cmd_lock);
+}
+
+void at_socket_mock_release(void)
+{
+	char reply[MOCK_FRAME_MAX_LEN];
+
+	k_mutex_lock(&cmd_lock, K_FOREVER);
+
+	hold = false;
+	strcpy(reply, held_reply);
+	held_reply[0] = '\0';
+
+	k_mutex_unlock(&cmd_lock);
+
+	if (reply[0] != '\0') {
+		frame_push(reply, false);
+	}
+}
+
+void at_socket_mock_notify(const char *notif)
+{
+	k_sem_take(&notif_space, K_FOREVER);
+	frame_push(notif, true);
+}
+
+size_t at_socket_mock_sent_count(void)
+{
+	return sent_count;
+}
+
+const char *at_socket_mock_sent(size_t index)
+{
+	if (index >= ARRAY_SIZE(sent)) {
+		return "";
+	}
+
+	return sent[index];
+}
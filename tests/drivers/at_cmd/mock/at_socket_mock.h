@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef AT_SOCKET_MOCK_H_
+#define AT_SOCKET_MOCK_H_
+
+#include <zephyr/types.h>
+
+/* Simulated modem behind an offloaded AT socket.
+ *
+ * Commands are answered as they are sent:
+ *   AT+ECHO=<text>  "+ECHO: <text>" and OK
+ *   AT+ERR          ERROR
+ *   AT+CME=<n>      +CME ERROR: <n>
+ *   AT+CMS=<n>      +CMS ERROR: <n>
+ *   AT+NOTIF        a "+NOTIF: 1" notification, then OK
+ *   other           OK
+ */
+
+/* Register the socket operations. Must be called before at_cmd_init(). */
+void at_socket_mock_init(void);
+
+/* Forget the sent commands and stop holding replies. */
+void at_socket_mock_reset(void);
+
+/* Hold back the reply to the command that is sent next. */
+void at_socket_mock_hold(void);
+
+/* Send the reply that is held back, and stop holding replies. */
+void at_socket_mock_release(void);
+
+/* Send @p notif as an unsolicited notification. */
+void at_socket_mock_notify(const char *notif);
+
+/* Get the number of commands sent since the last reset. */
+size_t at_socket_mock_sent_count(void);
+
+/* Get the command sent at position @p index since the last reset, or an
+ * empty string.
+ */
+const char *at_socket_mock_sent(size_t index);
+
+#endif /* AT_SOCKET_MOCK_H_ */
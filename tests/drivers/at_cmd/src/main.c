@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <stdio.h>
+#include <at_cmd.h>
+#include "at_socket_mock.h"
+
+/* Time for the driver threads to process a command or notification. */
+#define WAIT_MS			20
+#define TIMEOUT_MS		50
+
+#define WRITER_COUNT		5
+#define WRITER_STACK_SIZE	1024
+#define WRITER_CMD_COUNT	25
+#define STRESS_NOTIF_COUNT	50
+
+/* A command written from a separate thread, to queue several commands. */
+struct writer {
+	struct k_thread thread;
+	char cmd[32];
+	enum at_cmd_prio prio;
+	char buf[32];
+	int err;
+	struct k_sem done;
+};
+
+static K_THREAD_STACK_ARRAY_DEFINE(writer_stacks, WRITER_COUNT,
+				   WRITER_STACK_SIZE);
+static struct writer writers[WRITER_COUNT];
+
+static K_SEM_DEFINE(notif_sem, 0, STRESS_NOTIF_COUNT);
+static char notif_a[32];
+static int notif_a_count;
+static int notif_b_count;
+static int notif_all_count;
+
+static void test_setup(void)
+{
+	at_socket_mock_reset();
+	k_sem_reset(&notif_sem);
+	notif_a_count = 0;
+	notif_b_count = 0;
+	notif_all_count = 0;
+}
+
+static void writer_fn(void *arg1, void *arg2, void *arg3)
+{
+	struct writer *w = arg1;
+
+	w->err = at_cmd_write_prio(w->cmd, w->buf, sizeof(w->buf), NULL,
+				   w->prio, K_FOREVER);
+	k_sem_give(&w->done);
+}
+
+/* Start writing @p cmd from a separate thread, and wait for it to be queued
+ * or sent.
+ */
+static struct writer *writer_start(size_t index, const char *cmd,
+				   enum at_cmd_prio prio)
+{
+	struct writer *w = &writers[index];
+
+	strcpy(w->cmd, cmd);
+	w->prio = prio;
+	w->buf[0] = '\0';
+	k_sem_init(&w->done, 0, 1);
+
+	k_thread_create(&w->thread, writer_stacks[index],
+			K_THREAD_STACK_SIZEOF(writer_stacks[index]),
+			writer_fn, w, NULL, NULL,
+			K_PRIO_PREEMPT(5), 0, K_NO_WAIT);
+
+	k_sleep(WAIT_MS);
+
+	return w;
+}
+
+static void handler_a(char *notif)
+{
+	strncpy(notif_a, notif, sizeof(notif_a) - 1);
+	notif_a_count++;
+	k_sem_give(&notif_sem);
+}
+
+static void handler_b(char *notif)
+{
+	notif_b_count++;
+	k_sem_give(&notif_sem);
+}
+
+static void handler_all(char *notif)
+{
+	notif_all_count++;
+}
+
+static void test_result_codes(void)
+{
+	char buf[32];
+	enum at_cmd_state state;
+	const char *response;
+
+	zassert_equal(at_cmd_write("AT+ECHO=1,2", buf, sizeof(buf), &state),
+		      0, "Write should succeed");
+	zassert_equal(state, AT_CMD_OK, "State should be OK");
+	zassert_equal(strcmp(buf, "+ECHO: 1,2\r\n"), 0,
+		      "Result code should be removed");
+
+	zassert_equal(at_cmd_write("AT+ERR", buf, sizeof(buf), &state),
+		      -ENOEXEC, "ERROR should be returned");
+	zassert_equal(state, AT_CMD_ERROR, "State should be ERROR");
+
+	zassert_equal(at_cmd_write("AT+CME=513", NULL, 0, &state), 513,
+		      "CME error code should be returned");
+	zassert_equal(state, AT_CMD_ERROR_CME, "State should be CME error");
+
+	zassert_equal(at_cmd_write("AT+CMS=300", NULL, 0, &state), 300,
+		      "CMS error code should be returned");
+	zassert_equal(state, AT_CMD_ERROR_CMS, "State should be CMS error");
+
+	zassert_equal(at_cmd_write("AT+ECHO=too long for the buffer", buf,
+				   8, &state),
+		      -EMSGSIZE, "Response should not fit");
+
+	zassert_equal(at_cmd_write_ref("AT+ECHO=ref", &response, &state), 0,
+		      "Write should succeed");
+	zassert_not_null(response, "Response should be returned");
+	zassert_equal(strcmp(response, "+ECHO: ref\r\n"), 0,
+		      "Response should be returned without result code");
+	at_cmd_response_unref(response);
+
+	zassert_equal(at_cmd_write_prio("AT", NULL, 0, NULL,
+					AT_CMD_PRIO_LOW + 1, K_FOREVER),
+		      -EINVAL, "Invalid priority should be rejected");
+}
+
+static void test_priority_order(void)
+{
+	static const char * const expected[] = {
+		"AT+ECHO=first", "AT+ECHO=high", "AT+ECHO=normal1",
+		"AT+ECHO=normal2", "AT+ECHO=low",
+	};
+
+	at_socket_mock_hold();
+
+	writer_start(0, "AT+ECHO=first", AT_CMD_PRIO_LOW);
+	writer_start(1, "AT+ECHO=low", AT_CMD_PRIO_LOW);
+	writer_start(2, "AT+ECHO=normal1", AT_CMD_PRIO_NORMAL);
+	writer_start(3, "AT+ECHO=high", AT_CMD_PRIO_HIGH);
+	writer_start(4, "AT+ECHO=normal2", AT_CMD_PRIO_NORMAL);
+
+	zassert_equal(at_socket_mock_sent_count(), 1,
+		      "Only one command should be sent at a time");
+
+	at_socket_mock_release();
+
+	for (size_t i = 0; i < WRITER_COUNT; i++) {
+		zassert_equal(k_sem_take(&writers[i].done, K_MSEC(WAIT_MS)),
+			      0, "Command should complete");
+		zassert_equal(writers[i].err, 0, "Write should succeed");
+	}
+
+	zassert_equal(at_socket_mock_sent_count(), ARRAY_SIZE(expected),
+		      "All commands should be sent");
+
+	for (size_t i = 0; i < ARRAY_SIZE(expected); i++) {
+		zassert_equal(strcmp(at_socket_mock_sent(i), expected[i]), 0,
+			      "Commands should be sent in order of priority");
+	}
+
+	zassert_equal(strcmp(writers[3].buf, "+ECHO: high\r\n"), 0,
+		      "Each writer should get its own response");
+}
+
+static void test_timeout_queued(void)
+{
+	struct writer *w;
+
+	at_socket_mock_hold();
+
+	w = writer_start(0, "AT+ECHO=busy", AT_CMD_PRIO_NORMAL);
+
+	zassert_equal(at_cmd_write_prio("AT+ECHO=late", NULL, 0, NULL,
+					AT_CMD_PRIO_HIGH, K_MSEC(TIMEOUT_MS)),
+		      -ETIMEDOUT, "Write should time out");
+
+	at_socket_mock_release();
+
+	zassert_equal(k_sem_take(&w->done, K_MSEC(WAIT_MS)), 0,
+		      "Command should complete");
+	zassert_equal(strcmp(w->buf, "+ECHO: busy\r\n"), 0,
+		      "Writer should get its response");
+
+	k_sleep(WAIT_MS);
+
+	zassert_equal(at_socket_mock_sent_count(), 1,
+		      "Timed out command should not be sent");
+}
+
+static void test_timeout_sent(void)
+{
+	char buf[32];
+
+	at_socket_mock_hold();
+
+	zassert_equal(at_cmd_write_prio("AT+ECHO=slow", buf, sizeof(buf), NULL,
+					AT_CMD_PRIO_NORMAL, K_MSEC(TIMEOUT_MS)),
+		      -ETIMEDOUT, "Write should time out");
+
+	at_socket_mock_release();
+
+	/* The late result of the timed out command must not be taken as the
+	 * result of the next one.
+	 */
+	zassert_equal(at_cmd_write("AT+ECHO=next", buf, sizeof(buf), NULL), 0,
+		      "Write should succeed");
+	zassert_equal(strcmp(buf, "+ECHO: next\r\n"), 0,
+		      "Command should get its own response");
+}
+
+static void test_notif_register(void)
+{
+	zassert_equal(at_cmd_notif_register("+A", NULL), -EINVAL,
+		      "Handler should be required");
+	zassert_equal(at_cmd_notif_register("+A", handler_a), 0,
+		      "Handler should be registered");
+	zassert_equal(at_cmd_notif_register("+A", handler_a), -EALREADY,
+		      "Handler should only be registered once");
+	zassert_equal(at_cmd_notif_register("+B", handler_b), 0,
+		      "Handler should be registered");
+	zassert_equal(at_cmd_notif_register(NULL, handler_all), 0,
+		      "Handler should be registered for all notifications");
+	zassert_equal(at_cmd_notif_register("+C", handler_b), 0,
+		      "Handler should be registered");
+	zassert_equal(at_cmd_notif_register("+D", handler_b), -ENOMEM,
+		      "Registry should be full");
+	zassert_equal(at_cmd_notif_deregister("+C", handler_b), 0,
+		      "Handler should be deregistered");
+	zassert_equal(at_cmd_notif_deregister("+C", handler_b), -ENXIO,
+		      "Handler should not be found");
+}
+
+static void test_notif_routing(void)
+{
+	at_socket_mock_notify("+A: 1\r\n");
+	zassert_equal(k_sem_take(&notif_sem, K_MSEC(WAIT_MS)), 0,
+		      "Notification should be delivered");
+	at_socket_mock_notify("+B: 2\r\n");
+	zassert_equal(k_sem_take(&notif_sem, K_MSEC(WAIT_MS)), 0,
+		      "Notification should be delivered");
+	at_socket_mock_notify("+NONE: 3\r\n");
+	k_sleep(WAIT_MS);
+
+	zassert_equal(notif_a_count, 1, "Handler should get its prefix only");
+	zassert_equal(strcmp(notif_a, "+A: 1\r\n"), 0,
+		      "Notification should be passed unchanged");
+	zassert_equal(notif_b_count, 1, "Handler should get its prefix only");
+	zassert_equal(notif_all_count, 3,
+		      "Handler should get all notifications");
+}
+
+static void test_notif_during_command(void)
+{
+	char buf[32];
+
+	zassert_equal(at_cmd_write("AT+NOTIF", buf, sizeof(buf), NULL), 0,
+		      "Write should succeed");
+	zassert_equal(buf[0], '\0', "Notification should not be a response");
+
+	k_sleep(WAIT_MS);
+
+	zassert_equal(notif_all_count, 1, "Notification should be delivered");
+}
+
+static void stress_writer_fn(void *arg1, void *arg2, void *arg3)
+{
+	struct writer *w = arg1;
+	unsigned int index = POINTER_TO_UINT(arg2);
+	u32_t seed = index + 1;
+	char expected[sizeof(w->buf)];
+
+	w->err = 0;
+
+	for (int i = 0; i < WRITER_CMD_COUNT; i++) {
+		seed = seed * 1103515245 + 12345;
+
+		snprintf(w->cmd, sizeof(w->cmd), "AT+ECHO=%u,%d", index, i);
+		snprintf(expected, sizeof(expected), "+ECHO: %u,%d\r\n",
+			 index, i);
+
+		if (at_cmd_write_prio(w->cmd, w->buf, sizeof(w->buf), NULL,
+				      (seed >> 16) % (AT_CMD_PRIO_LOW + 1),
+				      K_FOREVER) != 0 ||
+		    strcmp(w->buf, expected) != 0) {
+			w->err = -EBADMSG;
+		}
+	}
+
+	k_sem_give(&w->done);
+}
+
+static void test_stress(void)
+{
+	for (size_t i = 0; i < WRITER_COUNT; i++) {
+		k_sem_init(&writers[i].done, 0, 1);
+		k_thread_create(&writers[i].thread, writer_stacks[i],
+				K_THREAD_STACK_SIZEOF(writer_stacks[i]),
+				stress_writer_fn, &writers[i],
+				UINT_TO_POINTER(i), NULL,
+				K_PRIO_PREEMPT(5 + i), 0, K_NO_WAIT);
+	}
+
+	for (int i = 0; i < STRESS_NOTIF_COUNT; i++) {
+		at_socket_mock_notify("+B: 0\r\n");
+	}
+
+	for (size_t i = 0; i < WRITER_COUNT; i++) {
+		zassert_equal(k_sem_take(&writers[i].done, K_SECONDS(5)), 0,
+			      "Writer should complete");
+		zassert_equal(writers[i].err, 0,
+			      "Each command should get its own response");
+	}
+
+	k_sleep(WAIT_MS);
+
+	zassert_equal(at_socket_mock_sent_count(),
+		      WRITER_COUNT * WRITER_CMD_COUNT,
+		      "All commands should be sent");
+	zassert_equal(notif_b_count, STRESS_NOTIF_COUNT,
+		      "All notifications should be delivered");
+	zassert_equal(notif_all_count, STRESS_NOTIF_COUNT,
+		      "All notifications should be delivered");
+}
+
+void test_main(void)
+{
+	at_socket_mock_init();
+	zassert_equal(at_cmd_init(), 0, "AT command driver should init");
+
+	ztest_test_suite(at_cmd_queue,
+		ztest_unit_test_setup_teardown(test_result_codes,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_priority_order,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_timeout_queued,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_timeout_sent,
+					       test_setup, unit_test_noop)
+	);
+
+	ztest_test_suite(at_cmd_notif,
+		ztest_unit_test_setup_teardown(test_notif_register,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_notif_routing,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_notif_during_command,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_stress,
+					       test_setup, unit_test_noop)
+	);
+
+	ztest_run_test_suite(at_cmd_queue);
+	ztest_run_test_suite(at_cmd_notif);
+}
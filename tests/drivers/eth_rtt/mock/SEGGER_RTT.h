@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Simulated RTT channel, implemented by the test. */
+
+#ifndef SEGGER_RTT_MOCK_H__
+#define SEGGER_RTT_MOCK_H__
+
+#define SEGGER_RTT_MAX_NUM_UP_BUFFERS 3
+#define SEGGER_RTT_MODE_BLOCK_IF_FIFO_FULL 2
+
+unsigned SEGGER_RTT_Write(unsigned buffer_index, const void *buffer,
+			  unsigned num_bytes);
+unsigned SEGGER_RTT_Read(unsigned buffer_index, void *buffer,
+			 unsigned buffer_size);
+
+static inline int SEGGER_RTT_ConfigUpBuffer(unsigned buffer_index,
+					    const char *name, void *buffer,
+					    unsigned buffer_size,
+					    unsigned flags)
+{
+	return 0;
+}
+
+static inline int SEGGER_RTT_ConfigDownBuffer(unsigned buffer_index,
+					      const char *name, void *buffer,
+					      unsigned buffer_size,
+					      unsigned flags)
+{
+	return 0;
+}
+
+#endif /* SEGGER_RTT_MOCK_H__ */
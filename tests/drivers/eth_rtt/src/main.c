@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+
+/* Received frames are taken by the test instead of the network stack. */
+#define net_recv_data frame_received
+#include "eth_rtt.c"
+#undef net_recv_data
+
+#define FRAME_MAX	CONFIG_ETH_RTT_MTU
+#define FRAMES_MAX	8
+
+/* Data waiting in the simulated RTT down channel. */
+static u8_t rtt_in[4 * (FRAME_MAX + 2) * 2];
+static size_t rtt_in_len;
+static size_t rtt_in_pos;
+static size_t rtt_read_max;
+
+static u8_t frames[FRAMES_MAX][FRAME_MAX];
+static size_t frame_len[FRAMES_MAX];
+static size_t frame_cnt;
+
+unsigned SEGGER_RTT_Write(unsigned buffer_index, const void *buffer,
+			  unsigned num_bytes)
+{
+	return num_bytes;
+}
+
+unsigned SEGGER_RTT_Read(unsigned buffer_index, void *buffer,
+			 unsigned buffer_size)
+{
+	size_t len = MIN(buffer_size, rtt_in_len - rtt_in_pos);
+
+	len = MIN(len, rtt_read_max);
+	memcpy(buffer, &rtt_in[rtt_in_pos], len);
+	rtt_in_pos += len;
+
+	return len;
+}
+
+int frame_received(struct net_if *iface, struct net_pkt *pkt)
+{
+	size_t len = 0;
+
+	zassert_true(frame_cnt < FRAMES_MAX, "Too many frames");
+
+	for (struct net_buf *frag = pkt->frags; frag; frag = frag->frags) {
+		zassert_true(len + frag->len <= FRAME_MAX, "Frame too long");
+		memcpy(&frames[frame_cnt][len], frag->data, frag->len);
+		len += frag->len;
+	}
+
+	frame_len[frame_cnt++] = len;
+	net_pkt_unref(pkt);
+
+	return 0;
+}
+
+static void put(const u8_t *data, size_t len)
+{
+	zassert_true(rtt_in_len + len <= sizeof(rtt_in), "Input too long");
+	memcpy(&rtt_in[rtt_in_len], data, len);
+	rtt_in_len += len;
+}
+
+static void put_byte(u8_t byte)
+{
+	put(&byte, 1);
+}
+
+/* Puts the SLIP encoded frame and its CRC, without the END bytes. */
+static void put_encoded(const u8_t *data, size_t len)
+{
+	u16_t crc = crc16_ccitt(0xFFFF, data, len);
+	u8_t crc_bytes[] = { crc >> 8, crc & 0xFF };
+
+	for (size_t i = 0; i < len + sizeof(crc_bytes); i++) {
+		u8_t byte = (i < len) ? data[i] : crc_bytes[i - len];
+
+		if (byte == SLIP_END) {
+			put_byte(SLIP_ESC);
+			put_byte(SLIP_ESC_END);
+		} else if (byte == SLIP_ESC) {
+			put_byte(SLIP_ESC);
+			put_byte(SLIP_ESC_ESC);
+		} else {
+			put_byte(byte);
+		}
+	}
+}
+
+static void put_frame(const u8_t *data, size_t len)
+{
+	put_byte(SLIP_END);
+	put_encoded(data, len);
+	put_byte(SLIP_END);
+}
+
+/* Reads all input, at most read_max bytes at a time. */
+static void receive(size_t read_max)
+{
+	rtt_read_max = read_max;
+	rtt_in_pos = 0;
+
+	while (rtt_in_pos < rtt_in_len) {
+		poll_work_handler(NULL);
+	}
+}
+
+static void setup(void)
+{
+	recv_reset(&context_data, false);
+	rtt_in_len = 0;
+	frame_cnt = 0;
+}
+
+static void teardown(void)
+{
+	recv_reset(&context_data, false);
+}
+
+/* Frame with every special byte, also at the start and at the end. */
+static void frame_fill(u8_t *data, size_t len)
+{
+	static const u8_t special[] = {
+		SLIP_END, SLIP_ESC, SLIP_ESC_END, SLIP_ESC_ESC
+	};
+
+	for (size_t i = 0; i < len; i++) {
+		data[i] = (i % 5 == 0) ? special[(i / 5) % 4] : i;
+	}
+	data[len - 1] = SLIP_ESC;
+}
+
+static void test_split_reads(void)
+{
+	static u8_t data[3][FRAME_MAX];
+	static const size_t len[] = { 60, 1, FRAME_MAX };
+
+	for (size_t i = 0; i < ARRAY_SIZE(len); i++) {
+		frame_fill(data[i], len[i]);
+		put_frame(data[i], len[i]);
+	}
+
+	/* Reads split escape sequences and frames at every position. */
+	for (size_t read_max = 1; read_max <= 17; read_max++) {
+		frame_cnt = 0;
+		receive(read_max);
+
+		zassert_equal(frame_cnt, ARRAY_SIZE(len),
+			      "Frames lost, %u bytes per read", read_max);
+		for (size_t i = 0; i < ARRAY_SIZE(len); i++) {
+			zassert_equal(frame_len[i], len[i], NULL);
+			zassert_mem_equal(frames[i], data[i], len[i], NULL);
+		}
+	}
+
+	frame_cnt = 0;
+	receive(RX_BUFFER_SIZE);
+	zassert_equal(frame_cnt, ARRAY_SIZE(len), "Frames lost");
+}
+
+static void test_escape_end(void)
+{
+	static const u8_t data[] = { 0x11, SLIP_END, 0x22, SLIP_ESC, 0x33 };
+	static const u8_t broken[] = { 0x11, 0x22, 0x33 };
+
+	/* END after ESC ends the broken frame. The frame after it is not
+	 * merged into the broken one.
+	 */
+	put_byte(SLIP_END);
+	put(broken, sizeof(broken));
+	put_byte(SLIP_ESC);
+	put_byte(SLIP_END);
+	put_encoded(data, sizeof(data));
+	put_byte(SLIP_END);
+
+	/* Also when ESC ends a read. */
+	put_byte(SLIP_ESC);
+	put_byte(SLIP_END);
+	put_frame(data, sizeof(data));
+
+	for (size_t read_max = 1; read_max <= 8; read_max++) {
+		frame_cnt = 0;
+		receive(read_max);
+
+		zassert_equal(frame_cnt, 2, "Frame lost, %u bytes per read",
+			      read_max);
+		for (size_t i = 0; i < frame_cnt; i++) {
+			zassert_equal(frame_len[i], sizeof(data), NULL);
+			zassert_mem_equal(frames[i], data, sizeof(data), NULL);
+		}
+		zassert_false(context_data.rx_escape, "Escape not reset");
+	}
+}
+
+static void test_escape_other(void)
+{
+	static const u8_t data[] = { 0x44, 0x55, 0x66 };
+	u8_t raw[sizeof(data) + 2];
+	u16_t crc;
+
+	memcpy(raw, data, sizeof(data));
+	crc = crc16_ccitt(0xFFFF, raw, sizeof(data));
+	raw[sizeof(data)] = crc >> 8;
+	raw[sizeof(data) + 1] = crc & 0xFF;
+
+	/* Other bytes after ESC are taken as they are. */
+	put_byte(SLIP_END);
+	put_byte(raw[0]);
+	put_byte(SLIP_ESC);
+	put(&raw[1], sizeof(raw) - 1);
+	put_byte(SLIP_END);
+
+	receive(RX_BUFFER_SIZE);
+	zassert_equal(frame_cnt, 1, "Frame lost");
+	zassert_equal(frame_len[0], sizeof(data), NULL);
+	zassert_mem_equal(frames[0], data, sizeof(data), NULL);
+}
+
+static void test_invalid_frames(void)
+{
+	static u8_t data[FRAME_MAX];
+	static const u8_t small[] = { 0x77 };
+
+	frame_fill(data, sizeof(data));
+
+	/* Frame with an invalid CRC. */
+	put_byte(SLIP_END);
+	put(small, sizeof(small));
+	put_byte(0);
+	put_byte(0);
+	put_byte(SLIP_END);
+
+	/* Frame too long, discarded up to the next END. */
+	put_byte(SLIP_END);
+	for (size_t i = 0; i <= RX_FRAME_MAX_LENGTH; i++) {
+		put_byte(0x88);
+	}
+	put_byte(SLIP_END);
+
+	put_frame(small, sizeof(small));
+
+	receive(RX_BUFFER_SIZE);
+	zassert_equal(frame_cnt, 1, "Invalid frame received");
+	zassert_equal(frame_len[0], sizeof(small), NULL);
+	zassert_equal(frames[0][0], small[0], NULL);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(eth_rtt_test,
+			 ztest_unit_test_setup_teardown(test_split_reads,
+							setup, teardown),
+			 ztest_unit_test_setup_teardown(test_escape_end,
+							setup, teardown),
+			 ztest_unit_test_setup_teardown(test_escape_other,
+							setup, teardown),
+			 ztest_unit_test_setup_teardown(test_invalid_frames,
+							setup, teardown)
+			 );
+
+	ztest_run_test_suite(eth_rtt_test);
+}
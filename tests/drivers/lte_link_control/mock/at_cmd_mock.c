@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <at_cmd.h>
+#include "at_cmd_mock.h"
+
+#define MOCK_CMD_MAX_LEN	64
+#define MOCK_RESPONSE_MAX_LEN	128
+#define MOCK_RESPONSE_COUNT	4
+#define MOCK_NOTIF_HANDLER_COUNT	4
+
+struct mock_response {
+	char cmd[MOCK_CMD_MAX_LEN];
+	char response[MOCK_RESPONSE_MAX_LEN];
+};
+
+static struct mock_response responses[MOCK_RESPONSE_COUNT];
+static char last_cmd[MOCK_CMD_MAX_LEN];
+static size_t cmd_count;
+
+struct mock_notif_handler {
+	const char *prefix;
+	at_cmd_handler_t handler;
+};
+
+static struct mock_notif_handler notif_handlers[MOCK_NOTIF_HANDLER_COUNT];
+static at_cmd_handler_t notification_handler;
+static char notif_buf[MOCK_RESPONSE_MAX_LEN];
+static struct k_work notif_work;
+static K_SEM_DEFINE(notif_done, 0, 1);
+
+static bool prefix_equal(const char *a, const char *b)
+{
+	if ((a == NULL) || (b == NULL)) {
+		return a == b;
+	}
+
+	return strcmp(a, b) == 0;
+}
+
+static void notif_work_fn(struct k_work *work)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(notif_handlers); i++) {
+		const char *prefix = notif_handlers[i].prefix;
+
+		if ((notif_handlers[i].handler != NULL) &&
+		    ((prefix == NULL) ||
+		     (strncmp(notif_buf, prefix, strlen(prefix)) == 0))) {
+			notif_handlers[i].handler(notif_buf);
+		}
+	}
+
+	if (notification_handler != NULL) {
+		notification_handler(notif_buf);
+	}
+
+	k_sem_give(&notif_done);
+}
+
+void at_cmd_mock_response_set(const char *cmd, const char *response)
+{
+	struct mock_response *free_rsp = NULL;
+
+	for (size_t i = 0; i < ARRAY_SIZE(responses); i++) {
+		if (strcmp(responses[i].cmd, cmd) == 0) {
+			free_rsp = &responses[i];
+			break;
+		}
+
+		if ((free_rsp == NULL) && (responses[i].cmd[0] == '\0')) {
+			free_rsp = &responses[i];
+		}
+	}
+
+	__ASSERT_NO_MSG(free_rsp != NULL);
+
+	strncpy(free_rsp->cmd, cmd, sizeof(free_rsp->cmd) - 1);
+	strncpy(free_rsp->response, response, sizeof(free_rsp->response) - 1);
+}
+
+void at_cmd_mock_notify(const char *notif)
+{
+	strncpy(notif_buf, notif, sizeof(notif_buf) - 1);
+
+	k_work_init(&notif_work, notif_work_fn);
+	k_work_submit(&notif_work);
+	k_sem_take(&notif_done, K_FOREVER);
+}
+
+const char *at_cmd_mock_last_cmd(void)
+{
+	return last_cmd;
+}
+
+size_t at_cmd_mock_cmd_count(void)
+{
+	return cmd_count;
+}
+
+void at_cmd_mock_reset(void)
+{
+	memset(responses, 0, sizeof(responses));
+	memset(last_cmd, 0, sizeof(last_cmd));
+	cmd_count = 0;
+}
+
+int at_cmd_write(const char *const cmd, char *buf, size_t buf_len,
+		 enum at_cmd_state *state)
+{
+	strncpy(last_cmd, cmd, sizeof(last_cmd) - 1);
+	last_cmd[sizeof(last_cmd) - 1] = '\0';
+	cmd_count++;
+
+	if (state != NULL) {
+		*state = AT_CMD_OK;
+	}
+
+	if ((buf == NULL) || (buf_len == 0)) {
+		return 0;
+	}
+
+	buf[0] = '\0';
+
+	for (size_t i = 0; i < ARRAY_SIZE(responses); i++) {
+		if ((responses[i].cmd[0] != '\0') &&
+		    (strncmp(cmd, responses[i].cmd,
+			     strlen(responses[i].cmd)) == 0)) {
+			if (strlen(responses[i].response) >= buf_len) {
+				return -EMSGSIZE;
+			}
+
+			strcpy(buf, responses[i].response);
+			break;
+		}
+	}
+
+	return 0;
+}
+
+void at_cmd_set_notification_handler(at_cmd_handler_t handler)
+{
+	notification_handler = handler;
+}
+
+int at_cmd_notif_register(const char *prefix, at_cmd_handler_t handler)
+{
+	struct mock_notif_handler *free_entry = NULL;
+
+	for (size_t i = 0; i < ARRAY_SIZE(notif_handlers); i++) {
+		if (notif_handlers[i].handler == NULL) {
+			if (free_entry == NULL) {
+				free_entry = &notif_handlers[i];
+			}
+		} else if ((notif_handlers[i].handler == handler) &&
+			   prefix_equal(notif_handlers[i].prefix, prefix)) {
+			return -EALREADY;
+		}
+	}
+
+	if (free_entry == NULL) {
+		return -ENOMEM;
+	}
+
+	free_entry->prefix = prefix;
+	free_entry->handler = handler;
+
+	return 0;
+}
+
+int at_cmd_notif_deregister(const char *prefix, at_cmd_handler_t handler)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(notif_handlers); i++) {
+		if ((notif_handlers[i].handler == handler) &&
+		    prefix_equal(notif_handlers[i].prefix, prefix)) {
+			notif_handlers[i].handler = NULL;
+			notif_handlers[i].prefix = NULL;
+			return 0;
+		}
+	}
+
+	return -ENXIO;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef AT_CMD_MOCK_H_
+#define AT_CMD_MOCK_H_
+
+#include <zephyr/types.h>
+
+/* Simulated modem for the AT command driver API.
+ *
+ * Commands are recorded and answered with OK. Read commands get the response
+ * set with at_cmd_mock_response_set() for their prefix.
+ */
+
+/* Set the response to read commands starting with @p cmd. */
+void at_cmd_mock_response_set(const char *cmd, const char *response);
+
+/* Deliver @p notif to the handlers registered for its prefix from the system
+ * work queue, as the AT command driver does, and wait for it to be processed.
+ */
+void at_cmd_mock_notify(const char *notif);
+
+/* Get the last command that was sent, or an empty string. */
+const char *at_cmd_mock_last_cmd(void);
+
+/* Get the number of commands sent since the last reset. */
+size_t at_cmd_mock_cmd_count(void);
+
+void at_cmd_mock_reset(void);
+
+#endif /* AT_CMD_MOCK_H_ */
@@ -0,0 +1,467 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <lte_lc.h>
+#include "at_cmd_mock.h"
+
+/* Time for the system work queue to run submitted work. */
+#define WORK_WAIT_MS		20
+/* Allowed error of the measured RRC connected time. */
+#define TIME_TOLERANCE_MS	20
+
+static struct k_work tx_work[3];
+static int tx_count[ARRAY_SIZE(tx_work)];
+
+static struct lte_lc_cycle_stats cycle_stats;
+static int cycle_count;
+
+/* Link state events since the last setup. */
+static struct lte_lc_evt evts[8];
+static size_t evt_count;
+
+/* Notification feed, with the link state and the events expected after each
+ * notification.
+ */
+static const struct feed_step {
+	const char *notif;
+	enum lte_lc_nw_reg_status nw_reg_status;
+	bool rrc_connected;
+	int tau;
+	int active_time;
+	size_t evt_count;
+	enum lte_lc_evt_type evt_types[2];
+} feed[] = {
+	{ "+CEREG: 2,\"0001\",\"01A2D101\",7\r\n",
+	  LTE_LC_NW_REG_SEARCHING, false, 1800, 60,
+	  1, { LTE_LC_EVT_NW_REG_STATUS } },
+	{ "+CEREG: 1,\"0001\",\"01A2D101\",7,,,"
+	  "\"00100010\",\"00000100\"\r\n",
+	  LTE_LC_NW_REG_REGISTERED_HOME, false, 2400, 120,
+	  2, { LTE_LC_EVT_NW_REG_STATUS, LTE_LC_EVT_PSM_UPDATE } },
+	{ "+CSCON: 1\r\n",
+	  LTE_LC_NW_REG_REGISTERED_HOME, true, 2400, 120,
+	  1, { LTE_LC_EVT_RRC_UPDATE } },
+	/* Repeated notifications are not reported. */
+	{ "+CSCON: 1\r\n",
+	  LTE_LC_NW_REG_REGISTERED_HOME, true, 2400, 120,
+	  0, { 0 } },
+	{ "+CSCON: 0\r\n",
+	  LTE_LC_NW_REG_REGISTERED_HOME, false, 2400, 120,
+	  1, { LTE_LC_EVT_RRC_UPDATE } },
+	{ "+CEREG: 5,\"0002\",\"01A2D102\",7,,,"
+	  "\"00100010\",\"00000100\"\r\n",
+	  LTE_LC_NW_REG_REGISTERED_ROAMING, false, 2400, 120,
+	  1, { LTE_LC_EVT_NW_REG_STATUS } },
+	/* PSM is not granted in the new cell. */
+	{ "+CEREG: 5,\"0002\",\"01A2D103\",7,,,"
+	  "\"11100000\",\"11100000\"\r\n",
+	  LTE_LC_NW_REG_REGISTERED_ROAMING, false, -1, -1,
+	  1, { LTE_LC_EVT_PSM_UPDATE } },
+	/* Malformed notifications are ignored. */
+	{ "+CEREG: \r\n",
+	  LTE_LC_NW_REG_REGISTERED_ROAMING, false, -1, -1,
+	  0, { 0 } },
+	{ "+CEREG: 0\r\n",
+	  LTE_LC_NW_REG_NOT_REGISTERED, false, -1, -1,
+	  1, { LTE_LC_EVT_NW_REG_STATUS } },
+};
+
+static void tx_work_fn(struct k_work *work)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(tx_work); i++) {
+		if (work == &tx_work[i]) {
+			tx_count[i]++;
+		}
+	}
+}
+
+static void cycle_handler(const struct lte_lc_cycle_stats *stats)
+{
+	cycle_stats = *stats;
+	cycle_count++;
+}
+
+static void evt_handler(const struct lte_lc_evt *evt)
+{
+	if (evt_count < ARRAY_SIZE(evts)) {
+		evts[evt_count] = *evt;
+	}
+
+	evt_count++;
+}
+
+static void evt_handler_other(const struct lte_lc_evt *evt)
+{
+}
+
+static void evt_handler_extra(const struct lte_lc_evt *evt)
+{
+}
+
+static void rrc_connect(void)
+{
+	at_cmd_mock_notify("+CSCON: 1\r\n");
+	k_sleep(WORK_WAIT_MS);
+}
+
+static void rrc_release(void)
+{
+	at_cmd_mock_notify("+CSCON: 0\r\n");
+	k_sleep(WORK_WAIT_MS);
+}
+
+static void test_setup(void)
+{
+	at_cmd_mock_reset();
+	at_cmd_mock_response_set("AT+CSCON?", "+CSCON: 1,0\r\n");
+	at_cmd_mock_response_set("AT+CEREG?",
+		"+CEREG: 5,1,\"0001\",\"01A2D101\",7,,,"
+		"\"00100001\",\"00000011\"\r\n");
+
+	for (size_t i = 0; i < ARRAY_SIZE(tx_work); i++) {
+		k_work_init(&tx_work[i], tx_work_fn);
+		tx_count[i] = 0;
+	}
+
+	cycle_count = 0;
+	evt_count = 0;
+}
+
+static void test_rai_req(void)
+{
+	zassert_equal(lte_lc_rai_req(LTE_LC_RAI_NO_RESPONSE), 0, NULL);
+	zassert_true(strcmp(at_cmd_mock_last_cmd(), "AT%XRAI=4") == 0, NULL);
+
+	zassert_equal(lte_lc_rai_req(LTE_LC_RAI_ONE_RESPONSE), 0, NULL);
+	zassert_true(strcmp(at_cmd_mock_last_cmd(), "AT%XRAI=3") == 0, NULL);
+
+	zassert_equal(lte_lc_rai_req(LTE_LC_RAI_DISABLED), 0, NULL);
+	zassert_true(strcmp(at_cmd_mock_last_cmd(), "AT%XRAI=0") == 0, NULL);
+
+	zassert_equal(lte_lc_rai_req(1), -EINVAL, NULL);
+}
+
+static void test_tx_schedule_invalid(void)
+{
+	zassert_equal(lte_lc_tx_schedule(NULL, K_FOREVER), -EINVAL, NULL);
+	zassert_equal(lte_lc_tx_schedule(&tx_work[0], -2), -EINVAL, NULL);
+}
+
+static void test_tx_schedule_wait_for_connection(void)
+{
+	zassert_equal(lte_lc_tx_schedule(&tx_work[0], K_FOREVER), 0, NULL);
+	k_sleep(WORK_WAIT_MS);
+	zassert_equal(tx_count[0], 0, "Sent while in RRC idle");
+
+	rrc_connect();
+	zassert_equal(tx_count[0], 1, "Not sent in RRC connected mode");
+
+	rrc_release();
+}
+
+static void test_tx_schedule_connected(void)
+{
+	rrc_connect();
+
+	zassert_equal(lte_lc_tx_schedule(&tx_work[0], K_FOREVER), 0, NULL);
+	k_sleep(WORK_WAIT_MS);
+	zassert_equal(tx_count[0], 1, "Not sent in RRC connected mode");
+
+	rrc_release();
+
+	zassert_equal(lte_lc_tx_schedule(&tx_work[1], K_NO_WAIT), 0, NULL);
+	k_sleep(WORK_WAIT_MS);
+	zassert_equal(tx_count[1], 1, "Not sent without delay");
+}
+
+static void test_tx_schedule_deadline(void)
+{
+	zassert_equal(lte_lc_tx_schedule(&tx_work[0], 100), 0, NULL);
+	zassert_equal(lte_lc_tx_schedule(&tx_work[1], 50), 0, NULL);
+
+	k_sleep(30);
+	zassert_equal(tx_count[0] + tx_count[1], 0, "Sent before deadline");
+
+	k_sleep(50);
+	zassert_equal(tx_count[1], 1, "Not sent at deadline");
+	zassert_equal(tx_count[0], 0, "Sent before deadline");
+
+	/* The connection for the first transmission carries the other one. */
+	rrc_connect();
+	zassert_equal(tx_count[0], 1, "Not sent in RRC connected mode");
+
+	rrc_release();
+	k_sleep(100);
+	zassert_equal(tx_count[0], 1, "Sent twice");
+}
+
+static void test_tx_schedule_queue_full(void)
+{
+	zassert_equal(lte_lc_tx_schedule(&tx_work[0], K_FOREVER), 0, NULL);
+	zassert_equal(lte_lc_tx_schedule(&tx_work[1], K_FOREVER), 0, NULL);
+	zassert_equal(lte_lc_tx_schedule(&tx_work[2], K_FOREVER), -ENOMEM,
+		      NULL);
+
+	rrc_connect();
+	zassert_equal(tx_count[0], 1, NULL);
+	zassert_equal(tx_count[1], 1, NULL);
+	zassert_equal(tx_count[2], 0, NULL);
+
+	rrc_release();
+}
+
+static void test_cycle(void)
+{
+	struct lte_lc_cycle_stats stats;
+
+	zassert_equal(lte_lc_cycle_start(cycle_handler), 0, NULL);
+
+	rrc_connect();
+	k_sleep(100);
+	rrc_release();
+	rrc_connect();
+	k_sleep(50);
+
+	zassert_equal(lte_lc_cycle_stats_get(&stats), 0, NULL);
+	zassert_equal(stats.rrc_connections, 2, NULL);
+	zassert_true(stats.rrc_connected_time >= 150, NULL);
+
+	zassert_equal(lte_lc_cycle_end(LTE_LC_RAI_NO_RESPONSE), 0, NULL);
+	zassert_true(strcmp(at_cmd_mock_last_cmd(), "AT%XRAI=4") == 0, NULL);
+	zassert_equal(lte_lc_cycle_end(LTE_LC_RAI_NO_RESPONSE), -EALREADY,
+		      NULL);
+	zassert_equal(cycle_count, 0, "Completed before RRC release");
+
+	rrc_release();
+	zassert_equal(cycle_count, 1, "Not completed after RRC release");
+	zassert_equal(cycle_stats.rrc_connections, 2, NULL);
+	zassert_true(cycle_stats.rrc_connected_time >= 150 + WORK_WAIT_MS,
+		     NULL);
+	zassert_true(cycle_stats.rrc_connected_time <=
+		     150 + 3 * WORK_WAIT_MS + TIME_TOLERANCE_MS, NULL);
+	zassert_true(cycle_stats.duration >= cycle_stats.rrc_connected_time,
+		     NULL);
+
+	/* The next cycle must not be released after its first uplink. */
+	zassert_equal(lte_lc_cycle_start(cycle_handler), 0, NULL);
+	zassert_true(strcmp(at_cmd_mock_last_cmd(), "AT%XRAI=0") == 0, NULL);
+
+	zassert_equal(lte_lc_cycle_end(LTE_LC_RAI_DISABLED), 0, NULL);
+	zassert_equal(cycle_count, 1, "Handler called from cycle end");
+	k_sleep(WORK_WAIT_MS);
+	zassert_equal(cycle_count, 2, "Not completed in RRC idle");
+	zassert_equal(cycle_stats.rrc_connections, 0, NULL);
+	zassert_equal(cycle_stats.rrc_connected_time, 0, NULL);
+}
+
+static void test_cycle_end_without_start(void)
+{
+	zassert_equal(lte_lc_cycle_end(LTE_LC_RAI_NO_RESPONSE), -EALREADY,
+		      NULL);
+}
+
+static void test_cycle_started_connected(void)
+{
+	struct lte_lc_cycle_stats stats;
+
+	rrc_connect();
+	k_sleep(100);
+
+	/* Only the part of the connection within the cycle is counted. */
+	zassert_equal(lte_lc_cycle_start(cycle_handler), 0, NULL);
+	k_sleep(50);
+	zassert_equal(lte_lc_cycle_stats_get(&stats), 0, NULL);
+	zassert_equal(stats.rrc_connections, 1, NULL);
+	zassert_true(stats.rrc_connected_time < 100, NULL);
+
+	zassert_equal(lte_lc_cycle_end(LTE_LC_RAI_DISABLED), 0, NULL);
+	rrc_release();
+	zassert_equal(cycle_count, 1, NULL);
+	zassert_true(cycle_stats.rrc_connected_time >= 50, NULL);
+	zassert_true(cycle_stats.rrc_connected_time <
+		     100 + TIME_TOLERANCE_MS, NULL);
+}
+
+static void test_invalid_notification(void)
+{
+	/* Malformed notifications must not change the RRC mode. */
+	at_cmd_mock_notify("+CSCON: \r\n");
+	zassert_equal(lte_lc_tx_schedule(&tx_work[0], K_FOREVER), 0, NULL);
+	k_sleep(WORK_WAIT_MS);
+	zassert_equal(tx_count[0], 0, NULL);
+
+	rrc_connect();
+	zassert_equal(tx_count[0], 1, NULL);
+	rrc_release();
+}
+
+static void test_link_state_initial(void)
+{
+	struct lte_lc_link_state state;
+	enum lte_lc_nw_reg_status status;
+
+	/* Started by the PSM scheduler, read from +CEREG? and +CSCON?. */
+	zassert_equal(lte_lc_link_state_get(&state), 0, NULL);
+	zassert_equal(state.nw_reg_status, LTE_LC_NW_REG_REGISTERED_HOME,
+		      NULL);
+	zassert_false(state.rrc_connected, NULL);
+	zassert_equal(state.tau, 1800, NULL);
+	zassert_equal(state.active_time, 60, NULL);
+
+	/* The cached status is returned without AT commands. */
+	zassert_equal(lte_lc_nw_reg_status_get(&status), 0, NULL);
+	zassert_equal(status, LTE_LC_NW_REG_REGISTERED_HOME, NULL);
+	zassert_equal(at_cmd_mock_cmd_count(), 0, NULL);
+
+	zassert_equal(lte_lc_link_state_get(NULL), -EINVAL, NULL);
+}
+
+static void test_link_state_register_handler(void)
+{
+	zassert_equal(lte_lc_register_handler(NULL), -EINVAL, NULL);
+	zassert_equal(lte_lc_register_handler(evt_handler), 0, NULL);
+	zassert_equal(lte_lc_register_handler(evt_handler), -EALREADY, NULL);
+	zassert_equal(lte_lc_register_handler(evt_handler_other), 0, NULL);
+	zassert_equal(lte_lc_register_handler(evt_handler_extra), -ENOMEM,
+		      NULL);
+
+	zassert_equal(lte_lc_deregister_handler(evt_handler_other), 0, NULL);
+	zassert_equal(lte_lc_deregister_handler(evt_handler_other), -ENXIO,
+		      NULL);
+}
+
+static void test_link_state_feed(void)
+{
+	struct lte_lc_link_state state;
+
+	for (size_t i = 0; i < ARRAY_SIZE(feed); i++) {
+		evt_count = 0;
+		at_cmd_mock_notify(feed[i].notif);
+
+		zassert_equal(lte_lc_link_state_get(&state), 0, NULL);
+		zassert_equal(state.nw_reg_status, feed[i].nw_reg_status,
+			      "Step %d", i);
+		zassert_equal(state.rrc_connected, feed[i].rrc_connected,
+			      "Step %d", i);
+		zassert_equal(state.tau, feed[i].tau, "Step %d", i);
+		zassert_equal(state.active_time, feed[i].active_time,
+			      "Step %d", i);
+
+		zassert_equal(evt_count, feed[i].evt_count, "Step %d", i);
+		for (size_t j = 0; j < feed[i].evt_count; j++) {
+			zassert_equal(evts[j].type, feed[i].evt_types[j],
+				      "Step %d", i);
+		}
+	}
+
+	zassert_equal(at_cmd_mock_cmd_count(), 0, "AT command sent");
+}
+
+static void test_link_state_evt_content(void)
+{
+	at_cmd_mock_notify("+CEREG: 1,\"0001\",\"01A2D101\",7,,,"
+			   "\"00100010\",\"00000100\"\r\n");
+	zassert_equal(evt_count, 2, NULL);
+	zassert_equal(evts[0].nw_reg_status, LTE_LC_NW_REG_REGISTERED_HOME,
+		      NULL);
+	zassert_equal(evts[1].psm_cfg.tau, 2400, NULL);
+	zassert_equal(evts[1].psm_cfg.active_time, 120, NULL);
+
+	at_cmd_mock_notify("+CSCON: 1\r\n");
+	zassert_equal(evt_count, 3, NULL);
+	zassert_true(evts[2].rrc_connected, NULL);
+
+	at_cmd_mock_notify("+CSCON: 0\r\n");
+	zassert_equal(evt_count, 4, NULL);
+	zassert_false(evts[3].rrc_connected, NULL);
+}
+
+static void test_link_state_tau_pre_warning(void)
+{
+	struct lte_lc_link_state state;
+	s64_t now;
+
+	at_cmd_mock_notify("%XT3412: \r\n");
+	zassert_equal(evt_count, 0, "Malformed pre-warning reported");
+
+	now = k_uptime_get();
+	at_cmd_mock_notify("%XT3412: 5000\r\n");
+
+	zassert_equal(evt_count, 1, NULL);
+	zassert_equal(evts[0].type, LTE_LC_EVT_TAU_PRE_WARNING, NULL);
+	zassert_equal(evts[0].time, 5000, NULL);
+
+	zassert_equal(lte_lc_link_state_get(&state), 0, NULL);
+	zassert_true(state.next_tau >= now + 5000, NULL);
+	zassert_true(state.next_tau <= now + 5000 + WORK_WAIT_MS, NULL);
+}
+
+static void test_link_state_deregister_handler(void)
+{
+	zassert_equal(lte_lc_deregister_handler(evt_handler), 0, NULL);
+
+	at_cmd_mock_notify("+CSCON: 1\r\n");
+	at_cmd_mock_notify("+CSCON: 0\r\n");
+	zassert_equal(evt_count, 0, "Deregistered handler called");
+}
+
+static void test_connect_async(void)
+{
+	zassert_equal(lte_lc_connect_async(), 0, NULL);
+	zassert_true(strcmp(at_cmd_mock_last_cmd(), "AT+CFUN=1") == 0, NULL);
+	zassert_equal(at_cmd_mock_cmd_count(), 2, NULL);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(lte_lc_psm_sched,
+		ztest_unit_test_setup_teardown(test_rai_req,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_tx_schedule_invalid,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(
+			test_tx_schedule_wait_for_connection,
+			test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_tx_schedule_connected,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_tx_schedule_deadline,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_tx_schedule_queue_full,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_cycle_end_without_start,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_cycle,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_cycle_started_connected,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_invalid_notification,
+					       test_setup, unit_test_noop)
+	);
+
+	ztest_test_suite(lte_lc_link_state,
+		ztest_unit_test_setup_teardown(test_link_state_initial,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(
+			test_link_state_register_handler,
+			test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_link_state_feed,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_link_state_evt_content,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_link_state_tau_pre_warning,
+					       test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(
+			test_link_state_deregister_handler,
+			test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_connect_async,
+					       test_setup, unit_test_noop)
+	);
+
+	ztest_run_test_suite(lte_lc_psm_sched);
+	ztest_run_test_suite(lte_lc_link_state);
+}
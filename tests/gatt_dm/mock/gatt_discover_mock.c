@@ -10,22 +10,71 @@
 #include <kernel.h>
 #include <ztest.h>
 #include <misc/util.h>
+#include <string.h>
+#include "gatt_discover_mock.h"
 
 
-/* Settings of the discover mock */
-static struct bt_discover_mock {
+/* Maximum number of simulated connections */
+#define DISCOVER_MOCK_CONN_MAX 8
+
+/* Settings of the discover mock, one per connection */
+struct bt_discover_mock {
 	const struct bt_gatt_attr *attr;
 	size_t len;
 	struct bt_conn *conn;
 	struct bt_gatt_discover_params *params;
 	struct k_delayed_work work;
-} discover_mock_data;
+};
+
+static struct bt_discover_mock discover_mock_data[DISCOVER_MOCK_CONN_MAX];
+
+/* Attribute database used for connections without their own one */
+static const struct bt_gatt_attr *discover_mock_attr;
+static size_t discover_mock_len;
+
+
+static struct bt_discover_mock *mock_data_get(struct bt_conn *conn)
+{
+	struct bt_discover_mock *free_data = NULL;
+
+	for (size_t i = 0; i < ARRAY_SIZE(discover_mock_data); i++) {
+		if (discover_mock_data[i].conn == conn) {
+			return &discover_mock_data[i];
+		}
+		if (!free_data && !discover_mock_data[i].conn) {
+			free_data = &discover_mock_data[i];
+		}
+	}
 
+	zassert_not_null(free_data, "Too many simulated connections");
+	free_data->conn = conn;
+	free_data->attr = discover_mock_attr;
+	free_data->len  = discover_mock_len;
+
+	return free_data;
+}
 
 void bt_gatt_discover_mock_setup(const struct bt_gatt_attr *attr, size_t len)
 {
-	discover_mock_data.attr = attr;
-	discover_mock_data.len  = len;
+	for (size_t i = 0; i < ARRAY_SIZE(discover_mock_data); i++) {
+		if (discover_mock_data[i].conn) {
+			k_delayed_work_cancel(&discover_mock_data[i].work);
+		}
+	}
+	memset(discover_mock_data, 0, sizeof(discover_mock_data));
+
+	discover_mock_attr = attr;
+	discover_mock_len  = len;
+}
+
+void bt_gatt_discover_mock_conn_setup(struct bt_conn *conn,
+				      const struct bt_gatt_attr *attr,
+				      size_t len)
+{
+	struct bt_discover_mock *mock_data = mock_data_get(conn);
+
+	mock_data->attr = attr;
+	mock_data->len  = len;
 }
 
 static bool bt_gatt_primary_check(const struct bt_gatt_attr *attr_cur,
@@ -46,7 +95,7 @@ static void bt_gatt_discover_work(struct k_work *work)
 	struct bt_discover_mock *mock_data =
 		CONTAINER_OF(work, struct bt_discover_mock, work);
 	const struct bt_gatt_attr *const attr_end =
-		discover_mock_data.attr + discover_mock_data.len;
+		mock_data->attr + mock_data->len;
 	const struct bt_gatt_attr *attr_cur;
 
 	printk("Running simulated discovery:"
@@ -55,7 +104,7 @@ static void bt_gatt_discover_work(struct k_work *work)
 	       mock_data->params->start_handle,
 	       mock_data->params->end_handle);
 
-	for (attr_cur = discover_mock_data.attr;
+	for (attr_cur = mock_data->attr;
 	     attr_cur < attr_end;
 	     ++attr_cur) {
 		if (attr_cur->handle > mock_data->params->end_handle) {
@@ -119,11 +168,13 @@ static void bt_gatt_discover_work(struct k_work *work)
 int bt_gatt_discover(struct bt_conn *conn,
 		     struct bt_gatt_discover_params *params)
 {
+	struct bt_discover_mock *mock_data = mock_data_get(conn);
+
 	printk("Running %s mock\n", __func__);
-	discover_mock_data.conn = conn;
-	discover_mock_data.params = params;
+	mock_data->params = params;
 
-	k_delayed_work_init(&(discover_mock_data.work), bt_gatt_discover_work);
-	k_delayed_work_submit(&(discover_mock_data.work), K_MSEC(5));
+	k_delayed_work_init(&(mock_data->work), bt_gatt_discover_work);
+	k_delayed_work_submit(&(mock_data->work),
+			      K_MSEC(BT_GATT_DISCOVER_MOCK_DELAY_MS));
 	return 0;
 }
@@ -80,15 +80,37 @@
 		.handle = _handle                    \
 	}
 
+/**
+ * @brief Simulated time of a single discovery request in milliseconds
+ */
+#define BT_GATT_DISCOVER_MOCK_DELAY_MS 5
+
 /**
  * @brief GATT discover mock setup
  *
  * This function setups the mock for @ref bt_gatt_discover function.
+ * The attributes are used for all connections that were not set up with
+ * @ref bt_gatt_discover_mock_conn_setup.
+ * All previously simulated connections are forgotten.
  *
  * @param attr The array of the attribute
  * @param len  The size of the array
  */
 void bt_gatt_discover_mock_setup(const struct bt_gatt_attr *attr, size_t len);
 
+/**
+ * @brief GATT discover mock setup for given connection
+ *
+ * This function sets the attributes discovered on the given connection.
+ * Discoveries on different connections are simulated independently.
+ *
+ * @param conn The connection object
+ * @param attr The array of the attribute
+ * @param len  The size of the array
+ */
+void bt_gatt_discover_mock_conn_setup(struct bt_conn *conn,
+				      const struct bt_gatt_attr *attr,
+				      size_t len);
+
 /** @} */
 #endif /* #define BT_GATT_DISCOVERY_MOCK_H_ */
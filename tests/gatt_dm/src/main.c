@@ -6,6 +6,7 @@
 #include <ztest.h>
 #include <kernel.h>
 #include <stddef.h>
+#include <errno.h>
 #include <misc/util.h>
 #include <bluetooth/uuid.h>
 #include <bluetooth/gatt_dm.h>
@@ -44,6 +45,25 @@ const struct bt_gatt_attr discover_sim[] = {
 	BT_GATT_DISCOVER_MOCK_DESC(16, BT_UUID_DIS_MANUFACTURER_NAME),
 };
 
+/* Attributes of the peers used to test parallel discovery */
+const struct bt_gatt_attr discover_sim_bas[] = {
+	/* BAS */
+	BT_GATT_DISCOVER_MOCK_SERV(1, BT_UUID_BAS, 4),
+	BT_GATT_DISCOVER_MOCK_CHRC(2, BT_UUID_BAS_BATTERY_LEVEL, BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY),
+	BT_GATT_DISCOVER_MOCK_DESC(3, BT_UUID_BAS_BATTERY_LEVEL),
+	BT_GATT_DISCOVER_MOCK_DESC(4, BT_UUID_GATT_CCC),
+};
+
+/* Number of peers discovered in parallel */
+#define PEER_CNT CONFIG_BT_GATT_DM_MAX_INSTANCES
+
+static char dummy_peer_conn[PEER_CNT + 1];
+
+static struct peer_discovery {
+	struct bt_gatt_dm *dm;
+	struct k_sem finished;
+} peers[PEER_CNT];
+
 
 void test_cb_completed(struct bt_gatt_dm *dm, void *context)
 {
@@ -376,6 +396,190 @@ void test_gatt_generic_serv(void)
 	/* No cleanup here - cleanup is done in run_dm_next */
 }
 
+static void peer_cb_completed(struct bt_gatt_dm *dm, void *context)
+{
+	struct peer_discovery *peer = context;
+
+	peer->dm = dm;
+	k_sem_give(&peer->finished);
+}
+
+static void peer_cb_service_not_found(struct bt_conn *conn, void *context)
+{
+	struct peer_discovery *peer = context;
+
+	peer->dm = NULL;
+	k_sem_give(&peer->finished);
+}
+
+static void peer_cb_error_found(struct bt_conn *conn, int err, void *context)
+{
+	zassert_unreachable("Peer discovery error found: %d", err);
+}
+
+static const struct bt_gatt_dm_cb peer_cb = {
+	.completed         = peer_cb_completed,
+	.service_not_found = peer_cb_service_not_found,
+	.error_found       = peer_cb_error_found
+};
+
+static struct bt_conn *peer_conn(size_t id)
+{
+	return (struct bt_conn *)&dummy_peer_conn[id];
+}
+
+/* Peers with even index expose HIDS and DIS, the others BAS */
+static bool peer_has_bas(size_t id)
+{
+	return (id % 2) != 0;
+}
+
+void test_multi_setup(void)
+{
+	test_setup();
+
+	for (size_t i = 0; i < PEER_CNT; i++) {
+		peers[i].dm = NULL;
+		k_sem_init(&peers[i].finished, 0, 1);
+
+		if (peer_has_bas(i)) {
+			bt_gatt_discover_mock_conn_setup(peer_conn(i),
+							 discover_sim_bas,
+							 ARRAY_SIZE(discover_sim_bas));
+		}
+	}
+}
+
+static void peer_start(size_t id)
+{
+	int err = bt_gatt_dm_start(peer_conn(id), NULL, &peer_cb, &peers[id]);
+
+	zassert_false(err, "bt_gatt_dm_start for peer %u failed: %d", id, err);
+}
+
+static void peer_wait(size_t id)
+{
+	int err = k_sem_take(&peers[id].finished,
+			     K_MSEC(SERVICE_DISCOVERY_TIMEOUT));
+
+	zassert_equal(0, err, "No callback called for peer %u: %d", id, err);
+	zassert_not_null(peers[id].dm, "Service not found on peer %u", id);
+}
+
+static void peer_check(size_t id)
+{
+	struct bt_gatt_dm *dm = peers[id].dm;
+	const struct bt_gatt_service_val *serv_val =
+		bt_gatt_dm_attr_service_val(bt_gatt_dm_service_get(dm));
+
+	zassert_equal_ptr(peer_conn(id), bt_gatt_dm_conn_get(dm),
+			  "Invalid connection of peer %u", id);
+
+	if (peer_has_bas(id)) {
+		zassert_true(!bt_uuid_cmp(BT_UUID_BAS, serv_val->uuid),
+			     "Invalid service detected on peer %u", id);
+		zassert_equal(4, bt_gatt_dm_attr_cnt(dm),
+			      "Unexpected number of attributes on peer %u", id);
+		zassert_not_null(bt_gatt_dm_char_by_uuid(dm, BT_UUID_BAS_BATTERY_LEVEL),
+				 "No battery level on peer %u", id);
+		zassert_is_null(bt_gatt_dm_char_by_uuid(dm, BT_UUID_HIDS_REPORT),
+				"HIDS report on peer %u", id);
+	} else {
+		zassert_true(!bt_uuid_cmp(BT_UUID_HIDS, serv_val->uuid),
+			     "Invalid service detected on peer %u", id);
+		zassert_equal(11, bt_gatt_dm_attr_cnt(dm),
+			      "Unexpected number of attributes on peer %u", id);
+		zassert_not_null(bt_gatt_dm_char_by_uuid(dm, BT_UUID_HIDS_REPORT),
+				 "No HIDS report on peer %u", id);
+		zassert_is_null(bt_gatt_dm_char_by_uuid(dm, BT_UUID_BAS_BATTERY_LEVEL),
+				"Battery level on peer %u", id);
+	}
+}
+
+static void peer_release(size_t id)
+{
+	int err = bt_gatt_dm_data_release(peers[id].dm);
+
+	zassert_equal(0, err, "Cannot release data of peer %u: %d", id, err);
+}
+
+/* Discoveries on different connections must not share the data */
+void test_gatt_multi_conn_isolation(void)
+{
+	int err;
+
+	for (size_t i = 0; i < PEER_CNT; i++) {
+		peer_start(i);
+	}
+
+	/* Only one discovery per connection */
+	err = bt_gatt_dm_start(peer_conn(0), NULL, &peer_cb, &peers[0]);
+	zassert_equal(-EALREADY, err, "Second discovery on connection: %d", err);
+
+	/* All instances are in use */
+	err = bt_gatt_dm_start(peer_conn(PEER_CNT), NULL, &peer_cb, NULL);
+	zassert_equal(-ENOMEM, err, "Discovery without instance: %d", err);
+
+	for (size_t i = 0; i < PEER_CNT; i++) {
+		peer_wait(i);
+	}
+
+	for (size_t i = 0; i < PEER_CNT; i++) {
+		for (size_t j = 0; j < i; j++) {
+			zassert_not_equal(peers[i].dm, peers[j].dm,
+					  "Peers %u and %u share instance", i, j);
+		}
+		peer_check(i);
+	}
+
+	/* Releasing one instance does not affect the others */
+	peer_release(0);
+	for (size_t i = 1; i < PEER_CNT; i++) {
+		peer_check(i);
+	}
+
+	for (size_t i = 1; i < PEER_CNT; i++) {
+		peer_release(i);
+	}
+}
+
+/* Compare the time of discovering all peers one by one and in parallel */
+void test_gatt_multi_conn_time(void)
+{
+	s64_t start;
+	s64_t sequential_time;
+	s64_t parallel_time;
+
+	start = k_uptime_get();
+	for (size_t i = 0; i < PEER_CNT; i++) {
+		peer_start(i);
+		peer_wait(i);
+		peer_check(i);
+		peer_release(i);
+	}
+	sequential_time = k_uptime_get() - start;
+
+	start = k_uptime_get();
+	for (size_t i = 0; i < PEER_CNT; i++) {
+		peer_start(i);
+	}
+	for (size_t i = 0; i < PEER_CNT; i++) {
+		peer_wait(i);
+		peer_check(i);
+	}
+	parallel_time = k_uptime_get() - start;
+
+	for (size_t i = 0; i < PEER_CNT; i++) {
+		peer_release(i);
+	}
+
+	printk("Discovery of %u peers: sequential %u ms, parallel %u ms\n",
+	       PEER_CNT, (u32_t)sequential_time, (u32_t)parallel_time);
+
+	zassert_true(parallel_time < sequential_time,
+		     "Parallel discovery is not faster");
+}
+
 void test_main(void)
 {
 	ztest_test_suite(
@@ -387,7 +591,9 @@ void test_main(void)
 		ztest_unit_test_setup_teardown(test_gatt_HIDS_attr_by_handle, test_setup, unit_test_noop),
 		ztest_unit_test_setup_teardown(test_gatt_HIDS_next_chrc_access, test_setup, unit_test_noop),
 		ztest_unit_test_setup_teardown(test_gatt_HIDS_chrc_by_uuid, test_setup, unit_test_noop),
-		ztest_unit_test_setup_teardown(test_gatt_generic_serv, test_setup, unit_test_noop)
+		ztest_unit_test_setup_teardown(test_gatt_generic_serv, test_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_gatt_multi_conn_isolation, test_multi_setup, unit_test_noop),
+		ztest_unit_test_setup_teardown(test_gatt_multi_conn_time, test_multi_setup, unit_test_noop)
 	);
 
 	ztest_run_test_suite(test_gatt);
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <errno.h>
+#include <string.h>
+#include <misc/util.h>
+
+#include <bluetooth/services/nus.h>
+
+#define MTU		23
+#define PAYLOAD		(MTU - 3)
+#define IN_FLIGHT	CONFIG_BT_GATT_NUS_STREAM_IN_FLIGHT
+#define BUF_SIZE	64
+/* Longer than the delay of a retry after -ENOMEM. */
+#define RETRY_WAIT	K_MSEC(50)
+
+BT_GATT_NUS_STREAM_DEFINE(stream, BUF_SIZE);
+
+static u8_t data[100];
+
+/* Connection and GATT functions used by the service. Notifications are
+ * queued until the test completes them.
+ */
+static u8_t conn_obj;
+#define CONN ((struct bt_conn *)&conn_obj)
+
+static const bt_addr_le_t peer;
+static int conn_refs;
+
+static const struct bt_gatt_attr *ccc_attr;
+static struct bt_gatt_notify_params queued[IN_FLIGHT + 1];
+static size_t queued_cnt;
+static u8_t rx[2 * sizeof(data)];
+static size_t rx_len;
+static int notify_err;
+static void (*notify_hook)(void);
+
+struct bt_conn *bt_conn_ref(struct bt_conn *conn)
+{
+	conn_refs++;
+
+	return conn;
+}
+
+void bt_conn_unref(struct bt_conn *conn)
+{
+	conn_refs--;
+}
+
+const bt_addr_le_t *bt_conn_get_dst(const struct bt_conn *conn)
+{
+	return &peer;
+}
+
+u16_t bt_gatt_get_mtu(struct bt_conn *conn)
+{
+	return MTU;
+}
+
+int bt_gatt_notify_cb(struct bt_conn *conn,
+		      struct bt_gatt_notify_params *params)
+{
+	if (notify_hook) {
+		void (*hook)(void) = notify_hook;
+
+		notify_hook = NULL;
+		hook();
+	}
+
+	if (notify_err) {
+		return notify_err;
+	}
+
+	zassert_true(rx_len + params->len <= sizeof(rx), "Too much data");
+	zassert_true(queued_cnt < ARRAY_SIZE(queued), "Too many in flight");
+
+	ccc_attr = params->attr;
+	memcpy(&rx[rx_len], params->data, params->len);
+	rx_len += params->len;
+	queued[queued_cnt++] = *params;
+
+	return 0;
+}
+
+static void complete_all(void)
+{
+	while (queued_cnt > 0) {
+		struct bt_gatt_notify_params params = queued[0];
+
+		queued_cnt--;
+		memmove(&queued[0], &queued[1], queued_cnt * sizeof(queued[0]));
+
+		if (params.func) {
+			params.func(CONN, params.user_data);
+		}
+	}
+}
+
+static void notifications_enable(void)
+{
+	struct bt_gatt_ccc_cfg *cfg;
+
+	/* The CCC attribute is given with every notification. */
+	zassert_equal(bt_gatt_nus_send(NULL, data, 1), 0, NULL);
+	zassert_not_null(ccc_attr, NULL);
+
+	cfg = ccc_attr->user_data;
+	memcpy(&cfg[0].peer, &peer, sizeof(peer));
+	cfg[0].value = BT_GATT_CCC_NOTIFY;
+
+	queued_cnt = 0;
+	rx_len = 0;
+}
+
+static void setup(void)
+{
+	for (size_t i = 0; i < sizeof(data); i++) {
+		data[i] = i * 7 + 1;
+	}
+
+	notify_err = 0;
+	notify_hook = NULL;
+	zassert_equal(bt_gatt_nus_stream_init(&stream, NULL), 0, NULL);
+	notifications_enable();
+	zassert_equal(bt_gatt_nus_stream_start(&stream, CONN), 0, NULL);
+}
+
+static void teardown(void)
+{
+	bt_gatt_nus_stream_stop(&stream);
+	complete_all();
+	zassert_equal(conn_refs, 0, "Connection reference leaked");
+}
+
+static void stream_stop(void)
+{
+	bt_gatt_nus_stream_stop(&stream);
+}
+
+static void test_partial_write(void)
+{
+	struct bt_gatt_nus_stream_stats stats;
+	int ret;
+
+	ret = bt_gatt_nus_stream_write(&stream, data, sizeof(data), K_NO_WAIT);
+	zassert_equal(ret, BUF_SIZE - 1, "Not limited by the buffer");
+	zassert_equal(queued_cnt, IN_FLIGHT, "Pipeline not filled");
+	zassert_equal(rx_len, IN_FLIGHT * PAYLOAD, "Partial notification");
+
+	/* Partially filled notification waits for the ones in flight. */
+	complete_all();
+	zassert_equal(rx_len, ret, "Buffered data not sent");
+
+	zassert_equal(bt_gatt_nus_stream_write(&stream, &data[ret],
+					       sizeof(data) - ret, K_NO_WAIT),
+		      sizeof(data) - ret, "Rest not accepted");
+	complete_all();
+
+	zassert_equal(rx_len, sizeof(data), NULL);
+	zassert_mem_equal(rx, data, sizeof(data), "Invalid data");
+	zassert_equal(bt_gatt_nus_stream_flush(&stream, K_NO_WAIT), 0,
+		      "Not flushed");
+
+	bt_gatt_nus_stream_stats_get(&stream, &stats);
+	zassert_equal(stats.tx_bytes, sizeof(data), NULL);
+	zassert_equal(stats.notifications, 6, NULL);
+	zassert_equal(stats.retries, 0, NULL);
+}
+
+static void test_full_buffer(void)
+{
+	struct bt_gatt_nus_stream_stats stats;
+
+	/* Bluetooth stack is out of buffers. */
+	notify_err = -ENOMEM;
+
+	zassert_equal(bt_gatt_nus_stream_write(&stream, data, sizeof(data),
+					       K_NO_WAIT),
+		      BUF_SIZE - 1, "Not limited by the buffer");
+	zassert_equal(bt_gatt_nus_stream_write(&stream, data, 1, K_NO_WAIT),
+		      0, "Full buffer accepted data");
+	zassert_equal(bt_gatt_nus_stream_flush(&stream, K_NO_WAIT), -EAGAIN,
+		      "Flushed without sending");
+	zassert_equal(rx_len, 0, NULL);
+
+	bt_gatt_nus_stream_stats_get(&stream, &stats);
+	zassert_true(stats.retries > 0, "Retry not counted");
+
+	/* Nothing is in flight, so the retry is delayed. */
+	notify_err = 0;
+	k_sleep(RETRY_WAIT);
+	zassert_equal(queued_cnt, IN_FLIGHT, "Not retried");
+
+	complete_all();
+	zassert_equal(rx_len, BUF_SIZE - 1, NULL);
+	zassert_mem_equal(rx, data, rx_len, "Invalid data");
+}
+
+static void test_stop_pending(void)
+{
+	zassert_equal(bt_gatt_nus_stream_write(&stream, data, sizeof(data),
+					       K_NO_WAIT),
+		      BUF_SIZE - 1, NULL);
+	zassert_equal(queued_cnt, IN_FLIGHT, NULL);
+
+	bt_gatt_nus_stream_stop(&stream);
+	zassert_equal(conn_refs, 0, "Connection not released");
+	zassert_equal(bt_gatt_nus_stream_write(&stream, data, 1, K_NO_WAIT),
+		      -ENOTCONN, "Written to stopped stream");
+	zassert_equal(bt_gatt_nus_stream_flush(&stream, K_NO_WAIT),
+		      -ENOTCONN, "Stopped stream flushed");
+
+	/* Notifications in flight complete after the stop. */
+	complete_all();
+	zassert_equal(rx_len, IN_FLIGHT * PAYLOAD, "Sent after stop");
+
+	/* Pending data is dropped, not sent on the next connection. */
+	zassert_equal(bt_gatt_nus_stream_start(&stream, CONN), 0, NULL);
+	rx_len = 0;
+	zassert_equal(bt_gatt_nus_stream_write(&stream, &data[50], 10,
+					       K_NO_WAIT), 10, NULL);
+	complete_all();
+	zassert_equal(rx_len, 10, "Dropped data sent");
+	zassert_mem_equal(rx, &data[50], 10, "Invalid data");
+}
+
+static void test_stop_while_sending(void)
+{
+	/* Connection is lost while the data is claimed for a notification. */
+	notify_hook = stream_stop;
+	zassert_equal(bt_gatt_nus_stream_write(&stream, data, 30, K_NO_WAIT),
+		      30, NULL);
+	zassert_equal(rx_len, PAYLOAD, NULL);
+	zassert_equal(conn_refs, 0, "Connection not released");
+	complete_all();
+
+	zassert_equal(bt_gatt_nus_stream_start(&stream, CONN), 0, NULL);
+	rx_len = 0;
+	zassert_equal(bt_gatt_nus_stream_write(&stream, &data[50], 5,
+					       K_NO_WAIT), 5, NULL);
+	complete_all();
+	zassert_equal(rx_len, 5, "Dropped data sent");
+	zassert_mem_equal(rx, &data[50], 5, "Invalid data");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(nus_stream_test,
+			 ztest_unit_test_setup_teardown(test_partial_write,
+							setup, teardown),
+			 ztest_unit_test_setup_teardown(test_full_buffer,
+							setup, teardown),
+			 ztest_unit_test_setup_teardown(test_stop_pending,
+							setup, teardown),
+			 ztest_unit_test_setup_teardown(test_stop_while_sending,
+							setup, teardown)
+			 );
+
+	ztest_run_test_suite(nus_stream_test);
+}
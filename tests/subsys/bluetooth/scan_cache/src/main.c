@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <errno.h>
+#include <string.h>
+#include <misc/util.h>
+
+#include "scan_cache.h"
+
+#define CACHE_SIZE 4
+#define WINDOW_MS  1000
+
+static struct scan_cache_entry entries[CACHE_SIZE];
+static struct scan_cache cache = {
+	.entries = entries,
+	.size = ARRAY_SIZE(entries),
+	.window = WINDOW_MS,
+};
+
+static const u8_t adv_data[] = {0x02, 0x01, 0x06, 0x03, 0x03, 0xaa, 0xfe};
+static const u8_t scan_rsp_data[] = {0x05, 0x09, 'T', 'e', 's', 't'};
+
+static void addr_get(bt_addr_le_t *addr, u8_t id)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->type = BT_ADDR_LE_RANDOM;
+	addr->a.val[0] = id;
+	addr->a.val[5] = 0xc0;
+}
+
+static bool report(u8_t id, enum scan_cache_pdu pdu, const u8_t *data,
+		   u16_t len, s8_t rssi, u32_t now)
+{
+	bt_addr_le_t addr;
+
+	addr_get(&addr, id);
+
+	return scan_cache_report(&cache, &addr, pdu,
+				 scan_cache_data_hash(data, len), rssi, now);
+}
+
+static void setup(void)
+{
+	scan_cache_clear(&cache);
+}
+
+static void test_duplicate_dropped(void)
+{
+	zassert_false(report(1, SCAN_CACHE_PDU_ADV, adv_data,
+			     sizeof(adv_data), -40, 0),
+		      "First report dropped");
+	zassert_true(report(1, SCAN_CACHE_PDU_ADV, adv_data,
+			    sizeof(adv_data), -40, 100),
+		     "Repeated report delivered");
+	zassert_true(report(1, SCAN_CACHE_PDU_ADV, adv_data,
+			    sizeof(adv_data), -40, WINDOW_MS - 1),
+		     "Repeated report delivered");
+
+	/* Window is counted from the last delivered report. */
+	zassert_false(report(1, SCAN_CACHE_PDU_ADV, adv_data,
+			     sizeof(adv_data), -40, WINDOW_MS),
+		      "Report after window dropped");
+	zassert_true(report(1, SCAN_CACHE_PDU_ADV, adv_data,
+			    sizeof(adv_data), -40, WINDOW_MS + 1),
+		     "Repeated report delivered");
+
+	zassert_equal(cache.hits, 3, "Invalid number of hits");
+	zassert_equal(cache.misses, 2, "Invalid number of misses");
+}
+
+static void test_changed_data_delivered(void)
+{
+	u8_t data[sizeof(adv_data)];
+
+	memcpy(data, adv_data, sizeof(data));
+
+	zassert_false(report(1, SCAN_CACHE_PDU_ADV, data, sizeof(data),
+			     -40, 0),
+		      "First report dropped");
+
+	data[sizeof(data) - 1]++;
+	zassert_false(report(1, SCAN_CACHE_PDU_ADV, data, sizeof(data),
+			     -40, 10),
+		      "Changed report dropped");
+
+	/* Other device with the same data. */
+	zassert_false(report(2, SCAN_CACHE_PDU_ADV, data, sizeof(data),
+			     -40, 20),
+		      "Report of other device dropped");
+}
+
+static void test_scan_rsp_tracked_separately(void)
+{
+	/* Advertising reports and scan responses alternate when scanning
+	 * actively. Both must be dropped after the first delivery.
+	 */
+	for (u32_t i = 0; i < 4; i++) {
+		bool expected = (i > 0);
+
+		zassert_equal(report(1, SCAN_CACHE_PDU_ADV, adv_data,
+				     sizeof(adv_data), -40, i * 10),
+			      expected, "Invalid advertising report result");
+		zassert_equal(report(1, SCAN_CACHE_PDU_SCAN_RSP, scan_rsp_data,
+				     sizeof(scan_rsp_data), -40, i * 10 + 5),
+			      expected, "Invalid scan response result");
+	}
+}
+
+static void test_lru_eviction(void)
+{
+	/* Fill the cache and keep device 1 recently used. */
+	for (u8_t id = 1; id <= CACHE_SIZE; id++) {
+		report(id, SCAN_CACHE_PDU_ADV, adv_data, sizeof(adv_data),
+		       -40, id);
+	}
+
+	zassert_true(report(1, SCAN_CACHE_PDU_ADV, adv_data,
+			    sizeof(adv_data), -40, 10),
+		     "Cached device not dropped");
+
+	/* New device evicts device 2, the least recently used one. */
+	report(CACHE_SIZE + 1, SCAN_CACHE_PDU_ADV, adv_data,
+	       sizeof(adv_data), -40, 20);
+	zassert_equal(cache.evictions, 1, "Invalid number of evictions");
+
+	zassert_true(report(1, SCAN_CACHE_PDU_ADV, adv_data,
+			    sizeof(adv_data), -40, 30),
+		     "Recently used device evicted");
+	zassert_false(report(2, SCAN_CACHE_PDU_ADV, adv_data,
+			     sizeof(adv_data), -40, 40),
+		      "Least recently used device not evicted");
+}
+
+static void test_rssi_aggregation(void)
+{
+	static const s8_t rssi[] = {-40, -60, -50, -70, -30};
+	struct scan_cache_rssi stats;
+	bt_addr_le_t addr;
+
+	for (size_t i = 0; i < ARRAY_SIZE(rssi); i++) {
+		report(1, SCAN_CACHE_PDU_ADV, adv_data, sizeof(adv_data),
+		       rssi[i], i);
+	}
+
+	addr_get(&addr, 1);
+	zassert_equal(scan_cache_rssi_get(&cache, &addr, &stats), 0,
+		      "Cannot get RSSI");
+	zassert_equal(stats.min, -70, "Invalid minimum RSSI");
+	zassert_equal(stats.max, -30, "Invalid maximum RSSI");
+	zassert_equal(stats.avg, -50, "Invalid mean RSSI");
+	zassert_equal(stats.cnt, ARRAY_SIZE(rssi), "Invalid RSSI count");
+
+	addr_get(&addr, 2);
+	zassert_equal(scan_cache_rssi_get(&cache, &addr, &stats), -ENOENT,
+		      "RSSI of unknown device");
+}
+
+static void test_invalidate(void)
+{
+	struct scan_cache_rssi stats;
+	bt_addr_le_t addr;
+
+	report(1, SCAN_CACHE_PDU_ADV, adv_data, sizeof(adv_data), -40, 0);
+	scan_cache_invalidate(&cache);
+
+	zassert_false(report(1, SCAN_CACHE_PDU_ADV, adv_data,
+			     sizeof(adv_data), -40, 10),
+		      "Report dropped after invalidation");
+
+	addr_get(&addr, 1);
+	zassert_equal(scan_cache_rssi_get(&cache, &addr, &stats), 0,
+		      "Cannot get RSSI");
+	zassert_equal(stats.cnt, 2, "RSSI lost on invalidation");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(scan_cache_tests,
+			 ztest_unit_test_setup_teardown(test_duplicate_dropped,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(
+				test_changed_data_delivered,
+				setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(
+				test_scan_rsp_tracked_separately,
+				setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_lru_eviction,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_rssi_aggregation,
+							setup, unit_test_noop),
+			 ztest_unit_test_setup_teardown(test_invalidate,
+							setup, unit_test_noop)
+			 );
+
+	ztest_run_test_suite(scan_cache_tests);
+}
@@ -0,0 +1,462 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <kernel.h>
+#include <string.h>
+#include <misc/util.h>
+#include <misc/byteorder.h>
+#include <bluetooth/gap.h>
+
+#include "scan_index.h"
+
+#define ADDR_CNT       32
+#define UUID_CNT       16
+#define NAME_CNT       16
+#define NAME_MAX_LEN   16
+
+#define UUID_128_SIZE  16
+#define REPLAY_CNT     200
+
+/* Advertising report captured while scanning. */
+struct adv_report {
+	bt_addr_le_t addr;
+	u8_t data_len;
+	u8_t data[31];
+};
+
+/* Bluetooth Base UUID in the little-endian order. */
+static const u8_t uuid_base[UUID_128_SIZE] = {
+	0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80,
+	0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/* Advertising data captured in an office with several beacons, phones
+ * and nRF peripherals.
+ */
+static const struct adv_report reports[] = {
+	/* iBeacon */
+	{{BT_ADDR_LE_RANDOM, {{0x11, 0x22, 0x33, 0x44, 0x55, 0xc6}}}, 30,
+	 {0x02, 0x01, 0x06, 0x1a, 0xff, 0x4c, 0x00, 0x02, 0x15, 0xe2, 0xc5,
+	  0x6d, 0xb5, 0xdf, 0xfb, 0x48, 0xd2, 0xb0, 0x60, 0xd0, 0xf5, 0xa7,
+	  0x10, 0x96, 0xe0, 0x00, 0x01, 0x00, 0x02, 0xc5}},
+	/* Eddystone URL */
+	{{BT_ADDR_LE_RANDOM, {{0x01, 0xa0, 0x33, 0x44, 0x55, 0xd1}}}, 21,
+	 {0x02, 0x01, 0x06, 0x03, 0x03, 0xaa, 0xfe, 0x0d, 0x16, 0xaa, 0xfe,
+	  0x10, 0xeb, 0x03, 0x6e, 0x6f, 0x72, 0x64, 0x69, 0x63, 0x00}},
+	/* Nordic UART Service peripheral */
+	{{BT_ADDR_LE_PUBLIC, {{0x10, 0x20, 0x30, 0x40, 0x50, 0x60}}}, 31,
+	 {0x02, 0x01, 0x06, 0x11, 0x07, 0x9e, 0xca, 0xdc, 0x24, 0x0e, 0xe5,
+	  0xa9, 0xe0, 0x93, 0xf3, 0xa3, 0xb5, 0x01, 0x00, 0x40, 0x6e, 0x09,
+	  0x09, 'N', 'o', 'r', 'd', 'i', 'c', '_', 'U'}},
+	/* HID mouse */
+	{{BT_ADDR_LE_RANDOM, {{0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff}}}, 26,
+	 {0x02, 0x01, 0x06, 0x03, 0x19, 0xc2, 0x03, 0x05, 0x03, 0x12, 0x18,
+	  0x0f, 0x18, 0x0c, 0x09, 'D', 'e', 's', 'k', 't', 'o', 'p', ' ',
+	  'M', 'o', 'u'}},
+	/* Phone with 128-bit Base UUID form of the Battery Service */
+	{{BT_ADDR_LE_RANDOM, {{0x5a, 0x4b, 0x3c, 0x2d, 0x1e, 0x4f}}}, 27,
+	 {0x02, 0x01, 0x1a, 0x11, 0x06, 0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00,
+	  0x00, 0x80, 0x00, 0x10, 0x00, 0x00, 0x0f, 0x18, 0x00, 0x00, 0x05,
+	  0x08, 'P', 'i', 'x', 'e'}},
+	/* Thingy with 32-bit UUID and shortened name */
+	{{BT_ADDR_LE_RANDOM, {{0x99, 0x88, 0x77, 0x66, 0x55, 0xc4}}}, 17,
+	 {0x02, 0x01, 0x06, 0x05, 0x05, 0x0a, 0x18, 0x00, 0x00, 0x06, 0x08,
+	  'T', 'h', 'i', 'n', 'g', 0x00}},
+};
+
+static bt_addr_le_t addrs[ADDR_CNT];
+static u8_t addr_slots[SCAN_INDEX_SLOTS(ADDR_CNT)];
+static struct scan_addr_set addr_set = {
+	.addrs = addrs,
+	.slots = addr_slots,
+	.size = sizeof(addr_slots),
+};
+
+static u8_t uuids[UUID_CNT][UUID_128_SIZE];
+static u8_t uuid_lens[UUID_CNT];
+static struct scan_uuid_key uuid_keys[UUID_CNT];
+static u8_t uuid_slots[SCAN_INDEX_SLOTS(UUID_CNT)];
+static struct scan_uuid_set uuid_set = {
+	.keys = uuid_keys,
+	.slots = uuid_slots,
+	.size = sizeof(uuid_slots),
+};
+
+static char names[NAME_CNT][NAME_MAX_LEN + 1];
+static struct scan_trie_node name_nodes[
+	SCAN_INDEX_TRIE_NODES(NAME_CNT, NAME_MAX_LEN)];
+static struct scan_trie name_trie = {
+	.nodes = name_nodes,
+	.max_nodes = ARRAY_SIZE(name_nodes),
+};
+
+/* Result of classifying an advertising report. */
+struct classification {
+	int addr;
+	int name;
+	u32_t uuids;
+};
+
+static void uuid_to_128(const u8_t *data, u8_t uuid_len, u8_t *uuid_128)
+{
+	memcpy(uuid_128, uuid_base, UUID_128_SIZE);
+
+	switch (uuid_len) {
+	case sizeof(u16_t):
+		memcpy(&uuid_128[12], data, sizeof(u16_t));
+		break;
+	case sizeof(u32_t):
+		memcpy(&uuid_128[12], data, sizeof(u32_t));
+		break;
+	default:
+		memcpy(uuid_128, data, UUID_128_SIZE);
+		break;
+	}
+}
+
+static u8_t uuid_len_get(u8_t type)
+{
+	switch (type) {
+	case BT_DATA_UUID16_SOME:
+	case BT_DATA_UUID16_ALL:
+		return sizeof(u16_t);
+	case BT_DATA_UUID32_SOME:
+	case BT_DATA_UUID32_ALL:
+		return sizeof(u32_t);
+	case BT_DATA_UUID128_SOME:
+	case BT_DATA_UUID128_ALL:
+		return UUID_128_SIZE;
+	default:
+		return 0;
+	}
+}
+
+/* Reference classification, iterating over all filters. */
+static void classify_linear(const struct adv_report *report,
+			    struct classification *result)
+{
+	result->addr = -1;
+	result->name = -1;
+	result->uuids = 0;
+
+	for (size_t i = 0; i < ADDR_CNT; i++) {
+		if (!bt_addr_le_cmp(&addrs[i], &report->addr)) {
+			result->addr = i;
+			break;
+		}
+	}
+
+	for (size_t pos = 0; pos + 1 < report->data_len;) {
+		u8_t len = report->data[pos];
+		u8_t type = report->data[pos + 1];
+		const u8_t *data = &report->data[pos + 2];
+		u8_t data_len = len - 1;
+		u8_t uuid_len = uuid_len_get(type);
+
+		if ((len == 0) || (pos + 1 + len > report->data_len)) {
+			break;
+		}
+
+		if ((type == BT_DATA_NAME_COMPLETE) && (result->name < 0)) {
+			for (size_t i = 0; i < NAME_CNT; i++) {
+				if (!strncmp(names[i], (const char *)data,
+					     data_len)) {
+					result->name = i;
+					break;
+				}
+			}
+		}
+
+		for (size_t i = 0; uuid_len && (i < UUID_CNT); i++) {
+			u8_t target[UUID_128_SIZE];
+
+			uuid_to_128(uuids[i], uuid_lens[i], target);
+
+			for (size_t j = 0; j + uuid_len <= data_len;
+			     j += uuid_len) {
+				u8_t advertised[UUID_128_SIZE];
+
+				uuid_to_128(&data[j], uuid_len, advertised);
+				if (!memcmp(target, advertised,
+					    UUID_128_SIZE)) {
+					result->uuids |= BIT(i);
+				}
+			}
+		}
+
+		pos += len + 1;
+	}
+}
+
+/* Classification using the filter index. */
+static void classify_indexed(const struct adv_report *report,
+			     struct classification *result)
+{
+	result->addr = scan_addr_set_find(&addr_set, &report->addr);
+	result->name = -1;
+	result->uuids = 0;
+
+	if (result->addr < 0) {
+		result->addr = -1;
+	}
+
+	for (size_t pos = 0; pos + 1 < report->data_len;) {
+		u8_t len = report->data[pos];
+		u8_t type = report->data[pos + 1];
+		const u8_t *data = &report->data[pos + 2];
+		u8_t data_len = len - 1;
+		u8_t uuid_len = uuid_len_get(type);
+
+		if ((len == 0) || (pos + 1 + len > report->data_len)) {
+			break;
+		}
+
+		if ((type == BT_DATA_NAME_COMPLETE) && (result->name < 0)) {
+			u32_t match = scan_trie_match(&name_trie, data,
+						      data_len);
+
+			if (match) {
+				result->name = __builtin_ctz(match);
+			}
+		}
+
+		for (size_t j = 0; uuid_len && (j + uuid_len <= data_len);
+		     j += uuid_len) {
+			int idx = scan_uuid_set_find(&uuid_set, &data[j],
+						     uuid_len);
+
+			if (idx >= 0) {
+				result->uuids |= BIT(idx);
+			}
+		}
+
+		pos += len + 1;
+	}
+}
+
+static void add_uuid(size_t idx, const struct bt_uuid *uuid,
+		     const u8_t *data, u8_t uuid_len)
+{
+	memcpy(uuids[idx], data, uuid_len);
+	uuid_lens[idx] = uuid_len;
+	zassert_equal(scan_uuid_set_add(&uuid_set, uuid, idx), 0,
+		      "Cannot add UUID");
+}
+
+static void setup_filters(void)
+{
+	static const char * const target_names[] = {
+		"Nordic_UART", "Desktop Mouse", "Desktop Keyboard", "Pixel",
+		"Thingy", "Nordic_Blinky", "Nordic_HRM", "Gateway",
+	};
+
+	scan_addr_set_reset(&addr_set);
+	scan_uuid_set_reset(&uuid_set);
+	scan_trie_reset(&name_trie);
+
+	/* Filters that do not match the captured data come first, so that
+	 * linear search has to go through them.
+	 */
+	for (size_t i = 0; i < ADDR_CNT; i++) {
+		addrs[i].type = BT_ADDR_LE_RANDOM;
+		memset(addrs[i].a.val, i, sizeof(addrs[i].a.val));
+	}
+	addrs[ADDR_CNT - 1] = reports[3].addr;
+	addrs[ADDR_CNT - 2] = reports[2].addr;
+
+	for (size_t i = 0; i < ADDR_CNT; i++) {
+		zassert_equal(scan_addr_set_add(&addr_set, i), 0,
+			      "Cannot add address");
+	}
+
+	for (size_t i = 0; i < UUID_CNT - 4; i++) {
+		struct bt_uuid_16 uuid = {
+			.uuid.type = BT_UUID_TYPE_16,
+			.val = 0x2a00 + i,
+		};
+		u8_t data[sizeof(u16_t)];
+
+		sys_put_le16(uuid.val, data);
+		add_uuid(i, &uuid.uuid, data, sizeof(data));
+	}
+
+	/* Eddystone, HID and Battery Service as 16-bit UUIDs. */
+	static struct bt_uuid_16 eddystone = {
+		.uuid.type = BT_UUID_TYPE_16,
+		.val = 0xfeaa,
+	};
+	static struct bt_uuid_16 hids = {
+		.uuid.type = BT_UUID_TYPE_16,
+		.val = 0x1812,
+	};
+	static struct bt_uuid_16 bas = {
+		.uuid.type = BT_UUID_TYPE_16,
+		.val = 0x180f,
+	};
+	/* Nordic UART Service as 128-bit UUID. */
+	static struct bt_uuid_128 nus = {
+		.uuid.type = BT_UUID_TYPE_128,
+		.val = {0x9e, 0xca, 0xdc, 0x24, 0x0e, 0xe5, 0xa9, 0xe0,
+			0x93, 0xf3, 0xa3, 0xb5, 0x01, 0x00, 0x40, 0x6e},
+	};
+	u8_t data[sizeof(u16_t)];
+
+	sys_put_le16(eddystone.val, data);
+	add_uuid(UUID_CNT - 4, &eddystone.uuid, data, sizeof(data));
+	sys_put_le16(hids.val, data);
+	add_uuid(UUID_CNT - 3, &hids.uuid, data, sizeof(data));
+	sys_put_le16(bas.val, data);
+	add_uuid(UUID_CNT - 2, &bas.uuid, data, sizeof(data));
+	add_uuid(UUID_CNT - 1, &nus.uuid, nus.val, sizeof(nus.val));
+
+	for (size_t i = 0; i < NAME_CNT; i++) {
+		if (i < NAME_CNT - ARRAY_SIZE(target_names)) {
+			snprintk(names[i], sizeof(names[i]), "Unused_%u",
+				 (unsigned int)i);
+		} else {
+			strcpy(names[i],
+			       target_names[i - (NAME_CNT -
+						 ARRAY_SIZE(target_names))]);
+		}
+
+		zassert_equal(scan_trie_add(&name_trie, names[i], i), 0,
+			      "Cannot add name");
+	}
+}
+
+static void test_addr_set(void)
+{
+	bt_addr_le_t unknown = {
+		.type = BT_ADDR_LE_PUBLIC,
+		.a.val = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06},
+	};
+
+	setup_filters();
+
+	for (size_t i = 0; i < ADDR_CNT; i++) {
+		zassert_equal(scan_addr_set_find(&addr_set, &addrs[i]), i,
+			      "Address not found");
+	}
+
+	zassert_equal(scan_addr_set_find(&addr_set, &unknown), -ENOENT,
+		      "Unknown address found");
+
+	/* The same address of another type does not match. */
+	unknown = addrs[0];
+	unknown.type = BT_ADDR_LE_PUBLIC;
+	zassert_equal(scan_addr_set_find(&addr_set, &unknown), -ENOENT,
+		      "Address of different type found");
+}
+
+static void test_uuid_set(void)
+{
+	u8_t hids_16[] = {0x12, 0x18};
+	u8_t hids_32[] = {0x12, 0x18, 0x00, 0x00};
+	u8_t hids_128[UUID_128_SIZE];
+	u8_t unknown[] = {0x34, 0x12};
+
+	setup_filters();
+	uuid_to_128(hids_16, sizeof(hids_16), hids_128);
+
+	/* 16-bit filter matches all representations, as bt_uuid_cmp. */
+	zassert_equal(scan_uuid_set_find(&uuid_set, hids_16, sizeof(hids_16)),
+		      UUID_CNT - 3, "16-bit UUID not found");
+	zassert_equal(scan_uuid_set_find(&uuid_set, hids_32, sizeof(hids_32)),
+		      UUID_CNT - 3, "32-bit UUID not found");
+	zassert_equal(scan_uuid_set_find(&uuid_set, hids_128,
+					 sizeof(hids_128)),
+		      UUID_CNT - 3, "128-bit UUID not found");
+	zassert_equal(scan_uuid_set_find(&uuid_set, unknown, sizeof(unknown)),
+		      -ENOENT, "Unknown UUID found");
+}
+
+static void test_name_trie(void)
+{
+	static const char * const advertised[] = {
+		"Nordic", "Nordic_UART", "Nordic_UART_Service", "Desktop ",
+		"Desktop Mouse", "", "Pix", "Thingy", "Gate", "Unused_1",
+		"Unused_10", "Unused_1x",
+	};
+
+	setup_filters();
+
+	for (size_t i = 0; i < ARRAY_SIZE(advertised); i++) {
+		u8_t len = strlen(advertised[i]);
+		u32_t expected = 0;
+
+		for (size_t j = 0; j < NAME_CNT; j++) {
+			if (!strncmp(names[j], advertised[i], len)) {
+				expected |= BIT(j);
+			}
+		}
+
+		zassert_equal(scan_trie_match(&name_trie,
+					      (const u8_t *)advertised[i], len),
+			      expected, "Invalid match for %s",
+			      advertised[i]);
+	}
+
+	/* Name followed by the terminating character. */
+	zassert_equal(scan_trie_match(&name_trie, (const u8_t *)"Pixel",
+				      sizeof("Pixel")),
+		      BIT(NAME_CNT - 5), "Invalid match for terminated name");
+}
+
+static void test_replay(void)
+{
+	struct classification linear;
+	struct classification indexed;
+	u32_t linear_cycles = 0;
+	u32_t indexed_cycles = 0;
+
+	setup_filters();
+
+	for (size_t i = 0; i < ARRAY_SIZE(reports); i++) {
+		classify_linear(&reports[i], &linear);
+		classify_indexed(&reports[i], &indexed);
+
+		zassert_equal(linear.addr, indexed.addr,
+			      "Address mismatch in report %u", i);
+		zassert_equal(linear.name, indexed.name,
+			      "Name mismatch in report %u", i);
+		zassert_equal(linear.uuids, indexed.uuids,
+			      "UUID mismatch in report %u", i);
+	}
+
+	for (size_t n = 0; n < REPLAY_CNT; n++) {
+		u32_t start = k_cycle_get_32();
+
+		for (size_t i = 0; i < ARRAY_SIZE(reports); i++) {
+			classify_linear(&reports[i], &linear);
+		}
+
+		u32_t mid = k_cycle_get_32();
+
+		for (size_t i = 0; i < ARRAY_SIZE(reports); i++) {
+			classify_indexed(&reports[i], &indexed);
+		}
+
+		linear_cycles += mid - start;
+		indexed_cycles += k_cycle_get_32() - mid;
+	}
+
+	printk("Replayed %u reports: linear %u cycles, indexed %u cycles\n",
+	       (u32_t)(REPLAY_CNT * ARRAY_SIZE(reports)), linear_cycles,
+	       indexed_cycles);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(scan_index_tests,
+			 ztest_unit_test(test_addr_set),
+			 ztest_unit_test(test_uuid_set),
+			 ztest_unit_test(test_name_trie),
+			 ztest_unit_test(test_replay)
+			 );
+
+	ztest_run_test_suite(scan_index_tests);
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Register model of the nRF52 peripherals used by the ESB driver.
+ *
+ * Registers are plain memory. Tasks have no effect and events are raised
+ * by the test, which then calls the interrupt handler of the driver.
+ */
+
+#ifndef NRF_MODEL_H__
+#define NRF_MODEL_H__
+
+#include <zephyr/types.h>
+
+typedef struct {
+	volatile u32_t TASKS_TXEN;
+	volatile u32_t TASKS_RXEN;
+	volatile u32_t TASKS_START;
+	volatile u32_t TASKS_DISABLE;
+	volatile u32_t EVENTS_READY;
+	volatile u32_t EVENTS_ADDRESS;
+	volatile u32_t EVENTS_PAYLOAD;
+	volatile u32_t EVENTS_END;
+	volatile u32_t EVENTS_DISABLED;
+	volatile u32_t EVENTS_BCMATCH;
+	volatile u32_t SHORTS;
+	volatile u32_t INTENSET;
+	volatile u32_t INTENCLR;
+	volatile u32_t CRCSTATUS;
+	volatile u32_t RXMATCH;
+	volatile u32_t RXCRC;
+	volatile u32_t PACKETPTR;
+	volatile u32_t FREQUENCY;
+	volatile u32_t TXPOWER;
+	volatile u32_t MODE;
+	volatile u32_t PCNF0;
+	volatile u32_t PCNF1;
+	volatile u32_t BASE0;
+	volatile u32_t BASE1;
+	volatile u32_t PREFIX0;
+	volatile u32_t PREFIX1;
+	volatile u32_t TXADDRESS;
+	volatile u32_t RXADDRESSES;
+	volatile u32_t CRCCNF;
+	volatile u32_t CRCPOLY;
+	volatile u32_t CRCINIT;
+	volatile u32_t RSSISAMPLE;
+	volatile u32_t BCC;
+	volatile u32_t MODECNF0;
+} NRF_RADIO_Type;
+
+typedef struct {
+	volatile u32_t TASKS_START;
+	volatile u32_t TASKS_CLEAR;
+	volatile u32_t TASKS_SHUTDOWN;
+	volatile u32_t EVENTS_COMPARE[6];
+	volatile u32_t SHORTS;
+	volatile u32_t INTENSET;
+	volatile u32_t MODE;
+	volatile u32_t BITMODE;
+	volatile u32_t PRESCALER;
+	volatile u32_t CC[6];
+} NRF_TIMER_Type;
+
+typedef struct {
+	volatile u32_t CHENSET;
+	volatile u32_t CHENCLR;
+	struct {
+		volatile u32_t EEP;
+		volatile u32_t TEP;
+	} CH[20];
+} NRF_PPI_Type;
+
+typedef struct {
+	struct {
+		volatile u32_t VARIANT;
+	} INFO;
+} NRF_FICR_Type;
+
+extern NRF_RADIO_Type radio_model;
+extern NRF_TIMER_Type timer_model[5];
+extern NRF_PPI_Type ppi_model;
+extern NRF_FICR_Type ficr_model;
+extern u32_t nvic_pending;
+
+#define NRF_RADIO (&radio_model)
+#define NRF_TIMER0 (&timer_model[0])
+#define NRF_TIMER1 (&timer_model[1])
+#define NRF_TIMER2 (&timer_model[2])
+#define NRF_TIMER3 (&timer_model[3])
+#define NRF_TIMER4 (&timer_model[4])
+#define NRF_PPI (&ppi_model)
+#define NRF_FICR (&ficr_model)
+
+typedef enum {
+	RADIO_IRQn = 1,
+	TIMER0_IRQn = 8,
+	TIMER1_IRQn = 9,
+	TIMER2_IRQn = 10,
+	SWI0_IRQn = 20,
+	TIMER3_IRQn = 26,
+	TIMER4_IRQn = 27,
+} IRQn_Type;
+
+#define __CORTEX_M 0
+#define __ALIGN(x) __aligned(x)
+
+static inline void __DMB(void)
+{
+	__sync_synchronize();
+}
+
+static inline u32_t __REV(u32_t value)
+{
+	return __builtin_bswap32(value);
+}
+
+static inline void NVIC_SetPendingIRQ(IRQn_Type irq)
+{
+	nvic_pending |= BIT(irq);
+}
+
+static inline void NVIC_ClearPendingIRQ(IRQn_Type irq)
+{
+	nvic_pending &= ~BIT(irq);
+}
+
+#define RADIO_SHORTS_READY_START_Pos 0
+#define RADIO_SHORTS_READY_START_Msk (1UL << RADIO_SHORTS_READY_START_Pos)
+#define RADIO_SHORTS_READY_START_Enabled 1
+#define RADIO_SHORTS_END_DISABLE_Pos 1
+#define RADIO_SHORTS_END_DISABLE_Msk (1UL << RADIO_SHORTS_END_DISABLE_Pos)
+#define RADIO_SHORTS_END_DISABLE_Enabled 1
+#define RADIO_SHORTS_DISABLED_TXEN_Msk (1UL << 2)
+#define RADIO_SHORTS_DISABLED_RXEN_Msk (1UL << 3)
+#define RADIO_SHORTS_ADDRESS_RSSISTART_Msk (1UL << 4)
+#define RADIO_SHORTS_ADDRESS_BCSTART_Msk (1UL << 6)
+#define RADIO_SHORTS_DISABLED_RSSISTOP_Msk (1UL << 8)
+
+#define RADIO_INTENSET_READY_Msk (1UL << 0)
+#define RADIO_INTENSET_END_Msk (1UL << 3)
+#define RADIO_INTENSET_DISABLED_Msk (1UL << 4)
+
+#define RADIO_MODE_MODE_Pos 0
+#define RADIO_MODE_MODE_Nrf_1Mbit 0
+#define RADIO_MODE_MODE_Nrf_2Mbit 1
+#define RADIO_MODE_MODE_Nrf_250Kbit 2
+#define RADIO_MODE_MODE_Ble_1Mbit 3
+
+#define RADIO_MODECNF0_RU_Pos 0
+#define RADIO_MODECNF0_RU_Msk (1UL << RADIO_MODECNF0_RU_Pos)
+#define RADIO_MODECNF0_RU_Default 0
+#define RADIO_MODECNF0_RU_Fast 1
+
+#define RADIO_TXPOWER_TXPOWER_Pos 0
+#define RADIO_TXPOWER_TXPOWER_Pos4dBm 0x04
+#define RADIO_TXPOWER_TXPOWER_Pos3dBm 0x03
+#define RADIO_TXPOWER_TXPOWER_0dBm 0x00
+#define RADIO_TXPOWER_TXPOWER_Neg4dBm 0xFC
+#define RADIO_TXPOWER_TXPOWER_Neg8dBm 0xF8
+#define RADIO_TXPOWER_TXPOWER_Neg12dBm 0xF4
+#define RADIO_TXPOWER_TXPOWER_Neg16dBm 0xF0
+#define RADIO_TXPOWER_TXPOWER_Neg20dBm 0xEC
+#define RADIO_TXPOWER_TXPOWER_Neg30dBm 0xD8
+#define RADIO_TXPOWER_TXPOWER_Neg40dBm 0xD8
+
+#define RADIO_CRCCNF_LEN_Pos 0
+#define RADIO_CRCCNF_LEN_Disabled 0
+#define RADIO_CRCCNF_LEN_One 1
+#define RADIO_CRCCNF_LEN_Two 2
+
+#define RADIO_PCNF0_LFLEN_Pos 0
+#define RADIO_PCNF0_S0LEN_Pos 8
+#define RADIO_PCNF0_S1LEN_Pos 16
+#define RADIO_PCNF1_MAXLEN_Pos 0
+#define RADIO_PCNF1_STATLEN_Pos 8
+#define RADIO_PCNF1_BALEN_Pos 16
+#define RADIO_PCNF1_ENDIAN_Pos 24
+#define RADIO_PCNF1_ENDIAN_Big 1
+#define RADIO_PCNF1_WHITEEN_Pos 25
+#define RADIO_PCNF1_WHITEEN_Disabled 0
+
+#define TIMER_BITMODE_BITMODE_Pos 0
+#define TIMER_BITMODE_BITMODE_16Bit 0
+#define TIMER_BITMODE_BITMODE_32Bit 3
+#define TIMER_MODE_MODE_Pos 0
+#define TIMER_MODE_MODE_Timer 0
+#define TIMER_SHORTS_COMPARE0_CLEAR_Msk (1UL << 0)
+#define TIMER_SHORTS_COMPARE1_CLEAR_Msk (1UL << 1)
+#define TIMER_SHORTS_COMPARE0_STOP_Msk (1UL << 8)
+#define TIMER_SHORTS_COMPARE1_STOP_Msk (1UL << 9)
+#define TIMER_INTENSET_COMPARE0_Msk (1UL << 16)
+
+#endif /* NRF_MODEL_H__ */
@@ -0,0 +1,517 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+
+/* Built in to reach the interrupt handlers and the FIFO state. */
+#include "nrf_esb.c"
+
+NRF_RADIO_Type radio_model;
+NRF_TIMER_Type timer_model[5];
+NRF_PPI_Type ppi_model;
+NRF_FICR_Type ficr_model;
+u32_t nvic_pending;
+
+#define TX_FIFO_SIZE	CONFIG_NRF_ESB_TX_FIFO_SIZE
+#define RX_FIFO_SIZE	CONFIG_NRF_ESB_RX_FIFO_SIZE
+
+static u32_t tx_success_cnt;
+static u32_t tx_failed_cnt;
+static u32_t rx_received_cnt;
+static u16_t rx_crc;
+
+static void evt_handler(const struct nrf_esb_evt *event)
+{
+	switch (event->evt_id) {
+	case NRF_ESB_EVENT_TX_SUCCESS:
+		tx_success_cnt++;
+		break;
+	case NRF_ESB_EVENT_TX_FAILED:
+		tx_failed_cnt++;
+		break;
+	case NRF_ESB_EVENT_RX_RECEIVED:
+		rx_received_cnt++;
+		break;
+	}
+}
+
+static void esb_config_init(struct nrf_esb_config *config,
+			    enum nrf_esb_mode mode,
+			    enum nrf_esb_tx_mode tx_mode)
+{
+	*config = (struct nrf_esb_config)NRF_ESB_DEFAULT_CONFIG;
+	config->mode = mode;
+	config->tx_mode = tx_mode;
+	config->event_handler = evt_handler;
+}
+
+static void esb_init(enum nrf_esb_mode mode, enum nrf_esb_tx_mode tx_mode)
+{
+	struct nrf_esb_config config;
+
+	esb_config_init(&config, mode, tx_mode);
+	zassert_equal(nrf_esb_init(&config), 0, NULL);
+}
+
+static void setup(void)
+{
+	memset(&radio_model, 0, sizeof(radio_model));
+	memset(timer_model, 0, sizeof(timer_model));
+	memset(&ppi_model, 0, sizeof(ppi_model));
+	nvic_pending = 0;
+
+	tx_success_cnt = 0;
+	tx_failed_cnt = 0;
+	rx_received_cnt = 0;
+	rx_crc = 0x1000;
+}
+
+static void teardown(void)
+{
+	nrf_esb_disable();
+}
+
+/* Radio has finished the current packet. */
+static void radio_disabled(void)
+{
+	NRF_RADIO->EVENTS_DISABLED = 1;
+	RADIO_IRQHandler();
+}
+
+/* Deliver the events raised by the radio interrupt. */
+static void events_process(void)
+{
+	if (nvic_pending & BIT(ESB_EVT_IRQ)) {
+		NVIC_ClearPendingIRQ(ESB_EVT_IRQ);
+		ESB_EVT_IRQHandler();
+	}
+}
+
+/* PRX receives a packet that requests an ACK and sends the ACK, which is
+ * copied to ack when given. A new CRC is used unless the packet is
+ * retransmitted.
+ */
+static void prx_receive(u8_t pipe, u8_t pid, const u8_t *data, u8_t length,
+			bool retransmit, u8_t *ack)
+{
+	zassert_equal(esb_state, ESB_STATE_PRX, "Not receiving");
+
+	if (!retransmit) {
+		rx_crc++;
+	}
+
+	rx_payload_buffer[0] = length;
+	rx_payload_buffer[1] = (pid << 1) | 0x01;
+	memcpy(&rx_payload_buffer[2], data, length);
+
+	NRF_RADIO->RXMATCH = pipe;
+	NRF_RADIO->RXCRC = rx_crc;
+	NRF_RADIO->CRCSTATUS = 1;
+	radio_disabled();
+
+	zassert_equal(esb_state, ESB_STATE_PRX_SEND_ACK, "ACK not sent");
+	if (ack) {
+		memcpy(ack, tx_payload_buffer, sizeof(tx_payload_buffer));
+	}
+
+	radio_disabled();
+	events_process();
+}
+
+/* PTX sends the current packet. When an ACK is requested, the ACK packet
+ * ack of ack_len bytes is received. Returns if an ACK was requested.
+ */
+static bool ptx_send(const u8_t *ack, u8_t ack_len)
+{
+	bool ack_requested = (esb_state == ESB_STATE_PTX_TX_ACK);
+
+	zassert_true(ack_requested || esb_state == ESB_STATE_PTX_TX,
+		     "Not transmitting");
+	zassert_equal(ack_requested, tx_payload_buffer[1] & 0x01,
+		      "ACK bit differs from the state");
+	radio_disabled();
+
+	if (ack_requested) {
+		zassert_equal(esb_state, ESB_STATE_PTX_RX_ACK, NULL);
+
+		rx_payload_buffer[0] = ack_len;
+		rx_payload_buffer[1] = tx_payload_buffer[1] & ~0x01;
+		memcpy(&rx_payload_buffer[2], ack, ack_len);
+
+		NRF_RADIO->EVENTS_END = 1;
+		NRF_RADIO->CRCSTATUS = 1;
+		radio_disabled();
+		NRF_RADIO->EVENTS_END = 0;
+	}
+
+	events_process();
+
+	return ack_requested;
+}
+
+static void tx_payload_commit(u8_t pipe, u8_t length, u8_t fill)
+{
+	struct nrf_esb_payload *payload;
+
+	zassert_equal(nrf_esb_reserve_payload(&payload), 0, NULL);
+	payload->pipe = pipe;
+	payload->length = length;
+	payload->noack = false;
+	memset(payload->data, fill, length);
+	zassert_equal(nrf_esb_commit_payload(), 0, NULL);
+}
+
+static void test_tx_slot(void)
+{
+	struct nrf_esb_payload *payload;
+	struct nrf_esb_payload *again;
+
+	esb_init(NRF_ESB_MODE_PTX, NRF_ESB_TXMODE_MANUAL);
+
+	zassert_equal(nrf_esb_commit_payload(), -EINVAL, "Nothing reserved");
+	zassert_equal(nrf_esb_reserve_payload(&payload), 0, NULL);
+	zassert_equal(nrf_esb_reserve_payload(&again), 0, NULL);
+	zassert_equal_ptr(payload, again, "Reserved slot moved");
+
+	/* Rejected payload stays reserved, so it can be corrected. */
+	payload->pipe = 0;
+	payload->length = 0;
+	zassert_equal(nrf_esb_commit_payload(), -EMSGSIZE, "Empty payload");
+	payload->length = CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH + 1;
+	zassert_equal(nrf_esb_commit_payload(), -EMSGSIZE, "Too long");
+	payload->length = 4;
+	payload->pipe = CONFIG_NRF_ESB_PIPE_COUNT;
+	zassert_equal(nrf_esb_commit_payload(), -EINVAL, "Invalid pipe");
+	zassert_equal(tx_fifo_count(), 0, "Rejected payload queued");
+
+	payload->pipe = 1;
+	zassert_equal(nrf_esb_commit_payload(), 0, NULL);
+	zassert_equal(payload->pid, 1, "PID not assigned on commit");
+	zassert_equal(tx_fifo_count(), 1, NULL);
+	zassert_equal(nrf_esb_commit_payload(), -EINVAL, "Committed twice");
+
+	zassert_equal(nrf_esb_reserve_payload(&again), 0, NULL);
+	zassert_not_equal(payload, again, "Committed slot reused");
+	again->pipe = 1;
+	again->length = 4;
+	zassert_equal(nrf_esb_commit_payload(), 0, NULL);
+	zassert_equal(again->pid, 2, "PID not increased");
+	zassert_equal_ptr(tx_fifo_front(), payload, "Not first in, first out");
+	zassert_equal(nrf_esb_start_tx(), 0, NULL);
+	zassert_equal(tx_payload_buffer[1] >> 1, 1, "First PID not sent");
+	zassert_equal(nrf_esb_start_tx(), -EBUSY, NULL);
+}
+
+static void test_tx_full(void)
+{
+	struct nrf_esb_payload *payload;
+
+	esb_init(NRF_ESB_MODE_PTX, NRF_ESB_TXMODE_MANUAL);
+
+	for (u8_t i = 0; i < TX_FIFO_SIZE; i++) {
+		tx_payload_commit(0, 1, i);
+	}
+
+	zassert_equal(nrf_esb_reserve_payload(&payload), -ENOMEM, "Full");
+	zassert_equal(nrf_esb_pop_tx(), 0, NULL);
+	zassert_equal(tx_fifo_front()->data[0], 1, "Front not removed");
+	zassert_equal(nrf_esb_reserve_payload(&payload), 0, "Slot not freed");
+
+	zassert_equal(nrf_esb_flush_tx(), 0, NULL);
+	zassert_equal(tx_fifo_count(), 0, NULL);
+	zassert_equal(nrf_esb_pop_tx(), -ENODATA, "Popped empty FIFO");
+	zassert_equal(nrf_esb_commit_payload(), -EINVAL, "Flush kept slot");
+}
+
+/* The FIFO indices run to twice the FIFO size and wrap. */
+static void test_tx_wrap(void)
+{
+	u8_t fill = 0;
+	u8_t expected = 0;
+
+	esb_init(NRF_ESB_MODE_PTX, NRF_ESB_TXMODE_MANUAL);
+
+	for (u32_t round = 0; round < 5 * TX_FIFO_SIZE; round++) {
+		while (tx_fifo_count() < TX_FIFO_SIZE) {
+			tx_payload_commit(0, 1, fill++);
+		}
+
+		for (u32_t i = 0; i < round % TX_FIFO_SIZE + 1; i++) {
+			zassert_equal(tx_fifo_front()->data[0], expected++,
+				      "Out of order");
+			zassert_equal(nrf_esb_pop_tx(), 0, NULL);
+		}
+
+		zassert_true(tx_fifo.back < 2 * TX_FIFO_SIZE, NULL);
+		zassert_true(tx_fifo.front < 2 * TX_FIFO_SIZE, NULL);
+		zassert_equal(tx_fifo_count(), (u8_t)(fill - expected), NULL);
+	}
+}
+
+static void test_rx_acquire(void)
+{
+	static const u8_t data[] = { 1, 2, 3, 4, 5 };
+	struct nrf_esb_payload *payload;
+	struct nrf_esb_payload *again;
+	struct nrf_esb_payload read;
+
+	esb_init(NRF_ESB_MODE_PRX, NRF_ESB_TXMODE_AUTO);
+	zassert_equal(nrf_esb_acquire_rx_payload(&payload), -ENODATA, NULL);
+	zassert_equal(nrf_esb_release_rx_payload(), -ENODATA, NULL);
+	zassert_equal(nrf_esb_start_rx(), 0, NULL);
+
+	prx_receive(3, 1, data, sizeof(data), false, NULL);
+	prx_receive(4, 1, data, 2, false, NULL);
+	zassert_equal(rx_received_cnt, 2, NULL);
+
+	zassert_equal(nrf_esb_acquire_rx_payload(&payload), 0, NULL);
+	zassert_equal(nrf_esb_acquire_rx_payload(&again), 0, NULL);
+	zassert_equal_ptr(payload, again, "Front moved before release");
+	zassert_equal(payload->pipe, 3, NULL);
+	zassert_equal(payload->pid, 1, NULL);
+	zassert_equal(payload->length, sizeof(data), NULL);
+	zassert_mem_equal(payload->data, data, sizeof(data), NULL);
+	zassert_false(payload->noack, NULL);
+	zassert_equal(nrf_esb_release_rx_payload(), 0, NULL);
+
+	zassert_equal(nrf_esb_read_rx_payload(&read), 0, NULL);
+	zassert_equal(read.pipe, 4, NULL);
+	zassert_equal(read.length, 2, NULL);
+	zassert_mem_equal(read.data, data, 2, NULL);
+
+	zassert_equal(nrf_esb_acquire_rx_payload(&payload), -ENODATA, NULL);
+	zassert_equal(nrf_esb_read_rx_payload(&read), -ENODATA, NULL);
+
+	/* Retransmitted packet is not received again. */
+	prx_receive(4, 1, data, 2, true, NULL);
+	zassert_equal(rx_received_cnt, 2, "Retransmit received");
+	zassert_equal(nrf_esb_acquire_rx_payload(&payload), -ENODATA, NULL);
+
+	nrf_esb_disable();
+	zassert_equal(nrf_esb_acquire_rx_payload(&payload), -EACCES, NULL);
+}
+
+static void test_rx_wrap(void)
+{
+	struct nrf_esb_payload *payload;
+	u8_t sent = 0;
+	u8_t read = 0;
+
+	esb_init(NRF_ESB_MODE_PRX, NRF_ESB_TXMODE_AUTO);
+	zassert_equal(nrf_esb_start_rx(), 0, NULL);
+
+	for (u32_t round = 0; round < 5 * RX_FIFO_SIZE; round++) {
+		/* A full RX FIFO makes the radio drop the packet. */
+		while (rx_fifo_count() < RX_FIFO_SIZE - 1) {
+			prx_receive(0, sent % PID_MAX + 1, &sent, 1, false,
+				    NULL);
+			sent++;
+		}
+
+		for (u32_t i = 0; i < round % (RX_FIFO_SIZE - 1) + 1; i++) {
+			zassert_equal(nrf_esb_acquire_rx_payload(&payload), 0,
+				      NULL);
+			zassert_equal(payload->data[0], read++, "Out of order");
+			zassert_equal(nrf_esb_release_rx_payload(), 0, NULL);
+		}
+
+		zassert_true(rx_fifo.back < 2 * RX_FIFO_SIZE, NULL);
+		zassert_true(rx_fifo.front < 2 * RX_FIFO_SIZE, NULL);
+		zassert_equal(rx_fifo_count(), (u8_t)(sent - read), NULL);
+	}
+
+	zassert_equal(rx_received_cnt, sent, NULL);
+}
+
+static void test_burst(void)
+{
+	static const u8_t pipes[] = { 0, 0, 0, 0, 0, 1 };
+	static const bool acks[] = { true, false, false, true, true, true };
+	struct nrf_esb_config config;
+
+	esb_config_init(&config, NRF_ESB_MODE_PTX, NRF_ESB_TXMODE_AUTO);
+	config.burst_length = 3;
+	zassert_equal(nrf_esb_init(&config), 0, NULL);
+
+	/* The first payload is sent alone, the rest are queued meanwhile. */
+	for (u8_t i = 0; i < ARRAY_SIZE(pipes); i++) {
+		tx_payload_commit(pipes[i], 4, i);
+	}
+
+	for (u8_t i = 0; i < ARRAY_SIZE(pipes); i++) {
+		zassert_equal(tx_payload_buffer[2], i, "Out of order");
+		zassert_equal(ptx_send(NULL, 0), acks[i],
+			      "Burst ends at the length limit and pipe change");
+	}
+
+	zassert_equal(esb_state, ESB_STATE_IDLE, NULL);
+	zassert_equal(tx_fifo_count(), 0, NULL);
+	zassert_equal(tx_success_cnt, ARRAY_SIZE(pipes), NULL);
+	zassert_equal(tx_failed_cnt, 0, NULL);
+
+	config.protocol = NRF_ESB_PROTOCOL_ESB;
+	zassert_equal(nrf_esb_init(&config), -EINVAL,
+		      "Bursts without dynamic payload length");
+}
+
+static void test_ack_aggregation_prx(void)
+{
+	static const u8_t data[] = { 0xaa };
+	struct nrf_esb_config config;
+	struct nrf_esb_payload *payload;
+	u8_t ack[CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH + 2];
+	u8_t retransmitted[sizeof(ack)];
+
+	esb_config_init(&config, NRF_ESB_MODE_PRX, NRF_ESB_TXMODE_AUTO);
+	config.ack_aggregation = true;
+	zassert_equal(nrf_esb_init(&config), 0, NULL);
+
+	/* Element header must fit in the ACK packet. */
+	zassert_equal(nrf_esb_reserve_payload(&payload), 0, NULL);
+	payload->pipe = 0;
+	payload->length = CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH - 1;
+	zassert_equal(nrf_esb_commit_payload(), -EMSGSIZE, NULL);
+	payload->length = CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH - ACK_ELEM_HDR_LEN;
+	zassert_equal(nrf_esb_commit_payload(), 0, NULL);
+	zassert_equal(nrf_esb_flush_tx(), 0, NULL);
+
+	tx_payload_commit(0, 5, 0x10);
+	tx_payload_commit(1, 6, 0x20);
+	zassert_equal(nrf_esb_start_rx(), 0, NULL);
+
+	prx_receive(0, 1, data, sizeof(data), false, ack);
+	zassert_equal(ack[0], 2 * ACK_ELEM_HDR_LEN + 5 + 6, NULL);
+	zassert_equal(ack[2], 0, "First pipe");
+	zassert_equal(ack[3], 5, "First length");
+	zassert_equal(ack[4], 0x10, NULL);
+	zassert_equal(ack[2 + ACK_ELEM_HDR_LEN + 5], 1, "Second pipe");
+	zassert_equal(ack[3 + ACK_ELEM_HDR_LEN + 5], 6, "Second length");
+	zassert_equal(ack[4 + ACK_ELEM_HDR_LEN + 5], 0x20, NULL);
+	zassert_equal(rx_received_cnt, 1, NULL);
+	zassert_equal(tx_success_cnt, 0, "ACK not yet received");
+
+	/* Retransmitted ACK carries the same payloads, also if more were
+	 * queued meanwhile.
+	 */
+	tx_payload_commit(0, 3, 0x30);
+	tx_payload_commit(0, 30, 0x40);
+	prx_receive(0, 1, data, sizeof(data), true, retransmitted);
+	zassert_mem_equal(retransmitted, ack, ack[0] + 2, "ACK differs");
+	zassert_equal(rx_received_cnt, 1, "Retransmit received");
+	zassert_equal(tx_fifo_count(), 4, NULL);
+
+	/* Next packet acknowledges both payloads. The ACK is filled with
+	 * the payloads that fit.
+	 */
+	prx_receive(0, 2, data, sizeof(data), false, ack);
+	zassert_equal(tx_success_cnt, 1, NULL);
+	zassert_equal(tx_fifo_count(), 2, "Both payloads not removed");
+	zassert_equal(ack[0], ACK_ELEM_HDR_LEN + 3, NULL);
+	zassert_equal(ack[3], 3, NULL);
+	zassert_equal(ack[4], 0x30, NULL);
+
+	prx_receive(0, 3, data, sizeof(data), false, ack);
+	zassert_equal(tx_fifo_count(), 1, NULL);
+	zassert_equal(ack[0], ACK_ELEM_HDR_LEN + 30, NULL);
+	zassert_equal(ack[4], 0x40, NULL);
+
+	prx_receive(0, 1, data, sizeof(data), false, ack);
+	zassert_equal(tx_success_cnt, 3, NULL);
+	zassert_equal(tx_fifo_count(), 0, NULL);
+	zassert_equal(ack[0], 0, "Empty ACK");
+	zassert_equal(rx_received_cnt, 4, NULL);
+}
+
+static void test_ack_aggregation_ptx(void)
+{
+	static const u8_t aggregated[] = {
+		0, 3, 0x10, 0x11, 0x12,
+		2, 1, 0x20,
+		7, 0,
+	};
+	static const u8_t bad_pipe[] = {
+		1, 1, 0x30,
+		CONFIG_NRF_ESB_PIPE_COUNT, 1, 0x40,
+	};
+	static const u8_t bad_length[] = {
+		3, 2, 0x50, 0x51,
+		4, 3, 0x60,
+	};
+	struct nrf_esb_config config;
+	struct nrf_esb_payload *payload;
+
+	esb_config_init(&config, NRF_ESB_MODE_PTX, NRF_ESB_TXMODE_AUTO);
+	config.ack_aggregation = true;
+	zassert_equal(nrf_esb_init(&config), 0, NULL);
+
+	tx_payload_commit(0, 1, 0);
+	zassert_true(ptx_send(aggregated, sizeof(aggregated)), NULL);
+	zassert_equal(rx_received_cnt, 1, NULL);
+	zassert_equal(rx_fifo_count(), 3, "ACK not split");
+
+	zassert_equal(nrf_esb_acquire_rx_payload(&payload), 0, NULL);
+	zassert_equal(payload->pipe, 0, NULL);
+	zassert_equal(payload->length, 3, NULL);
+	zassert_mem_equal(payload->data, &aggregated[2], 3, NULL);
+	zassert_equal(nrf_esb_release_rx_payload(), 0, NULL);
+	zassert_equal(nrf_esb_acquire_rx_payload(&payload), 0, NULL);
+	zassert_equal(payload->pipe, 2, NULL);
+	zassert_equal(payload->length, 1, NULL);
+	zassert_equal(payload->data[0], 0x20, NULL);
+	zassert_equal(nrf_esb_release_rx_payload(), 0, NULL);
+	zassert_equal(nrf_esb_acquire_rx_payload(&payload), 0, NULL);
+	zassert_equal(payload->pipe, 7, NULL);
+	zassert_equal(payload->length, 0, "Empty payload");
+	zassert_equal(nrf_esb_release_rx_payload(), 0, NULL);
+
+	/* Malformed elements end the ACK, the ones before are kept. */
+	tx_payload_commit(0, 1, 1);
+	zassert_true(ptx_send(bad_pipe, sizeof(bad_pipe)), NULL);
+	tx_payload_commit(0, 1, 2);
+	zassert_true(ptx_send(bad_length, sizeof(bad_length)), NULL);
+	zassert_equal(rx_fifo_count(), 2, "Malformed payload received");
+	zassert_equal(rx_received_cnt, 3, NULL);
+
+	zassert_equal(nrf_esb_acquire_rx_payload(&payload), 0, NULL);
+	zassert_equal(payload->pipe, 1, NULL);
+	zassert_equal(payload->data[0], 0x30, NULL);
+	zassert_equal(nrf_esb_release_rx_payload(), 0, NULL);
+	zassert_equal(nrf_esb_acquire_rx_payload(&payload), 0, NULL);
+	zassert_equal(payload->pipe, 3, NULL);
+	zassert_equal(payload->length, 2, NULL);
+	zassert_equal(nrf_esb_release_rx_payload(), 0, NULL);
+
+	/* ACK without a complete element header has no payloads. */
+	tx_payload_commit(0, 1, 3);
+	zassert_true(ptx_send(bad_pipe, 1), NULL);
+	zassert_equal(rx_fifo_count(), 0, NULL);
+	zassert_equal(rx_received_cnt, 3, NULL);
+	zassert_equal(tx_success_cnt, 4, NULL);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(esb_test,
+			 ztest_unit_test_setup_teardown(test_tx_slot,
+							setup, teardown),
+			 ztest_unit_test_setup_teardown(test_tx_full,
+							setup, teardown),
+			 ztest_unit_test_setup_teardown(test_tx_wrap,
+							setup, teardown),
+			 ztest_unit_test_setup_teardown(test_rx_acquire,
+							setup, teardown),
+			 ztest_unit_test_setup_teardown(test_rx_wrap,
+							setup, teardown),
+			 ztest_unit_test_setup_teardown(test_burst,
+							setup, teardown),
+			 ztest_unit_test_setup_teardown(test_ack_aggregation_prx,
+							setup, teardown),
+			 ztest_unit_test_setup_teardown(test_ack_aggregation_ptx,
+							setup, teardown)
+			 );
+
+	ztest_run_test_suite(esb_test);
+}
@@ -0,0 +1,532 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <errno.h>
+#include <string.h>
+#include <misc/util.h>
+
+#include <nrf_esb_hop.h>
+
+#include "test_vector.c"
+
+/* Parameters of the simulated link, must match test_generator.py. */
+#define SIM_SEED		0x1234
+#define SIM_SLOTS		6000
+#define SIM_UPDATE_PERIOD	8
+#define SIM_STALL_START		1000
+#define SIM_STALL_LEN		7
+#define SIM_BLACKLIST_SLOTS	2000
+
+static const u8_t sim_bad[] = {10, 30, 50, 70};
+
+static struct nrf_esb_hop ptx;
+static struct nrf_esb_hop prx;
+
+static void map_set(u8_t *map, u8_t channel)
+{
+	map[channel / 8] |= (1 << (channel % 8));
+}
+
+static bool map_test(const u8_t *map, u8_t channel)
+{
+	return (map[channel / 8] & (1 << (channel % 8))) != 0;
+}
+
+static void config_init(struct nrf_esb_hop_config *cfg, u8_t first,
+			u8_t last, u8_t step)
+{
+	*cfg = (struct nrf_esb_hop_config)NRF_ESB_HOP_DEFAULT_CONFIG;
+
+	for (u32_t ch = first; ch <= last; ch += step) {
+		map_set(cfg->map, ch);
+	}
+}
+
+static void test_init_invalid(void)
+{
+	struct nrf_esb_hop_config cfg = NRF_ESB_HOP_DEFAULT_CONFIG;
+
+	zassert_equal(nrf_esb_hop_init(&ptx, &cfg), -EINVAL,
+		      "Empty map accepted");
+
+	map_set(cfg.map, 40);
+	zassert_equal(nrf_esb_hop_init(&ptx, &cfg), -EINVAL,
+		      "Single channel accepted");
+
+	map_set(cfg.map, 100);
+	zassert_equal(nrf_esb_hop_init(&ptx, &cfg), 0, "Valid map rejected");
+
+	map_set(cfg.map, 101);
+	zassert_equal(nrf_esb_hop_init(&ptx, &cfg), -EINVAL,
+		      "Invalid channel accepted");
+}
+
+static void check_sequence(const u8_t *map, u32_t seed, const u8_t *seq,
+			   size_t len)
+{
+	struct nrf_esb_hop_config cfg = NRF_ESB_HOP_DEFAULT_CONFIG;
+
+	memcpy(cfg.map, map, sizeof(cfg.map));
+	cfg.seed = seed;
+
+	zassert_equal(nrf_esb_hop_init(&ptx, &cfg), 0, "Init failed");
+	zassert_equal(nrf_esb_hop_cycle_len(&ptx), len, "Invalid cycle");
+	zassert_equal(nrf_esb_hop_channel(&ptx), seq[0], "Invalid channel");
+
+	/* Sequence repeats every cycle. */
+	for (size_t i = 1; i < 3 * len; i++) {
+		zassert_equal(nrf_esb_hop_next(&ptx), seq[i % len],
+			      "Invalid channel in slot %u", i);
+	}
+}
+
+static void test_sequence(void)
+{
+	check_sequence(seq_all_map, SEQ_ALL_SEED, seq_all,
+		       ARRAY_SIZE(seq_all));
+	check_sequence(seq_even_map, SEQ_EVEN_SEED, seq_even,
+		       ARRAY_SIZE(seq_even));
+	check_sequence(seq_three_map, SEQ_THREE_SEED, seq_three,
+		       ARRAY_SIZE(seq_three));
+}
+
+static void test_sync(void)
+{
+	struct nrf_esb_hop_config cfg = NRF_ESB_HOP_DEFAULT_CONFIG;
+
+	memcpy(cfg.map, seq_even_map, sizeof(cfg.map));
+	cfg.seed = SEQ_EVEN_SEED;
+	zassert_equal(nrf_esb_hop_init(&prx, &cfg), 0, "Init failed");
+
+	for (size_t i = 0; i < ARRAY_SIZE(sync_vec); i += 3) {
+		prx.slot = sync_vec[i];
+		zassert_equal(nrf_esb_hop_sync(&prx, sync_vec[i + 1]), 0,
+			      "Sync failed");
+		zassert_equal(prx.slot, sync_vec[i + 2],
+			      "Invalid slot after sync %u", i / 3);
+	}
+
+	zassert_equal(nrf_esb_hop_sync(&prx, 1), -ENOENT,
+		      "Synchronized to unused channel");
+}
+
+static void test_sync_missed_hops(void)
+{
+	struct nrf_esb_hop_config cfg;
+
+	config_init(&cfg, 2, 80, 2);
+	zassert_equal(nrf_esb_hop_init(&ptx, &cfg), 0, "Init failed");
+
+	u8_t len = nrf_esb_hop_cycle_len(&ptx);
+
+	for (size_t i = 0; i < 1000; i++) {
+		nrf_esb_hop_next(&ptx);
+	}
+
+	/* PRX that missed less than half a cycle of hops in either
+	 * direction finds the PTX slot on the first packet.
+	 */
+	for (s32_t missed = -(len - 1) / 2; missed <= len / 2; missed++) {
+		zassert_equal(nrf_esb_hop_init(&prx, &cfg), 0, "Init failed");
+		prx.slot = ptx.slot - missed;
+
+		zassert_equal(nrf_esb_hop_sync(&prx,
+					       nrf_esb_hop_channel(&ptx)), 0,
+			      "Sync failed");
+		zassert_equal(prx.slot, ptx.slot,
+			      "Invalid slot after %d missed hops", missed);
+	}
+
+	/* Slot counter does not go back before zero. */
+	zassert_equal(nrf_esb_hop_init(&prx, &cfg), 0, "Init failed");
+	zassert_equal(nrf_esb_hop_sync(&prx, prx.seq[len - 1]), 0,
+		      "Sync failed");
+	zassert_equal(prx.slot, len - 1, "Slot moved before zero");
+}
+
+static void test_estimator(void)
+{
+	struct nrf_esb_hop_config cfg;
+
+	config_init(&cfg, 0, 100, 1);
+	zassert_equal(nrf_esb_hop_init(&ptx, &cfg), 0, "Init failed");
+
+	for (size_t i = 0; i < ARRAY_SIZE(per_vec); i += 4) {
+		u8_t ch = per_vec[i];
+
+		nrf_esb_hop_tx_result(&ptx, ch, per_vec[i + 1], per_vec[i + 2]);
+		zassert_equal(ptx.per[ch], per_vec[i + 3],
+			      "Invalid error rate in step %u", i / 4);
+	}
+
+	/* Invalid results are ignored. */
+	nrf_esb_hop_tx_result(&ptx, 0, 0, false);
+	nrf_esb_hop_tx_result(&ptx, NRF_ESB_HOP_CHANNEL_COUNT, 1, false);
+}
+
+static void fail_tx(struct nrf_esb_hop *hop, u8_t channel, size_t cnt,
+		    u32_t attempts)
+{
+	for (size_t i = 0; i < cnt; i++) {
+		nrf_esb_hop_tx_result(hop, channel, attempts, false);
+	}
+}
+
+static void test_map_update(void)
+{
+	struct nrf_esb_hop_config cfg;
+
+	config_init(&cfg, 10, 19, 1);
+	cfg.channels_min = 8;
+	cfg.blacklist_slots = 100;
+	zassert_equal(nrf_esb_hop_init(&ptx, &cfg), 0, "Init failed");
+
+	zassert_false(nrf_esb_hop_map_update(&ptx), "Update without errors");
+
+	/* Only the two worst channels can be excluded. */
+	fail_tx(&ptx, 12, 20, 4);
+	nrf_esb_hop_tx_result(&ptx, 15, 2, true);
+	fail_tx(&ptx, 15, 10, 4);
+	fail_tx(&ptx, 17, 8, 4);
+	zassert_true(ptx.per[17] > cfg.per_threshold, "Invalid error rate");
+
+	zassert_true(nrf_esb_hop_map_update(&ptx), "No update");
+	zassert_false(nrf_esb_hop_map_update(&ptx), "Update while pending");
+	zassert_false(map_test(ptx.pending_map, 12), "Channel not excluded");
+	zassert_false(map_test(ptx.pending_map, 15), "Channel not excluded");
+	zassert_true(map_test(ptx.pending_map, 17), "Too many excluded");
+
+	/* New map is used from the instant. */
+	for (size_t i = 1; i < cfg.instant_offset; i++) {
+		nrf_esb_hop_next(&ptx);
+		zassert_equal(nrf_esb_hop_cycle_len(&ptx), 10,
+			      "Map applied before instant");
+	}
+	nrf_esb_hop_next(&ptx);
+	zassert_equal(nrf_esb_hop_cycle_len(&ptx), 8, "Map not applied");
+	zassert_equal(ptx.slot, cfg.instant_offset, "Invalid instant");
+
+	for (size_t i = 0; i < 2 * nrf_esb_hop_cycle_len(&ptx); i++) {
+		u8_t ch = nrf_esb_hop_next(&ptx);
+
+		zassert_true((ch != 12) && (ch != 15),
+			     "Excluded channel used");
+	}
+
+	/* Excluded channels are used again after the blacklist time. */
+	while (ptx.slot < cfg.blacklist_slots - 1) {
+		nrf_esb_hop_next(&ptx);
+		zassert_false(nrf_esb_hop_map_update(&ptx),
+			      "Channel used again too early");
+	}
+	nrf_esb_hop_next(&ptx);
+	zassert_true(nrf_esb_hop_map_update(&ptx), "No update");
+	zassert_equal(ptx.per[12], cfg.per_threshold / 2,
+		      "Error rate not reset");
+	zassert_true(map_test(ptx.pending_map, 12), "Channel not used");
+	zassert_true(map_test(ptx.pending_map, 15), "Channel not used");
+}
+
+static void test_sync_info(void)
+{
+	struct nrf_esb_hop_config cfg;
+	struct nrf_esb_hop_sync_info info;
+
+	config_init(&cfg, 0, 78, 2);
+	zassert_equal(nrf_esb_hop_init(&ptx, &cfg), 0, "Init failed");
+	zassert_equal(nrf_esb_hop_init(&prx, &cfg), 0, "Init failed");
+
+	for (size_t i = 0; i < 500; i++) {
+		nrf_esb_hop_next(&ptx);
+	}
+
+	/* PRX takes the slot from the PTX. */
+	nrf_esb_hop_sync_info_get(&ptx, &info);
+	zassert_equal(nrf_esb_hop_sync_info_apply(&prx, &info), 0,
+		      "Apply failed");
+	zassert_equal(prx.slot, ptx.slot, "Slot not synchronized");
+
+	fail_tx(&ptx, 20, 10, 4);
+	zassert_true(nrf_esb_hop_map_update(&ptx), "No update");
+
+	/* PRX receives the update before the instant. */
+	nrf_esb_hop_next(&ptx);
+	nrf_esb_hop_next(&prx);
+	nrf_esb_hop_sync_info_get(&ptx, &info);
+	zassert_equal(nrf_esb_hop_sync_info_apply(&prx, &info), 0,
+		      "Apply failed");
+	zassert_true(prx.pending, "Update not pending");
+
+	for (size_t i = 0; i < 2 * cfg.instant_offset; i++) {
+		zassert_equal(nrf_esb_hop_next(&ptx), nrf_esb_hop_next(&prx),
+			      "Devices not synchronized in slot %u", ptx.slot);
+	}
+	zassert_equal(nrf_esb_hop_cycle_len(&prx), 39, "Map not applied");
+
+	/* PRX that missed the instant applies the map on reception. */
+	zassert_equal(nrf_esb_hop_init(&prx, &cfg), 0, "Init failed");
+	nrf_esb_hop_sync_info_get(&ptx, &info);
+	zassert_equal(nrf_esb_hop_sync_info_apply(&prx, &info), 0,
+		      "Apply failed");
+	zassert_false(prx.pending, "Applied map pending");
+	zassert_equal(nrf_esb_hop_channel(&prx), nrf_esb_hop_channel(&ptx),
+		      "Devices not synchronized");
+
+	memset(info.map, 0, sizeof(info.map));
+	zassert_equal(nrf_esb_hop_sync_info_apply(&prx, &info), -EINVAL,
+		      "Invalid map applied");
+}
+
+/* PRX misses the info of one update and receives the next one while it is
+ * pending. It must use the map of the missed update until that instant.
+ */
+static void test_sync_info_missed_update(void)
+{
+	struct nrf_esb_hop_config cfg;
+	struct nrf_esb_hop_sync_info info;
+
+	config_init(&cfg, 0, 78, 2);
+	zassert_equal(nrf_esb_hop_init(&ptx, &cfg), 0, "Init failed");
+	zassert_equal(nrf_esb_hop_init(&prx, &cfg), 0, "Init failed");
+
+	fail_tx(&ptx, 20, 10, 4);
+	zassert_true(nrf_esb_hop_map_update(&ptx), "No update");
+
+	for (size_t i = 0; i < 2 * cfg.instant_offset; i++) {
+		nrf_esb_hop_next(&ptx);
+		nrf_esb_hop_next(&prx);
+	}
+	zassert_equal(nrf_esb_hop_cycle_len(&ptx), 39, "Map not applied");
+	zassert_equal(nrf_esb_hop_cycle_len(&prx), 40, "Update received");
+
+	fail_tx(&ptx, 30, 10, 4);
+	zassert_true(nrf_esb_hop_map_update(&ptx), "No update");
+	nrf_esb_hop_next(&ptx);
+	nrf_esb_hop_next(&prx);
+
+	nrf_esb_hop_sync_info_get(&ptx, &info);
+	zassert_equal(nrf_esb_hop_sync_info_apply(&prx, &info), 0,
+		      "Apply failed");
+	zassert_mem_equal(prx.map, ptx.map, sizeof(prx.map),
+			  "Missed map not applied");
+	zassert_true(prx.pending, "Update not pending");
+
+	for (size_t i = 0; i < 2 * cfg.instant_offset; i++) {
+		zassert_equal(nrf_esb_hop_channel(&ptx),
+			      nrf_esb_hop_channel(&prx),
+			      "Devices not synchronized in slot %u", ptx.slot);
+		nrf_esb_hop_next(&ptx);
+		nrf_esb_hop_next(&prx);
+	}
+	zassert_equal(nrf_esb_hop_cycle_len(&prx), 38, "Map not applied");
+
+	/* Both maps are checked. */
+	nrf_esb_hop_sync_info_get(&ptx, &info);
+	memset(info.next_map, 0, sizeof(info.next_map));
+	zassert_equal(nrf_esb_hop_sync_info_apply(&prx, &info), -EINVAL,
+		      "Invalid map applied");
+}
+
+/* Info is sent in the payload, compactly and in little-endian byte order. */
+static void test_sync_info_encode(void)
+{
+	struct nrf_esb_hop_config cfg;
+	struct nrf_esb_hop_sync_info info;
+	struct nrf_esb_hop_sync_info decoded;
+	u8_t buf[NRF_ESB_HOP_SYNC_INFO_LEN_MAX];
+	size_t len;
+
+	zassert_true(sizeof(buf) <= CONFIG_NRF_ESB_MAX_PAYLOAD_LENGTH,
+		     "Info does not fit in a payload");
+
+	config_init(&cfg, 0, 78, 2);
+	zassert_equal(nrf_esb_hop_init(&ptx, &cfg), 0, "Init failed");
+	zassert_equal(nrf_esb_hop_init(&prx, &cfg), 0, "Init failed");
+
+	for (size_t i = 0; i < 0x10203; i++) {
+		nrf_esb_hop_next(&ptx);
+	}
+
+	/* No update pending, only the map in use is sent. */
+	nrf_esb_hop_sync_info_get(&ptx, &info);
+	len = nrf_esb_hop_sync_info_encode(&info, buf);
+	zassert_equal(len, NRF_ESB_HOP_SYNC_INFO_LEN_MIN, "Wrong length");
+	zassert_equal(buf[0], 0x03, "Slot not little-endian");
+	zassert_equal(buf[1], 0x02, "Slot not little-endian");
+	zassert_equal(buf[2], 0x01, "Slot not little-endian");
+	zassert_equal(buf[3], 0x00, "Slot not little-endian");
+
+	zassert_equal(nrf_esb_hop_sync_info_decode(&decoded, buf, len), 0,
+		      "Decode failed");
+	zassert_equal(decoded.slot, info.slot, "Wrong slot");
+	zassert_mem_equal(decoded.map, info.map, sizeof(info.map),
+			  "Wrong map");
+	zassert_mem_equal(decoded.next_map, info.map, sizeof(info.map),
+			  "Wrong next map");
+	zassert_equal(nrf_esb_hop_sync_info_apply(&prx, &decoded), 0,
+		      "Apply failed");
+	zassert_equal(prx.slot, ptx.slot, "Slot not synchronized");
+
+	/* Update pending, the instant and the latest map are added. */
+	fail_tx(&ptx, 20, 10, 4);
+	zassert_true(nrf_esb_hop_map_update(&ptx), "No update");
+	nrf_esb_hop_next(&ptx);
+	nrf_esb_hop_next(&prx);
+
+	nrf_esb_hop_sync_info_get(&ptx, &info);
+	len = nrf_esb_hop_sync_info_encode(&info, buf);
+	zassert_equal(len, NRF_ESB_HOP_SYNC_INFO_LEN_MAX, "Wrong length");
+	zassert_equal(buf[NRF_ESB_HOP_SYNC_INFO_LEN_MIN],
+		      cfg.instant_offset - 1, "Wrong instant offset");
+	zassert_equal(buf[NRF_ESB_HOP_SYNC_INFO_LEN_MIN + 1], 0,
+		      "Wrong instant offset");
+
+	zassert_equal(nrf_esb_hop_sync_info_decode(&decoded, buf, len), 0,
+		      "Decode failed");
+	zassert_equal(decoded.slot, info.slot, "Wrong slot");
+	zassert_equal(decoded.instant, info.instant, "Wrong instant");
+	zassert_mem_equal(decoded.map, info.map, sizeof(info.map),
+			  "Wrong map");
+	zassert_mem_equal(decoded.next_map, info.next_map,
+			  sizeof(info.next_map), "Wrong next map");
+	zassert_equal(nrf_esb_hop_sync_info_apply(&prx, &decoded), 0,
+		      "Apply failed");
+	zassert_true(prx.pending, "Update not pending");
+
+	for (size_t i = 0; i < 2 * cfg.instant_offset; i++) {
+		zassert_equal(nrf_esb_hop_next(&ptx), nrf_esb_hop_next(&prx),
+			      "Devices not synchronized in slot %u", ptx.slot);
+	}
+
+	/* Truncated info and info with a wrong pending flag are rejected. */
+	zassert_equal(nrf_esb_hop_sync_info_decode(&decoded, buf, len - 1),
+		      -EINVAL, "Truncated info decoded");
+	zassert_equal(nrf_esb_hop_sync_info_decode(
+			      &decoded, buf, NRF_ESB_HOP_SYNC_INFO_LEN_MIN),
+		      -EINVAL, "Info without update decoded");
+}
+
+static bool sim_channel_bad(u8_t channel)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(sim_bad); i++) {
+		if (sim_bad[i] == channel) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Simulate a link with interference on some channels. PTX sends the
+ * synchronization info in every packet. PRX stops for a few slots, keeps
+ * hopping without reception for a cycle and then waits on one channel until
+ * it receives the next packet.
+ */
+static void test_simulation(void)
+{
+	struct nrf_esb_hop_config cfg;
+	struct nrf_esb_hop_sync_info info;
+	size_t missed = 0;
+	size_t updates = 0;
+	u32_t resync_slot = 0;
+	bool parked = false;
+	bool lost = false;
+
+	config_init(&cfg, 2, 80, 4);
+	cfg.seed = SIM_SEED;
+	cfg.blacklist_slots = SIM_BLACKLIST_SLOTS;
+	zassert_equal(nrf_esb_hop_init(&ptx, &cfg), 0, "Init failed");
+	zassert_equal(nrf_esb_hop_init(&prx, &cfg), 0, "Init failed");
+
+	for (u32_t slot = 0; slot < SIM_SLOTS; slot++) {
+		bool stalled = (slot >= SIM_STALL_START) &&
+			       (slot < SIM_STALL_START + SIM_STALL_LEN);
+		u8_t ch = nrf_esb_hop_channel(&ptx);
+		bool listening = !stalled &&
+				 (nrf_esb_hop_channel(&prx) == ch);
+		u32_t attempts = 4;
+		bool success = false;
+
+		if (listening && !sim_channel_bad(ch)) {
+			attempts = 1;
+			success = true;
+		} else if (listening && (slot % 3 == 0)) {
+			attempts = 3;
+			success = true;
+		}
+
+		nrf_esb_hop_tx_result(&ptx, ch, attempts, success);
+		if (success) {
+			nrf_esb_hop_sync_info_get(&ptx, &info);
+			zassert_equal(nrf_esb_hop_sync_info_apply(&prx, &info),
+				      0, "Apply failed");
+			if (lost) {
+				resync_slot = slot;
+				lost = false;
+			}
+			missed = 0;
+			parked = false;
+		} else if (!stalled) {
+			missed++;
+		}
+
+		if (stalled) {
+			lost = true;
+		}
+
+		if ((slot % SIM_UPDATE_PERIOD == 0) &&
+		    nrf_esb_hop_map_update(&ptx)) {
+			updates++;
+		}
+
+		nrf_esb_hop_next(&ptx);
+		if (stalled) {
+			continue;
+		}
+		if (parked) {
+			if (missed % nrf_esb_hop_cycle_len(&prx) == 0) {
+				nrf_esb_hop_next(&prx);
+			}
+		} else {
+			nrf_esb_hop_next(&prx);
+			if (missed >= nrf_esb_hop_cycle_len(&prx)) {
+				parked = true;
+			}
+		}
+	}
+
+	zassert_equal(updates, SIM_UPDATES, "Invalid update count");
+	zassert_equal(resync_slot, SIM_RESYNC_SLOT, "Invalid resync slot");
+	zassert_equal(ptx.slot, prx.slot, "Slots differ");
+	zassert_mem_equal(ptx.map, sim_map, sizeof(sim_map), "Invalid map");
+	zassert_mem_equal(prx.map, sim_map, sizeof(sim_map), "Invalid map");
+	zassert_mem_equal(ptx.per, sim_per, sizeof(sim_per),
+			  "Invalid error rates");
+
+	for (size_t i = 0; i < ARRAY_SIZE(sim_bad); i++) {
+		zassert_false(map_test(ptx.map, sim_bad[i]),
+			      "Bad channel %u used", sim_bad[i]);
+	}
+}
+
+void test_main(void)
+{
+	ztest_test_suite(esb_hop_tests,
+			 ztest_unit_test(test_init_invalid),
+			 ztest_unit_test(test_sequence),
+			 ztest_unit_test(test_sync),
+			 ztest_unit_test(test_sync_missed_hops),
+			 ztest_unit_test(test_estimator),
+			 ztest_unit_test(test_map_update),
+			 ztest_unit_test(test_sync_info),
+			 ztest_unit_test(test_sync_info_missed_update),
+			 ztest_unit_test(test_sync_info_encode),
+			 ztest_unit_test(test_simulation)
+			 );
+
+	ztest_run_test_suite(esb_hop_tests);
+}
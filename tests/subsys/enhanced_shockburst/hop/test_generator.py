@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2019 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+
+# Reference model of the ESB frequency hopping scheduler. Generates
+# test_vector.c with hop sequences, channel quality estimator results and
+# the result of a simulated PTX/PRX link with interference and missed hops.
+
+import random
+from os import linesep as ls
+
+CHANNEL_COUNT = 101
+MAP_SIZE = (CHANNEL_COUNT + 7) // 8
+CHANNELS_MIN = 2
+SEED_DEFAULT = 0x2545F491
+PER_WEIGHT = 7
+PER_MAX = 255
+U32 = 0xFFFFFFFF
+
+
+def instant_passed(slot, instant):
+	return ((slot - instant) & U32) < 0x80000000
+
+
+class Hop:
+	def __init__(self, channels, seed, per_threshold=128, channels_min=8,
+		     instant_offset=16, blacklist_slots=4096):
+		assert len(channels) >= CHANNELS_MIN
+		self.cfg_map = set(channels)
+		self.seed = seed
+		self.per_threshold = per_threshold
+		self.channels_min = channels_min
+		self.instant_offset = instant_offset
+		self.blacklist_slots = blacklist_slots
+		self.slot = 0
+		self.pending = None
+		self.per = [0] * CHANNEL_COUNT
+		self.excluded_at = [0] * CHANNEL_COUNT
+		self.map_apply(self.cfg_map, 0)
+
+	def seq_build(self):
+		state = self.seed if self.seed else SEED_DEFAULT
+		seq = sorted(self.map)
+		for i in range(len(seq) - 1, 0, -1):
+			state ^= (state << 13) & U32
+			state ^= state >> 17
+			state ^= (state << 5) & U32
+			j = state % (i + 1)
+			seq[i], seq[j] = seq[j], seq[i]
+		self.seq = seq
+
+	def map_apply(self, chmap, instant):
+		self.map = set(chmap)
+		self.instant = instant
+		self.pending = None
+		self.seq_build()
+
+	def channel(self):
+		return self.seq[self.slot % len(self.seq)]
+
+	def next(self):
+		self.slot = (self.slot + 1) & U32
+		if self.pending and instant_passed(self.slot, self.pending[1]):
+			self.map_apply(*self.pending)
+		return self.channel()
+
+	def sync(self, channel):
+		if channel not in self.seq:
+			return False
+		n = len(self.seq)
+		fwd = (self.seq.index(channel) + n - self.slot % n) % n
+		back = (n - fwd) % n
+		if back < fwd and self.slot >= back:
+			self.slot -= back
+		else:
+			self.slot += fwd
+		return True
+
+	def tx_result(self, channel, attempts, success):
+		errors = attempts - 1 if success else attempts
+		sample = errors * PER_MAX // attempts
+		self.per[channel] = (self.per[channel] * PER_WEIGHT + sample) // \
+				    (PER_WEIGHT + 1)
+
+	def map_update(self):
+		if self.pending:
+			return False
+		chmap = set(self.map)
+		for ch in sorted(self.cfg_map - self.map):
+			if ((self.slot - self.excluded_at[ch]) & U32) >= \
+			   self.blacklist_slots:
+				chmap.add(ch)
+				self.per[ch] = self.per_threshold // 2
+		used_min = max(self.channels_min, CHANNELS_MIN)
+		while len(chmap) > used_min:
+			bad = [ch for ch in sorted(chmap)
+			       if self.per[ch] > self.per_threshold]
+			if not bad:
+				break
+			worst = max(bad, key=lambda ch: (self.per[ch], -ch))
+			chmap.remove(worst)
+			self.excluded_at[worst] = self.slot
+		if chmap == self.map:
+			return False
+		self.pending = (chmap, (self.slot + self.instant_offset) & U32)
+		return True
+
+	def sync_info_get(self):
+		if self.pending:
+			return (set(self.map), set(self.pending[0]),
+				self.pending[1], self.slot)
+		return (set(self.map), set(self.map), self.instant, self.slot)
+
+	def sync_info_apply(self, info):
+		chmap, next_map, instant, slot = info
+		self.slot = slot
+		if chmap != self.map:
+			self.map_apply(chmap, slot)
+		if next_map == self.map:
+			self.pending = None
+		elif instant_passed(slot, instant):
+			self.map_apply(next_map, instant)
+		else:
+			self.pending = (next_map, instant)
+
+
+# Parameters of the simulated link, must match src/main.c.
+SIM_CHANNELS = list(range(2, 81, 4))
+SIM_SEED = 0x1234
+SIM_BAD = (10, 30, 50, 70)
+SIM_SLOTS = 6000
+SIM_UPDATE_PERIOD = 8
+SIM_STALL_START = 1000
+SIM_STALL_LEN = 7
+SIM_BLACKLIST_SLOTS = 2000
+
+
+def link(slot, channel, listening):
+	"""Return (tx_attempts, success) of a packet sent in the slot."""
+	if not listening:
+		return (4, False)
+	if channel in SIM_BAD:
+		return (3, True) if slot % 3 == 0 else (4, False)
+	return (1, True)
+
+
+def simulate():
+	ptx = Hop(SIM_CHANNELS, SIM_SEED, blacklist_slots=SIM_BLACKLIST_SLOTS)
+	prx = Hop(SIM_CHANNELS, SIM_SEED, blacklist_slots=SIM_BLACKLIST_SLOTS)
+	missed = 0
+	parked = False
+	updates = 0
+	resync_slot = 0
+	lost = False
+
+	for slot in range(SIM_SLOTS):
+		stalled = SIM_STALL_START <= slot < SIM_STALL_START + SIM_STALL_LEN
+		ch = ptx.channel()
+		listening = not stalled and prx.channel() == ch
+		attempts, success = link(slot, ch, listening)
+
+		ptx.tx_result(ch, attempts, success)
+		if success:
+			prx.sync_info_apply(ptx.sync_info_get())
+			if lost:
+				resync_slot = slot
+				lost = False
+			missed = 0
+			parked = False
+		elif not stalled:
+			missed += 1
+
+		if stalled:
+			lost = True
+
+		if slot % SIM_UPDATE_PERIOD == 0 and ptx.map_update():
+			updates += 1
+
+		ptx.next()
+		if stalled:
+			continue
+		if parked:
+			# Move to another channel if nothing was received for
+			# a whole cycle.
+			if missed % len(prx.seq) == 0:
+				prx.next()
+		else:
+			prx.next()
+			if missed >= len(prx.seq):
+				parked = True
+
+	assert ptx.slot == prx.slot
+	assert ptx.map == prx.map
+	return ptx, updates, resync_slot
+
+
+def c_array(ctype, name, array):
+	return "static const %s %s[] = {%s};%s" % (
+		ctype, name, ", ".join([str(c) for c in array]), ls)
+
+
+def c_map(channels):
+	chmap = [0] * MAP_SIZE
+	for ch in channels:
+		chmap[ch // 8] |= 1 << (ch % 8)
+	return chmap
+
+
+if __name__ == "__main__":
+	out = ("/*" + ls +
+	       " * Copyright (c) 2019 Nordic Semiconductor ASA" + ls +
+	       " *" + ls +
+	       " * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic" + ls +
+	       " */" + ls + ls +
+	       "/* Generated by test_generator.py, do not edit. */" + ls + ls)
+
+	seq_params = [
+		("seq_all", list(range(CHANNEL_COUNT)), 0),
+		("seq_even", list(range(0, 81, 2)), 1),
+		("seq_three", [5, 50, 100], 0xDEADBEEF),
+	]
+	for name, channels, seed in seq_params:
+		hop = Hop(channels, seed)
+		out += "#define %s_SEED %su" % (name.upper(), seed) + ls
+		out += c_array("u8_t", name + "_map", c_map(channels))
+		out += c_array("u8_t", name, hop.seq) + ls
+
+	hop = Hop(list(range(0, 81, 2)), 1)
+	sync_vec = []
+	rnd = random.Random(1)
+	for _ in range(16):
+		hop.slot = rnd.randrange(0, 200)
+		channel = rnd.choice(hop.seq)
+		start = hop.slot
+		hop.sync(channel)
+		sync_vec += [start, channel, hop.slot]
+	out += c_array("u32_t", "sync_vec", sync_vec) + ls
+
+	hop = Hop(list(range(CHANNEL_COUNT)), 0)
+	per_vec = []
+	for _ in range(64):
+		ch = rnd.randrange(0, 4)
+		attempts = rnd.randrange(1, 16)
+		success = rnd.randrange(0, 4) != 0
+		hop.tx_result(ch, attempts, success)
+		per_vec += [ch, attempts, int(success), hop.per[ch]]
+	out += c_array("u32_t", "per_vec", per_vec) + ls
+
+	ptx, updates, resync_slot = simulate()
+	out += "#define SIM_UPDATES %d" % updates + ls
+	out += "#define SIM_RESYNC_SLOT %d" % resync_slot + ls
+	out += c_array("u8_t", "sim_map", c_map(ptx.map))
+	out += c_array("u8_t", "sim_per", ptx.per[:81])
+
+	with open("test_vector.c", "w") as f:
+		f.write(out)
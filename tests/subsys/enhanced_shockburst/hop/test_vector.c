@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Generated by test_generator.py, do not edit. */
+
+#define SEQ_ALL_SEED 0u
+static const u8_t seq_all_map[] = {255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 31};
+static const u8_t seq_all[] = {32, 95, 9, 37, 58, 38, 19, 44, 87, 17, 63, 30, 8, 51, 82, 29, 26, 93, 84, 34, 72, 100, 60, 55, 5, 98, 70, 31, 27, 22, 80, 73, 56, 64, 49, 4, 76, 97, 85, 96, 78, 23, 6, 1, 54, 18, 50, 42, 13, 86, 91, 33, 62, 65, 0, 10, 45, 15, 28, 2, 57, 25, 69, 59, 12, 90, 52, 11, 94, 43, 67, 74, 71, 16, 48, 83, 47, 21, 66, 79, 7, 89, 99, 81, 20, 68, 92, 46, 36, 53, 40, 41, 24, 75, 77, 3, 61, 14, 88, 35, 39};
+
+#define SEQ_EVEN_SEED 1u
+static const u8_t seq_even_map[] = {85, 85, 85, 85, 85, 85, 85, 85, 85, 85, 1, 0, 0};
+static const u8_t seq_even[] = {60, 2, 6, 36, 44, 68, 76, 58, 70, 48, 64, 12, 4, 66, 20, 78, 80, 22, 72, 52, 74, 56, 26, 0, 24, 38, 10, 28, 34, 46, 50, 40, 16, 8, 14, 32, 54, 62, 42, 18, 30};
+
+#define SEQ_THREE_SEED 3735928559u
+static const u8_t seq_three_map[] = {32, 0, 0, 0, 0, 0, 4, 0, 0, 0, 0, 0, 16};
+static const u8_t seq_three[] = {50, 100, 5};
+
+static const u32_t sync_vec[] = {34, 54, 36, 195, 44, 209, 65, 58, 48, 126, 34, 110, 120, 24, 106, 53, 76, 47, 124, 2, 124, 99, 28, 109, 155, 60, 164, 178, 34, 192, 68, 20, 55, 151, 76, 170, 81, 2, 83, 5, 2, 1, 166, 14, 157, 2, 24, 24};
+
+static const u32_t per_vec[] = {1, 7, 0, 31, 1, 13, 1, 56, 3, 9, 1, 28, 2, 4, 1, 23, 3, 5, 0, 56, 3, 14, 0, 80, 1, 11, 1, 77, 0, 12, 1, 29, 3, 9, 1, 98, 2, 5, 1, 45, 3, 10, 0, 117, 3, 4, 1, 126, 3, 11, 1, 139, 2, 9, 1, 67, 0, 8, 0, 57, 1, 9, 1, 95, 2, 8, 0, 90, 3, 1, 1, 121, 3, 11, 1, 134, 1, 9, 1, 111, 0, 13, 1, 79, 1, 7, 1, 124, 2, 8, 1, 106, 0, 7, 1, 96, 1, 7, 0, 140, 3, 14, 1, 146, 1, 9, 1, 150, 3, 14, 1, 157, 3, 6, 0, 169, 2, 8, 0, 124, 1, 11, 1, 160, 1, 14, 0, 171, 2, 1, 0, 140, 0, 14, 0, 115, 3, 1, 1, 147, 1, 5, 0, 181, 1, 6, 1, 184, 0, 3, 1, 121, 2, 9, 1, 150, 2, 11, 1, 160, 3, 12, 1, 157, 3, 8, 0, 169, 0, 5, 1, 131, 2, 7, 1, 167, 2, 2, 1, 162, 1, 10, 1, 189, 0, 4, 0, 146, 3, 3, 0, 179, 1, 8, 1, 193, 1, 11, 1, 197, 1, 9, 0, 204, 3, 11, 1, 185, 3, 1, 1, 161, 1, 4, 0, 210, 2, 2, 0, 173, 2, 15, 1, 181, 1, 7, 1, 211, 1, 1, 0, 216, 1, 15, 1, 218, 1, 14, 0, 222, 3, 4, 1, 164, 0, 4, 1, 151, 1, 8, 0, 226, 3, 5, 1, 169};
+
+#define SIM_UPDATES 10
+#define SIM_RESYNC_SLOT 1032
+static const u8_t sim_map[] = {68, 64, 68, 4, 68, 68, 64, 68, 4, 68, 0, 0, 0};
+static const u8_t sim_per[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 143, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 132, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 155, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 147, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Subset of the BSD library sockets used to read the IMEI from the modem. */
+
+#ifndef NRF_SOCKET_MOCK_H__
+#define NRF_SOCKET_MOCK_H__
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define NRF_AF_LTE	102
+#define NRF_PROTO_AT	513
+
+int nrf_socket(int family, int type, int protocol);
+ssize_t nrf_write(int fd, const void *buf, size_t len);
+ssize_t nrf_read(int fd, void *buf, size_t len);
+int nrf_close(int fd);
+
+#endif /* NRF_SOCKET_MOCK_H__ */
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+
+#include "bifravst_cloud.c"
+
+#define IMEI		"352656100000000"
+#define QUEUE_SIZE	CONFIG_BIFRAVST_CLOUD_SEND_QUEUE_SIZE
+#define PUBLISH_MAX	16
+
+/* Messages handed to the simulated MQTT client. */
+static struct {
+	u16_t id;
+	enum mqtt_qos qos;
+	bool dup;
+	char data[16];
+} published[PUBLISH_MAX];
+static size_t publish_cnt;
+static int subscribe_cnt;
+
+/* Events received by the application. */
+static struct cloud_backend *backend;
+static u16_t sent_ids[PUBLISH_MAX];
+static size_t sent_cnt;
+
+int nrf_socket(int family, int type, int protocol)
+{
+	return 1;
+}
+
+ssize_t nrf_write(int fd, const void *buf, size_t len)
+{
+	return len;
+}
+
+ssize_t nrf_read(int fd, void *buf, size_t len)
+{
+	memcpy(buf, IMEI, MIN(len, strlen(IMEI)));
+
+	return MIN(len, strlen(IMEI));
+}
+
+int nrf_close(int fd)
+{
+	return 0;
+}
+
+void mqtt_client_init(struct mqtt_client *c)
+{
+}
+
+int mqtt_connect(struct mqtt_client *c)
+{
+	return 0;
+}
+
+int mqtt_disconnect(struct mqtt_client *c)
+{
+	return 0;
+}
+
+int mqtt_publish(struct mqtt_client *c,
+		 const struct mqtt_publish_param *param)
+{
+	zassert_true(publish_cnt < PUBLISH_MAX, "Too many publications");
+
+	published[publish_cnt].id = param->message_id;
+	published[publish_cnt].qos = param->message.topic.qos;
+	published[publish_cnt].dup = param->dup_flag;
+	memset(published[publish_cnt].data, 0,
+	       sizeof(published[publish_cnt].data));
+	memcpy(published[publish_cnt].data, param->message.payload.data,
+	       MIN(param->message.payload.len,
+		   sizeof(published[publish_cnt].data) - 1));
+	publish_cnt++;
+
+	return 0;
+}
+
+int mqtt_publish_qos2_release(struct mqtt_client *c,
+			      const struct mqtt_pubrel_param *param)
+{
+	return 0;
+}
+
+int mqtt_subscribe(struct mqtt_client *c,
+		   const struct mqtt_subscription_list *param)
+{
+	subscribe_cnt++;
+
+	return 0;
+}
+
+int mqtt_input(struct mqtt_client *c)
+{
+	return 0;
+}
+
+int mqtt_live(struct mqtt_client *c)
+{
+	return 0;
+}
+
+int mqtt_readall_publish_payload(struct mqtt_client *c, u8_t *buffer,
+				 size_t length)
+{
+	return 0;
+}
+
+static void cloud_event_handler(const struct cloud_backend *const backend,
+				const struct cloud_event *const evt,
+				void *user_data)
+{
+	if (evt->type == CLOUD_EVT_DATA_SENT) {
+		zassert_true(sent_cnt < ARRAY_SIZE(sent_ids), NULL);
+		sent_ids[sent_cnt++] = evt->data.msg.id;
+	}
+}
+
+/* Events from the broker, as the MQTT library reports them. */
+static void broker_connack(bool session_present)
+{
+	struct mqtt_evt evt = {
+		.type = MQTT_EVT_CONNACK,
+		.param.connack.session_present_flag = session_present
+	};
+
+	mqtt_evt_handler(&client, &evt);
+}
+
+static void broker_disconnect(void)
+{
+	struct mqtt_evt evt = {
+		.type = MQTT_EVT_DISCONNECT
+	};
+
+	mqtt_evt_handler(&client, &evt);
+}
+
+static void broker_puback(u16_t id)
+{
+	struct mqtt_evt evt = {
+		.type = MQTT_EVT_PUBACK,
+		.param.puback.message_id = id
+	};
+
+	mqtt_evt_handler(&client, &evt);
+}
+
+static int msg_send(char *data, enum cloud_qos qos, u16_t *id)
+{
+	struct cloud_msg msg = {
+		.buf = data,
+		.len = strlen(data),
+		.qos = qos,
+		.endpoint.type = CLOUD_EP_TOPIC_MSG
+	};
+	int err;
+
+	err = cloud_send_async(backend, &msg);
+	if ((err == 0) && id) {
+		*id = msg.id;
+	}
+
+	return err;
+}
+
+static void setup(void)
+{
+	backend = cloud_get_binding("BIFRAVST_CLOUD");
+	zassert_not_null(backend, "Backend not found");
+	zassert_equal(cloud_init(backend, cloud_event_handler), 0, NULL);
+
+	publish_cnt = 0;
+	subscribe_cnt = 0;
+	sent_cnt = 0;
+
+	broker_connack(false);
+	zassert_equal(subscribe_cnt, 1, "Not subscribed");
+}
+
+static void teardown(void)
+{
+	/* Messages left in the queue are dropped. */
+	broker_disconnect();
+
+	for (u32_t i = queue_head; i != queue_tail; i++) {
+		k_free(send_queue[i % ARRAY_SIZE(send_queue)].buf);
+	}
+
+	queue_head = 0;
+	queue_next = 0;
+	queue_tail = 0;
+}
+
+static void test_qos0(void)
+{
+	u16_t id;
+
+	zassert_equal(msg_send("qos0", CLOUD_QOS_AT_MOST_ONCE, &id), 0,
+		      NULL);
+	zassert_equal(publish_cnt, 1, "Not published");
+	zassert_equal(published[0].id, id, NULL);
+	zassert_false(published[0].dup, NULL);
+
+	/* Completed from cloud_input(), not while being queued. */
+	zassert_equal(sent_cnt, 0, "Sent notified from cloud_send_async()");
+	zassert_equal(cloud_input(backend), 0, NULL);
+	zassert_equal(sent_cnt, 1, "Sent not notified");
+	zassert_equal(sent_ids[0], id, NULL);
+
+	zassert_equal(cloud_input(backend), 0, NULL);
+	zassert_equal(sent_cnt, 1, "Sent notified twice");
+	zassert_equal(queue_head, queue_tail, "Message left in the queue");
+}
+
+static void test_qos1(void)
+{
+	u16_t id[2];
+
+	zassert_equal(msg_send("first", CLOUD_QOS_AT_LEAST_ONCE, &id[0]), 0,
+		      NULL);
+	zassert_equal(msg_send("second", CLOUD_QOS_AT_LEAST_ONCE, &id[1]), 0,
+		      NULL);
+	zassert_not_equal(id[0], id[1], "Message IDs not unique");
+	zassert_equal(publish_cnt, 2, NULL);
+
+	zassert_equal(cloud_input(backend), 0, NULL);
+	zassert_equal(sent_cnt, 0, "Sent without acknowledgment");
+
+	/* Acknowledgments may come in any order. */
+	broker_puback(id[1]);
+	zassert_equal(sent_cnt, 1, NULL);
+	zassert_equal(sent_ids[0], id[1], NULL);
+	zassert_not_equal(queue_head, queue_tail, "First message dropped");
+
+	broker_puback(id[1]);
+	zassert_equal(sent_cnt, 1, "Duplicate acknowledgment notified");
+
+	broker_puback(id[0]);
+	zassert_equal(sent_cnt, 2, NULL);
+	zassert_equal(sent_ids[1], id[0], NULL);
+	zassert_equal(queue_head, queue_tail, "Messages left in the queue");
+}
+
+static void test_reconnect(void)
+{
+	u16_t id[3];
+
+	zassert_equal(msg_send("qos1", CLOUD_QOS_AT_LEAST_ONCE, &id[0]), 0,
+		      NULL);
+	zassert_equal(msg_send("qos0", CLOUD_QOS_AT_MOST_ONCE, &id[1]), 0,
+		      NULL);
+	zassert_equal(publish_cnt, 2, NULL);
+
+	/* Connection is lost before any of them is acknowledged. */
+	broker_disconnect();
+	zassert_equal(msg_send("queued", CLOUD_QOS_AT_LEAST_ONCE, &id[2]), 0,
+		      NULL);
+	zassert_equal(publish_cnt, 2, "Published while disconnected");
+
+	broker_connack(false);
+	zassert_equal(subscribe_cnt, 2, NULL);
+	zassert_equal(cloud_input(backend), 0, NULL);
+
+	/* Unacknowledged message is published again as a duplicate. The QoS
+	 * 0 message was handed to the transport and is not published again.
+	 */
+	zassert_equal(publish_cnt, 4, NULL);
+	zassert_equal(published[2].id, id[0], NULL);
+	zassert_true(published[2].dup, "DUP flag not set");
+	zassert_equal(strcmp(published[2].data, "qos1"), 0, NULL);
+	zassert_equal(published[3].id, id[2], NULL);
+	zassert_false(published[3].dup, "DUP flag set on first publication");
+	zassert_equal(sent_cnt, 1, NULL);
+	zassert_equal(sent_ids[0], id[1], NULL);
+
+	broker_puback(id[0]);
+	broker_puback(id[2]);
+	zassert_equal(sent_cnt, 3, NULL);
+	zassert_equal(queue_head, queue_tail, "Messages left in the queue");
+}
+
+static void test_full_queue(void)
+{
+	u16_t id[QUEUE_SIZE];
+
+	broker_disconnect();
+
+	for (size_t i = 0; i < QUEUE_SIZE; i++) {
+		zassert_equal(msg_send("data", CLOUD_QOS_AT_LEAST_ONCE,
+				       &id[i]), 0, NULL);
+	}
+
+	zassert_equal(msg_send("full", CLOUD_QOS_AT_LEAST_ONCE, NULL),
+		      -ENOBUFS, "Message queued in full queue");
+	zassert_equal(msg_send("full", CLOUD_QOS_AT_MOST_ONCE, NULL),
+		      -ENOBUFS, "Message queued in full queue");
+
+	broker_connack(false);
+	zassert_equal(cloud_input(backend), 0, NULL);
+	zassert_equal(publish_cnt, QUEUE_SIZE, NULL);
+
+	/* Acknowledged message makes room for a new one. */
+	broker_puback(id[0]);
+	zassert_equal(msg_send("more", CLOUD_QOS_AT_LEAST_ONCE, NULL), 0,
+		      NULL);
+	zassert_equal(publish_cnt, QUEUE_SIZE + 1, NULL);
+	zassert_equal(strcmp(published[QUEUE_SIZE].data, "more"), 0, NULL);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(bifravst_cloud_test,
+			 ztest_unit_test_setup_teardown(test_qos0,
+							setup, teardown),
+			 ztest_unit_test_setup_teardown(test_qos1,
+							setup, teardown),
+			 ztest_unit_test_setup_teardown(test_reconnect,
+							setup, teardown),
+			 ztest_unit_test_setup_teardown(test_full_queue,
+							setup, teardown)
+			 );
+
+	ztest_run_test_suite(bifravst_cloud_test);
+}
@@ -0,0 +1,528 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+#include <string.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <ztest.h>
+#include <net/coap.h>
+#include <net/socket.h>
+#include <net/cloud.h>
+
+#define SERVER_PORT 5683
+#define SERVER_STACK_SIZE 2048
+#define SERVER_PRIORITY 5
+#define SERVER_BUF_SIZE 1280
+#define SERVER_BLOCK_SZX 4 /* 256 bytes */
+
+/* Waits until the server thread has processed the expected messages. */
+#define SERVER_WAIT(cond)						\
+	do {								\
+		for (int i = 0; (i < 200) && !(cond); i++) {		\
+			k_sleep(K_MSEC(10));				\
+		}							\
+	} while (0)
+
+#define BLOCK_VALUE(num, more, szx) (((num) << 4) | ((more) << 3) | (szx))
+#define BLOCK_BYTES(szx) (16 << (szx))
+
+/* Local CoAP server standing in for the cloud. */
+static struct {
+	int sock;
+	struct sockaddr client;
+	socklen_t client_len;
+
+	/* Configuration resource and its observer. */
+	u8_t cfg[1024];
+	size_t cfg_len;
+	bool observed;
+	u8_t observe_token[8];
+	u8_t observe_token_len;
+	u16_t next_id;
+
+	/* Last request with data. */
+	char path[16];
+	u8_t type;
+	u8_t data[4096];
+	size_t data_len;
+	int blocks;
+
+	bool drop_next_con;
+	int dropped;
+	/* Respond to data with an empty ACK and a separate response. */
+	bool separate;
+	/* Last confirmable message sent, to retransmit it. */
+	u8_t last_con[SERVER_BUF_SIZE];
+	size_t last_con_len;
+	int acks;
+	int resets;
+} srv;
+
+static u8_t srv_buf[SERVER_BUF_SIZE];
+static u8_t srv_tx_buf[SERVER_BUF_SIZE];
+
+/* Events received by the application. */
+static struct cloud_backend *backend;
+static int evt_count[CLOUD_EVT_COUNT];
+static u8_t evt_data[2048];
+static size_t evt_data_len;
+
+static u32_t option_int_get(const struct coap_packet *pkt, u16_t code,
+			    bool *found)
+{
+	struct coap_option option;
+
+	*found = (coap_find_options(pkt, code, &option, 1) == 1);
+
+	return *found ? coap_option_value_to_int(&option) : 0;
+}
+
+static void srv_reply(u8_t type, u16_t id, const u8_t *token,
+		      u8_t token_len, u8_t code, int observe, int block1,
+		      int block2, const u8_t *payload, size_t payload_len)
+{
+	struct coap_packet pkt;
+
+	if (coap_packet_init(&pkt, srv_tx_buf, sizeof(srv_tx_buf), 1, type,
+			     token_len, (u8_t *)token, code, id) < 0) {
+		return;
+	}
+	if (observe >= 0) {
+		coap_append_option_int(&pkt, COAP_OPTION_OBSERVE, observe);
+	}
+	if (block2 >= 0) {
+		coap_append_option_int(&pkt, COAP_OPTION_BLOCK2, block2);
+	}
+	if (block1 >= 0) {
+		coap_append_option_int(&pkt, COAP_OPTION_BLOCK1, block1);
+	}
+	if (payload_len > 0) {
+		coap_packet_append_payload_marker(&pkt);
+		coap_packet_append_payload(&pkt, (u8_t *)payload,
+					   payload_len);
+	}
+
+	if (type == COAP_TYPE_CON) {
+		memcpy(srv.last_con, pkt.data, pkt.offset);
+		srv.last_con_len = pkt.offset;
+	}
+
+	sendto(srv.sock, pkt.data, pkt.offset, 0, &srv.client,
+	       srv.client_len);
+}
+
+static void srv_resend(void)
+{
+	sendto(srv.sock, srv.last_con, srv.last_con_len, 0, &srv.client,
+	       srv.client_len);
+}
+
+static void srv_cfg_handle(const struct coap_packet *pkt, u8_t type,
+			   u16_t id, const u8_t *token, u8_t token_len)
+{
+	bool has_observe;
+	bool has_block2;
+	u32_t observe = option_int_get(pkt, COAP_OPTION_OBSERVE,
+				       &has_observe);
+	u32_t block2 = option_int_get(pkt, COAP_OPTION_BLOCK2, &has_block2);
+	u8_t szx = SERVER_BLOCK_SZX;
+	u32_t num = 0;
+	size_t offset;
+	size_t len;
+
+	if (has_observe && (observe == 1)) {
+		srv.observed = false;
+		return;
+	}
+
+	if (has_observe && (observe == 0)) {
+		srv.observed = true;
+		memcpy(srv.observe_token, token, token_len);
+		srv.observe_token_len = token_len;
+	}
+
+	if (has_block2) {
+		szx = MIN(szx, block2 & 0x07);
+		num = block2 >> 4;
+	}
+
+	offset = num * BLOCK_BYTES(szx);
+	len = MIN(BLOCK_BYTES(szx), srv.cfg_len - offset);
+
+	srv_reply(type == COAP_TYPE_CON ? COAP_TYPE_ACK : COAP_TYPE_NON_CON,
+		  type == COAP_TYPE_CON ? id : srv.next_id++,
+		  token, token_len, COAP_RESPONSE_CODE_CONTENT,
+		  (has_observe && (observe == 0)) ? 1 : -1, -1,
+		  BLOCK_VALUE(num, (offset + len) < srv.cfg_len, szx),
+		  &srv.cfg[offset], len);
+}
+
+static void srv_data_handle(const struct coap_packet *pkt, u8_t type,
+			    u16_t id, const u8_t *token, u8_t token_len)
+{
+	bool has_block1;
+	u32_t block1 = option_int_get(pkt, COAP_OPTION_BLOCK1, &has_block1);
+	const u8_t *payload;
+	u16_t payload_len;
+	size_t offset = 0;
+	u8_t code = COAP_RESPONSE_CODE_CHANGED;
+
+	payload = coap_packet_get_payload(pkt, &payload_len);
+	if (!payload) {
+		payload_len = 0;
+	}
+
+	if (has_block1) {
+		offset = (block1 >> 4) * BLOCK_BYTES(block1 & 0x07);
+		if (block1 & 0x08) {
+			code = COAP_RESPONSE_CODE_CONTINUE;
+		}
+	}
+
+	if (offset + payload_len > sizeof(srv.data)) {
+		return;
+	}
+
+	memcpy(&srv.data[offset], payload, payload_len);
+	srv.data_len = offset + payload_len;
+	srv.type = type;
+	srv.blocks++;
+
+	if ((type == COAP_TYPE_CON) && srv.separate) {
+		srv_reply(COAP_TYPE_ACK, id, NULL, 0, COAP_CODE_EMPTY, -1, -1,
+			  -1, NULL, 0);
+		srv_reply(COAP_TYPE_CON, srv.next_id++, token, token_len, code,
+			  -1, has_block1 ? (int)block1 : -1, -1, NULL, 0);
+	} else if (type == COAP_TYPE_CON) {
+		srv_reply(COAP_TYPE_ACK, id, token, token_len, code, -1,
+			  has_block1 ? (int)block1 : -1, -1, NULL, 0);
+	}
+}
+
+static void srv_request_handle(u8_t *buf, size_t len)
+{
+	struct coap_packet pkt;
+	struct coap_option path;
+	u8_t token[8];
+	u8_t token_len;
+	u8_t type;
+	u8_t code;
+	u16_t id;
+
+	if (coap_packet_parse(&pkt, buf, len, NULL, 0) < 0) {
+		return;
+	}
+
+	type = coap_header_get_type(&pkt);
+	code = coap_header_get_code(&pkt);
+	id = coap_header_get_id(&pkt);
+	token_len = coap_header_get_token(&pkt, token);
+
+	if (code == COAP_CODE_EMPTY) {
+		if (type == COAP_TYPE_ACK) {
+			srv.acks++;
+		} else if (type == COAP_TYPE_RESET) {
+			srv.resets++;
+		}
+		return;
+	}
+
+	if ((type == COAP_TYPE_CON) && srv.drop_next_con) {
+		srv.drop_next_con = false;
+		srv.dropped++;
+		return;
+	}
+
+	if (coap_find_options(&pkt, COAP_OPTION_URI_PATH, &path, 1) != 1) {
+		return;
+	}
+
+	memset(srv.path, 0, sizeof(srv.path));
+	memcpy(srv.path, path.value, MIN(path.len, sizeof(srv.path) - 1));
+
+	if (code == COAP_METHOD_GET) {
+		srv_cfg_handle(&pkt, type, id, token, token_len);
+	} else {
+		srv_data_handle(&pkt, type, id, token, token_len);
+	}
+}
+
+static void srv_thread(void)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(SERVER_PORT),
+	};
+
+	inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+	srv.sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if ((srv.sock < 0) ||
+	    bind(srv.sock, (struct sockaddr *)&addr, sizeof(addr))) {
+		printk("Local CoAP server not started\n");
+		return;
+	}
+
+	while (true) {
+		int len;
+
+		srv.client_len = sizeof(srv.client);
+		len = recvfrom(srv.sock, srv_buf, sizeof(srv_buf), 0,
+			       &srv.client, &srv.client_len);
+		if (len > 0) {
+			srv_request_handle(srv_buf, len);
+		}
+	}
+}
+
+K_THREAD_DEFINE(srv_tid, SERVER_STACK_SIZE, srv_thread, NULL, NULL, NULL,
+		SERVER_PRIORITY, 0, K_NO_WAIT);
+
+static void srv_notify(u32_t seq, bool more)
+{
+	size_t len = more ? BLOCK_BYTES(SERVER_BLOCK_SZX) : srv.cfg_len;
+
+	srv_reply(COAP_TYPE_CON, srv.next_id++, srv.observe_token,
+		  srv.observe_token_len, COAP_RESPONSE_CODE_CONTENT, seq, -1,
+		  more ? BLOCK_VALUE(0, 1, SERVER_BLOCK_SZX) : -1,
+		  srv.cfg, len);
+}
+
+static void cfg_set(size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		srv.cfg[i] = 'a' + (i % 26);
+	}
+	srv.cfg_len = len;
+}
+
+static void cloud_event_handler(const struct cloud_backend *const backend,
+				const struct cloud_event *const evt,
+				void *user_data)
+{
+	evt_count[evt->type]++;
+
+	if (evt->type == CLOUD_EVT_DATA_RECEIVED) {
+		zassert_true(evt->data.msg.len <= sizeof(evt_data), "");
+		zassert_equal(evt->data.msg.buf[evt->data.msg.len], '\0',
+			      "Data not terminated");
+		memcpy(evt_data, evt->data.msg.buf, evt->data.msg.len);
+		evt_data_len = evt->data.msg.len;
+	}
+}
+
+/* Waits for a message from the server and processes it. */
+static void cloud_wait_and_input(void)
+{
+	struct pollfd fds = {
+		.fd = backend->config->socket,
+		.events = POLLIN
+	};
+
+	zassert_equal(poll(&fds, 1, 2000), 1, "No data from server");
+	zassert_equal(cloud_input(backend), 0, "");
+}
+
+static void test_connect(void)
+{
+	int err;
+
+	cfg_set(40);
+
+	backend = cloud_get_binding("COAP_CLOUD");
+	zassert_not_null(backend, "Backend not found");
+
+	err = cloud_init(backend, cloud_event_handler);
+	zassert_equal(err, 0, "");
+
+	err = cloud_connect(backend);
+	zassert_equal(err, 0, "Not connected: %d", err);
+	zassert_true(backend->config->socket >= 0, "Socket not exposed");
+	zassert_equal(evt_count[CLOUD_EVT_CONNECTED], 1, "");
+	zassert_true(srv.observed, "Configuration not observed");
+	zassert_equal(evt_data_len, srv.cfg_len, "");
+	zassert_mem_equal(evt_data, srv.cfg, srv.cfg_len, "");
+}
+
+static void test_send_non_confirmable(void)
+{
+	char data[] = "{\"temp\":21}";
+	struct cloud_msg msg = {
+		.buf = data,
+		.len = strlen(data),
+		.qos = CLOUD_QOS_AT_MOST_ONCE,
+		.endpoint.type = CLOUD_EP_TOPIC_MSG
+	};
+	int sent = evt_count[CLOUD_EVT_DATA_SENT];
+
+	srv.data_len = 0;
+
+	zassert_equal(cloud_send(backend, &msg), 0, "");
+	zassert_equal(evt_count[CLOUD_EVT_DATA_SENT], sent + 1, "");
+
+	SERVER_WAIT(srv.data_len == msg.len);
+	zassert_equal(srv.type, COAP_TYPE_NON_CON, "");
+	zassert_equal(strcmp(srv.path, CONFIG_COAP_CLOUD_STATE_RESOURCE), 0,
+		      "");
+	zassert_equal(srv.data_len, msg.len, "");
+	zassert_mem_equal(srv.data, data, msg.len, "");
+}
+
+static void test_send_confirmable_retransmit(void)
+{
+	char data[] = "{\"bat\":3800}";
+	struct cloud_msg msg = {
+		.buf = data,
+		.len = strlen(data),
+		.qos = CLOUD_QOS_AT_LEAST_ONCE,
+		.endpoint.type = CLOUD_EP_TOPIC_MSG
+	};
+
+	srv.drop_next_con = true;
+	srv.dropped = 0;
+
+	zassert_equal(cloud_send(backend, &msg), 0, "");
+	zassert_equal(srv.dropped, 1, "First transmission not dropped");
+	zassert_equal(srv.type, COAP_TYPE_CON, "");
+	zassert_equal(srv.data_len, msg.len, "");
+	zassert_mem_equal(srv.data, data, msg.len, "");
+}
+
+static void test_duplicate_response(void)
+{
+	char data[] = "{\"bat\":3700}";
+	struct cloud_msg msg = {
+		.buf = data,
+		.len = strlen(data),
+		.qos = CLOUD_QOS_AT_LEAST_ONCE,
+		.endpoint.type = CLOUD_EP_TOPIC_MSG
+	};
+	int acks = srv.acks;
+	int resets = srv.resets;
+
+	srv.separate = true;
+	zassert_equal(cloud_send(backend, &msg), 0, "");
+	srv.separate = false;
+
+	/* Separate response is retransmitted as if the ACK was lost. The
+	 * request is completed, but the response must be acknowledged again.
+	 */
+	srv_resend();
+	cloud_wait_and_input();
+
+	SERVER_WAIT(srv.acks == acks + 2);
+	zassert_equal(srv.acks, acks + 2, "Duplicate not acknowledged");
+	zassert_equal(srv.resets, resets, "Duplicate rejected");
+}
+
+static void test_send_blockwise(void)
+{
+	static char data[2000];
+	struct cloud_msg msg = {
+		.buf = data,
+		.len = sizeof(data),
+		.qos = CLOUD_QOS_AT_MOST_ONCE,
+		.endpoint.type = CLOUD_EP_TOPIC_BATCH
+	};
+
+	for (size_t i = 0; i < sizeof(data); i++) {
+		data[i] = '0' + (i % 10);
+	}
+
+	srv.blocks = 0;
+
+	zassert_equal(cloud_send(backend, &msg), 0, "");
+	zassert_equal(srv.blocks,
+		      ceiling_fraction(sizeof(data),
+				       CONFIG_COAP_CLOUD_BLOCK_SIZE), "");
+	zassert_equal(strcmp(srv.path, CONFIG_COAP_CLOUD_BATCH_RESOURCE), 0,
+		      "");
+	zassert_equal(srv.data_len, sizeof(data), "");
+	zassert_mem_equal(srv.data, data, sizeof(data), "");
+}
+
+static void test_notification(void)
+{
+	int received = evt_count[CLOUD_EVT_DATA_RECEIVED];
+	int acks = srv.acks;
+
+	cfg_set(100);
+	srv_notify(2, false);
+	cloud_wait_and_input();
+
+	zassert_equal(evt_count[CLOUD_EVT_DATA_RECEIVED], received + 1, "");
+	zassert_equal(evt_data_len, srv.cfg_len, "");
+	zassert_mem_equal(evt_data, srv.cfg, srv.cfg_len, "");
+
+	/* Reordered notification is acknowledged, but not passed on. */
+	srv_notify(1, false);
+	cloud_wait_and_input();
+	zassert_equal(evt_count[CLOUD_EVT_DATA_RECEIVED], received + 1, "");
+
+	/* Duplicate is acknowledged again, but not passed on. */
+	cfg_set(50);
+	srv_resend();
+	cloud_wait_and_input();
+	zassert_equal(evt_count[CLOUD_EVT_DATA_RECEIVED], received + 1, "");
+
+	SERVER_WAIT(srv.acks == acks + 3);
+	zassert_equal(srv.acks, acks + 3, "Notifications not acknowledged");
+}
+
+static void test_notification_blockwise(void)
+{
+	int received = evt_count[CLOUD_EVT_DATA_RECEIVED];
+
+	cfg_set(700);
+	srv_notify(3, true);
+	cloud_wait_and_input();
+
+	zassert_equal(evt_count[CLOUD_EVT_DATA_RECEIVED], received + 1, "");
+	zassert_equal(evt_data_len, srv.cfg_len, "");
+	zassert_mem_equal(evt_data, srv.cfg, srv.cfg_len, "");
+}
+
+static void test_get_config(void)
+{
+	struct cloud_msg msg = {
+		.buf = "",
+		.len = 0,
+		.qos = CLOUD_QOS_AT_MOST_ONCE,
+		.endpoint.type = CLOUD_EP_TOPIC_PAIR
+	};
+
+	cfg_set(10);
+
+	zassert_equal(cloud_send(backend, &msg), 0, "");
+	zassert_equal(evt_data_len, srv.cfg_len, "");
+	zassert_mem_equal(evt_data, srv.cfg, srv.cfg_len, "");
+	zassert_true(srv.observed, "Observation cancelled by request");
+}
+
+static void test_disconnect(void)
+{
+	zassert_equal(cloud_disconnect(backend), 0, "");
+	zassert_equal(evt_count[CLOUD_EVT_DISCONNECTED], 1, "");
+
+	SERVER_WAIT(!srv.observed);
+	zassert_false(srv.observed, "Observation not cancelled");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(coap_cloud,
+			 ztest_unit_test(test_connect),
+			 ztest_unit_test(test_send_non_confirmable),
+			 ztest_unit_test(test_send_confirmable_retransmit),
+			 ztest_unit_test(test_duplicate_response),
+			 ztest_unit_test(test_send_blockwise),
+			 ztest_unit_test(test_notification),
+			 ztest_unit_test(test_notification_blockwise),
+			 ztest_unit_test(test_get_config),
+			 ztest_unit_test(test_disconnect)
+			 );
+
+	ztest_run_test_suite(coap_cloud);
+}
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2019 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <ztest.h>
+#include <errno.h>
+#include <string.h>
+#include <misc/util.h>
+#include <misc/byteorder.h>
+
+#include <nfc/ndef/msg_parser.h>
+
+#define MB_MASK			0x80
+#define ME_MASK			0x40
+
+#define RECORD_CNT_MAX		64
+#define TYPE_LEN_MAX		8
+#define ID_LEN_MAX		4
+#define PAYLOAD_LEN_MAX		300
+#define RECORD_LEN_MAX		(6 + TYPE_LEN_MAX + ID_LEN_MAX + \
+				 PAYLOAD_LEN_MAX)
+#define MSG_LEN_MAX		(RECORD_CNT_MAX * RECORD_LEN_MAX)
+
+#define FUZZ_CNT		2000
+#define BENCH_CNT		100
+
+static u8_t msg[MSG_LEN_MAX];
+static u8_t memo[NFC_NDEF_PARSER_REQIRED_MEMO_SIZE_CALC(RECORD_CNT_MAX)]
+	__aligned(4);
+static u32_t rnd_state = 1;
+
+static u32_t rnd(void)
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 17;
+	rnd_state ^= rnd_state << 5;
+
+	return rnd_state;
+}
+
+static u32_t record_put(u8_t *buf, u8_t flags, u8_t type_len, u8_t id_len,
+			u32_t payload_len)
+{
+	u8_t *p = buf;
+
+	if (payload_len <= UINT8_MAX && (rnd() & 1)) {
+		flags |= NDEF_RECORD_SR_MASK;
+	}
+	if (id_len || (rnd() & 1)) {
+		flags |= NDEF_RECORD_IL_MASK;
+	}
+
+	*p++ = flags;
+	*p++ = type_len;
+
+	if (flags & NDEF_RECORD_SR_MASK) {
+		*p++ = payload_len;
+	} else {
+		sys_put_be32(payload_len, p);
+		p += sizeof(u32_t);
+	}
+
+	if (flags & NDEF_RECORD_IL_MASK) {
+		*p++ = id_len;
+	}
+
+	for (u32_t i = 0; i < type_len + id_len + payload_len; i++) {
+		*p++ = rnd();
+	}
+
+	return p - buf;
+}
+
+/* Create a valid message with random records. */
+static u32_t msg_create(size_t record_cnt)
+{
+	u32_t len = 0;
+
+	for (size_t i = 0; i < record_cnt; i++) {
+		u8_t flags = rnd() % (TNF_UNCHANGED + 1);
+
+		if (i == 0) {
+			flags |= MB_MASK;
+		}
+		if (i == record_cnt - 1) {
+			flags |= ME_MASK;
+		}
+
+		len += record_put(&msg[len], flags, rnd() % (TYPE_LEN_MAX + 1),
+				  rnd() % (ID_LEN_MAX + 1),
+				  rnd() % (PAYLOAD_LEN_MAX + 1));
+	}
+
+	return len;
+}
+
+static void check_slice(const u8_t *ptr, u32_t len, u32_t data_len)
+{
+	if (len == 0) {
+		zassert_is_null(ptr, "Empty field not NULL");
+		return;
+	}
+
+	zassert_true((ptr >= msg) && (ptr + len <= msg + data_len),
+		     "Field outside of data");
+}
+
+/* Parse the data with both parsers and check that the results match. */
+static int parse_compare(u32_t data_len)
+{
+	const struct nfc_ndef_msg_desc *msg_desc =
+		(const struct nfc_ndef_msg_desc *)memo;
+	struct nfc_ndef_msg_iter iter;
+	struct nfc_ndef_record_view view;
+	u32_t memo_len = sizeof(memo);
+	u32_t parsed_len = data_len;
+	int err;
+	int iter_err;
+	u32_t cnt = 0;
+
+	err = nfc_ndef_msg_parse(memo, &memo_len, msg, &parsed_len);
+
+	nfc_ndef_msg_iter_init(&iter, msg, data_len);
+
+	while ((iter_err = nfc_ndef_msg_iter_next(&iter, &view)) == 0) {
+		check_slice(view.type, view.type_length, data_len);
+		check_slice(view.id, view.id_length, data_len);
+		check_slice(view.payload, view.payload_length, data_len);
+
+		if (cnt >= msg_desc->record_count) {
+			cnt++;
+			continue;
+		}
+
+		const struct nfc_ndef_record_desc *rec = msg_desc->record[cnt];
+		const struct nfc_ndef_bin_payload_desc *pay =
+			rec->payload_descriptor;
+
+		zassert_equal(view.tnf, rec->tnf, "Invalid TNF");
+		zassert_equal(view.type_length, rec->type_length,
+			      "Invalid type length");
+		zassert_equal(view.type, rec->type, "Invalid type");
+		zassert_equal(view.id_length, rec->id_length,
+			      "Invalid ID length");
+		zassert_equal(view.id, rec->id, "Invalid ID");
+		zassert_equal(view.payload_length, pay->payload_length,
+			      "Invalid payload length");
+		zassert_equal(view.payload, pay->payload, "Invalid payload");
+		cnt++;
+	}
+
+	if (err) {
+		zassert_equal(iter_err, err, "Different error");
+		return err;
+	}
+
+	zassert_equal(iter_err, -ENOENT, "Iteration not finished");
+	zassert_equal(cnt, msg_desc->record_count, "Invalid record count");
+	zassert_equal(iter.offset, parsed_len, "Invalid message length");
+
+	return 0;
+}
+
+static void test_records(void)
+{
+	static const u8_t uri_type[] = {'U'};
+	struct nfc_ndef_msg_iter iter;
+	struct nfc_ndef_record_view view;
+	u32_t len = 0;
+	u32_t text_end;
+
+	/* Well-known text record, URI record with ID and empty record. */
+	rnd_state = 1;
+	len += record_put(&msg[len], MB_MASK | TNF_WELL_KNOWN, 1, 0, 10);
+	msg[len - 11] = 'T';
+	text_end = len;
+	len += record_put(&msg[len], TNF_WELL_KNOWN, 1, 2, 300);
+	msg[len - 303] = 'U';
+	len += record_put(&msg[len], ME_MASK | TNF_EMPTY, 0, 0, 0);
+
+	nfc_ndef_msg_iter_init(&iter, msg, len + 5);
+
+	zassert_equal(nfc_ndef_msg_iter_next(&iter, &view), 0, "Parse failed");
+	zassert_equal(view.location, NDEF_FIRST_RECORD, "Invalid location");
+	zassert_equal(view.type[0], 'T', "Invalid type");
+	zassert_is_null(view.id, "Invalid ID");
+	zassert_equal(view.payload_length, 10, "Invalid payload length");
+	zassert_equal(view.payload, &msg[text_end - 10], "Invalid payload");
+
+	zassert_equal(nfc_ndef_msg_iter_next(&iter, &view), 0, "Parse failed");
+	zassert_equal(view.location, NDEF_MIDDLE_RECORD, "Invalid location");
+	zassert_equal(view.id_length, 2, "Invalid ID length");
+	zassert_equal(view.payload_length, 300, "Invalid payload length");
+
+	zassert_equal(nfc_ndef_msg_iter_next(&iter, &view), 0, "Parse failed");
+	zassert_equal(view.location, NDEF_LAST_RECORD, "Invalid location");
+	zassert_equal(view.tnf, TNF_EMPTY, "Invalid TNF");
+	zassert_is_null(view.payload, "Invalid payload");
+
+	zassert_equal(nfc_ndef_msg_iter_next(&iter, &view), -ENOENT,
+		      "Parsed after the last record");
+	zassert_equal(iter.record_count, 3, "Invalid record count");
+	zassert_equal(iter.offset, len, "Invalid message length");
+
+	/* Lookup stops at the matching record. */
+	nfc_ndef_msg_iter_init(&iter, msg, len);
+	zassert_equal(nfc_ndef_msg_record_find(&iter, TNF_WELL_KNOWN, uri_type,
+					       sizeof(uri_type), &view), 0,
+		      "Record not found");
+	zassert_equal(view.payload_length, 300, "Invalid record found");
+	zassert_equal(iter.record_count, 2, "Records parsed after match");
+	zassert_equal(nfc_ndef_msg_record_find(&iter, TNF_WELL_KNOWN, uri_type,
+					       sizeof(uri_type), &view),
+		      -ENOENT, "Record found twice");
+}
+
+static void test_invalid(void)
+{
+	struct nfc_ndef_msg_iter iter;
+	struct nfc_ndef_record_view view;
+	u32_t len;
+
+	/* Payload length that wraps the record size around. */
+	msg[0] = MB_MASK | ME_MASK | TNF_MEDIA_TYPE;
+	msg[1] = 4;
+	sys_put_be32(UINT32_MAX - 2, &msg[2]);
+	zassert_equal(parse_compare(16), -EINVAL, "Invalid length accepted");
+
+	/* Truncated record. */
+	rnd_state = 2;
+	len = msg_create(3);
+	zassert_equal(parse_compare(len), 0, "Parse failed");
+	zassert_equal(parse_compare(len - 1), -EINVAL, "Truncated accepted");
+
+	/* Missing message begin and end flags. */
+	msg[0] &= ~MB_MASK;
+	zassert_equal(parse_compare(len), -EFAULT, "Missing MB accepted");
+
+	len = msg_create(1);
+	msg[0] &= ~ME_MASK;
+	zassert_equal(parse_compare(len), -EFAULT, "Missing ME accepted");
+
+	nfc_ndef_msg_iter_init(&iter, msg, 0);
+	zassert_equal(nfc_ndef_msg_iter_next(&iter, &view), -EFAULT,
+		      "Empty data accepted");
+}
+
+/* Mutate valid messages and check that both parsers give the same result
+ * without accessing memory outside of the data.
+ */
+static void test_fuzz(void)
+{
+	size_t valid = 0;
+
+	rnd_state = 0x12345678;
+
+	for (size_t i = 0; i < FUZZ_CNT; i++) {
+		u32_t len = msg_create(1 + rnd() % 8);
+		size_t mutations = rnd() % 4;
+
+		for (size_t j = 0; j < mutations; j++) {
+			/* Headers are at the start of records, so mutate
+			 * the beginning of the message more often.
+			 */
+			u32_t pos = rnd() % ((rnd() & 1) ? len : 8);
+
+			msg[pos] ^= BIT(rnd() % 8);
+		}
+
+		if (rnd() % 4 == 0) {
+			len = rnd() % (len + 1);
+		}
+
+		if (parse_compare(len) == 0) {
+			valid++;
+		}
+	}
+
+	printk("Fuzzed %u messages, %u valid\n", FUZZ_CNT, (u32_t)valid);
+	zassert_true(valid > 0, "No valid message");
+	zassert_true(valid < FUZZ_CNT, "No invalid message");
+}
+
+static void test_benchmark(void)
+{
+	static const u8_t type[] = {'b', 'e', 'n', 'c', 'h'};
+	struct nfc_ndef_msg_iter iter;
+	struct nfc_ndef_record_view view;
+	u32_t parse_cycles = 0;
+	u32_t iter_cycles = 0;
+	u32_t find_cycles = 0;
+	u32_t len = 0;
+
+	/* Large message with the record to look up in the middle. */
+	rnd_state = 3;
+	for (size_t i = 0; i < RECORD_CNT_MAX; i++) {
+		u8_t flags = TNF_MEDIA_TYPE | ((i == 0) ? MB_MASK : 0) |
+			     ((i == RECORD_CNT_MAX - 1) ? ME_MASK : 0);
+		u32_t payload_len = rnd() % (PAYLOAD_LEN_MAX + 1);
+		u32_t rec_len = record_put(&msg[len], flags, sizeof(type), 0,
+					   payload_len);
+
+		if (i == RECORD_CNT_MAX / 2) {
+			memcpy(&msg[len + rec_len - payload_len - sizeof(type)],
+			       type, sizeof(type));
+		}
+		len += rec_len;
+	}
+
+	zassert_equal(parse_compare(len), 0, "Parse failed");
+
+	for (size_t n = 0; n < BENCH_CNT; n++) {
+		u32_t memo_len = sizeof(memo);
+		u32_t parsed_len = len;
+		u32_t start = k_cycle_get_32();
+
+		nfc_ndef_msg_parse(memo, &memo_len, msg, &parsed_len);
+
+		u32_t mid = k_cycle_get_32();
+
+		nfc_ndef_msg_iter_init(&iter, msg, len);
+		while (nfc_ndef_msg_iter_next(&iter, &view) == 0) {
+		}
+
+		u32_t end = k_cycle_get_32();
+
+		nfc_ndef_msg_iter_init(&iter, msg, len);
+		nfc_ndef_msg_record_find(&iter, TNF_MEDIA_TYPE, type,
+					 sizeof(type), &view);
+
+		parse_cycles += mid - start;
+		iter_cycles += end - mid;
+		find_cycles += k_cycle_get_32() - end;
+	}
+
+	printk("Parsed %u records %u times: parser %u cycles, "
+	       "iterator %u cycles, lookup %u cycles\n",
+	       RECORD_CNT_MAX, BENCH_CNT, parse_cycles, iter_cycles,
+	       find_cycles);
+	printk("Parser memory %u bytes, iterator memory %u bytes\n",
+	       (u32_t)sizeof(memo), (u32_t)(sizeof(iter) + sizeof(view)));
+}
+
+void test_main(void)
+{
+	ztest_test_suite(ndef_parser_tests,
+			 ztest_unit_test(test_records),
+			 ztest_unit_test(test_invalid),
+			 ztest_unit_test(test_fuzz),
+			 ztest_unit_test(test_benchmark)
+			 );
+
+	ztest_run_test_suite(ndef_parser_tests);
+}